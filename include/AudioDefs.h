@@ -1,70 +1,94 @@
 /*
- * AudioDefs.h - Audio File Definitions
- * ESP32-S3 Master only
+ * AudioDefs.h - Sound IDs and Sound Bank Index
+ * Host only
+ *
+ * GENERATED by scripts/copy_data.py from data_host/sounds.txt on every
+ * host_test build: edit the manifest, not this file.
+ *
+ * All clips are packed into SOUND_BANK_FILE on SPIFFS; a sound is played
+ * by seeking to its offset (SoundBank.h), not by looking up a path.
  */
 
 #ifndef AUDIODEFS_H
 #define AUDIODEFS_H
 
+#include <stdint.h>
+
 // =============================================================================
 // SOUND IDS
 // =============================================================================
-#define SND_NUM_1         1
-#define SND_NUM_2         2
-#define SND_NUM_3         3
-#define SND_NUM_4         4
-#define SND_NUM_10        5
-#define SND_NUM_15        6
-#define SND_NUM_20        7
-#define SND_GET_READY     8
-#define SND_PLAYER        10
-#define SND_READY         11
-#define SND_FASTEST       14
-#define SND_PRESS_TO_JOIN 15
-#define SND_REACTION_MODE 17
-#define SND_SHAKE_IT      19
-#define SND_GAME_OVER     22
-#define SND_WINS          23
-#define SND_BEEP          24
-#define SND_ERROR         25
-#define SND_VICTORY       27
+#define SND_BUTTON_CLICK      0
+#define SND_GET_READY         1
+#define SND_PRESS_TO_JOIN     2
+#define SND_READY             3
+#define SND_REACTION_MODE     4
+#define SND_REACTION_INSTRUCT 5
+#define SND_SHAKE_IT          6
+#define SND_YOU_WILL_SHAKE    7
+#define SND_NUM_10            8
+#define SND_NUM_15            9
+#define SND_NUM_20            10
+#define SND_BEEP              11
+#define SND_COUNTDOWN_3       12
+#define SND_COUNTDOWN_2       13
+#define SND_COUNTDOWN_1       14
+#define SND_FASTEST           15
+#define SND_PLAYER_1          16
+#define SND_PLAYER_2          17
+#define SND_PLAYER_3          18
+#define SND_PLAYER_4          19
+#define SND_WINS              20
+#define SND_VICTORY_FANFARE   21
+#define SND_GAME_OVER         22
+#define SND_ERROR_TONE        23
 
-#define NUM_SOUNDS        29
-#define AUDIO_QUEUE_SIZE  8
+#define NUM_SOUNDS            24
 
 // =============================================================================
-// FILE PATHS (SPIFFS)
+// SOUND BANK
 // =============================================================================
-static const char* const SOUND_FILES[NUM_SOUNDS] = {
-  "",             // 0 unused
-  "/1.mp3",       // 1
-  "/2.mp3",       // 2
-  "/3.mp3",       // 3
-  "/4.mp3",       // 4
-  "/10.mp3",      // 5
-  "/15.mp3",      // 6
-  "/20.mp3",      // 7
-  "/ready.mp3",   // 8
-  "/321go.mp3",   // 9
-  "/player.mp3",  // 10
-  "/joined.mp3",  // 11
-  "/disc.mp3",    // 12
-  "/slowest.mp3", // 13
-  "/fastest.mp3", // 14
-  "/join.mp3",    // 15
-  "/rule.mp3",    // 16
-  "/reaction.mp3",// 17
-  "/react_i.mp3", // 18
-  "/shake.mp3",   // 19
-  "/willshk.mp3", // 20
-  "/times.mp3",   // 21
-  "/over.mp3",    // 22
-  "/wins.mp3",    // 23
-  "/beep.mp3",    // 24
-  "/error.mp3",   // 25
-  "/tick.mp3",    // 26
-  "/victory.mp3", // 27
-  "/click.mp3",   // 28
+#define SOUND_BANK_FILE   "/sounds.bin"
+#define SOUND_BANK_SIZE   430097
+#define SOUND_BANK_CRC    0xED8B71AA
+#define SOUND_BANK_RATE   22050     // pcm and adpcm clips: mono at this rate
+
+#define SND_FMT_MP3       0
+#define SND_FMT_PCM       1
+#define SND_FMT_ADPCM     2
+
+typedef struct {
+  uint32_t offset;        // Bytes from the start of the bank
+  uint32_t length;
+  uint32_t frames;        // pcm, adpcm: samples (mp3: 0, not known)
+  uint8_t format;         // SND_FMT_
+  const char* name;       // File it was packed from, for logs
+} SoundEntry;
+
+static const SoundEntry SOUND_BANK[NUM_SOUNDS] = {
+  {       8,  35488,      0, SND_FMT_MP3, "click" },          // BUTTON_CLICK, 44100 Hz stereo
+  {   35496,   9508,      0, SND_FMT_MP3, "get_ready" },      // GET_READY, 22050 Hz mono
+  {   45004,  17347,      0, SND_FMT_MP3, "press_join" },     // PRESS_TO_JOIN, 22050 Hz mono
+  {   62351,   7736,      0, SND_FMT_MP3, "ready" },          // READY, 22050 Hz mono
+  {   70087,  12689,      0, SND_FMT_MP3, "reaction" },       // REACTION_MODE, 22050 Hz mono
+  {   82776,  44405,      0, SND_FMT_MP3, "react_inst" },     // REACTION_INSTRUCT, 22050 Hz mono
+  {  127181,   7838,      0, SND_FMT_MP3, "shake" },          // SHAKE_IT, 22050 Hz mono
+  {  135019,  43594,      0, SND_FMT_MP3, "will_shake" },     // YOU_WILL_SHAKE, 22050 Hz mono
+  {  178613,   9695,      0, SND_FMT_MP3, "num_10" },         // NUM_10, 22050 Hz mono
+  {  188308,  11311,      0, SND_FMT_MP3, "num_15" },         // NUM_15, 22050 Hz mono
+  {  199619,  13055,      0, SND_FMT_MP3, "num_20" },         // NUM_20, 22050 Hz mono
+  {  212674,  44464,      0, SND_FMT_MP3, "beep" },           // BEEP, 44100 Hz stereo
+  {  257138,   5654,      0, SND_FMT_MP3, "three" },          // COUNTDOWN_3, 22050 Hz mono
+  {  262792,   5754,      0, SND_FMT_MP3, "two" },            // COUNTDOWN_2, 22050 Hz mono
+  {  268546,   5129,      0, SND_FMT_MP3, "one" },            // COUNTDOWN_1, 22050 Hz mono
+  {  273675,   9649,      0, SND_FMT_MP3, "fastest" },        // FASTEST, 22050 Hz mono
+  {  283324,  13468,      0, SND_FMT_MP3, "player1" },        // PLAYER_1, 22050 Hz mono
+  {  296792,  13022,      0, SND_FMT_MP3, "player2" },        // PLAYER_2, 22050 Hz mono
+  {  309814,  12484,      0, SND_FMT_MP3, "player3" },        // PLAYER_3, 22050 Hz mono
+  {  322298,  12476,      0, SND_FMT_MP3, "player4" },        // PLAYER_4, 22050 Hz mono
+  {  334774,   4892,      0, SND_FMT_MP3, "wins" },           // WINS, 22050 Hz mono
+  {  339666,  33154,      0, SND_FMT_MP3, "victory" },        // VICTORY_FANFARE, 44100 Hz stereo
+  {  372820,  11561,      0, SND_FMT_MP3, "gameover" },       // GAME_OVER, 22050 Hz mono
+  {  384381,  45716,      0, SND_FMT_MP3, "error" },          // ERROR_TONE, 44100 Hz stereo
 };
 
 #endif // AUDIODEFS_H
@@ -0,0 +1,565 @@
+/*
+ * AudioEngine.h - Clip Sequencing into One Output Stream
+ * Host firmware and native builds
+ *
+ * The host plays one mono stream at AUDIO_RATE. Clips are pulled into it
+ * from decoders instead of each decoder pushing into I2S:
+ *   AudioDecoder    one clip: open() (seek, headers), read() frames
+ *   AudioSource     hands out pooled decoders by sound ID
+ *   AudioSink       takes as many frames as it has room for (I2S DMA)
+ *   AudioStream     blocks of the output stream, pulled by the pump
+ *   AudioSequencer  queued clips, back to back (an AudioStream)
+ *   AudioPump       stream → sink through one staging block
+ *
+ * Gapless: while a clip plays, the next one in the queue is already open
+ * (prefetched once the sink is full, so the open is paid for out of what
+ * the DMA holds, not at the boundary). When the current decoder runs out,
+ * the same fill() goes on with the next one, so the two clips meet inside
+ * one block, with no stop, restart or rate change of the output in
+ * between. Decoders come from the source's pool and go back to it:
+ * nothing is allocated per clip.
+ *
+ * Priorities: each queued sound has an AudioPriority and optionally a
+ * deadline (latest start). The queue is ordered by priority, FIFO among
+ * equals; a sound more important than the playing one cuts it (push()
+ * returns AUDIO_PUSH_PREEMPTED, and AudioPump::queue() flushes what the
+ * sink still holds of it). A sound that would start after its deadline is
+ * dropped instead of played late. A full queue drops its least important,
+ * newest entry for a more important one.
+ *
+ * Phrases: the words of one announcement (NumberSpeech.h) are queued as
+ * clips sharing a phrase ID. They play back to back like any clips; if one
+ * of them is cut, dropped or missing, the words after it go too, so a cue
+ * never leaves half a sentence to finish once it is over.
+ *
+ * Instrumentation:
+ * - Per boundary (a clip following another without the stream running
+ *   dry): the silent run where they meet, trailing silence of the first +
+ *   leading silence of the second, in frames (LOG AUDIO_GAP, getGapStats())
+ * - Per clip: queue-to-first-frame latency (getLatency())
+ * - Preempted, stale, evicted and rejected sounds (getQueueStats())
+ * - Phrases started and cut, queue-to-first-word latency (getPhraseStats())
+ */
+
+#ifndef AUDIO_ENGINE_H
+#define AUDIO_ENGINE_H
+
+#include <stdint.h>
+#include <string.h>
+#include "Log.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define AUDIO_RATE          22050   // Output: mono, every clip converted to it
+#define AUDIO_BLOCK_FRAMES  64      // Staging block (one DMA buffer)
+
+#ifndef AUDIO_QUEUE_SIZE
+#define AUDIO_QUEUE_SIZE    12      // Longest phrase + the fanfare + a cue
+#endif
+#define AUDIO_LATENCY_SLOTS 24      // Distinct clips with latency statistics
+#define AUDIO_SILENCE       48      // |sample| at or below is silence (gaps)
+
+// Higher cuts lower
+enum AudioPriority : uint8_t {
+  AUDIO_PRIO_LOW,         // Music, fanfares
+  AUDIO_PRIO_NORMAL,      // Voice prompts
+  AUDIO_PRIO_CUE          // Countdown, GO beep: their timing is the game
+};
+
+enum AudioPushResult : uint8_t {
+  AUDIO_PUSH_DROPPED,     // Queue full of sounds at least as important
+  AUDIO_PUSH_QUEUED,
+  AUDIO_PUSH_PREEMPTED    // Cut the playing clip
+};
+
+// =============================================================================
+// INTERFACES
+// =============================================================================
+class AudioDecoder {
+public:
+  virtual ~AudioDecoder() {}
+
+  // Locates and opens the clip; cheap enough to run while another plays
+  virtual bool open(uint8_t sound) = 0;
+
+  // Mono frames at AUDIO_RATE; fewer than asked only at the end
+  virtual uint32_t read(int16_t* out, uint32_t frames) = 0;
+
+  virtual void close() = 0;
+
+  // Padding frames dropped from this clip (encoder delay, filler)
+  virtual uint32_t trimmed() const { return 0; }
+};
+
+class AudioSource {
+public:
+  virtual ~AudioSource() {}
+
+  // A free pooled decoder, open on sound; nullptr if missing or none free
+  virtual AudioDecoder* open(uint8_t sound) = 0;
+  virtual void release(AudioDecoder* decoder) = 0;
+
+  // Decoded in RAM: starting it costs nothing
+  virtual bool cached(uint8_t sound) const { return false; }
+
+  // For logs
+  virtual const char* name(uint8_t sound) const = 0;
+};
+
+class AudioSink {
+public:
+  virtual ~AudioSink() {}
+
+  // Takes what fits, returns that count; never waits
+  virtual uint32_t write(const int16_t* frames, uint32_t count) = 0;
+
+  // Silences what was written and not played yet (preemption)
+  virtual void flush() {}
+};
+
+class AudioStream {
+public:
+  virtual ~AudioStream() {}
+
+  // Up to frames (at most AUDIO_BLOCK_FRAMES) of the stream; fewer only
+  // when it ran out
+  virtual uint32_t fill(int16_t* out, uint32_t frames, uint32_t nowUs) = 0;
+
+  // The sink is full: time to open what comes next
+  virtual void prefetch(uint32_t nowUs) {}
+};
+
+// =============================================================================
+// RAM CLIPS
+// =============================================================================
+typedef struct {
+  uint8_t sound;
+  int16_t* samples;       // Mono, AUDIO_RATE
+  uint32_t frames;
+} PcmClip;
+
+class PcmDecoder : public AudioDecoder {
+public:
+  PcmDecoder() : clip(nullptr), pos(0) {}
+
+  void load(const PcmClip* c) { clip = c; }
+
+  bool open(uint8_t sound) override {
+    pos = 0;
+    return clip != nullptr;
+  }
+
+  uint32_t read(int16_t* out, uint32_t frames) override {
+    uint32_t n = clip->frames - pos;
+    if (n > frames) n = frames;
+    memcpy(out, &clip->samples[pos], n * sizeof(int16_t));
+    pos += n;
+    return n;
+  }
+
+  void close() override { clip = nullptr; }
+
+private:
+  const PcmClip* clip;
+  uint32_t pos;
+};
+
+// =============================================================================
+// STATISTICS
+// =============================================================================
+// Queue-to-first-frame time of one clip
+typedef struct {
+  uint8_t sound;
+  const char* name;
+  uint16_t plays;
+  bool cached;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint32_t totalUs;
+} AudioLatency;
+
+typedef struct {
+  uint32_t boundaries;    // Clips that followed another without a break
+  uint32_t silent;        // Silent frames at those boundaries, summed
+  uint32_t maxSilent;     // Longest one
+  uint32_t trimmed;       // Padding frames the decoders dropped
+} AudioGapStats;
+
+// Decoder read() time, for one clip format
+typedef struct {
+  uint64_t cycles;
+  uint32_t frames;
+} AudioDecodeCost;
+
+typedef struct {
+  uint32_t preempted;     // Clips cut by a more important one
+  uint32_t stale;         // Dropped: would have started after their deadline
+  uint32_t evicted;       // Dropped from a full queue for a more important one
+  uint32_t rejected;      // Not queued: full of sounds at least as important
+} AudioQueueStats;
+
+typedef struct {
+  uint32_t started;       // First word played
+  uint32_t cut;           // Rest dropped: a word preempted, stale, evicted or missing
+  uint32_t minUs;         // Queue to first word
+  uint32_t maxUs;
+  uint32_t totalUs;
+} AudioPhraseStats;
+
+typedef struct {
+  uint8_t sound;
+  uint8_t priority;       // AudioPriority
+  uint32_t queuedUs;
+  uint32_t deadlineUs;    // Latest start (same clock as queuedUs); 0: none
+  uint8_t phrase;         // Words of one phrase share it; 0: a clip of its own
+} AudioQueueEntry;
+
+// =============================================================================
+// SEQUENCER CLASS
+// =============================================================================
+class AudioSequencer : public AudioStream {
+public:
+  explicit AudioSequencer(AudioSource* src) :
+    source(src), cur(nullptr), next(nullptr), started(false), prefetching(true),
+    count(0), boundary(false), measuring(false), tailSilent(0), leadSilent(0),
+    prevSound(0), latencyCount(0), lastPhrase(0) {
+    memset(&curEntry, 0, sizeof(curEntry));
+    memset(&nextEntry, 0, sizeof(nextEntry));
+    memset(&gaps, 0, sizeof(gaps));
+    memset(&qstats, 0, sizeof(qstats));
+    memset(&pstats, 0, sizeof(pstats));
+  }
+
+  AudioPushResult push(const AudioQueueEntry& e) {
+    if (count == AUDIO_QUEUE_SIZE) {
+      // Last: the least important, newest among equals
+      if (queue[count - 1].priority >= e.priority) {
+        qstats.rejected++;
+        LOG(AUDIO_QUEUE_FULL);
+        return AUDIO_PUSH_DROPPED;
+      }
+      count--;
+      qstats.evicted++;
+      LOG(AUDIO_EVICTED, source->name(queue[count].sound), source->name(e.sound));
+      dropPhrase(queue[count].phrase);
+    }
+    insert(e, false);
+    LOG(AUDIO_QUEUED, source->name(e.sound));
+
+    if (next && e.priority > nextEntry.priority) unprefetch(e.sound);
+    if (!cur || e.priority <= curEntry.priority) return AUDIO_PUSH_QUEUED;
+
+    LOG(AUDIO_PREEMPTED, source->name(curEntry.sound), source->name(e.sound));
+    qstats.preempted++;
+    source->release(cur);
+    cur = nullptr;
+    if (next) unprefetch(e.sound);
+    dropPhrase(curEntry.phrase);
+    boundary = measuring = false;
+    return AUDIO_PUSH_PREEMPTED;
+  }
+
+  bool push(uint8_t sound, uint32_t queuedUs, uint8_t priority = AUDIO_PRIO_NORMAL,
+            uint32_t deadlineUs = 0) {
+    AudioQueueEntry e = { sound, priority, queuedUs, deadlineUs, 0 };    // A clip of its own
+    return push(e) != AUDIO_PUSH_DROPPED;
+  }
+
+  // Drops the playing clip and everything queued
+  void clear() {
+    if (cur) source->release(cur);
+    if (next) source->release(next);
+    cur = next = nullptr;
+    count = 0;
+    boundary = measuring = false;
+  }
+
+  // Queue slots free: a phrase is queued whole or not at all
+  uint8_t room() const { return AUDIO_QUEUE_SIZE - count; }
+
+  // Playing, or something queued
+  bool busy() const { return cur != nullptr || next != nullptr || count != 0; }
+
+  // Would start with this fill: nothing ahead of it and already decoded
+  bool startsAtOnce() const {
+    return !cur && !next && count && source->cached(queue[0].sound);
+  }
+
+  // Opening the next clip early (measurements turn it off)
+  void setPrefetch(bool on) { prefetching = on; }
+
+  // Up to frames of the stream; fewer only when the queue ran out
+  uint32_t fill(int16_t* out, uint32_t frames, uint32_t nowUs) override {
+    uint32_t done = 0;
+    while (done < frames) {
+      if (!cur && !advance(nowUs)) break;
+      uint32_t n = cur->read(&out[done], frames - done);
+      if (n) noteFrames(&out[done], n, nowUs);
+      done += n;
+      if (done < frames) finish();
+    }
+    if (done < frames) boundary = false;    // Ran dry: the next clip starts a new stream
+    return done;
+  }
+
+  // Opens the next clip ahead of time; the pump calls it when the sink is
+  // full, so the open's cost is covered by everything queued in it
+  void prefetch(uint32_t nowUs) override {
+    if (prefetching && cur && !next) next = openNext(&nextEntry, nowUs);
+  }
+
+  const AudioLatency* getLatency(uint8_t* count) const {
+    *count = latencyCount;
+    return latency;
+  }
+
+  const AudioGapStats& getGapStats() const { return gaps; }
+  const AudioQueueStats& getQueueStats() const { return qstats; }
+  const AudioPhraseStats& getPhraseStats() const { return pstats; }
+
+private:
+  // By priority; a new entry goes after its equals, a requeued one
+  // (prefetched, then displaced) before them, being older
+  void insert(const AudioQueueEntry& e, bool front) {
+    uint8_t i = 0;
+    while (i < count && (front ? queue[i].priority > e.priority : queue[i].priority >= e.priority)) i++;
+    memmove(&queue[i + 1], &queue[i], (count - i) * sizeof(queue[0]));
+    queue[i] = e;
+    count++;
+  }
+
+  // The prefetched clip goes back to the queue: something more important
+  // (forSound) plays first. A full queue drops its least important, newest
+  // entry for it, as push() does; only when everything queued is more
+  // important does the prefetched clip go.
+  void unprefetch(uint8_t forSound) {
+    source->release(next);
+    next = nullptr;
+    if (count == AUDIO_QUEUE_SIZE) {
+      qstats.evicted++;
+      if (queue[count - 1].priority > nextEntry.priority) {
+        LOG(AUDIO_EVICTED, source->name(nextEntry.sound), source->name(forSound));
+        dropPhrase(nextEntry.phrase);
+        return;
+      }
+      count--;
+      LOG(AUDIO_EVICTED, source->name(queue[count].sound), source->name(nextEntry.sound));
+      uint8_t phrase = queue[count].phrase;
+      dropPhrase(phrase);
+      if (phrase && nextEntry.phrase == phrase) return;     // Its own phrase was cut
+    }
+    insert(nextEntry, true);
+  }
+
+  // The words after a phrase's cut or dropped one: half an announcement
+  // is worse than none
+  void dropPhrase(uint8_t phrase) {
+    if (!phrase) return;
+    if (next && nextEntry.phrase == phrase) {
+      source->release(next);
+      next = nullptr;
+    }
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < count; i++) {
+      if (queue[i].phrase != phrase) queue[kept++] = queue[i];
+    }
+    count = kept;
+    pstats.cut++;
+    LOG(AUDIO_PHRASE_CUT, phrase);
+  }
+
+  bool late(const AudioQueueEntry& e, uint32_t nowUs) {
+    if (!e.deadlineUs || (int32_t)(nowUs - e.deadlineUs) <= 0) return false;
+    qstats.stale++;
+    LOG(AUDIO_STALE, source->name(e.sound), nowUs - e.deadlineUs);
+    return true;
+  }
+
+  // Next clip in the queue, opened; missing and late ones are logged and
+  // skipped
+  AudioDecoder* openNext(AudioQueueEntry* entry, uint32_t nowUs) {
+    while (count) {
+      *entry = queue[0];
+      count--;
+      memmove(&queue[0], &queue[1], count * sizeof(queue[0]));
+      if (late(*entry, nowUs)) {
+        dropPhrase(entry->phrase);
+        continue;
+      }
+      AudioDecoder* d = source->open(entry->sound);
+      if (d) return d;
+      LOG(AUDIO_NOT_FOUND, source->name(entry->sound));
+      dropPhrase(entry->phrase);
+    }
+    return nullptr;
+  }
+
+  bool advance(uint32_t nowUs) {
+    if (next && late(nextEntry, nowUs)) {
+      source->release(next);
+      next = nullptr;
+      dropPhrase(nextEntry.phrase);
+    }
+    if (next) {
+      cur = next;
+      curEntry = nextEntry;
+      next = nullptr;
+    } else {
+      cur = openNext(&curEntry, nowUs);
+      if (!cur) return false;
+    }
+    LOG(AUDIO_PLAYING, source->name(curEntry.sound));
+    started = false;
+    measuring = boundary;
+    leadSilent = 0;
+    return true;
+  }
+
+  void finish() {
+    LOG(AUDIO_FINISHED);
+    gaps.trimmed += cur->trimmed();
+    if (measuring) recordGap();           // Silent all the way through
+    source->release(cur);
+    cur = nullptr;
+    prevSound = curEntry.sound;
+    boundary = true;
+  }
+
+  // Latency on the first frame (of a phrase: its first word only), silent
+  // runs on every block
+  void noteFrames(const int16_t* out, uint32_t n, uint32_t nowUs) {
+    if (!started) {
+      started = true;
+      if (!curEntry.phrase) {
+        noteLatency(nowUs - curEntry.queuedUs);
+      } else if (curEntry.phrase != lastPhrase) {
+        lastPhrase = curEntry.phrase;
+        noteLatency(nowUs - curEntry.queuedUs);
+        notePhrase(nowUs - curEntry.queuedUs);
+      }
+    }
+
+    uint32_t i = 0;
+    if (measuring) {
+      while (i < n && quiet(out[i])) i++;
+      leadSilent += i;
+      if (i < n) recordGap();
+    }
+    uint32_t run = 0;
+    while (run < n - i && quiet(out[n - 1 - run])) run++;
+    tailSilent = (run == n - i) ? tailSilent + run : run;
+  }
+
+  void recordGap() {
+    uint32_t silent = tailSilent + leadSilent;
+    gaps.boundaries++;
+    gaps.silent += silent;
+    if (silent > gaps.maxSilent) gaps.maxSilent = silent;
+    LOG(AUDIO_GAP, source->name(prevSound), source->name(curEntry.sound), silent, cur->trimmed());
+    measuring = false;
+    tailSilent = 0;
+  }
+
+  static bool quiet(int16_t s) {
+    return s <= AUDIO_SILENCE && s >= -AUDIO_SILENCE;
+  }
+
+  void noteLatency(uint32_t us) {
+    AudioLatency* l = nullptr;
+    for (uint8_t i = 0; i < latencyCount; i++) {
+      if (latency[i].sound == curEntry.sound) l = &latency[i];
+    }
+    if (!l) {
+      if (latencyCount >= AUDIO_LATENCY_SLOTS) return;
+      l = &latency[latencyCount++];
+      memset(l, 0, sizeof(*l));
+      l->sound = curEntry.sound;
+      l->name = source->name(curEntry.sound);
+    }
+    if (l->plays == 0 || us < l->minUs) l->minUs = us;
+    if (us > l->maxUs) l->maxUs = us;
+    l->totalUs += us;
+    l->plays++;
+    l->cached = source->cached(curEntry.sound);
+  }
+
+  void notePhrase(uint32_t us) {
+    if (pstats.started == 0 || us < pstats.minUs) pstats.minUs = us;
+    if (us > pstats.maxUs) pstats.maxUs = us;
+    pstats.totalUs += us;
+    pstats.started++;
+  }
+
+  AudioSource* source;
+  AudioDecoder* cur;
+  AudioDecoder* next;           // Prefetched
+  AudioQueueEntry curEntry;
+  AudioQueueEntry nextEntry;
+  bool started;                 // cur produced its first frame
+  bool prefetching;
+
+  AudioQueueEntry queue[AUDIO_QUEUE_SIZE];    // By priority, then age
+  uint8_t count;
+  AudioQueueStats qstats;
+
+  // Gap measurement
+  bool boundary;                // The last clip ended with the stream running
+  bool measuring;               // cur follows it: counting leading silence
+  uint32_t tailSilent;          // Trailing silent run of the stream so far
+  uint32_t leadSilent;
+  uint8_t prevSound;
+  AudioGapStats gaps;
+
+  AudioLatency latency[AUDIO_LATENCY_SLOTS];
+  uint8_t latencyCount;
+
+  uint8_t lastPhrase;           // Started last: its later words are not timed
+  AudioPhraseStats pstats;
+};
+
+// =============================================================================
+// PUMP
+// =============================================================================
+// Stream → sink. A block the sink only partly took waits for the next
+// run(), so no frame is lost or repeated. Prefetching happens with the
+// sink full. Sounds are queued through queue() so that a preempted clip
+// is also cut from the sink.
+class AudioPump {
+public:
+  AudioPump() : pending(0), offset(0) {}
+
+  // Until the sink is full (true) or the stream has nothing (false)
+  bool run(AudioStream* stream, AudioSink* sink, uint32_t nowUs) {
+    for (;;) {
+      if (offset == pending) {
+        pending = stream->fill(block, AUDIO_BLOCK_FRAMES, nowUs);
+        offset = 0;
+        if (pending == 0) return false;
+      }
+      offset += sink->write(&block[offset], pending - offset);
+      if (offset < pending) {
+        stream->prefetch(nowUs);
+        return true;
+      }
+    }
+  }
+
+  AudioPushResult queue(AudioSequencer* seq, AudioSink* sink, const AudioQueueEntry& e) {
+    AudioPushResult r = seq->push(e);
+    if (r == AUDIO_PUSH_PREEMPTED) {
+      reset();
+      sink->flush();
+    }
+    return r;
+  }
+
+  void reset() { pending = offset = 0; }
+
+private:
+  int16_t block[AUDIO_BLOCK_FRAMES];
+  uint32_t pending;
+  uint32_t offset;
+};
+
+#endif // AUDIO_ENGINE_H
@@ -1,8 +1,53 @@
 /*
  * AudioManager.h - Non-blocking Audio Queue for ESP32
  * 
- * Uses SPIFFS for MP3 storage (no SD card needed)
+ * Uses SPIFFS for MP3 storage (no SD card needed): one sound bank file,
+ * sounds played by SND_ ID (AudioDefs.h, generated with the bank)
  * Supports queuing multiple sounds for sequential playback
+ *
+ * Playback runs through AudioSequencer (AudioEngine.h): queued clips are
+ * pulled from pooled decoders (Mp3Decoder.h) into one mono stream at
+ * AUDIO_RATE and written straight to the I2S DMA (I2sOutput.h). With
+ * AUDIO_GAPLESS the next clip is opened while the current one plays and
+ * MP3 encoder padding is dropped, so "player 2" + "wins" or a countdown
+ * plays without the ~100 ms hole at each boundary (logged per boundary,
+ * AUDIO_GAP).
+ *
+ * Each sound has a priority and optionally a deadline: playCue() (GO
+ * beep, countdown) cuts a voice prompt still playing, and drops the cue
+ * rather than play it AUDIO_CUE_DEADLINE_MS late.
+ *
+ * Effects: playEffect() mixes a cached clip (button click) over whatever
+ * the queue is playing instead of waiting behind it (AudioMixer.h,
+ * AUDIO_VOICES voices, each with its own gain). An effect that is not
+ * cached is queued like any other sound.
+ *
+ * Clips transcoded at build time (custom_sound_format pcm or adpcm,
+ * scripts/copy_data.py) skip the MP3 decoder (BankPcmDecoder.h); the
+ * decode cost per second of audio is logged per format (logStats()).
+ *
+ * Announcements: announce() speaks a SpeechPhrase (NumberSpeech.h: "player
+ * two, two hundred thirty four milliseconds") from word clips, queued
+ * whole as one gapless phrase at low priority: any prompt or cue of the
+ * next round cuts it, and with it the words it had left, and it is dropped
+ * if it cannot start within AUDIO_ANNOUNCE_DEADLINE_MS. A phrase with a
+ * word the bank has no clip for is not played (logged).
+ *
+ * Latency-critical clips (GO beep, countdown) can be decoded to RAM at
+ * boot with cacheSound() (PcmCache.h); queuing one of them while nothing
+ * plays writes its first samples to the I2S DMA before queueSound()
+ * returns. Every play records the time from queueSound() to the refill
+ * pass that hands its first frame to the DMA, per clip (logStats()); a
+ * bank clip's open and first decode come on top of that. native_audio
+ * measures both kinds to the DAC.
+ *
+ * Threading: after startTask(), decoding and DMA refills run in their own
+ * FreeRTOS task (AUDIO_TASK_CORE, core 0; the Arduino loop is on core 1),
+ * so a slow loop pass (serial output, SPIFFS writes) no longer starves the
+ * DMA. queueSound(), stop(), setVolume() and logStats() then only post a
+ * command to a lock-free queue (SpscQueue.h) and wake the task; call them
+ * from one task, the game loop. Without startTask() the loop calls
+ * update() as before. I2sOutput counts DMA underruns either way.
  * 
  * ACCESSIBILITY: Audio provides feedback for visually impaired players
  */
@@ -12,68 +57,97 @@
 
 #include "Arduino.h"
 #include "SPIFFS.h"
-#include "AudioFileSourceSPIFFS.h"
 #include "AudioGeneratorMP3.h"
-#include "AudioOutputI2S.h"
-
-// =============================================================================
-// SOUND FILE DEFINITIONS
-// =============================================================================
-// Files should be stored in SPIFFS at these paths
-#define SND_BUTTON_CLICK      "/click.mp3"
-#define SND_GET_READY         "/ready.mp3"
-#define SND_PRESS_TO_JOIN     "/join.mp3"
-#define SND_READY             "/joined.mp3"
-#define SND_REACTION_MODE     "/reaction.mp3"
-#define SND_REACTION_INSTRUCT "/react_i.mp3"
-#define SND_SHAKE_IT          "/shake.mp3"
-#define SND_YOU_WILL_SHAKE    "/willshk.mp3"
-#define SND_NUM_10            "/10.mp3"
-#define SND_NUM_15            "/15.mp3"
-#define SND_NUM_20            "/20.mp3"
-#define SND_BEEP              "/beep.mp3"
-#define SND_COUNTDOWN_3       "/three.mp3"
-#define SND_COUNTDOWN_2       "/two.mp3"
-#define SND_COUNTDOWN_1       "/one.mp3"
-#define SND_FASTEST           "/fastest.mp3"
-#define SND_PLAYER_1          "/player1.mp3"
-#define SND_PLAYER_2          "/player2.mp3"
-#define SND_PLAYER_3          "/player3.mp3"
-#define SND_PLAYER_4          "/player4.mp3"
-#define SND_WINS              "/wins.mp3"
-#define SND_VICTORY_FANFARE   "/victory.mp3"
-#define SND_GAME_OVER         "/over.mp3"
-#define SND_ERROR_TONE        "/error.mp3"
+#include "AudioDefs.h"
+#include "AudioEngine.h"
+#include "AudioMixer.h"
+#include "I2sOutput.h"
+#include "Mp3Decoder.h"
+#include "NumberSpeech.h"
+#include "PcmCache.h"
+#include "SoundBank.h"
+#include "SpscQueue.h"
+#include "Log.h"
 
 // =============================================================================
 // CONFIGURATION
 // =============================================================================
-#define AUDIO_QUEUE_SIZE      8
 #define DEFAULT_VOLUME        1.0   // Max volume (range 0.0 - 4.0)
 
+#ifndef AUDIO_CUE_DEADLINE_MS
+#define AUDIO_CUE_DEADLINE_MS 250   // Countdown/GO later than this: dropped
+#endif
+
+#ifndef AUDIO_ANNOUNCE_DEADLINE_MS
+#define AUDIO_ANNOUNCE_DEADLINE_MS 1000   // Announcement not started by then: dropped
+#endif
+
+#ifndef AUDIO_EFFECT_GAIN
+#define AUDIO_EFFECT_GAIN     0.7   // Effects under the voice (mixer gain, 0.0 - 2.0)
+#endif
+
+#ifndef AUDIO_GAPLESS
+#define AUDIO_GAPLESS         1     // Prefetch the next clip, drop MP3 padding
+#endif
+
+#ifndef AUDIO_TASK_CORE
+#define AUDIO_TASK_CORE       0     // Not the loop's core
+#endif
+#define AUDIO_TASK_PRIORITY   3     // Above loop and log drain, below WiFi
+#define AUDIO_TASK_STACK      8192  // MP3 decoder frames
+#define AUDIO_TASK_WAIT_MS    2     // Refill period between commands (DMA: 23 ms)
+#define AUDIO_CMD_QUEUE_SIZE  16
+
+// onWinner(): the longest announcement and the fanfare queued behind it,
+// with room left for a cue
+static_assert(AUDIO_QUEUE_SIZE >= SPEECH_MAX_WORDS + 2, "AUDIO_QUEUE_SIZE too small for an announcement");
+
 // I2S Pins (match PCB schematic - fixed hardware)
 #define I2S_DOUT_PIN          25
 #define I2S_BCLK_PIN          26
 #define I2S_LRC_PIN           27
 
+// Loop → audio task
+enum AudioCmdType : uint8_t {
+  AUDIO_CMD_PLAY,
+  AUDIO_CMD_EFFECT,
+  AUDIO_CMD_PHRASE,
+  AUDIO_CMD_STOP,
+  AUDIO_CMD_VOLUME,
+  AUDIO_CMD_REPORT
+};
+
+typedef struct {
+  AudioCmdType type;
+  uint8_t sound;          // PLAY, EFFECT
+  uint8_t priority;       // PLAY: AudioPriority
+  float volume;           // VOLUME; EFFECT: mixer gain
+  uint32_t queuedUs;      // micros() when posted
+  uint32_t deadlineUs;    // PLAY, PHRASE: latest start (0: none)
+  uint8_t words;          // PHRASE
+  uint8_t phrase[SPEECH_MAX_WORDS];   // PHRASE: sound per word
+} AudioCommand;
+
 // =============================================================================
 // AUDIO MANAGER CLASS
 // =============================================================================
 class AudioManager {
 public:
   AudioManager() : 
+    mp3Space(nullptr),
     mp3(nullptr), 
-    file(nullptr), 
     out(nullptr),
-    queueHead(0), 
-    queueTail(0),
+    seq(&source),
+    mixer(&seq),
+    phraseId(0),
     isPlaying(false),
-    volume(DEFAULT_VOLUME) {}
+    volume(DEFAULT_VOLUME),
+    task(nullptr) {}
   
   ~AudioManager() {
-    stop();
+    halt();
     if (mp3) delete mp3;
-    if (file) delete file;
+    if (mp3Space) free(mp3Space);
     if (out) delete out;
   }
   
@@ -87,17 +161,53 @@ public:
       return false;
     }
 
-    out = new AudioOutputI2S(); // Use default constructor (external I2S DAC)
-    out->SetPinout(I2S_BCLK_PIN, I2S_LRC_PIN, I2S_DOUT_PIN);
-    out->SetGain(volume);
+    out = new I2sOutput();      // External I2S DAC, driver kept running
+    if (!out->install(I2S_BCLK_PIN, I2S_LRC_PIN, I2S_DOUT_PIN)) {
+      Serial.println(F("I2S init failed!"));
+      return false;
+    }
+    out->setGain(volume);
 
-    mp3 = new AudioGeneratorMP3();
+    // Decoder state allocated once, not on every clip
+    mp3Space = malloc(AudioGeneratorMP3::preAllocSize());
+    if (!mp3Space) {
+      Serial.println(F("MP3 decoder allocation failed!"));
+      return false;
+    }
+    mp3 = new AudioGeneratorMP3(mp3Space, AudioGeneratorMP3::preAllocSize());
 
-    Serial.printf("Audio system initialized (SPIFFS, volume: %.1f)\n", volume);
     listFiles();
+    if (!bank.begin()) {
+      Serial.println(F("Sound bank missing or from another build!"));
+      return false;
+    }
+    LOG(AUDIO_VOICE, voice.begin(SoundBank::name, NUM_SOUNDS), SPEECH_WORDS);
+    cache.begin(&bank);
+    source.begin(&bank, mp3, &cache, AUDIO_GAPLESS);
+    seq.setPrefetch(AUDIO_GAPLESS);
+
+    Serial.printf("Audio system initialized (%u sounds, volume: %.1f)\n", NUM_SOUNDS, volume);
     return true;
   }
 
+  // Decodes a clip to RAM now (after begin(), before playing anything);
+  // false if it keeps playing from the bank
+  bool cacheSound(uint8_t sound) {
+    if (!bank.valid() || isPlaying) return false;
+    return cache.add(sound, mp3);
+  }
+
+  const PcmCache& getCache() const { return cache; }
+
+  // Moves playback into its own task (after begin() and cacheSound());
+  // update() does nothing from then on
+  bool startTask(uint8_t core = AUDIO_TASK_CORE) {
+    if (task) return true;
+    if (!out) return false;
+    return xTaskCreatePinnedToCore(taskEntry, "audio", AUDIO_TASK_STACK, this,
+                                   AUDIO_TASK_PRIORITY, &task, core) == pdPASS;
+  }
+
   // List SPIFFS files for debugging
   void listFiles() {
     Serial.println("[AUDIO] Files in SPIFFS:");
@@ -114,24 +224,54 @@ public:
     }
   }
   
-  // Queue a sound to play
-  void queueSound(const char* filename) {
-    uint8_t nextTail = (queueTail + 1) % AUDIO_QUEUE_SIZE;
-    if (nextTail != queueHead) {  // Not full
-      queue[queueTail] = filename;
-      queueTail = nextTail;
-      Serial.printf("[AUDIO] Queued: %s\n", filename);
-    } else {
-      Serial.println("[AUDIO] Queue full!");
+  // Queue a sound to play. A cached clip with nothing ahead of it starts
+  // at once (in the task, woken by the command), not on the next pass.
+  // A higher priority than the playing sound cuts it; with deadlineMs, the
+  // sound is dropped if it cannot start within that time.
+  void queueSound(uint8_t sound, uint8_t priority = AUDIO_PRIO_NORMAL, uint16_t deadlineMs = 0) {
+    uint32_t now = micros();
+    uint32_t deadline = deadlineMs ? (now + deadlineMs * 1000UL) | 1 : 0;   // 0 means none
+    AudioCommand cmd = { AUDIO_CMD_PLAY, sound, priority, 0, now, deadline };
+    post(cmd);
+  }
+
+  // A sound whose timing matters (countdown, GO): cuts voice prompts and
+  // music, never plays more than AUDIO_CUE_DEADLINE_MS late
+  void playCue(uint8_t sound) {
+    queueSound(sound, AUDIO_PRIO_CUE, AUDIO_CUE_DEADLINE_MS);
+  }
+
+  // Mixed over whatever plays (button click); queued if not cached
+  void playEffect(uint8_t sound, float gain = AUDIO_EFFECT_GAIN) {
+    AudioCommand cmd = { AUDIO_CMD_EFFECT, sound, AUDIO_PRIO_NORMAL, gain, (uint32_t)micros(), 0 };
+    post(cmd);
+  }
+
+  // Speaks a phrase, all of it or none (see the header); false if a word
+  // has no clip
+  bool announce(const SpeechPhrase& phrase, uint8_t priority = AUDIO_PRIO_LOW,
+                uint16_t deadlineMs = AUDIO_ANNOUNCE_DEADLINE_MS) {
+    AudioCommand cmd = { AUDIO_CMD_PHRASE, 0, priority, 0, (uint32_t)micros(), 0 };
+    int words = voice.toSounds(phrase, cmd.phrase);
+    if (words < 0) {
+      LOG(AUDIO_WORD_MISSING, SPEECH_TABLE[phrase.word(-1 - words)].text);
+      return false;
     }
+    if (!words || phrase.truncated()) return false;
+    cmd.words = (uint8_t)words;
+    if (deadlineMs) cmd.deadlineUs = (cmd.queuedUs + deadlineMs * 1000UL) | 1;
+    post(cmd);
+    return true;
   }
-  
+
+  const SpeechVoice& getVoice() const { return voice; }
+
   // Play countdown number
   void playCountdown(uint8_t num) {
     switch (num) {
-      case 3: queueSound(SND_COUNTDOWN_3); break;
-      case 2: queueSound(SND_COUNTDOWN_2); break;
-      case 1: queueSound(SND_COUNTDOWN_1); break;
+      case 3: playCue(SND_COUNTDOWN_3); break;
+      case 2: playCue(SND_COUNTDOWN_2); break;
+      case 1: playCue(SND_COUNTDOWN_1); break;
     }
   }
   
@@ -145,88 +285,197 @@ public:
     }
   }
   
-  // Play "Player X wins"
+  // Play "Player X wins" (one stream, no gap between the two clips)
   void playPlayerWins(uint8_t player) {
     playPlayerNumber(player);
     queueSound(SND_WINS);
   }
   
-  // Must be called frequently (in loop)
+  // Must be called frequently (in loop) unless startTask() succeeded
   void update() {
-    // If currently playing, check if done
-    if (isPlaying && mp3) {
-      if (mp3->isRunning()) {
-        if (!mp3->loop()) {
-          mp3->stop();
-          Serial.println("[AUDIO] Finished playing");
-          isPlaying = false;
-          if (file) {
-            delete file;
-            file = nullptr;
-          }
-        }
-      } else {
-        isPlaying = false;
-      }
-    }
-
-    // If not playing and queue has items, start next
-    if (!isPlaying && queueHead != queueTail) {
-      const char* filename = queue[queueHead];
-      queueHead = (queueHead + 1) % AUDIO_QUEUE_SIZE;
-
-      // Check if file exists
-      if (SPIFFS.exists(filename)) {
-        Serial.printf("[AUDIO] Playing: %s\n", filename);
-
-        file = new AudioFileSourceSPIFFS(filename);
-        if (mp3->begin(file, out)) {
-          isPlaying = true;
-        } else {
-          Serial.println("[AUDIO] MP3 begin failed!");
-          delete file;
-          file = nullptr;
-        }
-      } else {
-        Serial.printf("[AUDIO] File not found: %s\n", filename);
-      }
-    }
+    if (!task) service();
   }
   
   // Stop current playback
   void stop() {
-    if (mp3 && mp3->isRunning()) {
-      mp3->stop();
-    }
-    isPlaying = false;
-    // Clear queue
-    queueHead = queueTail = 0;
+    AudioCommand cmd = { AUDIO_CMD_STOP, 0, 0, 0, (uint32_t)micros(), 0 };
+    post(cmd);
   }
   
-  // Check if playing
+  // Check if playing, or about to (queued, or a command on its way)
   bool playing() const {
-    return isPlaying;
+    return isPlaying || commands.size() != 0;
   }
   
   // Set volume (0.0 - 4.0)
   void setVolume(float vol) {
-    volume = vol;
-    if (out) {
-      out->SetGain(volume);
-    }
+    AudioCommand cmd = { AUDIO_CMD_VOLUME, 0, 0, vol, (uint32_t)micros(), 0 };
+    post(cmd);
   }
 
+  // One line per clip played: queue-to-first-frame min/avg/max in µs
+  // (the DAC is up to AUDIO_DMA_BUFFERS × AUDIO_DMA_FRAMES frames later),
+  // then silence at clip boundaries, phrases and their first word's
+  // latency, the mixer's CPU time, underruns and command queue use.
+  // Logged by the audio task.
+  void logStats() {
+    AudioCommand cmd = { AUDIO_CMD_REPORT, 0, 0, 0, (uint32_t)micros(), 0 };
+    post(cmd);
+  }
+
+  // Counters only ever grow; read from any task
+  const AudioOutStats& getOutputStats() const { return out->getStats(); }
+
 private:
+  // Runs a command now (no task) or hands it to the task
+  void post(const AudioCommand& cmd) {
+    if (!task) {
+      execute(cmd);
+      return;
+    }
+    if (!commands.push(cmd)) {
+      LOG(AUDIO_QUEUE_FULL);
+      return;
+    }
+    xTaskNotifyGive(task);
+  }
+
+  static void taskEntry(void* ctx) {
+    ((AudioManager*)ctx)->run();
+  }
+
+  // Audio task: commands first, then refill the DMA. Wakes on a command
+  // or after AUDIO_TASK_WAIT_MS.
+  void run() {
+    for (;;) {
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(AUDIO_TASK_WAIT_MS));
+      AudioCommand* cmd;
+      while ((cmd = commands.peek()) != nullptr) {
+        execute(*cmd);
+        commands.pop();
+      }
+      service();
+    }
+  }
+
+  void execute(const AudioCommand& cmd) {
+    switch (cmd.type) {
+      case AUDIO_CMD_PLAY:   enqueue(cmd); break;
+      case AUDIO_CMD_EFFECT: effect(cmd); break;
+      case AUDIO_CMD_PHRASE: say(cmd); break;
+      case AUDIO_CMD_STOP:   halt(); break;
+      case AUDIO_CMD_VOLUME:
+        volume = cmd.volume;
+        if (out) out->setGain(volume);
+        break;
+      case AUDIO_CMD_REPORT: report(); break;
+    }
+  }
+
+  void enqueue(const AudioCommand& cmd) {
+    AudioQueueEntry e = { cmd.sound, cmd.priority, cmd.queuedUs, cmd.deadlineUs, 0 };
+    if (pump.queue(&seq, out, e) == AUDIO_PUSH_DROPPED) return;
+    isPlaying = true;
+    if (seq.startsAtOnce()) service();
+  }
+
+  void effect(const AudioCommand& cmd) {
+    const PcmClip* clip = cache.find(cmd.sound);
+    if (!clip) {
+      enqueue(cmd);
+      return;
+    }
+    mixer.play(clip, cmd.volume);
+    isPlaying = true;
+    service();
+  }
+
+  // Every word or none; only the first has the deadline, the rest follow
+  // it without a gap or go with it
+  void say(const AudioCommand& cmd) {
+    if (seq.room() < cmd.words) {
+      LOG(AUDIO_PHRASE_FULL, cmd.words, seq.room());
+      return;
+    }
+    phraseId = phraseId % 255 + 1;
+    for (uint8_t i = 0; i < cmd.words; i++) {
+      AudioQueueEntry e = { cmd.phrase[i], cmd.priority, cmd.queuedUs, i ? 0 : cmd.deadlineUs, phraseId };
+      pump.queue(&seq, out, e);
+    }
+    isPlaying = true;
+    if (seq.startsAtOnce()) service();
+  }
+
+  // One refill pass: the mixer fills the DMA until it is full or nothing
+  // plays
+  void service() {
+    if (!out) return;
+    out->poll();
+    if (!pump.run(&mixer, out, micros())) out->endStream();
+    isPlaying = mixer.busy();
+  }
+
+  void halt() {
+    seq.clear();
+    mixer.stopEffects();
+    pump.reset();
+    if (out) out->endStream();
+    isPlaying = false;
+  }
+
+  void report() const {
+    if (!out) return;
+    uint8_t count;
+    const AudioLatency* latency = seq.getLatency(&count);
+    for (uint8_t i = 0; i < count; i++) {
+      const AudioLatency* l = &latency[i];
+      LOG(AUDIO_LATENCY, l->name, l->plays, l->minUs, l->totalUs / l->plays, l->maxUs, l->cached);
+    }
+    const AudioGapStats& g = seq.getGapStats();
+    LOG(AUDIO_GAP_STATS, g.boundaries, g.silent, g.maxSilent, g.trimmed);
+    const AudioQueueStats& q = seq.getQueueStats();
+    LOG(AUDIO_QUEUE_STATS, q.preempted, q.stale, q.evicted, q.rejected);
+    const AudioPhraseStats& p = seq.getPhraseStats();
+    LOG(AUDIO_PHRASE_STATS, p.started, p.cut, p.minUs, p.started ? p.totalUs / p.started : 0, p.maxUs);
+
+    // Mixer CPU per second of audio played: 1000000 is a whole core
+    const AudioMixStats& m = mixer.getStats();
+    uint64_t audioUs = (uint64_t)m.blocks * AUDIO_BLOCK_FRAMES * 1000000 / AUDIO_RATE;
+    uint32_t cpu = audioUs ? (uint32_t)(m.cycles / ESP.getCpuFreqMHz() * 1000000 / audioUs) : 0;
+    LOG(AUDIO_MIX_STATS, m.blocks, m.mixed, m.peakVoices, m.mixed ? (uint32_t)(m.cycles / m.mixed) : 0,
+        m.peakCycles, cpu, m.clipped, m.stolen);
+
+    // Streamed clips per bank format, file reads included
+    static const char* const formats[] = { "mp3", "pcm", "adpcm" };
+    for (uint8_t f = SND_FMT_MP3; f <= SND_FMT_ADPCM; f++) {
+      const AudioDecodeCost& d = source.getDecodeCost(f);
+      if (!d.frames) continue;
+      uint64_t perSecond = d.cycles * AUDIO_RATE / d.frames;
+      LOG(AUDIO_DECODE_STATS, formats[f], d.frames, (uint32_t)(perSecond / 1000),
+          (uint32_t)(perSecond / ESP.getCpuFreqMHz()));
+    }
+    const AudioOutStats& s = out->getStats();
+    LOG(AUDIO_STATS, s.frames, s.underruns, s.starved, commands.overflowCount(),
+        commands.peakDepth(), task != nullptr);
+  }
+
+  void* mp3Space;
   AudioGeneratorMP3 *mp3;
-  AudioFileSourceSPIFFS *file;
-  AudioOutputI2S *out;
+  I2sOutput *out;
+  SoundBank bank;
+  PcmCache cache;
+  BankSource source;
+  AudioSequencer seq;
+  AudioMixer mixer;
+  AudioPump pump;
+  SpeechVoice voice;
+  uint8_t phraseId;           // Last queued, 1 - 255
   
-  const char* queue[AUDIO_QUEUE_SIZE];
-  uint8_t queueHead;
-  uint8_t queueTail;
-  
-  bool isPlaying;
+  volatile bool isPlaying;    // Read by the loop, written by the task
   float volume;
+
+  TaskHandle_t task;
+  SpscQueue<AudioCommand, AUDIO_CMD_QUEUE_SIZE> commands;
 };
 
-#endif // AUDIO_MANAGER_H
\ No newline at end of file
+#endif // AUDIO_MANAGER_H
@@ -0,0 +1,188 @@
+/*
+ * AudioMixer.h - Overlapping Voices in the One Output Stream
+ * Host firmware and native builds
+ *
+ * The sequencer (AudioEngine.h) plays one clip at a time, so a button
+ * click waited behind the voice prompt in front of it. AudioMixer is the
+ * AudioStream the pump pulls from instead: voice 0 is the sequencer,
+ * voices 1 .. AUDIO_VOICES-1 play one clip each on top of it (effects).
+ * Effect clips are RAM clips (PcmClip, PcmCache.h): there is one MP3
+ * decoder, and it belongs to the sequencer.
+ *
+ * Each voice has a Q12 gain. A block is summed in 32 bits and saturated
+ * to 16 bits once, so two loud voices clip instead of wrapping around.
+ * With only the sequencer playing at unity gain, its block goes through
+ * untouched: mixing costs nothing until an effect plays.
+ *
+ * The kernels (mixAdd(), mixOut()) are plain loops over restrict
+ * pointers, 16 × 16 → 32-bit multiplies and min/max clamps, which GCC
+ * vectorizes on the native build (src/native_mixer.cpp); the ESP32 runs
+ * them as scalar loops. On Arduino, the cycles spent in them are counted
+ * (getStats()) for AudioManager's CPU report.
+ */
+
+#ifndef AUDIO_MIXER_H
+#define AUDIO_MIXER_H
+
+#include <stdint.h>
+#include <string.h>
+#include "AudioEngine.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#define AUDIO_MIX_CYCLES()  ESP.getCycleCount()
+#else
+#define AUDIO_MIX_CYCLES()  0u
+#endif
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#ifndef AUDIO_VOICES
+#define AUDIO_VOICES      3         // Sequencer + effects, 2 - 4
+#endif
+#define AUDIO_GAIN_SHIFT  12
+#define AUDIO_GAIN_ONE    (1 << AUDIO_GAIN_SHIFT)
+
+#if AUDIO_VOICES < 2 || AUDIO_VOICES > 4
+#error "AUDIO_VOICES must be 2 - 4"
+#endif
+
+typedef struct {
+  uint32_t blocks;        // Filled
+  uint32_t mixed;         // Through the kernels (an effect or a gain)
+  uint64_t cycles;        // In the kernels (Arduino only)
+  uint32_t peakCycles;    // One block
+  uint32_t clipped;       // Samples saturated
+  uint32_t stolen;        // Effects cut for a newer one
+  uint8_t peakVoices;
+} AudioMixStats;
+
+// =============================================================================
+// KERNELS
+// =============================================================================
+// acc += in × gain (Q12)
+static inline void mixAdd(int32_t* __restrict acc, const int16_t* __restrict in, int16_t gain,
+                          uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) acc[i] += (int32_t)in[i] * gain;
+}
+
+// out = acc (Q12) saturated to 16 bits; returns the samples clipped
+static inline uint32_t mixOut(int16_t* __restrict out, const int32_t* __restrict acc, uint32_t n) {
+  uint32_t clipped = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    int32_t v = acc[i] >> AUDIO_GAIN_SHIFT;
+    int32_t s = v < -32768 ? -32768 : (v > 32767 ? 32767 : v);
+    clipped += s != v;
+    out[i] = (int16_t)s;
+  }
+  return clipped;
+}
+
+// =============================================================================
+// MIXER CLASS
+// =============================================================================
+class AudioMixer : public AudioStream {
+public:
+  explicit AudioMixer(AudioSequencer* sequencer) : seq(sequencer), effects(0), age(0) {
+    for (uint8_t v = 0; v < AUDIO_VOICES; v++) gain[v] = AUDIO_GAIN_ONE;
+    memset(active, 0, sizeof(active));
+    memset(started, 0, sizeof(started));
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  // 0.0 - 2.0; voice 0 is the sequencer
+  void setGain(uint8_t voice, float g) {
+    if (voice < AUDIO_VOICES) gain[voice] = toGain(g);
+  }
+
+  // Starts clip on a free effect voice, or on the one playing the longest;
+  // returns the voice
+  uint8_t play(const PcmClip* clip, float g) {
+    uint8_t v = 0;
+    for (uint8_t i = 1; i < AUDIO_VOICES && !v; i++) {
+      if (!active[i]) v = i;
+    }
+    if (!v) {
+      v = 1;
+      for (uint8_t i = 2; i < AUDIO_VOICES; i++) {
+        if (started[i] < started[v]) v = i;
+      }
+      stats.stolen++;
+    } else {
+      effects++;
+    }
+    fx[v].load(clip);
+    fx[v].open(clip->sound);
+    active[v] = true;
+    started[v] = ++age;
+    gain[v] = toGain(g);
+    return v;
+  }
+
+  // Effects only; the sequencer keeps its queue
+  void stopEffects() {
+    memset(active, 0, sizeof(active));
+    effects = 0;
+  }
+
+  bool busy() const { return seq->busy() || effects != 0; }
+  uint8_t effectsPlaying() const { return effects; }
+
+  uint32_t fill(int16_t* out, uint32_t frames, uint32_t nowUs) override {
+    stats.blocks++;
+    if (!effects && gain[0] == AUDIO_GAIN_ONE) return seq->fill(out, frames, nowUs);
+
+    // Sources first, so the kernels are timed on their own
+    uint32_t len = seq->fill(out, frames, nowUs);
+    uint8_t voices = len ? 1 : 0;
+    uint32_t got[AUDIO_VOICES] = { len };
+    for (uint8_t v = 1; v < AUDIO_VOICES; v++) {
+      if (!active[v]) continue;
+      got[v] = fx[v].read(part[v], frames);
+      if (got[v]) voices++;
+      if (got[v] > len) len = got[v];
+      if (got[v] < frames) {
+        active[v] = false;
+        effects--;
+      }
+    }
+    if (voices > stats.peakVoices) stats.peakVoices = voices;
+
+    uint32_t c0 = AUDIO_MIX_CYCLES();
+    memset(acc, 0, len * sizeof(acc[0]));
+    mixAdd(acc, out, gain[0], got[0]);
+    for (uint8_t v = 1; v < AUDIO_VOICES; v++) mixAdd(acc, part[v], gain[v], got[v]);
+    stats.clipped += mixOut(out, acc, len);
+    uint32_t cycles = AUDIO_MIX_CYCLES() - c0;
+
+    stats.mixed++;
+    stats.cycles += cycles;
+    if (cycles > stats.peakCycles) stats.peakCycles = cycles;
+    return len;
+  }
+
+  void prefetch(uint32_t nowUs) override { seq->prefetch(nowUs); }
+
+  const AudioMixStats& getStats() const { return stats; }
+
+private:
+  static int16_t toGain(float g) {
+    if (g < 0.0f) g = 0.0f;
+    if (g > 2.0f) g = 2.0f;
+    return (int16_t)(g * AUDIO_GAIN_ONE);
+  }
+
+  AudioSequencer* seq;
+  int16_t gain[AUDIO_VOICES];           // Q12
+  PcmDecoder fx[AUDIO_VOICES];          // [0] unused: the sequencer
+  bool active[AUDIO_VOICES];
+  uint32_t started[AUDIO_VOICES];       // Play order, for stealing
+  uint8_t effects;
+  uint32_t age;
+  int32_t acc[AUDIO_BLOCK_FRAMES];
+  int16_t part[AUDIO_VOICES][AUDIO_BLOCK_FRAMES];
+  AudioMixStats stats;
+};
+
+#endif // AUDIO_MIXER_H
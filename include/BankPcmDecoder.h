@@ -0,0 +1,95 @@
+/*
+ * BankPcmDecoder.h - PCM and IMA-ADPCM Clips of the Sound Bank
+ * Host only
+ *
+ * Clips that scripts/copy_data.py transcoded (SND_FMT_PCM, SND_FMT_ADPCM
+ * in AudioDefs.h) are already mono at AUDIO_RATE with the encoder delay
+ * and padding gone: reading one is a file read and, for ADPCM, a block
+ * decode (ImaAdpcm.h), with no MP3 generator, rate conversion or gapless
+ * trim. open() seeks, as for MP3 clips. read() time is added to the
+ * clip format's AudioDecodeCost, if given.
+ */
+
+#ifndef BANK_PCM_DECODER_H
+#define BANK_PCM_DECODER_H
+
+#include <Arduino.h>
+#include "AudioDefs.h"
+#include "AudioEngine.h"
+#include "ImaAdpcm.h"
+#include "SoundBank.h"
+
+static_assert(SOUND_BANK_RATE == AUDIO_RATE, "sound bank transcoded for another AUDIO_RATE");
+
+// =============================================================================
+// BANK PCM DECODER CLASS
+// =============================================================================
+class BankPcmDecoder : public AudioDecoder {
+public:
+  BankPcmDecoder() : bank(nullptr), costs(nullptr), format(SND_FMT_PCM), left(0), offset(0),
+                     have(0) {}
+
+  bool begin(const SoundBank* sounds) {
+    bank = sounds;
+    return file.begin();
+  }
+
+  // Indexed by SND_FMT_
+  void setCost(AudioDecodeCost* perFormat) { costs = perFormat; }
+
+  // PCM or ADPCM clips only
+  bool open(uint8_t sound) override {
+    const SoundEntry* e = bank->entry(sound);
+    if (!e || e->format == SND_FMT_MP3 || !file.open(e)) return false;
+    format = e->format;
+    left = e->frames;
+    offset = have = 0;
+    return true;
+  }
+
+  uint32_t read(int16_t* out, uint32_t frames) override {
+    uint32_t c0 = ESP.getCycleCount();
+    if (frames > left) frames = left;
+    uint32_t done = 0;
+    if (format == SND_FMT_PCM) {
+      done = file.read(out, frames * sizeof(int16_t)) / sizeof(int16_t);
+    } else {
+      while (done < frames) {
+        if (offset == have && !nextBlock()) break;
+        uint32_t n = have - offset;
+        if (n > frames - done) n = frames - done;
+        memcpy(&out[done], &pcm[offset], n * sizeof(int16_t));
+        offset += n;
+        done += n;
+      }
+    }
+    left -= done;
+    if (costs) {
+      costs[format].cycles += ESP.getCycleCount() - c0;
+      costs[format].frames += done;
+    }
+    return done;
+  }
+
+  void close() override { file.close(); }
+
+private:
+  bool nextBlock() {
+    uint32_t bytes = file.read(block, sizeof(block));
+    have = adpcmDecodeBlock(block, bytes, pcm);
+    offset = 0;
+    return have != 0;
+  }
+
+  BankFileSource file;
+  const SoundBank* bank;
+  AudioDecodeCost* costs;
+  uint8_t format;
+  uint32_t left;          // Frames of the clip not read yet
+  uint32_t offset;        // In pcm
+  uint32_t have;
+  uint8_t block[ADPCM_BLOCK_BYTES];
+  int16_t pcm[ADPCM_BLOCK_FRAMES];
+};
+
+#endif // BANK_PCM_DECODER_H
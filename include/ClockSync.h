@@ -0,0 +1,190 @@
+/*
+ * ClockSync.h - Host/Node Clock Synchronization (NTP-style)
+ * Shared between Host, Display and Joysticks
+ *
+ * Exchange (all times in microseconds, 32-bit wrapping):
+ *   Host  t1 --CMD_SYNC_REQ-->  t2 Node
+ *   Host  t4 <--CMD_SYNC_RESP-- t3 Node
+ *   offset = ((t2 - t1) + (t3 - t4)) / 2     (node clock - host clock)
+ *   delay  = (t4 - t1) - (t3 - t2)
+ *
+ * The host keeps one SyncEstimator per node: the minimum-delay sample of the
+ * last SYNC_WINDOW exchanges (least queueing, least asymmetry) anchors the
+ * offset, and the slope between anchors at least SYNC_DRIFT_SPAN_US apart
+ * gives the drift. Every CMD_SYNC_REQ carries the current estimate back to
+ * the node, whose SyncedClock converts host instants to local ones.
+ */
+
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <stdint.h>
+#include <string.h>
+#include "Protocol.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define SYNC_WINDOW         8
+#define SYNC_DRIFT_SPAN_US  8000000   // Min anchor spacing for a drift update
+#define SYNC_DRIFT_MAX_PPB  200000    // Clamp: 200 ppm crystals
+#define SYNC_PERIOD_IDLE_MS 250       // Exchange rate between rounds
+#define SYNC_PERIOD_MS      2000      // Exchange rate during a round
+
+// CMD_SYNC_REQ flags
+#define SYNC_FLAG_VALID     0x01      // Offset/drift fields hold an estimate
+
+// =============================================================================
+// HOST SIDE: PER-NODE ESTIMATOR
+// =============================================================================
+class SyncEstimator {
+public:
+  SyncEstimator() { reset(); }
+
+  void reset() {
+    memset(samples, 0, sizeof(samples));
+    count = 0;
+    next = 0;
+    hasAnchor = false;
+    hasDriftRef = false;
+    anchorHostUs = 0;
+    anchorOffsetUs = 0;
+    driftRefHostUs = 0;
+    driftRefOffsetUs = 0;
+    driftPpb = 0;
+    lastDelayUs = 0;
+  }
+
+  // Feed one completed exchange
+  void addSample(uint32_t t1, uint32_t t2, uint32_t t3, uint32_t t4) {
+    int32_t delay = (int32_t)(t4 - t1) - (int32_t)(t3 - t2);
+    if (delay < 0) delay = 0;
+    lastDelayUs = (uint32_t)delay;
+
+    Sample* s = &samples[next];
+    s->hostUs = t1 + (uint32_t)delay / 2;
+    s->offsetUs = ((int32_t)(t2 - t1) + (int32_t)(t3 - t4)) / 2;
+    s->delayUs = (uint32_t)delay;
+    next = (next + 1) % SYNC_WINDOW;
+    if (count < SYNC_WINDOW) count++;
+
+    // Anchor on the least-delayed sample in the window
+    const Sample* best = &samples[0];
+    for (uint8_t i = 1; i < count; i++) {
+      if (samples[i].delayUs < best->delayUs) best = &samples[i];
+    }
+    anchorHostUs = best->hostUs;
+    anchorOffsetUs = best->offsetUs;
+    hasAnchor = true;
+
+    if (!hasDriftRef) {
+      driftRefHostUs = anchorHostUs;
+      driftRefOffsetUs = anchorOffsetUs;
+      hasDriftRef = true;
+      return;
+    }
+
+    int32_t span = (int32_t)(anchorHostUs - driftRefHostUs);
+    if (span >= SYNC_DRIFT_SPAN_US) {
+      int64_t ppb = (int64_t)(anchorOffsetUs - driftRefOffsetUs) * 1000000000LL / span;
+      if (ppb > SYNC_DRIFT_MAX_PPB) ppb = SYNC_DRIFT_MAX_PPB;
+      if (ppb < -SYNC_DRIFT_MAX_PPB) ppb = -SYNC_DRIFT_MAX_PPB;
+      driftPpb += ((int32_t)ppb - driftPpb) / 4;
+      driftRefHostUs = anchorHostUs;
+      driftRefOffsetUs = anchorOffsetUs;
+    }
+  }
+
+  bool valid() const { return hasAnchor; }
+
+  // Node clock minus host clock at the given host instant
+  int32_t offsetAt(uint32_t hostUs) const {
+    int32_t elapsed = (int32_t)(hostUs - anchorHostUs);
+    return anchorOffsetUs + (int32_t)((int64_t)elapsed * driftPpb / 1000000000LL);
+  }
+
+  uint32_t toNode(uint32_t hostUs) const { return hostUs + offsetAt(hostUs); }
+  uint32_t toHost(uint32_t nodeUs) const { return nodeUs - offsetAt(nodeUs - anchorOffsetUs); }
+
+  int32_t drift() const { return driftPpb; }
+  uint32_t delay() const { return lastDelayUs; }
+
+private:
+  struct Sample {
+    uint32_t hostUs;
+    int32_t offsetUs;
+    uint32_t delayUs;
+  };
+
+  Sample samples[SYNC_WINDOW];
+  uint8_t count;
+  uint8_t next;
+
+  bool hasAnchor;
+  bool hasDriftRef;
+  uint32_t anchorHostUs;
+  int32_t anchorOffsetUs;
+  uint32_t driftRefHostUs;
+  int32_t driftRefOffsetUs;
+  int32_t driftPpb;
+  uint32_t lastDelayUs;
+};
+
+// =============================================================================
+// NODE SIDE: HOST TIMEBASE VIEW
+// =============================================================================
+class SyncedClock {
+public:
+  SyncedClock() : synced(false), refHostUs(0), offsetUs(0), driftPpb(0) {}
+
+  // Adopt the estimate carried by a CMD_SYNC_REQ record
+  void update(const FrameRecord* req) {
+    if (req->len < 13 || !(req->data[12] & SYNC_FLAG_VALID)) return;
+    refHostUs = recordU32(req, 0);
+    offsetUs = (int32_t)recordU32(req, 4);
+    driftPpb = (int32_t)recordU32(req, 8);
+    synced = true;
+  }
+
+  bool isSynced() const { return synced; }
+
+  uint32_t toLocal(uint32_t hostUs) const {
+    int32_t elapsed = (int32_t)(hostUs - refHostUs);
+    return hostUs + offsetUs + (int32_t)((int64_t)elapsed * driftPpb / 1000000000LL);
+  }
+
+  uint32_t toHost(uint32_t localUs) const {
+    uint32_t hostUs = localUs - offsetUs;
+    return localUs - (uint32_t)(toLocal(hostUs) - hostUs);
+  }
+
+private:
+  bool synced;
+  uint32_t refHostUs;
+  int32_t offsetUs;
+  int32_t driftPpb;
+};
+
+// =============================================================================
+// RECORD BUILDERS
+// =============================================================================
+// Host → node: t1 plus the host's current estimate for that node
+inline bool frameAddSyncRequest(GameFrame* f, uint32_t t1, const SyncEstimator* est) {
+  uint8_t body[13];
+  putU32(&body[0], t1);
+  putU32(&body[4], est->valid() ? (uint32_t)est->offsetAt(t1) : 0);
+  putU32(&body[8], (uint32_t)est->drift());
+  body[12] = est->valid() ? SYNC_FLAG_VALID : 0;
+  return frameAdd(f, CMD_SYNC_REQ, body, sizeof(body));
+}
+
+// Node → host: echo t1, receive instant t2, transmit instant t3
+inline bool frameAddSyncResponse(GameFrame* f, uint32_t t1, uint32_t t2, uint32_t t3) {
+  uint8_t body[12];
+  putU32(&body[0], t1);
+  putU32(&body[4], t2);
+  putU32(&body[8], t3);
+  return frameAdd(f, CMD_SYNC_RESP, body, sizeof(body));
+}
+
+#endif // CLOCK_SYNC_H
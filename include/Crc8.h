@@ -0,0 +1,103 @@
+/*
+ * Crc8.h - CRC8 Engines (Polynomial 0x8C, reflected)
+ * Shared between Host, Display and Joysticks
+ *
+ * Three interchangeable engines, selected with -DCRC8_IMPL=...:
+ * - CRC8_IMPL_TABLE:   one 256-entry lookup per byte (default)
+ * - CRC8_IMPL_NIBBLE:  two 16-entry lookups per byte (16 bytes of table)
+ * - CRC8_IMPL_BITWISE: 8 shift/xor steps per byte, no table
+ *
+ * Both tables are generated at compile time from the same step function as
+ * the bitwise engine, so every engine produces identical bytes (checked
+ * exhaustively, and timed per packet, by env:native_crc8).
+ */
+
+#ifndef CRC8_H
+#define CRC8_H
+
+#include <stdint.h>
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define CRC8_POLY         0x8C
+
+#define CRC8_IMPL_BITWISE 0
+#define CRC8_IMPL_NIBBLE  1
+#define CRC8_IMPL_TABLE   2
+
+#ifndef CRC8_IMPL
+#define CRC8_IMPL         CRC8_IMPL_TABLE
+#endif
+
+// =============================================================================
+// COMPILE-TIME TABLE GENERATION
+// =============================================================================
+// Shift 'steps' bits out of the register (C++11 constexpr: single return)
+constexpr uint8_t crc8Shift(uint8_t crc, uint8_t steps) {
+  return steps == 0 ? crc
+       : crc8Shift((crc & 0x01) ? (uint8_t)((crc >> 1) ^ CRC8_POLY)
+                                : (uint8_t)(crc >> 1),
+                   (uint8_t)(steps - 1));
+}
+
+#define CRC8_E8(i)    crc8Shift((uint8_t)(i), 8)
+#define CRC8_E4(i)    crc8Shift((uint8_t)(i), 4)
+#define CRC8_ROW4(E, i)  E(i), E((i) + 1), E((i) + 2), E((i) + 3)
+#define CRC8_ROW16(E, i) CRC8_ROW4(E, i), CRC8_ROW4(E, (i) + 4), \
+                         CRC8_ROW4(E, (i) + 8), CRC8_ROW4(E, (i) + 12)
+#define CRC8_ROW64(E, i) CRC8_ROW16(E, i), CRC8_ROW16(E, (i) + 16), \
+                         CRC8_ROW16(E, (i) + 32), CRC8_ROW16(E, (i) + 48)
+
+// Full byte table: crc = TABLE[crc ^ byte]
+static constexpr uint8_t CRC8_TABLE[256] = {
+  CRC8_ROW64(CRC8_E8, 0),   CRC8_ROW64(CRC8_E8, 64),
+  CRC8_ROW64(CRC8_E8, 128), CRC8_ROW64(CRC8_E8, 192)
+};
+
+// Nibble table: crc = (crc >> 4) ^ NIBBLE[crc & 0x0F], twice per byte
+static constexpr uint8_t CRC8_NIBBLE[16] = {
+  CRC8_ROW16(CRC8_E4, 0)
+};
+
+// Known values of the Dallas/Maxim 0x8C table
+static_assert(CRC8_TABLE[0x01] == 0x5E && CRC8_TABLE[0x80] == 0x8C &&
+              CRC8_TABLE[0xFF] == 0x35, "CRC8 table generation broken");
+static_assert(CRC8_NIBBLE[0x01] == crc8Shift(0x01, 4), "CRC8 nibble table broken");
+
+// =============================================================================
+// ENGINES
+// =============================================================================
+inline uint8_t crc8Bitwise(const uint8_t* data, uint8_t len) {
+  uint8_t crc = 0x00;
+  while (len--) {
+    uint8_t extract = *data++;
+    for (uint8_t i = 8; i; i--) {
+      uint8_t sum = (crc ^ extract) & 0x01;
+      crc >>= 1;
+      if (sum) crc ^= CRC8_POLY;
+      extract >>= 1;
+    }
+  }
+  return crc;
+}
+
+inline uint8_t crc8Nibble(const uint8_t* data, uint8_t len) {
+  uint8_t crc = 0x00;
+  while (len--) {
+    crc ^= *data++;
+    crc = (crc >> 4) ^ CRC8_NIBBLE[crc & 0x0F];
+    crc = (crc >> 4) ^ CRC8_NIBBLE[crc & 0x0F];
+  }
+  return crc;
+}
+
+inline uint8_t crc8Table(const uint8_t* data, uint8_t len) {
+  uint8_t crc = 0x00;
+  while (len--) {
+    crc = CRC8_TABLE[crc ^ *data++];
+  }
+  return crc;
+}
+
+#endif // CRC8_H
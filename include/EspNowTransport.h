@@ -0,0 +1,153 @@
+/*
+ * EspNowTransport.h - ESP-NOW Backend for Transport
+ * ESP32 (Host, Display) and ESP8266 (Joysticks)
+ *
+ * ESP-NOW callbacks carry no context pointer, so only one instance can be
+ * active; it is registered in begin().
+ *
+ * ESP32 only: trackRssi() before begin() reads the signal strength of each
+ * ESP-NOW frame from the promiscuous receive info (management frames only),
+ * which runs in the WiFi task just before the receive callback.
+ */
+
+#ifndef ESPNOW_TRANSPORT_H
+#define ESPNOW_TRANSPORT_H
+
+#include "Transport.h"
+#include "Protocol.h"
+
+#if defined(ESP8266)
+#include <ESP8266WiFi.h>
+#include <espnow.h>
+#else
+#include <WiFi.h>
+#include <esp_wifi.h>
+#include <esp_now.h>
+#endif
+
+// =============================================================================
+// ESP-NOW TRANSPORT CLASS
+// =============================================================================
+class EspNowTransport : public Transport {
+public:
+  explicit EspNowTransport(uint8_t channel = ESPNOW_CHANNEL) :
+    channel(channel), handler(nullptr), rssiOn(false), rssi(0) {}
+
+  void trackRssi() { rssiOn = true; }
+
+  bool begin(TransportHandler* h) override {
+    handler = h;
+    active() = this;
+
+    WiFi.mode(WIFI_STA);
+    WiFi.disconnect();
+#if defined(ESP8266)
+    wifi_set_channel(channel);
+    if (esp_now_init() != 0) return false;
+    esp_now_set_self_role(ESP_NOW_ROLE_COMBO);
+#else
+    esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+    if (esp_now_init() != ESP_OK) return false;
+    if (rssiOn) {
+      wifi_promiscuous_filter_t filter = {};
+      filter.filter_mask = WIFI_PROMIS_FILTER_MASK_MGMT;
+      esp_wifi_set_promiscuous_filter(&filter);
+      esp_wifi_set_promiscuous_rx_cb(onPromiscuous);
+      esp_wifi_set_promiscuous(true);
+    }
+#endif
+
+    esp_now_register_recv_cb(onRecv);
+    esp_now_register_send_cb(onSent);
+    return addPeer(BROADCAST_MAC);
+  }
+
+  bool addPeer(const uint8_t* mac) override {
+#if defined(ESP8266)
+    if (esp_now_is_peer_exist((uint8_t*)mac)) return true;
+    return esp_now_add_peer((uint8_t*)mac, ESP_NOW_ROLE_COMBO, channel, NULL, 0) == 0;
+#else
+    if (esp_now_is_peer_exist(mac)) return true;
+    esp_now_peer_info_t peerInfo = {};
+    memcpy(peerInfo.peer_addr, mac, 6);
+    peerInfo.channel = channel;
+    peerInfo.encrypt = false;
+    peerInfo.ifidx = WIFI_IF_STA;
+    return esp_now_add_peer(&peerInfo) == ESP_OK;
+#endif
+  }
+
+  // The broadcast peer stays: begin() added it for every node
+  bool removePeer(const uint8_t* mac) override {
+    if (isBroadcastMac(mac)) return false;
+#if defined(ESP8266)
+    if (!esp_now_is_peer_exist((uint8_t*)mac)) return true;
+    return esp_now_del_peer((uint8_t*)mac) == 0;
+#else
+    if (!esp_now_is_peer_exist(mac)) return true;
+    return esp_now_del_peer(mac) == ESP_OK;
+#endif
+  }
+
+  bool send(const uint8_t* mac, const uint8_t* data, uint8_t len) override {
+#if defined(ESP8266)
+    return esp_now_send((uint8_t*)mac, (uint8_t*)data, len) == 0;
+#else
+    return esp_now_send(mac, data, len) == ESP_OK;
+#endif
+  }
+
+  void macAddress(uint8_t* mac) override {
+    WiFi.macAddress(mac);
+  }
+
+  int8_t lastRssi() override { return rssi; }
+
+private:
+#if defined(ESP8266)
+  static void onRecv(uint8_t* mac, uint8_t* data, uint8_t len) {
+    EspNowTransport* t = active();
+    if (t && t->handler) t->handler->onTransportReceive(mac, data, len);
+  }
+
+  static void onSent(uint8_t* mac, uint8_t status) {
+    EspNowTransport* t = active();
+    if (t && t->handler) t->handler->onTransportSent(mac, status == 0);
+  }
+#else
+  static void onRecv(const uint8_t* mac, const uint8_t* data, int len) {
+    if (len <= 0 || len > FRAME_MAX_SIZE) return;
+    EspNowTransport* t = active();
+    if (t && t->handler) t->handler->onTransportReceive(mac, data, (uint8_t)len);
+  }
+
+  static void onSent(const uint8_t* mac, esp_now_send_status_t status) {
+    EspNowTransport* t = active();
+    if (t && t->handler) t->handler->onTransportSent(mac, status == ESP_NOW_SEND_SUCCESS);
+  }
+
+  // ESP-NOW frame: action frame (0xD0), vendor category 127, Espressif OUI
+  static void onPromiscuous(void* buf, wifi_promiscuous_pkt_type_t type) {
+    if (type != WIFI_PKT_MGMT) return;
+    const wifi_promiscuous_pkt_t* pkt = (const wifi_promiscuous_pkt_t*)buf;
+    const uint8_t* hdr = pkt->payload;
+    if (pkt->rx_ctrl.sig_len < 28 || hdr[0] != 0xD0 || hdr[24] != 127 ||
+        hdr[25] != 0x18 || hdr[26] != 0xFE || hdr[27] != 0x34) return;
+    EspNowTransport* t = active();
+    if (t) t->rssi = (int8_t)pkt->rx_ctrl.rssi;
+  }
+#endif
+
+  uint8_t channel;
+  TransportHandler* handler;
+  bool rssiOn;
+  volatile int8_t rssi;   // Last ESP-NOW frame (ESP32 with trackRssi())
+
+  // Instance the static callbacks forward to
+  static EspNowTransport*& active() {
+    static EspNowTransport* instance = nullptr;
+    return instance;
+  }
+};
+
+#endif // ESPNOW_TRANSPORT_H
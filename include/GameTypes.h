@@ -11,7 +11,9 @@
 // =============================================================================
 // GAME CONSTANTS
 // =============================================================================
-#define MAX_PLAYERS       4
+#ifndef MAX_PLAYERS
+#define MAX_PLAYERS       4       // Up to 16 (Roster.h), e.g. -DMAX_PLAYERS=16
+#endif
 #define TOTAL_ROUNDS      5
 
 // =============================================================================
@@ -56,12 +58,12 @@ typedef enum {
 // =============================================================================
 // PLAYER DATA
 // =============================================================================
+// Joined/finished state lives in the Roster bitmasks
 typedef struct {
-  bool joined;
-  bool finished;
   uint16_t reactionTime;
   uint8_t score;
   uint8_t mac[6];
+  uint32_t reactionUs;    // Full resolution when the joystick reports it
 } Player;
 
 // =============================================================================
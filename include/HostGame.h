@@ -0,0 +1,677 @@
+/*
+ * HostGame.h - Host Game Logic
+ * Host firmware and native builds
+ *
+ * The round state machine, reliable broadcasts, clock sync and GO
+ * scheduling, without any hardware access:
+ * - Radio: any Transport (ESP-NOW on the ESP32, UDP multicast natively)
+ * - Time:  any Clock
+ * - Audio and LEDs: HostEvents callbacks plus getNeoMode()/getRoster()
+ * - Pairing: nodes join with CMD_REQ_ID, assignments kept in a PairingStore
+ * - Logging: LOG() tokens (Log.h), formatted off the device
+ * - Link quality: PeerTelemetry per node (LinkTelemetry.h), logged by
+ *   logTelemetry() and sent to the display after each round
+ *
+ * Receive callbacks only timestamp and enqueue (they may run in the WiFi
+ * task); update() processes them from the loop.
+ */
+
+#ifndef HOST_GAME_H
+#define HOST_GAME_H
+
+#include <stdint.h>
+#include <string.h>
+#include "Platform.h"
+#include "Log.h"
+#include "Transport.h"
+#include "Protocol.h"
+#include "GameTypes.h"
+#include "ReliableLink.h"
+#include "ClockSync.h"
+#include "Scheduler.h"
+#include "SpscQueue.h"
+#include "Pairing.h"
+#include "Roster.h"
+#include "LinkTelemetry.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define HOST_MAX_NODES    (MAX_PLAYERS + 1)  // Sticks + display
+#define TX_STATUS_QUEUE   32      // Send results between two update() calls
+
+// =============================================================================
+// OUTPUTS (audio, LEDs)
+// =============================================================================
+class HostEvents {
+public:
+  virtual ~HostEvents() {}
+  virtual void onIdle() {}
+  virtual void onCountdown(uint8_t num) {}
+  virtual void onGo() {}
+  virtual void onPlayerFinished(uint8_t playerIdx, uint16_t timeMs) {}
+  virtual void onWinner(uint8_t playerIdx, uint16_t timeMs) {}
+};
+
+// =============================================================================
+// HOST GAME CLASS
+// =============================================================================
+class HostGame : public TransportHandler {
+public:
+  HostGame() :
+    transport(nullptr),
+    clock(nullptr),
+    events(nullptr),
+    store(nullptr),
+    gameState(GAME_IDLE),
+    stateStartTime(0),
+    countdownNum(3),
+    neoMode(NEO_OFF),
+    nodeCount(0),
+    lastSyncTime(0),
+    nextSyncNode(0),
+    goUs(0),
+    lastResultUs(0) {
+    memset(nodeIndex, ROSTER_NO_SLOT, sizeof(nodeIndex));
+  }
+
+  // Starts the transport and restores stored pairings (store may be
+  // nullptr: nodes then rejoin after every host restart); false if the
+  // radio/socket failed
+  bool begin(Transport* t, Clock* c, HostEvents* e, PairingStore* s = nullptr) {
+    transport = t;
+    clock = c;
+    events = e;
+    store = s;
+    radioLink.begin(ID_HOST, linkSend, this);
+    radioLink.setRttHook(linkRtt);
+    if (!transport->begin(this)) return false;
+    loadPairings();
+    return true;
+  }
+
+  // Loop body
+  void update() {
+    radioLink.poll(clock->micros());
+    processSendStatus();
+    updateNodes();
+    updateClockSync();
+    updateScheduler();
+    runGame();
+  }
+
+  // WiFi task: copy and timestamp only, never block the radio
+  void onTransportReceive(const uint8_t* mac, const uint8_t* data, uint8_t len) override {
+    uint32_t rxUs = clock->micros();
+    if (len == 0 || len > FRAME_MAX_SIZE) return;
+
+    InboundPacket* pkt = rxQueue.claim();
+    if (!pkt) return;  // Full: counted by the queue
+    pkt->rxUs = rxUs;
+    memcpy(pkt->mac, mac, 6);
+    pkt->rssi = transport->lastRssi();
+    pkt->len = len;
+    memcpy(pkt->data, data, len);
+    rxQueue.publish();
+  }
+
+  void onTransportSent(const uint8_t* mac, bool ok) override {
+    radioLink.noteSendStatus(ok);
+    if (isBroadcastMac(mac)) return;   // Never ACKed by the radio
+
+    SendStatus* status = txStatus.claim();
+    if (!status) return;
+    memcpy(status->mac, mac, 6);
+    status->ok = ok;
+    txStatus.publish();
+  }
+
+  GameState getState() const { return gameState; }
+  NeoMode getNeoMode() const { return neoMode; }
+  const Roster& getRoster() const { return roster; }
+
+  // Link quality of every paired node (serial command, end of a session)
+  void logTelemetry() {
+    uint32_t now = clock->millis();
+    for (uint8_t i = 0; i < nodeCount; i++) {
+      const Node* node = &nodes[i];
+      const PeerTelemetry& t = node->link;
+      LOG(LINK_PEER, node->id, t.txOk, t.txFail, t.rxFrames, t.rssiAvg(), t.rssiMin,
+          now - node->lastSeenMs, t.rttMaxUs);
+      LOG(LINK_RTT, node->id, t.rttShare(0), t.rttShare(1), t.rttShare(2),
+          t.rttShare(3), t.rttShare(4), t.rttShare(5), t.rttShare(6));
+    }
+  }
+
+private:
+  struct Node {
+    uint8_t id;
+    uint8_t mac[6];
+    SyncEstimator sync;   // Clock estimate
+    int32_t skewUs;       // Lateness of its last scheduled action
+    bool online;          // Heard from within JOIN_LOST_MS
+    uint32_t lastSeenMs;
+    PeerTelemetry link;
+  };
+
+  typedef struct {
+    uint8_t mac[6];
+    bool ok;
+  } SendStatus;
+
+  // ===========================================================================
+  // SEND
+  // ===========================================================================
+  void sendPacket(const uint8_t* mac, uint8_t dest, uint8_t cmd, uint16_t data) {
+    GamePacket pkt;
+    buildPacket(&pkt, dest, ID_HOST, cmd, data);
+    transport->send(mac, (uint8_t*)&pkt, sizeof(pkt));
+  }
+
+  void broadcast(uint8_t cmd, uint16_t data) {
+    sendPacket(BROADCAST_MAC, ID_BROADCAST, cmd, data);
+  }
+
+  // Several commands in one v2 transmission
+  void sendFrame(const uint8_t* mac, GameFrame* frame) {
+    uint8_t len = frameFinish(frame);
+    transport->send(mac, frame->buf, len);
+  }
+
+  const uint8_t* macForId(uint8_t id) const {
+    if (id == ID_BROADCAST) return BROADCAST_MAC;
+    uint8_t i = nodeIndex[id];
+    return (i == ROSTER_NO_SLOT) ? nullptr : nodes[i].mac;
+  }
+
+  // Direct-indexed: called for every received frame
+  Node* nodeForId(uint8_t id) {
+    uint8_t i = nodeIndex[id];
+    return (i == ROSTER_NO_SLOT) ? nullptr : &nodes[i];
+  }
+
+  // ReliableLink send hook
+  static void linkSend(void* ctx, uint8_t destId, const uint8_t* data, uint8_t len) {
+    HostGame* game = (HostGame*)ctx;
+    const uint8_t* mac = game->macForId(destId);
+    if (mac) game->transport->send(mac, data, len);
+  }
+
+  // ReliableLink RTT hook: ACK round trips
+  static void linkRtt(void* ctx, uint8_t id, uint32_t rttUs) {
+    Node* node = ((HostGame*)ctx)->nodeForId(id);
+    if (node) node->link.noteRtt(rttUs);
+  }
+
+  // Broadcast that every joystick must acknowledge (retransmitted if lost)
+  void broadcastReliable(GameFrame* frame) {
+    if (!radioLink.send(frame, clock->micros())) {
+      LOG(HOST_LINK_BUSY);
+      sendFrame(BROADCAST_MAC, frame);
+    }
+  }
+
+  // ===========================================================================
+  // PAIRING
+  // ===========================================================================
+  // Known node: kept in clock sync; sticks must acknowledge reliable
+  // broadcasts once they are online. Replaces the MAC of an existing ID.
+  Node* setNode(uint8_t id, const uint8_t* mac) {
+    Node* node = nodeForId(id);
+    if (!node) {
+      if (nodeCount >= HOST_MAX_NODES) return nullptr;
+      nodeIndex[id] = nodeCount;
+      node = &nodes[nodeCount++];
+      node->id = id;
+    } else {
+      if (node->online && id != ID_DISPLAY) radioLink.removePeer(id);
+      // The old MAC would hold one of the radio's few peer slots forever
+      if (memcmp(node->mac, mac, 6) != 0) transport->removePeer(node->mac);
+    }
+    if (id != ID_DISPLAY) radioLink.resetPeer(id);
+    memcpy(node->mac, mac, 6);
+    node->sync.reset();
+    node->skewUs = 0;
+    node->online = false;
+    node->lastSeenMs = 0;
+    node->link.reset();
+    transport->addPeer(mac);
+    return node;
+  }
+
+  void markSeen(Node* node) {
+    node->lastSeenMs = clock->millis();
+    if (node->online) return;
+    node->online = true;
+    if (node->id != ID_DISPLAY) radioLink.addPeer(node->id);
+    LOG(PAIR_NODE_ONLINE, node->id);
+  }
+
+  PlayerMask onlineSticks() const {
+    PlayerMask mask = 0;
+    for (uint8_t i = 0; i < nodeCount; i++) {
+      uint8_t slot = roster.slotOf(nodes[i].id);
+      if (nodes[i].online && slot != ROSTER_NO_SLOT) mask |= (PlayerMask)(1U << slot);
+    }
+    return mask;
+  }
+
+  // A known MAC keeps its ID; a new one gets the lowest free ID, or replaces
+  // the stick that has been offline longest. ID_NEW if every stick is online.
+  uint8_t assignStickId(const uint8_t* mac) {
+    for (uint8_t i = 0; i < nodeCount; i++) {
+      if (Roster::isStickId(nodes[i].id) && memcmp(nodes[i].mac, mac, 6) == 0) return nodes[i].id;
+    }
+    for (uint8_t id = ID_STICK1; Roster::isStickId(id); id++) {
+      if (!nodeForId(id)) return id;
+    }
+    Node* oldest = nullptr;
+    for (uint8_t i = 0; i < nodeCount; i++) {
+      Node* node = &nodes[i];
+      if (!Roster::isStickId(node->id) || node->online) continue;
+      if (!oldest || (int32_t)(node->lastSeenMs - oldest->lastSeenMs) < 0) oldest = node;
+    }
+    return oldest ? oldest->id : ID_NEW;
+  }
+
+  // CMD_REQ_ID: assign, persist if changed, confirm to the requesting MAC
+  void handleJoin(uint8_t srcId, const uint8_t* mac) {
+    uint8_t id = (srcId == ID_DISPLAY) ? ID_DISPLAY : assignStickId(mac);
+    if (id == ID_NEW) {
+      LOG(PAIR_REFUSED);
+      return;
+    }
+
+    Node* node = nodeForId(id);
+    if (!node || memcmp(node->mac, mac, 6) != 0) {
+      node = setNode(id, mac);
+      if (!node) return;
+      savePairings();
+      LOG(PAIR_PAIRED, id, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    } else {
+      // Rejoin: the node restarted, its clock and sequence numbers with it
+      node->sync.reset();
+      radioLink.resetPeer(id);
+    }
+    markSeen(node);
+
+    // Unicast, so concurrent joins of several ID_NEW sticks cannot mix up
+    sendPacket(mac, srcId, CMD_OK, id);
+  }
+
+  void loadPairings() {
+    if (!store) return;
+    PairingEntry entries[PAIRING_MAX];
+    uint8_t n = store->load(entries, PAIRING_MAX);
+    for (uint8_t i = 0; i < n; i++) {
+      if (Roster::isStickId(entries[i].id) || entries[i].id == ID_DISPLAY) {
+        setNode(entries[i].id, entries[i].mac);
+      }
+    }
+    LOG(PAIR_LOADED, nodeCount);
+  }
+
+  // Only on change: NVS writes wear the flash
+  void savePairings() {
+    if (!store) return;
+    PairingEntry entries[HOST_MAX_NODES];
+    for (uint8_t i = 0; i < nodeCount; i++) {
+      entries[i].id = nodes[i].id;
+      memcpy(entries[i].mac, nodes[i].mac, 6);
+    }
+    if (!store->save(entries, nodeCount)) {
+      LOG(PAIR_SAVE_FAILED);
+    }
+  }
+
+  // Nodes that stopped answering clock sync no longer hold up broadcasts
+  void updateNodes() {
+    uint32_t now = clock->millis();
+    for (uint8_t i = 0; i < nodeCount; i++) {
+      Node* node = &nodes[i];
+      if (!node->online || now - node->lastSeenMs <= JOIN_LOST_MS) continue;
+      node->online = false;
+      if (node->id != ID_DISPLAY) radioLink.removePeer(node->id);
+      LOG(PAIR_NODE_OFFLINE, node->id);
+    }
+  }
+
+  // ===========================================================================
+  // RECEIVE
+  // ===========================================================================
+  void handleCommand(uint8_t srcId, const FrameRecord* rec, uint32_t rxUs) {
+    // Clock sync reply: t4 is the receive instant
+    if (rec->cmd == CMD_SYNC_RESP && rec->len >= 12) {
+      Node* node = nodeForId(srcId);
+      if (node) {
+        uint32_t t1 = recordU32(rec, 0), t2 = recordU32(rec, 4), t3 = recordU32(rec, 8);
+        node->sync.addSample(t1, t2, t3, rxUs);
+        node->link.noteRtt((rxUs - t1) - (t3 - t2));
+      }
+      return;
+    }
+
+    // How late a node ran a scheduled command
+    if (rec->cmd == CMD_SKEW_REPORT && rec->len >= 5) {
+      Node* node = nodeForId(srcId);
+      if (node) node->skewUs = (int32_t)recordU32(rec, 1);
+      return;
+    }
+
+    // Handle joystick responses
+    uint8_t slot = roster.slotOf(srcId);
+    if (slot == ROSTER_NO_SLOT) return;
+
+    if (rec->cmd == CMD_REACTION_US && rec->len >= 4) {
+      // Follows CMD_REACTION_DONE in the same frame
+      if (roster.isFinished(slot)) roster.setReactionUs(slot, recordU32(rec));
+      return;
+    }
+
+    if (rec->cmd == CMD_REACTION_DONE && roster.finish(slot, recordU16(rec))) {
+      uint16_t timeMs = roster.player(slot).reactionTime;
+      lastResultUs = rxUs;
+
+      LOG(HOST_PLAYER_DONE, slot + 1, timeMs);
+      events->onPlayerFinished(slot, timeMs);
+    }
+  }
+
+  // Process everything received since the last pass
+  void processInbound() {
+    InboundPacket* pkt;
+    while ((pkt = rxQueue.peek()) != nullptr) {
+      // ACKs, duplicates and retransmissions are handled by the link
+      if (radioLink.onReceive(pkt->data, pkt->len, pkt->rxUs)) {
+        FrameReader reader;
+        if (frameOpen(&reader, pkt->data, pkt->len)) {
+          // Only paired nodes, from the MAC they paired with
+          Node* node = nodeForId(reader.src_id);
+          bool known = node && memcmp(node->mac, pkt->mac, 6) == 0;
+          if (known) {
+            markSeen(node);
+            node->link.noteReceive(pkt->rssi);
+          }
+
+          FrameRecord rec;
+          while (frameNext(&reader, &rec)) {
+            if (rec.cmd == CMD_REQ_ID) {
+              handleJoin(reader.src_id, pkt->mac);
+            } else if (known) {
+              handleCommand(reader.src_id, &rec, pkt->rxUs);
+            }
+          }
+        }
+      }
+      rxQueue.pop();
+    }
+  }
+
+  // Radio-level delivery of unicast frames, by destination MAC
+  void processSendStatus() {
+    SendStatus* status;
+    while ((status = txStatus.peek()) != nullptr) {
+      for (uint8_t i = 0; i < nodeCount; i++) {
+        if (memcmp(nodes[i].mac, status->mac, 6) == 0) {
+          nodes[i].link.noteSent(status->ok);
+          break;
+        }
+      }
+      txStatus.pop();
+    }
+  }
+
+  // ===========================================================================
+  // CLOCK SYNC
+  // ===========================================================================
+  // One exchange per call, round-robin over the synced nodes
+  void sendSyncRequest(Node* node) {
+    GameFrame frame;
+    frameBegin(&frame, node->id, ID_HOST);
+    uint32_t t1 = clock->micros();
+    frameAddSyncRequest(&frame, t1, &node->sync);
+    sendFrame(node->mac, &frame);
+  }
+
+  void updateClockSync() {
+    if (nodeCount == 0) return;
+    uint32_t now = clock->millis();
+    uint32_t period = (gameState == GAME_REACTION_ACTIVE) ? SYNC_PERIOD_MS : SYNC_PERIOD_IDLE_MS;
+    if (now - lastSyncTime < period / nodeCount) return;
+
+    lastSyncTime = now;
+    sendSyncRequest(&nodes[nextSyncNode]);
+    nextSyncNode = (nextSyncNode + 1) % nodeCount;
+  }
+
+  // ===========================================================================
+  // SCHEDULED ACTIONS
+  // ===========================================================================
+  // Runs on the host at the same host instant the other nodes run it
+  static void runScheduled(void* ctx, const FrameRecord* rec, uint32_t targetUs) {
+    HostGame* game = (HostGame*)ctx;
+    if (rec->cmd == CMD_VIBRATE && (recordU16(rec) & 0xFF) == VIBRATE_GO) {
+      game->neoMode = NEO_FIXED_COLOR;
+      game->events->onGo();
+      game->gameState = GAME_REACTION_ACTIVE;
+      game->stateStartTime = game->clock->millis();
+      LOG(HOST_GO);
+    }
+  }
+
+  // Busy-wait the last stretch so loop latency does not add jitter
+  void updateScheduler() {
+    uint32_t atUs = 0;
+    if (!scheduler.nextDue(&atUs) || (int32_t)(atUs - clock->micros()) > SCHED_SPIN_US) return;
+    clock->waitUntil(atUs);
+    scheduler.run(clock->micros(), runScheduled, this);
+  }
+
+  // ===========================================================================
+  // GAME STATE MACHINE
+  // ===========================================================================
+  void runGame() {
+    processInbound();
+    uint32_t now = clock->millis();
+
+    switch (gameState) {
+      case GAME_IDLE:
+        if (stateStartTime == 0) {
+          stateStartTime = now;
+          neoMode = NEO_IDLE_RAINBOW;
+
+          // No round in progress: reports are ignored until COUNTDOWN
+          roster.startRound(0);
+
+          broadcast(CMD_IDLE, 0);
+          events->onIdle();
+
+          LOG(HOST_IDLE);
+        }
+
+        // Auto-start after DURATION_IDLE
+        if (now - stateStartTime > DURATION_IDLE) {
+          gameState = GAME_COUNTDOWN;
+          stateStartTime = 0;
+          countdownNum = 3;
+        }
+        break;
+
+      case GAME_COUNTDOWN:
+        if (stateStartTime == 0) {
+          stateStartTime = now;
+          neoMode = NEO_COUNTDOWN;
+          events->onCountdown(countdownNum);
+
+          // Round roster: sticks online at round start
+          roster.startRound(onlineSticks());
+
+          // Round start + first tick in one transmission
+          GameFrame frame;
+          frameBegin(&frame, ID_BROADCAST, ID_HOST);
+          frameAddU16(&frame, CMD_GAME_START, (MODE_REACTION << 8));
+          frameAddU16(&frame, CMD_COUNTDOWN, countdownNum);
+          broadcastReliable(&frame);
+
+          LOG(HOST_COUNTDOWN, countdownNum);
+        }
+
+        if (now - stateStartTime > 1000) {
+          countdownNum--;
+          if (countdownNum > 0) {
+            stateStartTime = now;
+            events->onCountdown(countdownNum);
+            broadcast(CMD_COUNTDOWN, countdownNum);
+            LOG(HOST_COUNTDOWN, countdownNum);
+          } else {
+            gameState = GAME_REACTION_WAIT;
+            stateStartTime = 0;
+          }
+        }
+        break;
+
+      case GAME_REACTION_WAIT:
+        if (stateStartTime == 0) {
+          stateStartTime = now;
+
+          // GO is scheduled slightly ahead so every node (joysticks, display,
+          // host LEDs and beep) can switch at the same synchronized instant
+          goUs = clock->micros() + SCHED_LEAD_US;
+          uint8_t goData[2] = { 0, VIBRATE_GO };
+          FrameRecord go = { CMD_VIBRATE, sizeof(goData), goData };
+          scheduler.schedule(goUs, &go);
+
+          GameFrame frame;
+          frameBegin(&frame, ID_BROADCAST, ID_HOST);
+          frameAddFireAt(&frame, goUs);
+          frameAdd(&frame, go.cmd, go.data, go.len);
+          broadcastReliable(&frame);
+        }
+        // runScheduled() moves on to GAME_REACTION_ACTIVE at the GO instant
+        break;
+
+      case GAME_REACTION_ACTIVE: {
+        // Check if every player finished or timeout
+        bool timeout = (now - stateStartTime > TIMEOUT_REACTION);
+
+        if (roster.allDone() || timeout) {
+          roster.penalizeUnfinished();
+          gameState = GAME_RESULTS;
+          stateStartTime = 0;
+        }
+        break;
+      }
+
+      case GAME_RESULTS:
+        if (stateStartTime == 0) {
+          stateStartTime = now;
+          neoMode = NEO_STATUS;
+          showResults();
+        }
+
+        // Return to IDLE after DURATION_RESULTS
+        if (now - stateStartTime > DURATION_RESULTS) {
+          gameState = GAME_IDLE;
+          stateStartTime = 0;
+        }
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  void showResults() {
+    uint8_t order[MAX_PLAYERS], place[MAX_PLAYERS];
+    uint8_t ranked = roster.rank(order, place);
+
+    // All player times in one transmission, in finishing order
+    LOG(HOST_RESULTS);
+    GameFrame frame;
+    frameBegin(&frame, ID_BROADCAST, ID_HOST);
+    for (uint8_t k = 0; k < ranked; k++) {
+      const Player& p = roster.player(order[k]);
+      LOG(HOST_RANK, place[k], order[k] + 1, p.reactionTime, p.reactionUs);
+      uint8_t result[3] = {
+        Roster::idOf(order[k]),
+        (uint8_t)(p.reactionTime >> 8),
+        (uint8_t)(p.reactionTime & 0xFF)
+      };
+      frameAdd(&frame, CMD_RESULT, result, sizeof(result));
+    }
+    sendFrame(BROADCAST_MAC, &frame);
+
+    const LinkStats& ls = radioLink.getStats();
+    LOG(HOST_LINK_STATS, ls.sent, ls.retries, ls.drops, ls.dupes, ls.macFails);
+    for (uint8_t i = 0; i < nodeCount; i++) {
+      LOG(HOST_NODE_SYNC,
+          nodes[i].id, nodes[i].sync.offsetAt(clock->micros()), nodes[i].sync.drift(),
+          nodes[i].sync.delay(), nodes[i].skewUs);
+    }
+    LOG(HOST_GO_SKEW, scheduler.skew().lastUs);
+    LOG(HOST_RX_QUEUE, rxQueue.peakDepth(), rxQueue.capacity(), rxQueue.overflowCount());
+    sendTelemetry();
+    if (ranked && !roster.isPenalty(order[0])) {
+      LOG(HOST_LAST_RESULT, lastResultUs - goUs);
+    }
+
+    // Determine winner (microsecond resolution)
+    uint8_t winner = roster.winner();
+    if (winner != NO_WINNER) {
+      LOG(HOST_WINNER, winner + 1);
+      events->onWinner(winner, roster.player(winner).reactionTime);
+    } else {
+      LOG(HOST_NO_WINNER);
+    }
+  }
+
+  // CMD_PEER_STATS for every node, as many frames as it takes (unreliable:
+  // the next round sends fresh figures)
+  void sendTelemetry() {
+    Node* display = nodeForId(ID_DISPLAY);
+    if (!display || !display->online) return;
+
+    uint32_t now = clock->millis();
+    GameFrame frame;
+    frameBegin(&frame, ID_DISPLAY, ID_HOST);
+    for (uint8_t i = 0; i < nodeCount; i++) {
+      uint8_t rec[TELEM_RECORD_SIZE];
+      nodes[i].link.encode(nodes[i].id, now - nodes[i].lastSeenMs, rec);
+      if (!frameAdd(&frame, CMD_PEER_STATS, rec, sizeof(rec))) {
+        sendFrame(display->mac, &frame);
+        frameBegin(&frame, ID_DISPLAY, ID_HOST);
+        frameAdd(&frame, CMD_PEER_STATS, rec, sizeof(rec));
+      }
+    }
+    sendFrame(display->mac, &frame);
+  }
+
+  Transport* transport;
+  Clock* clock;
+  HostEvents* events;
+  PairingStore* store;
+
+  ReliableLink radioLink;
+  ActionScheduler scheduler;
+
+  // Receive callback (WiFi task) → game loop; the callback only enqueues
+  SpscQueue<InboundPacket, RX_QUEUE_SIZE> rxQueue;
+  SpscQueue<SendStatus, TX_STATUS_QUEUE> txStatus;
+
+  GameState gameState;
+  Roster roster;
+  uint32_t stateStartTime;
+  uint8_t countdownNum;
+  NeoMode neoMode;
+
+  Node nodes[HOST_MAX_NODES];
+  uint8_t nodeCount;
+  uint8_t nodeIndex[256];   // Node ID → nodes[] index, ROSTER_NO_SLOT if unknown
+  uint32_t lastSyncTime;
+  uint8_t nextSyncNode;
+
+  uint32_t goUs;          // Host instant of the last GO
+  uint32_t lastResultUs;  // Arrival of the last reaction
+};
+
+#endif // HOST_GAME_H
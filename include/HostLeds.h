@@ -0,0 +1,125 @@
+/*
+ * HostLeds.h - Ring Scenes for the Host Game
+ * Host firmware and native builds
+ *
+ * Turns the game's NeoMode and player results into LedCompositor layers:
+ *   NEO_IDLE_RAINBOW  background rainbow across all rings
+ *   NEO_COUNTDOWN     background red blink
+ *   NEO_FIXED_COLOR   background green (GO); finished players on the
+ *                     status layer, with a white flash that fades out
+ *   NEO_STATUS        player rings green/red by round membership, the
+ *                     center ring cycling through the wheel
+ *   NEO_OFF           everything off
+ * Layers are set when the mode changes; render() draws any instant.
+ *
+ * draw() is the loop's entry point: a layer change (GO, a result) is drawn
+ * at once, pure animation at most LED_MAX_FPS times per second, and
+ * nothing while the scene is static.
+ */
+
+#ifndef HOST_LEDS_H
+#define HOST_LEDS_H
+
+#include <stdint.h>
+#include "GameTypes.h"
+#include "Roster.h"
+#include "LedCompositor.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define LED_RAINBOW_MS    12800   // Idle rainbow: one turn (1/256 per 50 ms)
+#define LED_SPIN_MS       1000    // Results: center ring color cycle
+#define LED_BLINK_MS      500     // Countdown: 250 ms on, 250 ms off
+#define LED_FLASH_MS      300     // Player finished: flash fade-out
+#define LED_FLASH_COLOR   0xFFFFFF
+#define RING_CENTER       2
+
+#ifndef LED_MAX_FPS
+#define LED_MAX_FPS       100     // Animation frames per second
+#endif
+#define LED_FRAME_MS      (1000 / LED_MAX_FPS)
+
+// =============================================================================
+// HOST LEDS CLASS
+// =============================================================================
+class HostLeds {
+public:
+  HostLeds() : mode(NEO_OFF), started(false), lastDrawMs(0), renders(0) {}
+
+  void setBrightness(uint8_t brightness) { fx.setBrightness(brightness); }
+
+  // Every loop: rebuilds the layers when the game changes mode
+  void update(NeoMode m, const Roster& roster, uint32_t nowMs) {
+    if (started && m == mode) return;
+    started = true;
+    mode = m;
+
+    fx.clearLayer(LAYER_STATUS);
+    fx.clearLayer(LAYER_FLASH);
+    for (uint8_t ring = 0; ring < NUM_RINGS; ring++) {
+      switch (m) {
+        case NEO_IDLE_RAINBOW:
+          fx.animate(ring, LAYER_BACKGROUND, FX_RAINBOW, 0, LED_RAINBOW_MS, 0);
+          break;
+
+        case NEO_COUNTDOWN:
+          fx.animate(ring, LAYER_BACKGROUND, FX_BLINK, COLOR_RED, LED_BLINK_MS, nowMs);
+          break;
+
+        case NEO_FIXED_COLOR:
+          fx.solid(ring, LAYER_BACKGROUND, COLOR_GREEN);
+          break;
+
+        case NEO_STATUS:
+          if (ring == RING_CENTER) {
+            fx.animate(ring, LAYER_BACKGROUND, FX_SPIN, 0, LED_SPIN_MS, nowMs);
+          } else {
+            uint8_t player = (ring < RING_CENTER) ? ring : ring - 1;
+            fx.solid(ring, LAYER_BACKGROUND, roster.isJoined(player) ? COLOR_GREEN : COLOR_RED);
+          }
+          break;
+
+        default:
+          fx.clear(ring, LAYER_BACKGROUND);
+          break;
+      }
+    }
+  }
+
+  // Players 1-4 have a ring
+  void playerFinished(uint8_t playerIdx, bool penalty, uint32_t nowMs) {
+    if (playerIdx >= NUM_RINGS - 1) return;
+    uint8_t ring = playerToRing(playerIdx);
+    fx.solid(ring, LAYER_STATUS, penalty ? COLOR_RED : COLOR_GREEN);
+    fx.animate(ring, LAYER_FLASH, FX_FADE, LED_FLASH_COLOR, LED_FLASH_MS, nowMs);
+  }
+
+  // R G B per LED (LED_FRAME_BYTES), unconditionally
+  void render(uint32_t nowMs, uint8_t* out) { fx.render(nowMs, out); }
+
+  // Renders into out only if the frame may have changed and is due; true
+  // if out was written
+  bool draw(uint32_t nowMs, uint8_t* out) {
+    if (!fx.isDirty()) {
+      if (!fx.isAnimating() || nowMs - lastDrawMs < LED_FRAME_MS) return false;
+    }
+    fx.render(nowMs, out);
+    lastDrawMs = nowMs;
+    renders++;
+    return true;
+  }
+
+  uint32_t renderCount() const { return renders; }
+
+  LedCompositor& compositor() { return fx; }
+
+private:
+  LedCompositor fx;
+  NeoMode mode;
+  bool started;
+  uint32_t lastDrawMs;
+  uint32_t renders;
+};
+
+#endif // HOST_LEDS_H
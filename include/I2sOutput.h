@@ -0,0 +1,126 @@
+/*
+ * I2sOutput.h - Direct I2S DMA Output (ESP32 legacy I2S driver)
+ * Host only
+ *
+ * Replaces ESP8266Audio's AudioOutputI2S. The driver is installed once at
+ * AUDIO_RATE and keeps clocking: with nothing to send the DMA repeats
+ * zeros (tx_desc_auto_clear), so starting a sound is one i2s_write() into
+ * a free DMA buffer, with no driver start, pin setup or rate change in the
+ * way. Every clip reaches it already converted (AudioEngine.h), so the
+ * clock is never reprogrammed between two clips.
+ *
+ * write() takes mono frames, as many as fit in the DMA buffers, applies
+ * the volume and duplicates them to both slots (the MAX98357A mixes L+R).
+ * The DAC plays a frame after what is already queued, at most
+ * AUDIO_DMA_BUFFERS × AUDIO_DMA_FRAMES frames.
+ *
+ * Underruns are reckoned from the frames written and micros()
+ * (UnderrunMeter.h); the check runs on the first write after poll() or
+ * after the DMA was full, not per frame.
+ */
+
+#ifndef I2S_OUTPUT_H
+#define I2S_OUTPUT_H
+
+#include <Arduino.h>
+#include <driver/i2s.h>
+#include "AudioEngine.h"
+#include "UnderrunMeter.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#ifndef AUDIO_I2S_PORT
+#define AUDIO_I2S_PORT    I2S_NUM_0
+#endif
+
+// =============================================================================
+// I2S OUTPUT CLASS
+// =============================================================================
+class I2sOutput : public AudioSink {
+public:
+  I2sOutput() : installed(false), gain(256) {}
+
+  bool install(int bclk, int lrc, int dout) {
+    if (installed) return true;
+    i2s_config_t config = {};
+    config.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX);
+    config.sample_rate = AUDIO_RATE;
+    config.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+    config.channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT;
+    config.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+    config.intr_alloc_flags = ESP_INTR_FLAG_LEVEL1;
+    config.dma_buf_count = AUDIO_DMA_BUFFERS;
+    config.dma_buf_len = AUDIO_DMA_FRAMES;
+    config.use_apll = false;
+    config.tx_desc_auto_clear = true;   // Silence, not the last buffer, when starved
+    if (i2s_driver_install(AUDIO_I2S_PORT, &config, 0, nullptr) != ESP_OK) return false;
+
+    i2s_pin_config_t pins = {};
+    pins.mck_io_num = I2S_PIN_NO_CHANGE;
+    pins.bck_io_num = bclk;
+    pins.ws_io_num = lrc;
+    pins.data_out_num = dout;
+    pins.data_in_num = I2S_PIN_NO_CHANGE;
+    if (i2s_set_pin(AUDIO_I2S_PORT, &pins) != ESP_OK) return false;
+    i2s_zero_dma_buffer(AUDIO_I2S_PORT);
+    installed = true;
+    return true;
+  }
+
+  // 0.0 - 4.0, above 1.0 clipped at full scale
+  void setGain(float g) {
+    if (g < 0.0f) g = 0.0f;
+    if (g > 4.0f) g = 4.0f;
+    gain = (int32_t)(g * 256.0f);
+  }
+
+  uint32_t write(const int16_t* mono, uint32_t count) override {
+    int16_t chunk[AUDIO_DMA_FRAMES * 2];
+    uint32_t done = 0;
+    while (done < count) {
+      uint32_t n = count - done;
+      if (n > AUDIO_DMA_FRAMES) n = AUDIO_DMA_FRAMES;
+      for (uint32_t i = 0; i < n; i++) {
+        int32_t v = (mono[done + i] * gain) >> 8;
+        if (v > 32767) v = 32767;
+        if (v < -32768) v = -32768;
+        chunk[i * 2] = (int16_t)v;
+        chunk[i * 2 + 1] = (int16_t)v;
+      }
+      size_t written = 0;
+      i2s_write(AUDIO_I2S_PORT, chunk, n * 4, &written, 0);
+      uint32_t took = written / 4;
+      if (took) meter.accepted(took, meter.due() ? (uint32_t)micros() : 0);
+      done += took;
+      if (took < n) {
+        meter.poll();
+        break;
+      }
+    }
+    return done;
+  }
+
+  // Preemption: zeros over everything queued. The DMA still plays them
+  // out, so the next write starts at most one DMA depth later.
+  void flush() override {
+    i2s_zero_dma_buffer(AUDIO_I2S_PORT);
+    meter.endStream();
+  }
+
+  // Once per refill pass: the next write checks for an underrun
+  void poll() { meter.poll(); }
+
+  // The queue ran out; silence from here on is not an underrun
+  void endStream() { meter.endStream(); }
+
+  uint32_t framesWritten() const { return meter.getStats().frames; }
+  const AudioOutStats& getStats() const { return meter.getStats(); }
+
+private:
+  bool installed;
+  int32_t gain;           // Q8
+  UnderrunMeter meter;
+};
+
+#endif // I2S_OUTPUT_H
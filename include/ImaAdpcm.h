@@ -0,0 +1,124 @@
+/*
+ * ImaAdpcm.h - IMA-ADPCM Blocks (WAV layout, mono)
+ * Host firmware and native builds
+ *
+ * scripts/copy_data.py can store sound bank clips as IMA-ADPCM instead
+ * of MP3: 4 bits per sample, decoded with a table lookup, a shift-and-add
+ * and a clamp per sample, where an MP3 frame costs a Huffman decode, an
+ * IMDCT and a polyphase filterbank. Layout as in a mono IMA ADPCM WAV
+ * (fmt 0x11), so any WAV tool can check an encoder:
+ *   [int16 first sample][uint8 step index][uint8 0][data]
+ * data: two samples per byte, low nibble first. A block of
+ * ADPCM_BLOCK_BYTES holds ADPCM_BLOCK_FRAMES samples; the last block of a
+ * clip may be shorter. Each block restarts the predictor, so a clip is
+ * decoded block by block from any block boundary.
+ *
+ * adpcmEncodeBlock() is the reference encoder (native tools; the build
+ * step has its own in Python, the same algorithm).
+ */
+
+#ifndef IMA_ADPCM_H
+#define IMA_ADPCM_H
+
+#include <stdint.h>
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define ADPCM_BLOCK_BYTES   256
+#define ADPCM_HEADER_BYTES  4
+#define ADPCM_BLOCK_FRAMES  (1 + (ADPCM_BLOCK_BYTES - ADPCM_HEADER_BYTES) * 2)    // 505
+
+// =============================================================================
+// TABLES
+// =============================================================================
+static const int16_t ADPCM_STEPS[89] = {
+  7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+  50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+  253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+  1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+  3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+  11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+  32767
+};
+
+static const int8_t ADPCM_INDEX[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+// =============================================================================
+// DECODING
+// =============================================================================
+// One nibble into the predictor; returns the new sample
+static inline int16_t adpcmStep(uint8_t nibble, int32_t* predictor, int8_t* index) {
+  int32_t step = ADPCM_STEPS[*index];
+  int32_t diff = step >> 3;
+  if (nibble & 4) diff += step;
+  if (nibble & 2) diff += step >> 1;
+  if (nibble & 1) diff += step >> 2;
+  int32_t p = (nibble & 8) ? *predictor - diff : *predictor + diff;
+  if (p > 32767) p = 32767;
+  if (p < -32768) p = -32768;
+  *predictor = p;
+
+  int8_t i = *index + ADPCM_INDEX[nibble & 7];
+  *index = i < 0 ? 0 : (i > 88 ? 88 : i);
+  return (int16_t)p;
+}
+
+// Samples in a block of bytes (the last one of a clip may be short)
+static inline uint32_t adpcmBlockFrames(uint32_t bytes) {
+  return bytes > ADPCM_HEADER_BYTES ? 1 + (bytes - ADPCM_HEADER_BYTES) * 2 :
+         (bytes == ADPCM_HEADER_BYTES ? 1 : 0);
+}
+
+// Decodes one block into out (room for adpcmBlockFrames(bytes)); returns
+// the samples written
+static inline uint32_t adpcmDecodeBlock(const uint8_t* block, uint32_t bytes, int16_t* out) {
+  if (bytes < ADPCM_HEADER_BYTES) return 0;
+  int32_t predictor = (int16_t)(block[0] | (block[1] << 8));
+  int8_t index = block[2] > 88 ? 88 : (int8_t)block[2];
+  uint32_t n = 0;
+  out[n++] = (int16_t)predictor;
+  for (uint32_t i = ADPCM_HEADER_BYTES; i < bytes; i++) {
+    out[n++] = adpcmStep(block[i] & 0x0F, &predictor, &index);
+    out[n++] = adpcmStep(block[i] >> 4, &predictor, &index);
+  }
+  return n;
+}
+
+// =============================================================================
+// ENCODING
+// =============================================================================
+// Encodes up to ADPCM_BLOCK_FRAMES samples starting with in[0]; index
+// carries the step index from block to block. Returns the bytes written
+// (an odd sample count leaves the last high nibble 0).
+static inline uint32_t adpcmEncodeBlock(const int16_t* in, uint32_t frames, int8_t* index,
+                                        uint8_t* block) {
+  if (!frames) return 0;
+  if (frames > ADPCM_BLOCK_FRAMES) frames = ADPCM_BLOCK_FRAMES;
+  int32_t predictor = in[0];
+  block[0] = (uint8_t)(in[0] & 0xFF);
+  block[1] = (uint8_t)((in[0] >> 8) & 0xFF);
+  block[2] = (uint8_t)*index;
+  block[3] = 0;
+  uint32_t bytes = ADPCM_HEADER_BYTES;
+  for (uint32_t i = 1; i < frames; i++) {
+    int32_t step = ADPCM_STEPS[*index];
+    int32_t diff = in[i] - predictor;
+    uint8_t nibble = 0;
+    if (diff < 0) {
+      nibble = 8;
+      diff = -diff;
+    }
+    if (diff >= step) { nibble |= 4; diff -= step; }
+    if (diff >= step >> 1) { nibble |= 2; diff -= step >> 1; }
+    if (diff >= step >> 2) nibble |= 1;
+    adpcmStep(nibble, &predictor, index);
+
+    if (i & 1) block[bytes] = nibble;
+    else block[bytes++] |= (uint8_t)(nibble << 4);
+  }
+  if (!(frames & 1)) bytes++;     // Last byte has only its low nibble
+  return bytes;
+}
+
+#endif // IMA_ADPCM_H
@@ -0,0 +1,113 @@
+/*
+ * InputCapture.h - Interrupt-timestamped Button Presses
+ * Joysticks only
+ *
+ * The GPIO edge interrupt calls onEdge() with micros() and the pin level;
+ * edges go through a small lock-free ring (ISR writes head, loop writes
+ * tail) and nextPress() turns them into debounced presses. A press keeps
+ * the timestamp of its FIRST falling edge, so debouncing costs no accuracy.
+ * A press ends once the line has been released for CAPTURE_DEBOUNCE_US.
+ *
+ * No platform calls: feed it any edge source, including recorded ones
+ * (env:native_input replays synthetic bounce trains).
+ */
+
+#ifndef INPUT_CAPTURE_H
+#define INPUT_CAPTURE_H
+
+#include <stdint.h>
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define CAPTURE_QUEUE_SIZE  16      // Power of two
+#define CAPTURE_DEBOUNCE_US 5000
+
+// Keep the ISR path in IRAM on the ESP cores
+#ifdef IRAM_ATTR
+#define CAPTURE_ISR_ATTR    IRAM_ATTR
+#else
+#define CAPTURE_ISR_ATTR
+#endif
+
+// =============================================================================
+// INPUT CAPTURE CLASS (active-low button)
+// =============================================================================
+class InputCapture {
+public:
+  InputCapture() :
+    head(0),
+    tail(0),
+    overflows(0),
+    pressed(false),
+    rawLevel(1),
+    rawUs(0) {}
+
+  // ISR: record one edge. Drops (and counts) edges when the ring is full
+  CAPTURE_ISR_ATTR void onEdge(uint32_t us, uint8_t level) {
+    uint8_t h = head;
+    uint8_t next = (h + 1) & (CAPTURE_QUEUE_SIZE - 1);
+    if (next == tail) {
+      overflows++;
+      return;
+    }
+    edges[h].us = us;
+    edges[h].level = level;
+    head = next;
+  }
+
+  // Loop: next debounced press, oldest first
+  bool nextPress(uint32_t* pressUs, uint32_t nowUs) {
+    while (tail != head) {
+      uint8_t t = tail;
+      uint32_t us = edges[t].us;
+      uint8_t level = edges[t].level;
+      tail = (t + 1) & (CAPTURE_QUEUE_SIZE - 1);
+
+      releaseIfSettled(us);
+      bool fresh = (level == 0 && !pressed);
+      rawLevel = level;
+      rawUs = us;
+      if (fresh) {
+        pressed = true;
+        *pressUs = us;
+        return true;
+      }
+    }
+
+    releaseIfSettled(nowUs);
+    return false;
+  }
+
+  // Drop queued edges (e.g. between rounds)
+  void flush() {
+    tail = head;
+  }
+
+  bool isPressed() const { return pressed; }
+  uint32_t overflowCount() const { return overflows; }
+
+private:
+  struct Edge {
+    uint32_t us;
+    uint8_t level;
+  };
+
+  // Released long enough: ready for the next press
+  void releaseIfSettled(uint32_t us) {
+    if (pressed && rawLevel && (uint32_t)(us - rawUs) >= CAPTURE_DEBOUNCE_US) {
+      pressed = false;
+    }
+  }
+
+  volatile Edge edges[CAPTURE_QUEUE_SIZE];
+  volatile uint8_t head;
+  volatile uint8_t tail;
+  volatile uint32_t overflows;
+
+  bool pressed;
+  uint8_t rawLevel;
+  uint32_t rawUs;
+};
+
+#endif // INPUT_CAPTURE_H
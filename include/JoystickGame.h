@@ -0,0 +1,367 @@
+/*
+ * JoystickGame.h - Joystick Game Logic
+ * Joystick firmware and native builds
+ *
+ * Reaction timing against the synchronized GO instant, reliable reports to
+ * the host, clock sync replies and scheduled commands, without hardware
+ * access:
+ * - Radio:  any Transport (ESP-NOW on the ESP8266, UDP multicast natively)
+ * - Time:   any Clock
+ * - Button: edges fed to onButtonEdge() (ISR-safe), level via JoystickIO
+ *
+ * The stick has no built-in ID or host MAC: it joins with CMD_REQ_ID
+ * (Pairing.h), learns both from the host's CMD_OK and rejoins when the
+ * host goes quiet.
+ *
+ * Received frames are handled directly in the receive callback (the ESP8266
+ * runs it from the loop context).
+ */
+
+#ifndef JOYSTICK_GAME_H
+#define JOYSTICK_GAME_H
+
+#include <stdint.h>
+#include <string.h>
+#include "Platform.h"
+#include "Log.h"
+#include "Transport.h"
+#include "Protocol.h"
+#include "GameTypes.h"
+#include "ReliableLink.h"
+#include "ClockSync.h"
+#include "Scheduler.h"
+#include "InputCapture.h"
+#include "Pairing.h"
+
+// =============================================================================
+// INPUTS / OUTPUTS
+// =============================================================================
+class JoystickIO {
+public:
+  virtual ~JoystickIO() {}
+  virtual bool buttonDown() = 0;          // Current level (active-low button)
+  virtual void onGo(uint32_t goUs) {}     // Timing started at the local instant goUs
+};
+
+// =============================================================================
+// JOYSTICK GAME CLASS
+// =============================================================================
+class JoystickGame : public TransportHandler {
+public:
+  JoystickGame() :
+    transport(nullptr),
+    clock(nullptr),
+    io(nullptr),
+    myId(ID_NEW),
+    joined(false),
+    lastJoinMs(0),
+    lastHostMs(0),
+    gameState(GAME_IDLE),
+    gameStartUs(0),
+    reactionTime(0),
+    hasPress(false),
+    lastPressUs(0) {
+    memset(hostMac, 0, sizeof(hostMac));
+  }
+
+  // Starts the transport and the join handshake; false on failure
+  bool begin(Transport* t, Clock* c, JoystickIO* i) {
+    transport = t;
+    clock = c;
+    io = i;
+    if (!transport->begin(this)) return false;
+    sendJoinRequest();
+    return true;
+  }
+
+  // ISR: one button edge (level 0 = pressed)
+  CAPTURE_ISR_ATTR void onButtonEdge(uint32_t us, uint8_t level) {
+    capture.onEdge(us, level);
+  }
+
+  // Loop body
+  void update() {
+    uint32_t now = clock->millis();
+    if (!joined) {
+      if (now - lastJoinMs >= JOIN_RETRY_MS) sendJoinRequest();
+      return;
+    }
+    // The host syncs every node at least every SYNC_PERIOD_MS
+    if (now - lastHostMs > JOIN_LOST_MS) {
+      LOG(PAIR_HOST_LOST);
+      joined = false;
+      gameState = GAME_IDLE;
+      sendJoinRequest();
+      return;
+    }
+
+    // Scheduled commands: busy-wait the last stretch for accuracy
+    uint32_t atUs = 0;
+    if (scheduler.nextDue(&atUs) && (int32_t)(atUs - clock->micros()) <= SCHED_SPIN_US) {
+      clock->waitUntil(atUs);
+      scheduler.run(clock->micros(), runScheduled, this);
+    }
+
+    takePresses();
+
+    if (gameState == GAME_REACTION_ACTIVE) {
+      // Timeout check (10 seconds)
+      if ((int32_t)(clock->micros() - gameStartUs) > TIMEOUT_REACTION * 1000L) {
+        gameState = GAME_IDLE;
+        reactionTime = TIME_PENALTY;
+        sendToHost(CMD_REACTION_DONE, TIME_PENALTY);
+        LOG(STICK_TIMEOUT);
+      }
+    }
+
+    radioLink.poll(clock->micros());
+  }
+
+  void onTransportReceive(const uint8_t* mac, const uint8_t* data, uint8_t len) override {
+    uint32_t rxUs = clock->micros();
+
+    if (!joined) {
+      handleJoinReply(mac, data, len);
+      return;
+    }
+    if (memcmp(mac, hostMac, 6) != 0) return;
+    lastHostMs = clock->millis();
+
+    // ACKs, duplicates and retransmissions are handled by the link
+    if (!radioLink.onReceive(data, len, rxUs)) return;
+
+    FrameReader reader;
+    if (!frameOpen(&reader, data, len)) return;
+    if (reader.dest_id != myId && reader.dest_id != ID_BROADCAST) return;
+
+    bool deferred = false;
+    uint32_t fireUs = 0;
+    FrameRecord rec;
+    while (frameNext(&reader, &rec)) {
+      // Records after CMD_FIRE_AT wait for the host instant (needs sync)
+      if (rec.cmd == CMD_FIRE_AT) {
+        deferred = hostClock.isSynced();
+        fireUs = hostClock.toLocal(recordU32(&rec));
+        continue;
+      }
+      if (deferred && scheduler.schedule(fireUs, &rec)) continue;
+      handleCommand(&rec, rxUs);
+    }
+  }
+
+  void onTransportSent(const uint8_t* mac, bool ok) override {
+    radioLink.noteSendStatus(ok);
+  }
+
+  GameState getState() const { return gameState; }
+  uint16_t getReactionTime() const { return reactionTime; }
+  bool isJoined() const { return joined; }
+  uint8_t getId() const { return myId; }
+
+private:
+  // ===========================================================================
+  // JOIN
+  // ===========================================================================
+  // A rebooted stick is recognized by its MAC and gets its old ID back
+  void sendJoinRequest() {
+    lastJoinMs = clock->millis();
+    GamePacket pkt;
+    buildPacket(&pkt, ID_HOST, ID_NEW, CMD_REQ_ID, 0);
+    transport->send(BROADCAST_MAC, (uint8_t*)&pkt, sizeof(pkt));
+  }
+
+  void handleJoinReply(const uint8_t* mac, const uint8_t* data, uint8_t len) {
+    FrameReader reader;
+    if (!frameOpen(&reader, data, len) || reader.dest_id != ID_NEW) return;
+
+    FrameRecord rec;
+    while (frameNext(&reader, &rec)) {
+      uint8_t id = recordU16(&rec) & 0xFF;
+      if (rec.cmd != CMD_OK || id < ID_STICK1 || id >= ID_DISPLAY) continue;
+
+      myId = id;
+      memcpy(hostMac, mac, 6);
+      radioLink.begin(myId, linkSend, this);
+      radioLink.addPeer(ID_HOST);
+      transport->addPeer(hostMac);
+      joined = true;
+      lastHostMs = clock->millis();
+      LOG(PAIR_JOINED, myId);
+      return;
+    }
+  }
+
+  // ===========================================================================
+  // SEND
+  // ===========================================================================
+  // ReliableLink send hook (the host is the only peer)
+  static void linkSend(void* ctx, uint8_t destId, const uint8_t* data, uint8_t len) {
+    JoystickGame* game = (JoystickGame*)ctx;
+    game->transport->send(game->hostMac, data, len);
+  }
+
+  void sendFrame(GameFrame* frame) {
+    uint8_t len = frameFinish(frame);
+    transport->send(hostMac, frame->buf, len);
+  }
+
+  // Retransmitted until the host acknowledges it
+  void sendToHost(uint8_t cmd, uint16_t data) {
+    GameFrame frame;
+    frameBegin(&frame, ID_HOST, myId);
+    frameAddU16(&frame, cmd, data);
+
+    if (radioLink.send(&frame, clock->micros())) {
+      LOG(STICK_SENT, cmd, data);
+    } else {
+      LOG(STICK_LINK_BUSY);
+    }
+  }
+
+  // ms for v1 receivers plus the full-resolution µs value, one transmission
+  void sendReaction(uint32_t reactionUs) {
+    uint32_t ms = reactionUs / 1000;
+    reactionTime = (ms < TIME_PENALTY) ? (uint16_t)ms : (uint16_t)(TIME_PENALTY - 1);
+
+    uint8_t us[4];
+    putU32(us, reactionUs);
+    GameFrame frame;
+    frameBegin(&frame, ID_HOST, myId);
+    frameAddU16(&frame, CMD_REACTION_DONE, reactionTime);
+    frameAdd(&frame, CMD_REACTION_US, us, sizeof(us));
+
+    if (radioLink.send(&frame, clock->micros())) {
+      LOG(STICK_SENT_US, reactionUs);
+    } else {
+      LOG(STICK_LINK_BUSY);
+    }
+  }
+
+  // ===========================================================================
+  // BUTTON
+  // ===========================================================================
+  // Presses captured by the edge interrupt, stamped at the first edge
+  void takePresses() {
+    uint32_t pressUs;
+    while (capture.nextPress(&pressUs, clock->micros())) {
+      hasPress = true;
+      lastPressUs = pressUs;
+      if (gameState == GAME_REACTION_ACTIVE) {
+        finishReaction(pressUs);
+      }
+    }
+  }
+
+  // Score a press against the GO instant
+  void finishReaction(uint32_t pressUs) {
+    int32_t elapsedUs = (int32_t)(pressUs - gameStartUs);
+    gameState = GAME_IDLE;
+
+    if (elapsedUs < 0) {
+      // Pressed before the GO instant (GO was processed late)
+      reactionTime = TIME_PENALTY;
+      sendToHost(CMD_REACTION_DONE, TIME_PENALTY);
+      LOG(STICK_EARLY);
+      return;
+    }
+
+    sendReaction((uint32_t)elapsedUs);
+    LOG(STICK_PRESSED, (uint32_t)elapsedUs);
+  }
+
+  // ===========================================================================
+  // COMMANDS
+  // ===========================================================================
+  // eventUs: local instant the command takes effect (arrival, or the
+  // scheduled instant for commands deferred by CMD_FIRE_AT)
+  void handleCommand(const FrameRecord* rec, uint32_t eventUs) {
+    switch (rec->cmd) {
+      case CMD_SYNC_REQ: {
+        hostClock.update(rec);
+        GameFrame frame;
+        frameBegin(&frame, ID_HOST, myId);
+        frameAddSyncResponse(&frame, recordU32(rec), eventUs, clock->micros());
+        sendFrame(&frame);
+        break;
+      }
+
+      case CMD_IDLE:
+        gameState = GAME_IDLE;
+        reactionTime = 0;
+        hasPress = false;
+        LOG(STICK_IDLE);
+        break;
+
+      case CMD_COUNTDOWN:
+        gameState = GAME_COUNTDOWN;
+        LOG(STICK_COUNTDOWN, recordU16(rec) & 0xFF);
+        break;
+
+      case CMD_VIBRATE:
+        if ((recordU16(rec) & 0xFF) == VIBRATE_GO) {
+          // A GO that runs late may find a press made after its instant
+          takePresses();
+          bool pressedAfterGo = hasPress && (int32_t)(lastPressUs - eventUs) >= 0;
+
+          // Early press = penalty: button down, or a press from before GO
+          // still bouncing
+          if ((io->buttonDown() || capture.isPressed()) && !pressedAfterGo) {
+            gameState = GAME_IDLE;
+            reactionTime = TIME_PENALTY;
+            sendToHost(CMD_REACTION_DONE, TIME_PENALTY);
+            LOG(STICK_EARLY);
+          } else {
+            // Start timing from the GO instant: the host's synchronized
+            // instant when scheduled, so a late or retried packet costs nothing
+            gameState = GAME_REACTION_ACTIVE;
+            gameStartUs = eventUs;
+            io->onGo(gameStartUs);
+            LOG(STICK_GO);
+
+            // GO ran late and the player already reacted to the lights
+            if (pressedAfterGo) {
+              finishReaction(lastPressUs);
+            }
+          }
+        }
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  // Runs a deferred command and reports its lateness to the host
+  static void runScheduled(void* ctx, const FrameRecord* rec, uint32_t targetUs) {
+    JoystickGame* game = (JoystickGame*)ctx;
+    game->handleCommand(rec, targetUs);
+
+    GameFrame frame;
+    frameBegin(&frame, ID_HOST, game->myId);
+    frameAddSkewReport(&frame, rec->cmd, game->scheduler.skew().lastUs);
+    game->sendFrame(&frame);
+  }
+
+  Transport* transport;
+  Clock* clock;
+  JoystickIO* io;
+  uint8_t myId;                // ID_NEW until the host assigns one
+  uint8_t hostMac[6];          // Sender of CMD_OK
+  bool joined;
+  uint32_t lastJoinMs;         // Last CMD_REQ_ID sent
+  uint32_t lastHostMs;         // Last frame from the host
+
+  GameState gameState;
+  uint32_t gameStartUs;        // Local instant of GO
+  uint16_t reactionTime;
+  ReliableLink radioLink;
+  SyncedClock hostClock;       // Host timebase, maintained by CMD_SYNC_REQ
+  ActionScheduler scheduler;   // Commands deferred by CMD_FIRE_AT
+  InputCapture capture;        // Button edges, timestamped in the ISR
+
+  // Most recent press, kept for a GO that is processed after the press
+  bool hasPress;
+  uint32_t lastPressUs;
+};
+
+#endif // JOYSTICK_GAME_H
@@ -0,0 +1,234 @@
+/*
+ * LedCompositor.h - Layered LED Effects
+ * Host firmware and native builds
+ *
+ * Each ring has three layers, drawn bottom to top:
+ *   LAYER_BACKGROUND  mode animation (rainbow, countdown blink, GO green)
+ *   LAYER_STATUS      per-player state (finished, penalty)
+ *   LAYER_FLASH       short one-shot highlights
+ * A layer is an effect plus a color and an alpha. Layers are blended in
+ * 8-bit fixed point (out += (color - out) * alpha / 256), then every
+ * channel goes through one 256-entry gamma/brightness table, so
+ * brightness never destroys the drawn colors.
+ *
+ * Animations take their phase from the time passed to render(), not from
+ * how often it is called. The color wheel is a compile-time table.
+ *
+ * Dirty tracking: isDirty() after any layer or brightness change,
+ * isAnimating() while some layer changes with time. With neither, the
+ * last frame is still current and render() can be skipped.
+ *
+ * render() fills an RGB framebuffer (3 bytes per LED), which LedStrip
+ * sends on the host and native_leds writes to PPM images.
+ */
+
+#ifndef LED_COMPOSITOR_H
+#define LED_COMPOSITOR_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "GameTypes.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#ifndef LED_GAMMA
+#define LED_GAMMA         2.2f
+#endif
+
+#define LED_FRAME_BYTES   (NEOPIXEL_COUNT * 3)
+
+enum LedLayerId : uint8_t {
+  LAYER_BACKGROUND = 0,
+  LAYER_STATUS,
+  LAYER_FLASH,
+  LED_LAYERS
+};
+
+enum LedEffect : uint8_t {
+  FX_NONE = 0,        // Transparent
+  FX_SOLID,           // color
+  FX_RAINBOW,         // Wheel across the whole strip, one turn per period
+  FX_SPIN,            // Whole ring through the wheel, one turn per period
+  FX_BLINK,           // color for the first half of each period, then clear
+  FX_FADE             // color, alpha falling to 0 over one period, then off
+};
+
+typedef struct {
+  LedEffect effect;
+  uint8_t alpha;      // 255 = opaque
+  uint32_t color;     // 0xRRGGBB
+  uint32_t periodMs;
+  uint32_t startMs;   // Phase origin
+} LedLayer;
+
+// =============================================================================
+// COLOR WHEEL (compile time)
+// =============================================================================
+// Same wheel as the Adafruit examples: red → green → blue → red
+constexpr uint32_t ledRgb(uint32_t r, uint32_t g, uint32_t b) {
+  return (r << 16) | (g << 8) | b;
+}
+
+constexpr uint32_t ledWheelAt(uint8_t pos) {
+  return (pos < 85) ? ledRgb(255 - pos * 3, 0, pos * 3) :
+         (pos < 170) ? ledRgb(0, (pos - 85) * 3, 255 - (pos - 85) * 3) :
+                       ledRgb((pos - 170) * 3, 255 - (pos - 170) * 3, 0);
+}
+
+template <uint16_t... I> struct LedIndexList {};
+template <uint16_t N, uint16_t... I> struct LedIndexRange : LedIndexRange<N - 1, N - 1, I...> {};
+template <uint16_t... I> struct LedIndexRange<0, I...> { typedef LedIndexList<I...> type; };
+
+template <typename List> struct LedWheelTable;
+template <uint16_t... I> struct LedWheelTable<LedIndexList<I...> > {
+  static constexpr uint32_t colors[sizeof...(I)] = { ledWheelAt((uint8_t)(255 - I))... };
+};
+template <uint16_t... I>
+constexpr uint32_t LedWheelTable<LedIndexList<I...> >::colors[sizeof...(I)];
+
+typedef LedWheelTable<LedIndexRange<256>::type> LedWheel;
+
+static_assert(LedWheel::colors[0] == COLOR_RED && LedWheel::colors[85] == COLOR_GREEN,
+              "Wheel table out of order");
+
+inline uint32_t ledWheel(uint8_t pos) { return LedWheel::colors[pos]; }
+
+// =============================================================================
+// COMPOSITOR CLASS
+// =============================================================================
+class LedCompositor {
+public:
+  LedCompositor() : dirty(true) {
+    memset(layers, 0, sizeof(layers));
+    setBrightness(255);
+  }
+
+  // Rebuilds the output table: gamma first, then brightness
+  void setBrightness(uint8_t brightness) {
+    for (uint16_t v = 0; v < 256; v++) {
+      float level = powf(v / 255.0f, LED_GAMMA) * brightness;
+      lut[v] = (uint8_t)(level + 0.5f);
+    }
+    dirty = true;
+  }
+
+  void setLayer(uint8_t ring, uint8_t layer, const LedLayer& l) {
+    if (ring >= NUM_RINGS || layer >= LED_LAYERS) return;
+    layers[ring][layer] = l;
+    dirty = true;
+  }
+
+  void solid(uint8_t ring, uint8_t layer, uint32_t color, uint8_t alpha = 255) {
+    LedLayer l = { FX_SOLID, alpha, color, 0, 0 };
+    setLayer(ring, layer, l);
+  }
+
+  void animate(uint8_t ring, uint8_t layer, LedEffect effect, uint32_t color,
+               uint32_t periodMs, uint32_t startMs, uint8_t alpha = 255) {
+    LedLayer l = { effect, alpha, color, periodMs ? periodMs : 1, startMs };
+    setLayer(ring, layer, l);
+  }
+
+  void clear(uint8_t ring, uint8_t layer) {
+    if (ring >= NUM_RINGS || layer >= LED_LAYERS || layers[ring][layer].effect == FX_NONE) return;
+    layers[ring][layer].effect = FX_NONE;
+    dirty = true;
+  }
+
+  // One layer on every ring
+  void clearLayer(uint8_t layer) {
+    for (uint8_t r = 0; r < NUM_RINGS; r++) clear(r, layer);
+  }
+
+  const LedLayer& layer(uint8_t ring, uint8_t layer) const { return layers[ring][layer]; }
+
+  // Changed since the last render()
+  bool isDirty() const { return dirty; }
+
+  // Some layer changes with time (a fade until its last, empty frame)
+  bool isAnimating() const {
+    for (uint8_t ring = 0; ring < NUM_RINGS; ring++) {
+      for (uint8_t l = 0; l < LED_LAYERS; l++) {
+        LedEffect e = layers[ring][l].effect;
+        if (e != FX_NONE && e != FX_SOLID) return true;
+      }
+    }
+    return false;
+  }
+
+  // Framebuffer for instant nowMs: R G B per LED, gamma and brightness applied
+  void render(uint32_t nowMs, uint8_t* out) {
+    for (uint8_t ring = 0; ring < NUM_RINGS; ring++) {
+      for (uint8_t k = 0; k < LEDS_PER_RING; k++) {
+        uint16_t pixel = ring * LEDS_PER_RING + k;
+        int32_t r = 0, g = 0, b = 0;
+        for (uint8_t l = 0; l < LED_LAYERS; l++) {
+          uint32_t color;
+          int32_t alpha = sample(&layers[ring][l], pixel, nowMs, &color);
+          if (alpha == 0) continue;
+          alpha++;   // 1..256: opaque copies the color exactly
+          r += (((int32_t)(color >> 16 & 0xFF) - r) * alpha) >> 8;
+          g += (((int32_t)(color >> 8 & 0xFF) - g) * alpha) >> 8;
+          b += (((int32_t)(color & 0xFF) - b) * alpha) >> 8;
+        }
+        uint8_t* p = &out[pixel * 3];
+        p[0] = lut[r];
+        p[1] = lut[g];
+        p[2] = lut[b];
+      }
+    }
+
+    // Finished fades have drawn their empty frame: no longer animating
+    for (uint8_t ring = 0; ring < NUM_RINGS; ring++) {
+      for (uint8_t l = 0; l < LED_LAYERS; l++) {
+        LedLayer* layer = &layers[ring][l];
+        if (layer->effect == FX_FADE && nowMs - layer->startMs >= layer->periodMs) layer->effect = FX_NONE;
+      }
+    }
+    dirty = false;
+  }
+
+private:
+  // Color and alpha of one layer at one pixel, alpha 0 if transparent
+  static uint8_t sample(const LedLayer* l, uint16_t pixel, uint32_t nowMs, uint32_t* color) {
+    uint32_t elapsed = nowMs - l->startMs;
+    switch (l->effect) {
+      case FX_SOLID:
+        *color = l->color;
+        return l->alpha;
+
+      case FX_RAINBOW:
+        *color = ledWheel((uint8_t)(pixel * 256 / NEOPIXEL_COUNT + phase(elapsed, l->periodMs)));
+        return l->alpha;
+
+      case FX_SPIN:
+        *color = ledWheel(phase(elapsed, l->periodMs));
+        return l->alpha;
+
+      case FX_BLINK:
+        *color = l->color;
+        return ((elapsed % l->periodMs) < l->periodMs / 2) ? l->alpha : 0;
+
+      case FX_FADE:
+        if (elapsed >= l->periodMs) return 0;
+        *color = l->color;
+        return (uint8_t)(l->alpha * (l->periodMs - elapsed) / l->periodMs);
+
+      default:
+        return 0;
+    }
+  }
+
+  // 0..255 over one period
+  static uint8_t phase(uint32_t elapsed, uint32_t periodMs) {
+    return (uint8_t)((elapsed % periodMs) * 256 / periodMs);
+  }
+
+  LedLayer layers[NUM_RINGS][LED_LAYERS];
+  uint8_t lut[256];
+  bool dirty;
+};
+
+#endif // LED_COMPOSITOR_H
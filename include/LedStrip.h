@@ -0,0 +1,156 @@
+/*
+ * LedStrip.h - Non-blocking NeoPixel Output (ESP32 RMT)
+ * Host only
+ *
+ * Adafruit_NeoPixel::show() keeps the CPU busy for the whole transmission
+ * (~1.8 ms for 60 LEDs, 30 µs per LED plus the latch), every time it is
+ * called. Here the frame is double-buffered:
+ * - Back buffer: RGB bytes the game draws into (setPixelColor/pixels())
+ * - Front buffer: RMT symbols the peripheral clocks out on its own
+ * show() only encodes and hands the frame to the RMT driver (the driver's
+ * ISR refills the channel RAM), then returns. A frame equal to the last
+ * one sent is not transmitted again; while a transmission is still running
+ * show() returns at once and the frame goes out on a later call (pending()).
+ *
+ * src/led_bench.cpp measures the CPU cycles per frame of both paths.
+ */
+
+#ifndef LED_STRIP_H
+#define LED_STRIP_H
+
+#include <Arduino.h>
+#include <driver/rmt.h>
+#include "GameTypes.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#ifndef LED_RMT_CHANNEL
+#define LED_RMT_CHANNEL   RMT_CHANNEL_0
+#endif
+
+// WS2812B timing in RMT ticks: 80 MHz APB / 2 = 25 ns
+#define LED_RMT_CLK_DIV   2
+#define LED_T0H           16      // 0.40 µs
+#define LED_T0L           34      // 0.85 µs
+#define LED_T1H           32      // 0.80 µs
+#define LED_T1L           18      // 0.45 µs
+#define LED_RESET_TICKS   12000   // 300 µs low: latch (newer WS2812B need 280)
+
+#define LED_BYTES         (NEOPIXEL_COUNT * 3)
+#define LED_SYMBOLS       (LED_BYTES * 8 + 1)   // + latch
+
+typedef struct {
+  uint32_t shows;         // Frames handed to the RMT
+  uint32_t unchanged;     // show() with nothing new to send
+  uint32_t busy;          // show() during a transmission (sent later)
+} LedStats;
+
+// =============================================================================
+// LED STRIP CLASS
+// =============================================================================
+class LedStrip {
+public:
+  LedStrip() : brightness(255), dirty(true), waiting(false) {
+    memset(back, 0, sizeof(back));
+    memset(sent, 0, sizeof(sent));
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  bool begin(uint8_t pin) {
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)pin, LED_RMT_CHANNEL);
+    config.clk_div = LED_RMT_CLK_DIV;
+    if (rmt_config(&config) != ESP_OK) return false;
+    return rmt_driver_install(LED_RMT_CHANNEL, 0, 0) == ESP_OK;
+  }
+
+  static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) {
+    return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+  }
+
+  void setPixelColor(uint16_t i, uint32_t color) {
+    if (i >= NEOPIXEL_COUNT) return;
+    uint8_t* p = &back[i * 3];
+    p[0] = (uint8_t)(color >> 16);
+    p[1] = (uint8_t)(color >> 8);
+    p[2] = (uint8_t)color;
+  }
+
+  void fill(uint32_t color) {
+    for (uint16_t i = 0; i < NEOPIXEL_COUNT; i++) setPixelColor(i, color);
+  }
+
+  // Back buffer, R G B per LED, for writers that fill it directly
+  uint8_t* pixels() { return back; }
+
+  // Applied while encoding: the back buffer keeps full-scale colors
+  void setBrightness(uint8_t b) {
+    if (b != brightness) dirty = true;
+    brightness = b;
+  }
+
+  bool busy() {
+    return rmt_wait_tx_done(LED_RMT_CHANNEL, 0) != ESP_OK;
+  }
+
+  // Starts a transmission if the frame changed and the RMT is free; true
+  // if it did. Never waits.
+  bool show() {
+    if (!dirty && memcmp(back, sent, LED_BYTES) == 0) {
+      stats.unchanged++;
+      return false;
+    }
+    if (busy()) {
+      stats.busy++;
+      waiting = true;
+      return false;
+    }
+    memcpy(sent, back, LED_BYTES);
+    dirty = false;
+    waiting = false;
+    encode();
+    rmt_write_items(LED_RMT_CHANNEL, front, LED_SYMBOLS, false);
+    stats.shows++;
+    return true;
+  }
+
+  // A frame is waiting for the running transmission: call show() again
+  bool pending() const { return waiting; }
+
+  const LedStats& getStats() const { return stats; }
+
+private:
+  // Wire order is G R B, most significant bit first
+  void encode() {
+    static const uint8_t order[3] = { 1, 0, 2 };
+    uint32_t scale = brightness + 1;
+    rmt_item32_t* out = front;
+    for (uint16_t i = 0; i < NEOPIXEL_COUNT; i++) {
+      for (uint8_t c = 0; c < 3; c++) {
+        uint8_t v = (uint8_t)((sent[i * 3 + order[c]] * scale) >> 8);
+        for (uint8_t bit = 0x80; bit; bit >>= 1) {
+          bool one = v & bit;
+          out->level0 = 1;
+          out->duration0 = one ? LED_T1H : LED_T0H;
+          out->level1 = 0;
+          out->duration1 = one ? LED_T1L : LED_T0L;
+          out++;
+        }
+      }
+    }
+    out->level0 = 0;
+    out->duration0 = LED_RESET_TICKS;
+    out->level1 = 0;
+    out->duration1 = 0;
+  }
+
+  uint8_t back[LED_BYTES];            // Drawn by the game
+  uint8_t sent[LED_BYTES];            // Last frame handed to the RMT
+  rmt_item32_t front[LED_SYMBOLS];    // Read by the RMT driver while busy
+  uint8_t brightness;
+  bool dirty;                         // Brightness changed since the last show
+  bool waiting;                       // show() found the RMT busy
+  LedStats stats;
+};
+
+#endif // LED_STRIP_H
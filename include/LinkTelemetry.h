@@ -0,0 +1,150 @@
+/*
+ * LinkTelemetry.h - Per-Peer Link Quality Statistics
+ * Host (collects) and Display (shows the host's figures)
+ *
+ * The host keeps one PeerTelemetry per paired node:
+ * - Send status: radio-level ACK or failure of every unicast frame
+ * - Receive: frame count and RSSI (promiscuous receive info on the ESP32,
+ *   see EspNowTransport::trackRssi(); 0 where the transport has none)
+ * - Round trips: clock sync exchanges and reliable-link ACKs, as a log2
+ *   histogram (<0.5, <1, <2, <4, <8, <16, >=16 ms) plus the maximum
+ * Last-seen times come from the node table itself.
+ *
+ * After each round the host sends the figures to the display as
+ * CMD_PEER_STATS records, TELEM_RECORD_SIZE bytes each (big-endian):
+ *   id, tx ok u16, tx fail u16, rx u16, rssi avg, rssi min,
+ *   seen ago u16 (100 ms), rtt max u16 (100 µs), rtt share % × 7
+ * Counters saturate; histogram shares are percent of all samples.
+ */
+
+#ifndef LINK_TELEMETRY_H
+#define LINK_TELEMETRY_H
+
+#include <stdint.h>
+#include <string.h>
+#include "Protocol.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define TELEM_RTT_BUCKETS   7
+#define TELEM_RTT_FIRST_US  500     // Upper edge of the first bucket
+#define TELEM_RECORD_SIZE   20
+#define TELEM_RSSI_SHIFT    3       // Average: 1/8 of each new sample
+
+// =============================================================================
+// PER-PEER COUNTERS
+// =============================================================================
+class PeerTelemetry {
+public:
+  PeerTelemetry() { reset(); }
+
+  void reset() {
+    txOk = txFail = rxFrames = 0;
+    rssiLast = rssiMin = 0;
+    rssiAvgQ = 0;
+    memset(rtt, 0, sizeof(rtt));
+    rttSamples = 0;
+    rttMaxUs = 0;
+  }
+
+  void noteSent(bool ok) {
+    if (ok) txOk++; else txFail++;
+  }
+
+  // rssi 0: not measured (kept out of the average)
+  void noteReceive(int8_t rssi) {
+    rxFrames++;
+    if (rssi == 0) return;
+    if (rssiLast == 0) {
+      rssiMin = rssi;
+      rssiAvgQ = (int16_t)(rssi * (1 << TELEM_RSSI_SHIFT));
+    } else {
+      if (rssi < rssiMin) rssiMin = rssi;
+      rssiAvgQ += rssi - (rssiAvgQ >> TELEM_RSSI_SHIFT);
+    }
+    rssiLast = rssi;
+  }
+
+  void noteRtt(uint32_t us) {
+    uint8_t b = 0;
+    for (uint32_t edge = TELEM_RTT_FIRST_US; b < TELEM_RTT_BUCKETS - 1 && us >= edge; edge <<= 1) b++;
+    if (rtt[b] < 0xFFFF) rtt[b]++;
+    rttSamples++;
+    if (us > rttMaxUs) rttMaxUs = us;
+  }
+
+  int8_t rssiAvg() const { return (int8_t)(rssiAvgQ >> TELEM_RSSI_SHIFT); }
+
+  // Percent of the samples in bucket b (rounded down)
+  uint8_t rttShare(uint8_t b) const {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < TELEM_RTT_BUCKETS; i++) total += rtt[i];
+    return total ? (uint8_t)(rtt[b] * 100UL / total) : 0;
+  }
+
+  // CMD_PEER_STATS payload; returns TELEM_RECORD_SIZE
+  uint8_t encode(uint8_t id, uint32_t seenAgoMs, uint8_t* out) const {
+    uint8_t n = 0;
+    out[n++] = id;
+    n = putSat16(out, n, txOk);
+    n = putSat16(out, n, txFail);
+    n = putSat16(out, n, rxFrames);
+    out[n++] = (uint8_t)rssiAvg();
+    out[n++] = (uint8_t)rssiMin;
+    n = putSat16(out, n, seenAgoMs / 100);
+    n = putSat16(out, n, rttMaxUs / 100);
+    for (uint8_t i = 0; i < TELEM_RTT_BUCKETS; i++) out[n++] = rttShare(i);
+    return n;
+  }
+
+  uint32_t txOk;          // Radio ACKed
+  uint32_t txFail;        // No radio ACK after the MAC retries
+  uint32_t rxFrames;
+  int8_t rssiLast;        // dBm, 0 = none yet
+  int8_t rssiMin;
+  uint16_t rtt[TELEM_RTT_BUCKETS];
+  uint32_t rttSamples;
+  uint32_t rttMaxUs;
+
+private:
+  static uint8_t putSat16(uint8_t* out, uint8_t n, uint32_t v) {
+    if (v > 0xFFFF) v = 0xFFFF;
+    out[n] = (uint8_t)(v >> 8);
+    out[n + 1] = (uint8_t)v;
+    return n + 2;
+  }
+
+  int16_t rssiAvgQ;       // dBm << TELEM_RSSI_SHIFT
+};
+
+// =============================================================================
+// RECEIVED RECORD (display side)
+// =============================================================================
+typedef struct {
+  uint8_t id;
+  uint16_t txOk;
+  uint16_t txFail;
+  uint16_t rxFrames;
+  int8_t rssiAvg;
+  int8_t rssiMin;
+  uint32_t seenAgoMs;
+  uint32_t rttMaxUs;
+  uint8_t rttShare[TELEM_RTT_BUCKETS];
+} PeerStatsRecord;
+
+inline bool peerStatsDecode(const FrameRecord* rec, PeerStatsRecord* out) {
+  if (rec->cmd != CMD_PEER_STATS || rec->len < TELEM_RECORD_SIZE) return false;
+  out->id = rec->data[0];
+  out->txOk = recordU16(rec, 1);
+  out->txFail = recordU16(rec, 3);
+  out->rxFrames = recordU16(rec, 5);
+  out->rssiAvg = (int8_t)rec->data[7];
+  out->rssiMin = (int8_t)rec->data[8];
+  out->seenAgoMs = recordU16(rec, 9) * 100UL;
+  out->rttMaxUs = recordU16(rec, 11) * 100UL;
+  memcpy(out->rttShare, &rec->data[13], TELEM_RTT_BUCKETS);
+  return true;
+}
+
+#endif // LINK_TELEMETRY_H
@@ -0,0 +1,335 @@
+/*
+ * Log.h - Tokenized Deferred Logging
+ * Shared between Host, Display, Joysticks and the native builds
+ *
+ * LOG(NAME, args...) with NAME from LogMessages.h. On the devices a call
+ * stores {µs timestamp, message index, arguments} in a RAM ring and returns
+ * (no formatting, no UART wait). A low-priority drain sends the records as
+ * binary frames; scripts/decode_log.py turns them back into text:
+ *
+ *   [0xA5][words][id u16][us u32][arg u32 × words][CRC8]   (big-endian)
+ *
+ *   ESP32:   logStartTask(Serial)  drain task, core 0, just above idle
+ *   ESP8266: logDrain(Serial)      from loop(), only what the TX FIFO takes
+ *   Native:  formatted to stdout at once (logEnabled() switches it off)
+ *
+ * Levels per module, fixed at compile time (build_flags):
+ *   -DLOG_LEVEL=LOG_LVL_INFO         default for every module
+ *   -DLOG_LEVEL_AUDIO=LOG_LVL_NONE   one module
+ * A message above its module's level is a constant-false branch: no call,
+ * no record, and its format string never reaches the binary.
+ */
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+#include <string.h>
+#include "Protocol.h"
+#include "LogMessages.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#define LOG_DEFERRED
+#else
+#include <stdio.h>
+#endif
+
+#ifdef LOG_DEFERRED
+#include <atomic>
+#endif
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define LOG_LVL_NONE      0
+#define LOG_LVL_ERROR     1
+#define LOG_LVL_WARN      2
+#define LOG_LVL_INFO      3
+#define LOG_LVL_DEBUG     4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL         LOG_LVL_DEBUG
+#endif
+#ifndef LOG_LEVEL_LOG
+#define LOG_LEVEL_LOG     LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_HOST
+#define LOG_LEVEL_HOST    LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_PAIR
+#define LOG_LEVEL_PAIR    LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_STICK
+#define LOG_LEVEL_STICK   LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_DISPLAY
+#define LOG_LEVEL_DISPLAY LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_AUDIO
+#define LOG_LEVEL_AUDIO   LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_LINK
+#define LOG_LEVEL_LINK    LOG_LEVEL
+#endif
+
+#define LOG_MAX_WORDS     8       // Argument words per record
+#define LOG_STR_CHARS     8       // %s: characters kept (two words)
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE     64      // Records (power of two), 44 bytes each
+#endif
+#define LOG_DRAIN_MS      10      // ESP32 drain task period
+#define LOG_FRAME_START   0xA5
+#define LOG_FRAME_MAX     (4 + 4 + LOG_MAX_WORDS * 4 + 1)
+
+// =============================================================================
+// MESSAGE IDS AND COMPILE-TIME FILTER
+// =============================================================================
+#define LOG_MSG(name, module, level, fmt) LOGID_##name,
+enum LogId : uint16_t { LOG_MESSAGES LOGID_COUNT };
+#undef LOG_MSG
+
+#define LOG_MSG(name, module, level, fmt) LOG_ON_##name = (LOG_LVL_##level <= LOG_LEVEL_##module),
+enum LogEnabled { LOG_MESSAGES };
+#undef LOG_MSG
+
+#define LOG(name, ...) \
+  do { if (LOG_ON_##name) logWrite(LOGID_##name, ##__VA_ARGS__); } while (0)
+
+#ifndef LOG_DEFERRED
+// =============================================================================
+// NATIVE: FORMAT IMMEDIATELY
+// =============================================================================
+// Simulations running thousands of rounds switch printing off
+inline bool& logEnabled() {
+  static bool enabled = true;
+  return enabled;
+}
+
+inline const char* logFormat(uint16_t id) {
+#define LOG_MSG(name, module, level, fmt) fmt,
+  static const char* const formats[] = { LOG_MESSAGES };
+#undef LOG_MSG
+  return (id < LOGID_COUNT) ? formats[id] : "";
+}
+
+template <typename... Args>
+inline void logWrite(LogId id, Args... args) {
+  if (logEnabled()) printf(logFormat(id), args...);
+}
+
+#else
+// =============================================================================
+// DEVICE: RECORD RING
+// =============================================================================
+// Bounded multi-producer ring (host loop, WiFi task callbacks) with a single
+// consumer, the drain. Each cell carries a sequence number: a producer owns
+// a cell once it has moved the head past it and publishes it by bumping the
+// sequence, so a full ring drops the new record without blocking anyone.
+typedef struct {
+  std::atomic<uint32_t> seq;
+  uint32_t us;
+  uint16_t id;
+  uint8_t words;
+  uint32_t arg[LOG_MAX_WORDS];
+} LogRecord;
+
+class LogRing {
+  static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "LOG_RING_SIZE must be a power of two");
+
+public:
+  LogRing() : head(0), dropped(0), tail(0), reported(0) {
+    for (uint32_t i = 0; i < LOG_RING_SIZE; i++) {
+      cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  void push(uint16_t id, const uint32_t* arg, uint8_t words) {
+    uint32_t pos;
+    LogRecord* cell = claim(&pos);
+    if (!cell) return;
+    cell->us = ::micros();
+    cell->id = id;
+    cell->words = words;
+    memcpy(cell->arg, arg, words * sizeof(uint32_t));
+    cell->seq.store(pos + 1, std::memory_order_release);
+  }
+
+  // Consumer: next record as a wire frame, 0 when empty
+  uint8_t nextFrame(uint8_t* out) {
+    uint32_t lost = dropped;
+    if (lost != reported) {
+      uint32_t n = lost - reported;
+      reported = lost;
+      return encode(out, LOGID_LOG_DROPPED, ::micros(), &n, 1);
+    }
+
+    LogRecord* cell = &cells[tail & (LOG_RING_SIZE - 1)];
+    if (cell->seq.load(std::memory_order_acquire) != tail + 1) return 0;
+    uint8_t len = encode(out, cell->id, cell->us, cell->arg, cell->words);
+    cell->seq.store(tail + LOG_RING_SIZE, std::memory_order_release);
+    tail++;
+    return len;
+  }
+
+  // Consumer: length of the next frame without taking it, 0 when empty
+  uint8_t peekLength() {
+    if (dropped != reported) return 4 + 4 + 4 + 1;
+    LogRecord* cell = &cells[tail & (LOG_RING_SIZE - 1)];
+    if (cell->seq.load(std::memory_order_acquire) != tail + 1) return 0;
+    return 4 + 4 + cell->words * 4 + 1;
+  }
+
+private:
+#if defined(ARDUINO_ARCH_ESP8266)
+  // Single core, no atomic compare-and-swap: a few cycles with interrupts off
+  LogRecord* claim(uint32_t* outPos) {
+    noInterrupts();
+    uint32_t pos = head;
+    LogRecord* cell = &cells[pos & (LOG_RING_SIZE - 1)];
+    if (cell->seq.load(std::memory_order_relaxed) != pos) {
+      dropped++;
+      interrupts();
+      return nullptr;
+    }
+    head = pos + 1;
+    interrupts();
+    *outPos = pos;
+    return cell;
+  }
+#else
+  LogRecord* claim(uint32_t* outPos) {
+    uint32_t pos = head.load(std::memory_order_relaxed);
+    for (;;) {
+      LogRecord* cell = &cells[pos & (LOG_RING_SIZE - 1)];
+      int32_t diff = (int32_t)(cell->seq.load(std::memory_order_acquire) - pos);
+      if (diff == 0) {
+        if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          *outPos = pos;
+          return cell;
+        }
+      } else if (diff < 0) {
+        dropped++;
+        return nullptr;
+      } else {
+        pos = head.load(std::memory_order_relaxed);
+      }
+    }
+  }
+#endif
+
+  static uint8_t encode(uint8_t* out, uint16_t id, uint32_t us, const uint32_t* arg, uint8_t words) {
+    uint8_t len = 0;
+    out[len++] = LOG_FRAME_START;
+    out[len++] = words;
+    out[len++] = (uint8_t)(id >> 8);
+    out[len++] = (uint8_t)id;
+    putU32(&out[len], us);
+    len += 4;
+    for (uint8_t i = 0; i < words; i++) {
+      putU32(&out[len], arg[i]);
+      len += 4;
+    }
+    out[len] = calcCRC8(&out[1], len - 1);
+    return len + 1;
+  }
+
+  LogRecord cells[LOG_RING_SIZE];
+#if defined(ARDUINO_ARCH_ESP8266)
+  volatile uint32_t head;
+  volatile uint32_t dropped;
+#else
+  std::atomic<uint32_t> head;
+  std::atomic<uint32_t> dropped;
+#endif
+  uint32_t tail;                  // Consumer only
+  uint32_t reported;              // Consumer only: drops already sent
+};
+
+inline LogRing& logRing() {
+  static LogRing ring;
+  return ring;
+}
+
+// =============================================================================
+// ARGUMENT PACKING
+// =============================================================================
+inline void logPack(uint32_t*, uint8_t*) {}
+template <typename... Rest>
+inline void logPack(uint32_t* w, uint8_t* n, const char* s, Rest... rest);
+
+template <typename T, typename... Rest>
+inline void logPack(uint32_t* w, uint8_t* n, T v, Rest... rest) {
+  w[(*n)++] = (uint32_t)v;
+  logPack(w, n, rest...);
+}
+
+// Strings are SPIFFS paths and names: keep the first characters after '/'
+template <typename... Rest>
+inline void logPack(uint32_t* w, uint8_t* n, const char* s, Rest... rest) {
+  // Characters in wire order (big-endian words), zero padded
+  if (s && *s == '/') s++;
+  memset(&w[*n], 0, LOG_STR_CHARS);
+  for (uint8_t i = 0; i < LOG_STR_CHARS; i++) {
+    uint8_t c = (s && *s) ? (uint8_t)*s++ : 0;
+    w[*n + i / 4] = (w[*n + i / 4] << 8) | c;
+  }
+  *n += LOG_STR_CHARS / 4;
+  logPack(w, n, rest...);
+}
+
+// Words an argument list packs into, checked at compile time
+template <typename T> struct LogArgWords { enum { value = 1 }; };
+template <> struct LogArgWords<const char*> { enum { value = LOG_STR_CHARS / 4 }; };
+template <typename... Args> struct LogWords { enum { value = 0 }; };
+template <typename T, typename... Rest> struct LogWords<T, Rest...> {
+  enum { value = LogArgWords<T>::value + LogWords<Rest...>::value };
+};
+
+template <typename... Args>
+inline void logWrite(LogId id, Args... args) {
+  static_assert(LogWords<Args...>::value <= LOG_MAX_WORDS, "Too many log arguments");
+  uint32_t w[LOG_MAX_WORDS];
+  uint8_t n = 0;
+  logPack(w, &n, args...);
+  logRing().push(id, w, n);
+}
+
+// =============================================================================
+// DRAIN
+// =============================================================================
+// Non-blocking: stops at the first frame the UART buffer cannot take whole.
+// Any Print: HardwareSerial, or the S3's USB CDC Serial (HWCDC/USBCDC)
+inline void logDrain(Print& out) {
+  uint8_t frame[LOG_FRAME_MAX];
+  for (;;) {
+    uint8_t len = logRing().peekLength();
+    if (len == 0 || out.availableForWrite() < len) return;
+    len = logRing().nextFrame(frame);
+    out.write(frame, len);
+  }
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+// Blocking writes are fine here: only this task waits on the UART
+inline void logTask(void* ctx) {
+  Print* out = (Print*)ctx;
+  uint8_t frame[LOG_FRAME_MAX];
+  for (;;) {
+    uint8_t len;
+    while ((len = logRing().nextFrame(frame)) != 0) {
+      out->write(frame, len);
+    }
+    vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_MS));
+  }
+}
+
+// Core 0 next to the WiFi task; the game loop keeps core 1
+inline void logStartTask(Print& out) {
+  xTaskCreatePinnedToCore(logTask, "log", 2048, &out, tskIDLE_PRIORITY + 1, nullptr, 0);
+}
+#endif
+
+#endif // LOG_DEFERRED
+
+#endif // LOG_H
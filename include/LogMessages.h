@@ -0,0 +1,95 @@
+/*
+ * LogMessages.h - Log Message Table
+ * Shared between Host, Display, Joysticks, the native builds and
+ * scripts/decode_log.py
+ *
+ * One line per message: LOG_MSG(NAME, MODULE, LEVEL, "format")
+ * The devices send only the message index and its arguments; the decoder
+ * reads this file to turn them back into text. The index is the line's
+ * position, so new messages go at the END and old ones are never removed
+ * while captures made with them are still of interest.
+ *
+ * Arguments are integers (one 32-bit word each) or const char* (%s, first
+ * 8 characters, two words). At most LOG_MAX_WORDS words per message.
+ */
+
+#define LOG_MESSAGES \
+  LOG_MSG(LOG_DROPPED,         LOG,     WARN,  "[LOG] %u records dropped\n") \
+  \
+  LOG_MSG(HOST_LINK_BUSY,      HOST,    WARN,  "Link busy, sending unreliably\n") \
+  LOG_MSG(HOST_PLAYER_DONE,    HOST,    INFO,  "Player %d: %d ms\n") \
+  LOG_MSG(HOST_GO,             HOST,    INFO,  "GO!\n") \
+  LOG_MSG(HOST_IDLE,           HOST,    INFO,  "IDLE - Press button to start\n") \
+  LOG_MSG(HOST_COUNTDOWN,      HOST,    INFO,  "Countdown: %d\n") \
+  LOG_MSG(HOST_RESULTS,        HOST,    INFO,  "\n=== RESULTS ===\n") \
+  LOG_MSG(HOST_RANK,           HOST,    INFO,  "%2d. Player %d: %d ms (%u us)\n") \
+  LOG_MSG(HOST_LINK_STATS,     HOST,    INFO,  "Link: sent %u, retries %u, drops %u, dupes %u, mac fails %u\n") \
+  LOG_MSG(HOST_NODE_SYNC,      HOST,    INFO,  "Node 0x%02X: offset %d us, drift %d ppb, delay %u us, GO skew %d us\n") \
+  LOG_MSG(HOST_GO_SKEW,        HOST,    INFO,  "Host GO skew %d us\n") \
+  LOG_MSG(HOST_RX_QUEUE,       HOST,    INFO,  "RX queue: peak %u/%u, overflows %u\n") \
+  LOG_MSG(HOST_LAST_RESULT,    HOST,    INFO,  "Last result %u us after GO\n") \
+  LOG_MSG(HOST_WINNER,         HOST,    INFO,  "Player %d WINS!\n") \
+  LOG_MSG(HOST_NO_WINNER,      HOST,    INFO,  "TIE or ALL PENALTY\n") \
+  \
+  LOG_MSG(PAIR_NODE_ONLINE,    PAIR,    INFO,  "Node 0x%02X online\n") \
+  LOG_MSG(PAIR_NODE_OFFLINE,   PAIR,    INFO,  "Node 0x%02X offline\n") \
+  LOG_MSG(PAIR_REFUSED,        PAIR,    WARN,  "Join refused: all player slots in use\n") \
+  LOG_MSG(PAIR_PAIRED,         PAIR,    INFO,  "Node 0x%02X paired: %02X:%02X:%02X:%02X:%02X:%02X\n") \
+  LOG_MSG(PAIR_LOADED,         PAIR,    INFO,  "Pairing: %d stored nodes\n") \
+  LOG_MSG(PAIR_SAVE_FAILED,    PAIR,    ERROR, "Pairing: save failed\n") \
+  LOG_MSG(PAIR_JOINED,         PAIR,    INFO,  "Joined as 0x%02X\n") \
+  LOG_MSG(PAIR_HOST_LOST,      PAIR,    WARN,  "Host lost, rejoining\n") \
+  \
+  LOG_MSG(STICK_TIMEOUT,       STICK,   INFO,  "TIMEOUT!\n") \
+  LOG_MSG(STICK_SENT,          STICK,   DEBUG, "Sent CMD=0x%02X, DATA=%d\n") \
+  LOG_MSG(STICK_SENT_US,       STICK,   DEBUG, "Sent reaction %u us\n") \
+  LOG_MSG(STICK_LINK_BUSY,     STICK,   WARN,  "Send failed: link busy\n") \
+  LOG_MSG(STICK_EARLY,         STICK,   INFO,  "PENALTY - Early press!\n") \
+  LOG_MSG(STICK_PRESSED,       STICK,   INFO,  "Button pressed! Time: %u us\n") \
+  LOG_MSG(STICK_IDLE,          STICK,   INFO,  "IDLE mode\n") \
+  LOG_MSG(STICK_COUNTDOWN,     STICK,   INFO,  "Countdown: %d\n") \
+  LOG_MSG(STICK_GO,            STICK,   INFO,  "GO! Waiting for button press...\n") \
+  \
+  LOG_MSG(DISP_COUNTDOWN,      DISPLAY, INFO,  "COUNTDOWN: %d\n") \
+  LOG_MSG(DISP_GO,             DISPLAY, INFO,  "GO!\n") \
+  LOG_MSG(DISP_RESULTS,        DISPLAY, INFO,  "RESULTS:\n") \
+  LOG_MSG(DISP_PLAYER_TIME,    DISPLAY, INFO,  "  Player %d: %d ms\n") \
+  LOG_MSG(DISP_WINNER,         DISPLAY, INFO,  "Player %d WINS!\n") \
+  LOG_MSG(DISP_NO_WINNER,      DISPLAY, INFO,  "NO WINNER (all penalties)\n") \
+  LOG_MSG(DISP_PLAYER_DONE,    DISPLAY, INFO,  "Player %d done: %d ms\n") \
+  LOG_MSG(DISP_IDLE,           DISPLAY, INFO,  "IDLE mode\n") \
+  LOG_MSG(DISP_JOINED,         DISPLAY, INFO,  "Joined host\n") \
+  \
+  LOG_MSG(AUDIO_QUEUED,        AUDIO,   DEBUG, "[AUDIO] Queued: %s\n") \
+  LOG_MSG(AUDIO_QUEUE_FULL,    AUDIO,   WARN,  "[AUDIO] Queue full!\n") \
+  LOG_MSG(AUDIO_PLAYING,       AUDIO,   INFO,  "[AUDIO] Playing: %s\n") \
+  LOG_MSG(AUDIO_FINISHED,      AUDIO,   DEBUG, "[AUDIO] Finished playing\n") \
+  LOG_MSG(AUDIO_BEGIN_FAILED,  AUDIO,   ERROR, "[AUDIO] MP3 begin failed!\n") \
+  LOG_MSG(AUDIO_NOT_FOUND,     AUDIO,   ERROR, "[AUDIO] File not found: %s\n") \
+  \
+  LOG_MSG(LINK_PEER,           LINK,    INFO,  "Link 0x%02X: tx %u ok %u fail, rx %u, rssi %d avg %d min, seen %u ms ago, rtt max %u us\n") \
+  LOG_MSG(LINK_RTT,            LINK,    INFO,  "Link 0x%02X rtt: <0.5 %u%%, <1 %u%%, <2 %u%%, <4 %u%%, <8 %u%%, <16 %u%%, more %u%%\n") \
+  \
+  LOG_MSG(HOST_LED_STATS,      HOST,    INFO,  "LEDs over %u ms: %u loops/s, %u renders/s, %u shows/s, %u unchanged, %u busy, %u us/s CPU\n") \
+  \
+  LOG_MSG(AUDIO_CACHED,        AUDIO,   INFO,  "[AUDIO] Cached %s: %u frames at %u Hz, %u leading silent frames cut\n") \
+  LOG_MSG(AUDIO_CACHE_SKIPPED, AUDIO,   WARN,  "[AUDIO] Not cached %s: %u bytes, %u left\n") \
+  LOG_MSG(AUDIO_LATENCY,       AUDIO,   INFO,  "[AUDIO] %s: %u plays, first sample %u/%u/%u us min/avg/max, cached %u\n") \
+  LOG_MSG(AUDIO_STATS,         AUDIO,   INFO,  "[AUDIO] %u frames, %u underruns (%u frames starved), commands: %u dropped, peak %u, task %u\n") \
+  LOG_MSG(HOST_STRESS,         HOST,    INFO,  "Audio stress %u ms: %u clips queued, %u underruns (%u frames starved), %u ms loop max\n") \
+  LOG_MSG(AUDIO_GAP,           AUDIO,   INFO,  "[AUDIO] Gap %s -> %s: %u silent frames, %u padding frames trimmed\n") \
+  LOG_MSG(AUDIO_GAP_STATS,     AUDIO,   INFO,  "[AUDIO] %u boundaries: %u silent frames (max %u), %u padding frames trimmed\n") \
+  LOG_MSG(AUDIO_BAD_RATE,      AUDIO,   WARN,  "[AUDIO] %u Hz is not an integer ratio of %u Hz: pitch will be off\n") \
+  LOG_MSG(AUDIO_NO_DECODER,    AUDIO,   WARN,  "[AUDIO] No free decoder for %s\n") \
+  LOG_MSG(AUDIO_BANK_MISMATCH, AUDIO,   ERROR, "[AUDIO] Sound bank is %u bytes, crc %08x; firmware expects %u bytes, crc %08x: upload the filesystem image\n") \
+  LOG_MSG(AUDIO_PREEMPTED,     AUDIO,   INFO,  "[AUDIO] %s cut by %s\n") \
+  LOG_MSG(AUDIO_STALE,         AUDIO,   WARN,  "[AUDIO] Dropped %s: %u us past its deadline\n") \
+  LOG_MSG(AUDIO_EVICTED,       AUDIO,   WARN,  "[AUDIO] Queue full: dropped %s for %s\n") \
+  LOG_MSG(AUDIO_QUEUE_STATS,   AUDIO,   INFO,  "[AUDIO] Queue: %u preempted, %u stale, %u evicted, %u rejected\n") \
+  LOG_MSG(AUDIO_MIX_STATS,     AUDIO,   INFO,  "[AUDIO] Mixer: %u blocks, %u mixed (peak %u voices), %u/%u cycles/block avg/max, %u us/s CPU, %u clipped, %u stolen\n") \
+  LOG_MSG(AUDIO_DECODE_STATS,  AUDIO,   INFO,  "[AUDIO] Decode %s: %u frames, %u kcycles/s of audio (%u us/s CPU)\n") \
+  LOG_MSG(AUDIO_PHRASE_CUT,    AUDIO,   INFO,  "[AUDIO] Phrase %u cut short\n") \
+  LOG_MSG(AUDIO_PHRASE_STATS,  AUDIO,   INFO,  "[AUDIO] Phrases: %u started, %u cut, first word %u/%u/%u us min/avg/max\n") \
+  LOG_MSG(AUDIO_WORD_MISSING,  AUDIO,   WARN,  "[AUDIO] Phrase dropped: no clip for \"%s\"\n") \
+  LOG_MSG(AUDIO_PHRASE_FULL,   AUDIO,   WARN,  "[AUDIO] Phrase dropped: %u words, %u queue slots free\n") \
+  LOG_MSG(AUDIO_VOICE,         AUDIO,   INFO,  "[AUDIO] Announcer: %u of %u words recorded\n")
@@ -0,0 +1,210 @@
+/*
+ * Mp3Decoder.h - Sound Bank Clips for the Audio Sequencer
+ * Host only
+ *
+ * Mp3Decoder: one MP3 clip of the sound bank (SoundBank.h) as an
+ * AudioDecoder (AudioEngine.h). The bank file source is a member, seeked
+ * to the clip on open(), and the AudioGeneratorMP3 and PcmCapture are
+ * shared by all of them: only one MP3 decodes at a time, the prefetched
+ * one has just its file open. The generator is built on one preallocated
+ * block (AudioManager::begin()), so starting a clip allocates nothing.
+ * open() reads the first frame's Xing/LAME tag (Mp3Gapless.h); read()
+ * then drops the encoder delay and padding, so a clip's first and last
+ * frames are its audio.
+ *
+ * BankSource: the AudioSource behind AudioManager. Pools
+ * AUDIO_MP3_DECODERS Mp3Decoders, as many BankPcmDecoders for transcoded
+ * clips (BankPcmDecoder.h) and as many PcmDecoders for clips in the
+ * PcmCache: the playing one and the prefetched one. Times every read()
+ * per clip format (getDecodeCost()).
+ */
+
+#ifndef MP3_DECODER_H
+#define MP3_DECODER_H
+
+#include <Arduino.h>
+#include "AudioGeneratorMP3.h"
+#include "AudioEngine.h"
+#include "BankPcmDecoder.h"
+#include "Mp3Gapless.h"
+#include "PcmCache.h"
+#include "SoundBank.h"
+#include "Log.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define AUDIO_MP3_DECODERS  2       // Playing + prefetched
+
+// =============================================================================
+// MP3 DECODER CLASS
+// =============================================================================
+class Mp3Decoder : public AudioDecoder {
+public:
+  Mp3Decoder() : bank(nullptr), mp3(nullptr), capture(nullptr), cost(nullptr), trim(true),
+                 running(false), skip(0), length(0), dropped(0) {}
+
+  bool begin(const SoundBank* sounds, AudioGeneratorMP3* generator, PcmCapture* target,
+             bool gapless) {
+    bank = sounds;
+    mp3 = generator;
+    capture = target;
+    trim = gapless;
+    return file.begin();
+  }
+
+  void setCost(AudioDecodeCost* c) { cost = c; }
+
+  bool open(uint8_t sound) override {
+    const SoundEntry* e = bank->entry(sound);
+    if (!e || e->format != SND_FMT_MP3 || !file.open(e)) return false;
+    running = false;
+    skip = length = dropped = 0;
+
+    // Gapless span from the LAME tag (the bank has no ID3 tags), in
+    // AUDIO_RATE frames
+    uint8_t probe[MP3_PROBE_BYTES];
+    uint32_t n = file.read(probe, sizeof(probe));
+    file.seek(0, SEEK_SET);
+
+    Mp3Info info;
+    if (trim && mp3ParseInfo(probe, n, &info)) {
+      uint32_t s, len;
+      mp3GaplessSpan(info, &s, &len);
+      skip = toOutput(s, info.rate);
+      length = toOutput(len, info.rate);
+      dropped = skip;
+      if (info.lame && info.padding > MP3_DECODER_DELAY) {
+        dropped += toOutput(info.padding - MP3_DECODER_DELAY, info.rate);
+      }
+    }
+    return true;
+  }
+
+  uint32_t read(int16_t* out, uint32_t frames) override {
+    uint32_t c0 = ESP.getCycleCount();
+    if (!running) {
+      capture->start(skip, length);
+      if (!mp3->begin(&file, capture)) {
+        LOG(AUDIO_BEGIN_FAILED);
+        return 0;
+      }
+      running = true;
+    }
+
+    capture->target(out, frames);
+    while (capture->count() < frames) {
+      if (capture->complete() || !mp3->isRunning() || !mp3->loop()) break;
+    }
+    if (cost) {
+      cost->cycles += ESP.getCycleCount() - c0;
+      cost->frames += capture->count();
+    }
+    return capture->count();
+  }
+
+  void close() override {
+    if (running) mp3->stop();     // Closes the file too
+    else file.close();
+    running = false;
+  }
+
+  uint32_t trimmed() const override { return dropped; }
+
+private:
+  static uint32_t toOutput(uint32_t samples, uint32_t rate) {
+    return rate ? (uint32_t)((uint64_t)samples * AUDIO_RATE / rate) : samples;
+  }
+
+  BankFileSource file;
+  const SoundBank* bank;
+  AudioGeneratorMP3* mp3;
+  PcmCapture* capture;
+  AudioDecodeCost* cost;
+  bool trim;
+  bool running;           // The generator is on this clip
+  uint32_t skip;          // AUDIO_RATE frames
+  uint32_t length;        // 0: to the end
+  uint32_t dropped;
+};
+
+// =============================================================================
+// BANK SOURCE CLASS
+// =============================================================================
+class BankSource : public AudioSource {
+public:
+  BankSource() : bank(nullptr), cache(nullptr) {
+    memset(mp3Busy, 0, sizeof(mp3Busy));
+    memset(rawBusy, 0, sizeof(rawBusy));
+    memset(pcmBusy, 0, sizeof(pcmBusy));
+    memset(cost, 0, sizeof(cost));
+  }
+
+  bool begin(const SoundBank* sounds, AudioGeneratorMP3* mp3, PcmCache* clips, bool gapless) {
+    bank = sounds;
+    cache = clips;
+    bool ok = true;
+    for (uint8_t i = 0; i < AUDIO_MP3_DECODERS; i++) {
+      ok = mp3s[i].begin(bank, mp3, &capture, gapless) && ok;
+      ok = raws[i].begin(bank) && ok;
+      mp3s[i].setCost(&cost[SND_FMT_MP3]);
+      raws[i].setCost(cost);
+    }
+    return ok;
+  }
+
+  AudioDecoder* open(uint8_t sound) override {
+    const PcmClip* clip = cache->find(sound);
+    const SoundEntry* e = bank->entry(sound);
+    bool mp3 = e && e->format == SND_FMT_MP3;
+    for (uint8_t i = 0; i < AUDIO_MP3_DECODERS; i++) {
+      if (clip && !pcmBusy[i]) {
+        pcms[i].load(clip);
+        pcms[i].open(sound);
+        pcmBusy[i] = true;
+        return &pcms[i];
+      }
+      if (!clip && mp3 && !mp3Busy[i]) {
+        if (!mp3s[i].open(sound)) return nullptr;
+        mp3Busy[i] = true;
+        return &mp3s[i];
+      }
+      if (!clip && !mp3 && !rawBusy[i]) {
+        if (!raws[i].open(sound)) return nullptr;
+        rawBusy[i] = true;
+        return &raws[i];
+      }
+    }
+    LOG(AUDIO_NO_DECODER, SoundBank::name(sound));
+    return nullptr;
+  }
+
+  void release(AudioDecoder* decoder) override {
+    decoder->close();
+    for (uint8_t i = 0; i < AUDIO_MP3_DECODERS; i++) {
+      if (decoder == &mp3s[i]) mp3Busy[i] = false;
+      if (decoder == &raws[i]) rawBusy[i] = false;
+      if (decoder == &pcms[i]) pcmBusy[i] = false;
+    }
+  }
+
+  // read() cycles and frames per SND_FMT_ (cached clips not counted)
+  const AudioDecodeCost& getDecodeCost(uint8_t format) const { return cost[format]; }
+
+  bool cached(uint8_t sound) const override { return cache->find(sound) != nullptr; }
+  const char* name(uint8_t sound) const override { return SoundBank::name(sound); }
+
+private:
+  const SoundBank* bank;
+  PcmCache* cache;
+  PcmCapture capture;
+  Mp3Decoder mp3s[AUDIO_MP3_DECODERS];
+  BankPcmDecoder raws[AUDIO_MP3_DECODERS];
+  PcmDecoder pcms[AUDIO_MP3_DECODERS];
+  bool mp3Busy[AUDIO_MP3_DECODERS];
+  bool rawBusy[AUDIO_MP3_DECODERS];
+  bool pcmBusy[AUDIO_MP3_DECODERS];
+  AudioDecodeCost cost[SND_FMT_ADPCM + 1];
+};
+
+#endif // MP3_DECODER_H
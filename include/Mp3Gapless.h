@@ -0,0 +1,111 @@
+/*
+ * Mp3Gapless.h - MP3 Header and Encoder Padding Info
+ * Host firmware and native builds
+ *
+ * An MP3 decodes to more samples than were encoded:
+ * - The first frame of a VBR or LAME file is a Xing/Info header, a valid
+ *   frame of silence (576 samples at 22.05 kHz)
+ * - The encoder delays the audio (LAME: 576) and the decoder's filterbank
+ *   adds 529 more
+ * - The last frame is padded to a whole frame
+ * For "player 2" + "wins" that is ~100 ms of silence where the clips meet.
+ * LAME records the delay and padding in its tag after the Info header;
+ * mp3GaplessSpan() turns them into the decoded samples to drop at the
+ * start and the number to keep. Files without a LAME tag only lose the
+ * header frame.
+ */
+
+#ifndef MP3_GAPLESS_H
+#define MP3_GAPLESS_H
+
+#include <stdint.h>
+#include <string.h>
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define MP3_DECODER_DELAY 529     // Filterbank delay of every standard decoder
+#define MP3_PROBE_BYTES   256     // Read after the ID3 tag: header + Info + LAME
+
+typedef struct {
+  uint32_t rate;          // Hz
+  uint8_t channels;
+  uint16_t frameSamples;  // Per frame and channel: 1152 (MPEG-1) or 576
+  bool infoFrame;         // First frame is a Xing/Info header
+  uint32_t frames;        // Audio frames after the header (0: unknown)
+  bool lame;              // encDelay/padding valid
+  uint16_t encDelay;
+  uint16_t padding;
+} Mp3Info;
+
+// =============================================================================
+// PARSING
+// =============================================================================
+// Size of the ID3v2 tag that starts the file (0 if none); needs 10 bytes
+inline uint32_t mp3Id3Size(const uint8_t* head) {
+  if (head[0] != 'I' || head[1] != 'D' || head[2] != '3') return 0;
+  uint32_t size = ((uint32_t)(head[6] & 0x7F) << 21) | ((uint32_t)(head[7] & 0x7F) << 14) |
+                  ((uint32_t)(head[8] & 0x7F) << 7) | (head[9] & 0x7F);
+  return 10 + size + ((head[5] & 0x10) ? 10 : 0);   // Footer flag
+}
+
+// First frame header at data[0] (right after the ID3 tag); false if the
+// data does not start with a layer III frame
+inline bool mp3ParseInfo(const uint8_t* data, uint32_t len, Mp3Info* info) {
+  static const uint16_t rates[3] = { 44100, 48000, 32000 };
+  memset(info, 0, sizeof(*info));
+  if (len < 4 || data[0] != 0xFF || (data[1] & 0xE0) != 0xE0) return false;
+
+  uint8_t version = (data[1] >> 3) & 3;       // 3: MPEG-1, 2: MPEG-2, 0: MPEG-2.5
+  uint8_t layer = (data[1] >> 1) & 3;         // 1: layer III
+  uint8_t rateIdx = (data[2] >> 2) & 3;
+  if (version == 1 || layer != 1 || rateIdx == 3) return false;
+
+  bool mpeg1 = (version == 3);
+  info->rate = rates[rateIdx] >> (mpeg1 ? 0 : (version == 2 ? 1 : 2));
+  info->channels = ((data[3] >> 6) == 3) ? 1 : 2;
+  info->frameSamples = mpeg1 ? 1152 : 576;
+
+  // Xing/Info sits after the side information
+  uint32_t side = mpeg1 ? (info->channels == 1 ? 17 : 32) : (info->channels == 1 ? 9 : 17);
+  uint32_t x = 4 + side;
+  if (len < x + 8) return true;
+  if (memcmp(&data[x], "Xing", 4) != 0 && memcmp(&data[x], "Info", 4) != 0) return true;
+  info->infoFrame = true;
+
+  uint32_t flags = ((uint32_t)data[x + 4] << 24) | ((uint32_t)data[x + 5] << 16) |
+                   ((uint32_t)data[x + 6] << 8) | data[x + 7];
+  uint32_t p = x + 8;
+  if (flags & 0x1) {
+    if (len < p + 4) return true;
+    info->frames = ((uint32_t)data[p] << 24) | ((uint32_t)data[p + 1] << 16) |
+                   ((uint32_t)data[p + 2] << 8) | data[p + 3];
+    p += 4;
+  }
+  if (flags & 0x2) p += 4;      // Bytes
+  if (flags & 0x4) p += 100;    // Seek table
+  if (flags & 0x8) p += 4;      // Quality
+
+  // LAME tag: 9-byte version string, delay/padding 12 bits each at +21
+  if (len < p + 24 || memcmp(&data[p], "LAME", 4) != 0) return true;
+  const uint8_t* e = &data[p + 21];
+  info->encDelay = (uint16_t)((e[0] << 4) | (e[1] >> 4));
+  info->padding = (uint16_t)(((e[1] & 0x0F) << 8) | e[2]);
+  info->lame = true;
+  return true;
+}
+
+// Decoded samples (per channel, at info.rate) to drop before the audio and
+// to keep after that; length 0 means up to the end of the stream
+inline void mp3GaplessSpan(const Mp3Info& info, uint32_t* skip, uint32_t* length) {
+  *skip = info.infoFrame ? info.frameSamples : 0;
+  *length = 0;
+  if (!info.lame) return;
+  *skip += info.encDelay + MP3_DECODER_DELAY;
+  uint32_t total = info.frames * info.frameSamples;
+  if (info.frames && total > (uint32_t)info.encDelay + info.padding) {
+    *length = total - info.encDelay - info.padding;
+  }
+}
+
+#endif // MP3_GAPLESS_H
@@ -0,0 +1,193 @@
+/*
+ * NumberSpeech.h - Spoken Numbers and Phrases from Word Clips
+ * Host firmware and native builds
+ *
+ * An announcement ("player two, two hundred thirty four milliseconds") is
+ * a list of SpeechWords: SpeechPhrase builds it, number() spelling a value
+ * the way it is said (US English, no "and"): 0 - 19 have a word each,
+ * then the tens, "hundred" and "thousand", so up to 65535 takes the 30
+ * number words of the table below.
+ *
+ * SpeechVoice maps each word to a sound bank clip by the clip's file
+ * name: number words are num_<value> (num_4, num_30, num_100 for
+ * "hundred"), with the countdown's one/two/three standing in for num_1 -
+ * num_3; then player1 - player4, milliseconds, points. A word with no clip
+ * makes the whole phrase unplayable (its text() can still be logged).
+ *
+ * The clips play back to back as one phrase (AudioEngine.h); nothing here
+ * knows about audio.
+ */
+
+#ifndef NUMBER_SPEECH_H
+#define NUMBER_SPEECH_H
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define SPEECH_MAX_WORDS  10        // "player N" + 65535 (7 words) + unit
+#define SPEECH_NONE       0xFF      // No clip for the word
+
+// 0 - 19 are the numbers themselves
+enum SpeechWord : uint8_t {
+  WORD_ZERO = 0,
+  WORD_TWENTY = 20,       // Tens: WORD_TWENTY + tens - 2, up to ninety
+  WORD_HUNDRED = 28,
+  WORD_THOUSAND,
+  WORD_PLAYER_1,          // "player one" - "player four", one clip each
+  WORD_PLAYER_4 = WORD_PLAYER_1 + 3,
+  WORD_MILLISECONDS,
+  WORD_POINTS,
+  SPEECH_WORDS
+};
+
+typedef struct {
+  const char* text;       // For logs
+  const char* clip;       // Sound bank file name, without .mp3
+  const char* alias;      // Used if the bank has no clip named clip
+} SpeechWordInfo;
+
+static const SpeechWordInfo SPEECH_TABLE[SPEECH_WORDS] = {
+  { "zero", "num_0", nullptr },           { "one", "num_1", "one" },
+  { "two", "num_2", "two" },              { "three", "num_3", "three" },
+  { "four", "num_4", nullptr },           { "five", "num_5", nullptr },
+  { "six", "num_6", nullptr },            { "seven", "num_7", nullptr },
+  { "eight", "num_8", nullptr },          { "nine", "num_9", nullptr },
+  { "ten", "num_10", nullptr },           { "eleven", "num_11", nullptr },
+  { "twelve", "num_12", nullptr },        { "thirteen", "num_13", nullptr },
+  { "fourteen", "num_14", nullptr },      { "fifteen", "num_15", nullptr },
+  { "sixteen", "num_16", nullptr },       { "seventeen", "num_17", nullptr },
+  { "eighteen", "num_18", nullptr },      { "nineteen", "num_19", nullptr },
+  { "twenty", "num_20", nullptr },        { "thirty", "num_30", nullptr },
+  { "forty", "num_40", nullptr },         { "fifty", "num_50", nullptr },
+  { "sixty", "num_60", nullptr },         { "seventy", "num_70", nullptr },
+  { "eighty", "num_80", nullptr },        { "ninety", "num_90", nullptr },
+  { "hundred", "num_100", nullptr },      { "thousand", "num_1000", nullptr },
+  { "player one", "player1", nullptr },   { "player two", "player2", nullptr },
+  { "player three", "player3", nullptr }, { "player four", "player4", nullptr },
+  { "milliseconds", "milliseconds", nullptr },
+  { "points", "points", nullptr },
+};
+
+// =============================================================================
+// PHRASE
+// =============================================================================
+class SpeechPhrase {
+public:
+  SpeechPhrase() : count(0), overflow(false) {}
+
+  void clear() {
+    count = 0;
+    overflow = false;
+  }
+
+  void add(uint8_t word) {
+    if (count < SPEECH_MAX_WORDS) words[count++] = word;
+    else overflow = true;
+  }
+
+  // 1 - 4
+  void player(uint8_t n) {
+    if (n >= 1 && n <= 4) add(WORD_PLAYER_1 + n - 1);
+  }
+
+  void number(uint16_t n) {
+    if (n == 0) {
+      add(WORD_ZERO);
+      return;
+    }
+    if (n >= 1000) {
+      under1000(n / 1000);
+      add(WORD_THOUSAND);
+      n %= 1000;
+    }
+    under1000(n);
+  }
+
+  uint8_t size() const { return count; }
+  uint8_t word(uint8_t i) const { return words[i]; }
+
+  // More words than SPEECH_MAX_WORDS were added; the rest were lost
+  bool truncated() const { return overflow; }
+
+  // Words separated by spaces, as far as size allows
+  void text(char* out, size_t size) const {
+    size_t len = 0;
+    if (size) out[0] = '\0';
+    for (uint8_t i = 0; i < count && len + 1 < size; i++) {
+      int n = snprintf(&out[len], size - len, "%s%s", i ? " " : "", SPEECH_TABLE[words[i]].text);
+      if (n < 0) break;
+      len += (size_t)n;
+    }
+  }
+
+private:
+  void under1000(uint16_t n) {
+    if (n >= 100) {
+      add(n / 100);
+      add(WORD_HUNDRED);
+      n %= 100;
+    }
+    if (n >= 20) {
+      add(WORD_TWENTY + n / 10 - 2);
+      n %= 10;
+      if (n) add(n);
+    } else if (n) {
+      add(n);
+    }
+  }
+
+  uint8_t words[SPEECH_MAX_WORDS];
+  uint8_t count;
+  bool overflow;
+};
+
+// =============================================================================
+// VOICE
+// =============================================================================
+class SpeechVoice {
+public:
+  SpeechVoice() : recorded(0) { memset(sounds, SPEECH_NONE, sizeof(sounds)); }
+
+  // nameOf(sound): the clip's file name (SoundBank::name()), sounds 0 -
+  // count-1; returns the words found
+  uint8_t begin(const char* (*nameOf)(uint8_t), uint8_t count) {
+    recorded = 0;
+    for (uint8_t w = 0; w < SPEECH_WORDS; w++) {
+      const SpeechWordInfo& info = SPEECH_TABLE[w];
+      sounds[w] = find(nameOf, count, info.clip);
+      if (sounds[w] == SPEECH_NONE && info.alias) sounds[w] = find(nameOf, count, info.alias);
+      if (sounds[w] != SPEECH_NONE) recorded++;
+    }
+    return recorded;
+  }
+
+  uint8_t soundOf(uint8_t word) const { return word < SPEECH_WORDS ? sounds[word] : SPEECH_NONE; }
+  uint8_t wordsRecorded() const { return recorded; }
+
+  // Sound IDs of the phrase's words into out (SPEECH_MAX_WORDS); returns
+  // the word count, or -1 - i if word i has no clip
+  int toSounds(const SpeechPhrase& phrase, uint8_t* out) const {
+    for (uint8_t i = 0; i < phrase.size(); i++) {
+      out[i] = soundOf(phrase.word(i));
+      if (out[i] == SPEECH_NONE) return -1 - i;
+    }
+    return phrase.size();
+  }
+
+private:
+  static uint8_t find(const char* (*nameOf)(uint8_t), uint8_t count, const char* name) {
+    for (uint8_t s = 0; s < count; s++) {
+      if (!strcmp(nameOf(s), name)) return s;
+    }
+    return SPEECH_NONE;
+  }
+
+  uint8_t sounds[SPEECH_WORDS];
+  uint8_t recorded;
+};
+
+#endif // NUMBER_SPEECH_H
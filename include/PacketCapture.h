@@ -0,0 +1,334 @@
+/*
+ * PacketCapture.h - Flight Recorder for Radio Traffic
+ * Shared between Host, Display, Joysticks and the native builds
+ *
+ * CaptureTransport wraps any Transport and records every frame sent and
+ * received (µs timestamp, peer MAC, direction, bytes) into a RAM ring that
+ * overwrites its oldest records. dump() writes the ring as text lines, so
+ * a capture can travel through the serial log (scripts/decode_log.py
+ * passes it through) or be saved to SPIFFS:
+ *
+ *   CAP-BEGIN <records> <overwritten> <start us>
+ *   CAP <us> <R|T> <peer MAC, 12 hex> <frame hex>
+ *   CAP-END
+ *
+ * native_replay feeds a saved capture back into the host or stick logic
+ * (CaptureReader below).
+ */
+
+#ifndef PACKET_CAPTURE_H
+#define PACKET_CAPTURE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include "Platform.h"
+#include "Transport.h"
+#include "Protocol.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#ifndef PCAP_BUFFER_SIZE
+#if defined(ARDUINO_ARCH_ESP8266)
+#define PCAP_BUFFER_SIZE    2048  // ~60 typical frames
+#elif defined(ARDUINO)
+#define PCAP_BUFFER_SIZE    16384
+#else
+#define PCAP_BUFFER_SIZE    262144
+#endif
+#endif
+
+#define PCAP_RX             'R'
+#define PCAP_TX             'T'
+#define PCAP_HEADER_SIZE    12    // us 4, mac 6, dir 1, len 1
+#define PCAP_LINE_MAX       (32 + 2 * FRAME_MAX_SIZE)
+
+typedef struct {
+  uint32_t us;
+  uint8_t mac[6];
+  uint8_t dir;                      // PCAP_RX / PCAP_TX
+  uint8_t len;
+  uint8_t data[FRAME_MAX_SIZE];
+} CaptureRecord;
+
+// Receives one line at a time (no newline), e.g. Serial or a SPIFFS file
+typedef void (*CaptureLineFn)(void* ctx, const char* line);
+
+// =============================================================================
+// CAPTURE RING
+// =============================================================================
+// Records are packed back to back (header + frame bytes) and may wrap.
+// record() is called from the WiFi task (receive) and the loop (send), so
+// it takes a short critical section; no allocation, no formatting.
+class PacketCapture {
+public:
+  PacketCapture() : head(0), tail(0), used(0), count(0), overwritten(0), startUs(0), paused(false) {}
+
+  // Transport start; with nothing overwritten, a replay can start there too
+  void start(uint32_t us) { startUs = us; }
+
+  void record(uint8_t dir, const uint8_t* mac, const uint8_t* data, uint8_t len, uint32_t us) {
+    uint32_t need = PCAP_HEADER_SIZE + len;
+    if (need > PCAP_BUFFER_SIZE) return;
+
+    uint8_t hdr[PCAP_HEADER_SIZE];
+    putU32(hdr, us);
+    memcpy(&hdr[4], mac, 6);
+    hdr[10] = dir;
+    hdr[11] = len;
+
+    lock();
+    if (!paused) {
+      while (PCAP_BUFFER_SIZE - used < need) {
+        uint32_t oldest = PCAP_HEADER_SIZE + buf[(tail + 11) % PCAP_BUFFER_SIZE];
+        tail = (tail + oldest) % PCAP_BUFFER_SIZE;
+        used -= oldest;
+        count--;
+        overwritten++;
+      }
+      copyIn(hdr, PCAP_HEADER_SIZE);
+      copyIn(data, len);
+      used += need;
+      count++;
+    }
+    unlock();
+  }
+
+  // Oldest first. Recording pauses meanwhile (slow outputs would otherwise
+  // see the ring change under them); frames in that time are not kept.
+  uint32_t dump(CaptureLineFn fn, void* ctx) {
+    lock();
+    paused = true;
+    unlock();
+
+    static char line[PCAP_LINE_MAX];   // dump() callers are not reentrant
+    snprintf(line, sizeof(line), "CAP-BEGIN %u %u %u",
+             (unsigned)count, (unsigned)overwritten, (unsigned)startUs);
+    fn(ctx, line);
+
+    uint32_t pos = tail;
+    for (uint32_t i = 0; i < count; i++) {
+      CaptureRecord rec;
+      pos = readAt(pos, &rec);
+      formatLine(&rec, line);
+      fn(ctx, line);
+    }
+    fn(ctx, "CAP-END");
+
+    lock();
+    paused = false;
+    unlock();
+    return count;
+  }
+
+  void clear() {
+    lock();
+    head = tail = used = count = 0;
+    overwritten = 0;
+    unlock();
+  }
+
+  uint32_t records() const { return count; }
+  uint32_t overwrittenCount() const { return overwritten; }
+
+  static void formatLine(const CaptureRecord* rec, char* out) {
+    static const char hex[] = "0123456789ABCDEF";
+    int n = sprintf(out, "CAP %u %c ", (unsigned)rec->us, rec->dir);
+    for (uint8_t i = 0; i < 6; i++) {
+      out[n++] = hex[rec->mac[i] >> 4];
+      out[n++] = hex[rec->mac[i] & 0x0F];
+    }
+    out[n++] = ' ';
+    for (uint8_t i = 0; i < rec->len; i++) {
+      out[n++] = hex[rec->data[i] >> 4];
+      out[n++] = hex[rec->data[i] & 0x0F];
+    }
+    out[n] = '\0';
+  }
+
+private:
+  void copyIn(const uint8_t* src, uint32_t len) {
+    for (uint32_t i = 0; i < len; i++) {
+      buf[head] = src[i];
+      head = (head + 1) % PCAP_BUFFER_SIZE;
+    }
+  }
+
+  uint32_t readAt(uint32_t pos, CaptureRecord* rec) const {
+    uint8_t hdr[PCAP_HEADER_SIZE];
+    for (uint8_t i = 0; i < PCAP_HEADER_SIZE; i++) {
+      hdr[i] = buf[pos];
+      pos = (pos + 1) % PCAP_BUFFER_SIZE;
+    }
+    rec->us = getU32(hdr);
+    memcpy(rec->mac, &hdr[4], 6);
+    rec->dir = hdr[10];
+    rec->len = hdr[11];
+    for (uint8_t i = 0; i < rec->len; i++) {
+      rec->data[i] = buf[pos];
+      pos = (pos + 1) % PCAP_BUFFER_SIZE;
+    }
+    return pos;
+  }
+
+#if defined(ARDUINO_ARCH_ESP32)
+  void lock() { portENTER_CRITICAL(&mux); }
+  void unlock() { portEXIT_CRITICAL(&mux); }
+  portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+#elif defined(ARDUINO)
+  void lock() { noInterrupts(); }
+  void unlock() { interrupts(); }
+#else
+  void lock() {}                      // Native transports deliver in the loop
+  void unlock() {}
+#endif
+
+  uint8_t buf[PCAP_BUFFER_SIZE];
+  uint32_t head;                      // Next write offset
+  uint32_t tail;                      // Oldest record
+  uint32_t used;
+  uint32_t count;
+  uint32_t overwritten;
+  uint32_t startUs;
+  bool paused;
+};
+
+// =============================================================================
+// CAPTURING TRANSPORT
+// =============================================================================
+// Sits between the game logic and the real transport; the game sees the
+// same interface.
+class CaptureTransport : public Transport, public TransportHandler {
+public:
+  CaptureTransport(Transport* inner, PacketCapture* capture, Clock* clock) :
+    inner(inner), capture(capture), clock(clock), handler(nullptr) {}
+
+  bool begin(TransportHandler* h) override {
+    handler = h;
+    capture->start(clock->micros());
+    return inner->begin(this);
+  }
+
+  bool addPeer(const uint8_t* mac) override { return inner->addPeer(mac); }
+  bool removePeer(const uint8_t* mac) override { return inner->removePeer(mac); }
+
+  bool send(const uint8_t* mac, const uint8_t* data, uint8_t len) override {
+    capture->record(PCAP_TX, mac, data, len, clock->micros());
+    return inner->send(mac, data, len);
+  }
+
+  void poll() override { inner->poll(); }
+  void macAddress(uint8_t* mac) override { inner->macAddress(mac); }
+  int8_t lastRssi() override { return inner->lastRssi(); }
+
+  void onTransportReceive(const uint8_t* mac, const uint8_t* data, uint8_t len) override {
+    capture->record(PCAP_RX, mac, data, len, clock->micros());
+    if (handler) handler->onTransportReceive(mac, data, len);
+  }
+
+  void onTransportSent(const uint8_t* mac, bool ok) override {
+    if (handler) handler->onTransportSent(mac, ok);
+  }
+
+private:
+  Transport* inner;
+  PacketCapture* capture;
+  Clock* clock;
+  TransportHandler* handler;
+};
+
+#if !defined(ARDUINO)
+// =============================================================================
+// CAPTURE READER (native builds)
+// =============================================================================
+// Picks the CAP lines out of any text: a dump file, a decoded serial log
+// or a raw serial capture with log frames in between.
+class CaptureReader {
+public:
+  CaptureReader() : file(nullptr), header(false), lost(0), firstUs(0) {}
+  ~CaptureReader() { close(); }
+
+  bool open(const char* path) {
+    close();
+    file = fopen(path, "rb");
+    return file != nullptr;
+  }
+
+  void rewind() {
+    if (file) ::rewind(file);
+  }
+
+  void close() {
+    if (file) fclose(file);
+    file = nullptr;
+  }
+
+  // Records in order; the CAP-BEGIN line on the way fills in the header
+  bool next(CaptureRecord* rec) {
+    static char line[PCAP_LINE_MAX + 64];
+    while (file && fgets(line, sizeof(line), file)) {
+      const char* p = strstr(line, "CAP");
+      if (!p) continue;
+      unsigned n, overwritten, start;
+      if (sscanf(p, "CAP-BEGIN %u %u %u", &n, &overwritten, &start) == 3) {
+        lost = overwritten;
+        firstUs = start;
+        header = true;
+        continue;
+      }
+      if (parseLine(p, rec)) return true;
+    }
+    return false;
+  }
+
+  // From CAP-BEGIN, once next() has passed it
+  bool hasHeader() const { return header; }
+  uint32_t overwritten() const { return lost; }
+  uint32_t startUs() const { return firstUs; }
+
+  static bool parseLine(const char* p, CaptureRecord* rec) {
+    unsigned us;
+    char dir;
+    char mac[13];
+    int used = 0;
+    if (sscanf(p, "CAP %u %c %12s %n", &us, &dir, mac, &used) != 3 || used == 0) return false;
+    if (dir != PCAP_RX && dir != PCAP_TX) return false;
+    rec->us = us;
+    rec->dir = (uint8_t)dir;
+    if (parseHex(mac, rec->mac, 6) != 6) return false;
+    int len = parseHex(p + used, rec->data, FRAME_MAX_SIZE);
+    if (len <= 0) return false;
+    rec->len = (uint8_t)len;
+    return true;
+  }
+
+private:
+  static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+  }
+
+  // Bytes parsed up to the first non-hex character
+  static int parseHex(const char* s, uint8_t* out, int max) {
+    int n = 0;
+    while (n < max) {
+      int hi = hexValue(s[0]);
+      int lo = (hi < 0) ? -1 : hexValue(s[1]);
+      if (lo < 0) break;
+      out[n++] = (uint8_t)((hi << 4) | lo);
+      s += 2;
+    }
+    return n;
+  }
+
+  FILE* file;
+  bool header;
+  uint32_t lost;
+  uint32_t firstUs;
+};
+#endif
+
+#endif // PACKET_CAPTURE_H
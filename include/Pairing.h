@@ -0,0 +1,136 @@
+/*
+ * Pairing.h - Join Handshake and Persistent ID Assignments
+ * Shared between Host, Display, Joysticks and the native builds
+ *
+ * Handshake (v1 packets, no link layer):
+ *   Node → broadcast:  CMD_REQ_ID  src = ID_NEW (stick) or ID_DISPLAY
+ *   Host → node MAC:   CMD_OK      dest = request's src, data = assigned ID
+ *
+ * The host keys assignments by MAC and keeps them in a PairingStore (NVS on
+ * the ESP32), so a rebooted stick gets its old ID back in one round-trip
+ * and a rebooted host still knows every node. Nodes learn the host MAC from
+ * the CMD_OK sender and rejoin when the host goes quiet.
+ */
+
+#ifndef PAIRING_H
+#define PAIRING_H
+
+#include <stdint.h>
+#include <string.h>
+#include "Protocol.h"
+#include "GameTypes.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define JOIN_RETRY_MS     500     // CMD_REQ_ID repeat until CMD_OK arrives
+#define JOIN_LOST_MS      10000   // No host traffic for this long: rejoin
+                                  // (host: node offline)
+#define PAIRING_MAX       (MAX_PLAYERS + 1)  // Stored assignments (+ display)
+
+// =============================================================================
+// STORED ASSIGNMENT
+// =============================================================================
+typedef struct {
+  uint8_t id;
+  uint8_t mac[6];
+} PairingEntry;
+
+// =============================================================================
+// STORE INTERFACE
+// =============================================================================
+class PairingStore {
+public:
+  virtual ~PairingStore() {}
+  // Returns the number of entries read into out
+  virtual uint8_t load(PairingEntry* out, uint8_t max) = 0;
+  virtual bool save(const PairingEntry* entries, uint8_t count) = 0;
+};
+
+// =============================================================================
+// MEMORY STORE (native builds, tests)
+// =============================================================================
+class MemoryPairingStore : public PairingStore {
+public:
+  MemoryPairingStore() : count(0) {}
+
+  uint8_t load(PairingEntry* out, uint8_t max) override {
+    uint8_t n = (count < max) ? count : max;
+    memcpy(out, entries, n * sizeof(PairingEntry));
+    return n;
+  }
+
+  bool save(const PairingEntry* e, uint8_t n) override {
+    count = (n < PAIRING_MAX) ? n : PAIRING_MAX;
+    memcpy(entries, e, count * sizeof(PairingEntry));
+    return true;
+  }
+
+private:
+  PairingEntry entries[PAIRING_MAX];
+  uint8_t count;
+};
+
+// =============================================================================
+// NVS STORE (ESP32)
+// =============================================================================
+#if defined(ARDUINO_ARCH_ESP32)
+#include <Preferences.h>
+
+#define PAIRING_NVS_NAMESPACE "pairing"
+#define PAIRING_NVS_KEY       "table"
+
+// One blob, written only when an assignment changes
+class NvsPairingStore : public PairingStore {
+public:
+  uint8_t load(PairingEntry* out, uint8_t max) override {
+    Preferences prefs;
+    if (!prefs.begin(PAIRING_NVS_NAMESPACE, true)) return 0;
+    size_t len = prefs.getBytes(PAIRING_NVS_KEY, out, max * sizeof(PairingEntry));
+    prefs.end();
+    return (uint8_t)(len / sizeof(PairingEntry));
+  }
+
+  bool save(const PairingEntry* entries, uint8_t count) override {
+    Preferences prefs;
+    if (!prefs.begin(PAIRING_NVS_NAMESPACE, false)) return false;
+    size_t len = count * sizeof(PairingEntry);
+    bool ok = prefs.putBytes(PAIRING_NVS_KEY, entries, len) == len;
+    prefs.end();
+    return ok;
+  }
+};
+#endif
+
+// =============================================================================
+// FILE STORE (native builds)
+// =============================================================================
+#if !defined(ARDUINO)
+#include <stdio.h>
+
+class FilePairingStore : public PairingStore {
+public:
+  explicit FilePairingStore(const char* path) : path(path) {}
+
+  uint8_t load(PairingEntry* out, uint8_t max) override {
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0;
+    size_t n = fread(out, sizeof(PairingEntry), max, f);
+    fclose(f);
+    return (uint8_t)n;
+  }
+
+  bool save(const PairingEntry* entries, uint8_t count) override {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(entries, sizeof(PairingEntry), count, f) == count;
+    fclose(f);
+    return ok;
+  }
+
+private:
+  const char* path;
+};
+#endif
+
+#endif // PAIRING_H
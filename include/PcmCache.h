@@ -0,0 +1,295 @@
+/*
+ * PcmCache.h - Clips Decoded to RAM at Boot
+ * Host only
+ *
+ * Playing an MP3 from the sound bank means seeking to it, starting the
+ * decoder and syncing to the first frame, all after the game
+ * asked for the sound. For the sounds players react to (GO beep,
+ * countdown) that delay is unfair, and it varies. Those clips are decoded
+ * once in setup() and kept as PCM (PcmClip, AudioEngine.h), so their first
+ * samples reach the I2S DMA as soon as they are queued.
+ *
+ * Stored form, to fit the ESP32's RAM: mono at AUDIO_RATE (PcmCapture
+ * converts), with leading and trailing silence (below AUDIO_CACHE_TRIM)
+ * cut off. Each clip is decoded twice: once to measure it, once into a
+ * buffer of exactly its size. Clips go in the order added until
+ * AUDIO_CACHE_BYTES is used up (PSRAM, when the board has it:
+ * AUDIO_CACHE_PSRAM_BYTES); one that does not fit keeps playing from
+ * the bank.
+ *
+ * Transcoded clips (pcm, adpcm: BankPcmDecoder.h) are read the same way,
+ * twice, without the MP3 generator.
+ *
+ * PcmCapture is also what Mp3Decoder streams through: the MP3 generator
+ * writes into it as if it were an output, a read() at a time.
+ */
+
+#ifndef PCM_CACHE_H
+#define PCM_CACHE_H
+
+#include <Arduino.h>
+#include "AudioGeneratorMP3.h"
+#include "AudioOutput.h"
+#include "AudioEngine.h"
+#include "BankPcmDecoder.h"
+#include "SoundBank.h"
+#include "Log.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#ifndef AUDIO_CACHE_BYTES
+#define AUDIO_CACHE_BYTES       (128 * 1024)
+#endif
+#ifndef AUDIO_CACHE_PSRAM_BYTES
+#define AUDIO_CACHE_PSRAM_BYTES (1024 * 1024)
+#endif
+#ifndef AUDIO_CACHE_TRIM
+#define AUDIO_CACHE_TRIM        48      // |sample| at or below is silence (0: no trim)
+#endif
+
+#define AUDIO_CACHE_CLIPS       8
+#define AUDIO_CAPTURE_UP_MAX    4       // Lowest clip rate: AUDIO_RATE / 4
+
+// =============================================================================
+// DECODE TARGET
+// =============================================================================
+// Output the MP3 generator writes into instead of I2S. Downmixes to mono
+// and converts to AUDIO_RATE by an integer ratio (averaging down, repeating
+// up). Frames are numbered from the start of the clip: the first skip are
+// dropped, then at most limit are kept (encoder padding, Mp3Gapless.h).
+// With a target buffer, ConsumeSample() refuses once it is full, and the
+// generator keeps the sample for the next read (repeats that did not fit
+// are carried into the next target); without one, the clip is only
+// measured (non-silent span for trimming).
+class PcmCapture : public AudioOutput {
+public:
+  PcmCapture() : dst(nullptr), capacity(0), filled(0), skip(0), limit(0xFFFFFFFF),
+                 down(1), up(1), acc(0), pending(0), carried(0), frames(0), first(0), last(0),
+                 loud(false) {}
+
+  // New clip: skip and limit in AUDIO_RATE frames
+  void start(uint32_t from, uint32_t count) {
+    skip = from;
+    limit = count ? count : 0xFFFFFFFF;
+    acc = 0;
+    pending = 0;
+    carried = 0;
+    frames = 0;
+    loud = false;
+    target(nullptr, 0);
+  }
+
+  // Where the next frames go (nullptr: measure only)
+  void target(int16_t* buffer, uint32_t cap) {
+    dst = buffer;
+    capacity = cap;
+    filled = 0;
+    if (!dst) return;
+    uint8_t i = 0;
+    while (i < carried && filled < capacity) dst[filled++] = carry[i++];
+    memmove(carry, &carry[i], (carried - i) * sizeof(int16_t));
+    carried -= i;
+  }
+
+  bool SetRate(int hz) override {
+    hertz = hz;
+    down = (hz > AUDIO_RATE) ? (hz + AUDIO_RATE / 2) / AUDIO_RATE : 1;
+    up = (hz < AUDIO_RATE) ? (AUDIO_RATE + hz / 2) / hz : 1;
+    if (up > AUDIO_CAPTURE_UP_MAX) up = AUDIO_CAPTURE_UP_MAX;
+    if ((uint32_t)hz * up != (uint32_t)AUDIO_RATE * down) LOG(AUDIO_BAD_RATE, hz, AUDIO_RATE);
+    return true;
+  }
+
+  bool begin() override { return true; }
+  bool stop() override { return true; }
+
+  bool ConsumeSample(int16_t sample[2]) override {
+    if (dst && (filled >= capacity || carried)) return false;
+
+    int32_t v = sample[LEFTCHANNEL];
+    if (channels == 2) v = (v + sample[RIGHTCHANNEL]) / 2;
+    acc += v;
+    if (++pending < down) return true;
+    v = acc / (int32_t)down;
+    acc = 0;
+    pending = 0;
+
+    for (uint32_t k = 0; k < up; k++) {
+      uint32_t i = frames++;
+      if (i < skip || i - skip >= limit) continue;
+      if (v > AUDIO_CACHE_TRIM || v < -AUDIO_CACHE_TRIM) {
+        if (!loud) first = i - skip;
+        last = i - skip;
+        loud = true;
+      }
+      if (!dst) continue;
+      if (filled < capacity) dst[filled++] = (int16_t)v;
+      else carry[carried++] = (int16_t)v;
+    }
+    return true;
+  }
+
+  uint32_t count() const { return filled; }
+
+  // Kept span is over: no need to decode further
+  bool complete() const { return limit != 0xFFFFFFFF && frames >= skip + limit; }
+
+  // Frames the converter produced, kept or not
+  uint32_t total() const { return frames; }
+
+  // Non-silent span of the last clip (after skip); the whole clip with
+  // trimming off
+  uint32_t firstLoud() const { return (AUDIO_CACHE_TRIM && loud) ? first : 0; }
+  uint32_t loudFrames() const {
+    if (!AUDIO_CACHE_TRIM) return frames > skip ? frames - skip : 0;
+    return loud ? last - first + 1 : 0;
+  }
+
+private:
+  int16_t* dst;
+  uint32_t capacity;
+  uint32_t filled;
+  uint32_t skip;
+  uint32_t limit;
+  uint32_t down;          // Input frames averaged per output frame
+  uint32_t up;            // Output frames per input frame
+  int32_t acc;
+  uint32_t pending;
+  int16_t carry[AUDIO_CAPTURE_UP_MAX];
+  uint8_t carried;
+  uint32_t frames;        // AUDIO_RATE frames so far
+  uint32_t first;
+  uint32_t last;
+  bool loud;
+};
+
+// =============================================================================
+// PCM CACHE CLASS
+// =============================================================================
+class PcmCache {
+public:
+  PcmCache() : bank(nullptr), count(0), used(0), budget(AUDIO_CACHE_BYTES), psram(false) {}
+
+  ~PcmCache() {
+    for (uint8_t i = 0; i < count; i++) free(clips[i].samples);
+  }
+
+  // Call before add(); PSRAM boards get the larger budget
+  void begin(const SoundBank* sounds) {
+    bank = sounds;
+    file.begin();
+    raw.begin(sounds);
+    psram = psramFound();
+    budget = psram ? AUDIO_CACHE_PSRAM_BYTES : AUDIO_CACHE_BYTES;
+  }
+
+  // Decodes sound with mp3 (idle, not playing) and keeps it; false if it
+  // is not in the bank, does not decode or does not fit
+  bool add(uint8_t sound, AudioGeneratorMP3* mp3) {
+    if (find(sound)) return true;
+    const SoundEntry* e = bank ? bank->entry(sound) : nullptr;
+    if (count >= AUDIO_CACHE_CLIPS || !e) return false;
+    if (e->format != SND_FMT_MP3) return addRaw(sound, e);
+
+    PcmCapture capture;
+    if (!decode(e, mp3, &capture, 0, nullptr, 0)) return false;
+    uint32_t skip = capture.firstLoud();
+    uint32_t frames = capture.loudFrames();
+    int16_t* samples = reserve(e, frames);
+    if (!samples) return false;
+    if (!decode(e, mp3, &capture, skip, samples, frames)) {
+      free(samples);
+      return false;
+    }
+    keep(sound, e, samples, frames, skip);
+    return true;
+  }
+
+  const PcmClip* find(uint8_t sound) const {
+    for (uint8_t i = 0; i < count; i++) {
+      if (clips[i].sound == sound) return &clips[i];
+    }
+    return nullptr;
+  }
+
+  uint32_t bytesUsed() const { return used; }
+  uint8_t size() const { return count; }
+
+private:
+  // Buffer for frames within the budget; nullptr (logged) if they do not fit
+  int16_t* reserve(const SoundEntry* e, uint32_t frames) {
+    uint32_t bytes = frames * sizeof(int16_t);
+    int16_t* samples = nullptr;
+    if (frames && used + bytes <= budget) {
+      samples = (int16_t*)(psram ? ps_malloc(bytes) : malloc(bytes));
+    }
+    if (!samples) LOG(AUDIO_CACHE_SKIPPED, e->name, bytes, budget - used);
+    return samples;
+  }
+
+  void keep(uint8_t sound, const SoundEntry* e, int16_t* samples, uint32_t frames, uint32_t skip) {
+    PcmClip* clip = &clips[count++];
+    clip->sound = sound;
+    clip->samples = samples;
+    clip->frames = frames;
+    used += frames * sizeof(int16_t);
+    LOG(AUDIO_CACHED, e->name, frames, AUDIO_RATE, skip);
+  }
+
+  // pcm/adpcm: one pass for the loud span, one to copy it
+  bool addRaw(uint8_t sound, const SoundEntry* e) {
+    int16_t buf[AUDIO_BLOCK_FRAMES];
+    uint32_t first = 0, end = 0, pos = 0, n;
+    if (!raw.open(sound)) return false;
+    while ((n = raw.read(buf, AUDIO_BLOCK_FRAMES)) > 0) {
+      for (uint32_t i = 0; i < n; i++) {
+        if (AUDIO_CACHE_TRIM && buf[i] <= AUDIO_CACHE_TRIM && buf[i] >= -AUDIO_CACHE_TRIM) continue;
+        if (!end) first = pos + i;
+        end = pos + i + 1;
+      }
+      pos += n;
+    }
+    raw.close();
+
+    uint32_t frames = end - first;
+    int16_t* samples = reserve(e, frames);
+    if (!samples) return false;
+    raw.open(sound);
+    for (uint32_t skipped = 0; skipped < first; skipped += n) {
+      n = raw.read(buf, first - skipped < AUDIO_BLOCK_FRAMES ? first - skipped : AUDIO_BLOCK_FRAMES);
+      if (!n) break;
+    }
+    uint32_t got = 0;
+    while (got < frames && (n = raw.read(&samples[got], frames - got)) > 0) got += n;
+    raw.close();
+    if (got < frames) {
+      free(samples);
+      return false;
+    }
+    keep(sound, e, samples, frames, first);
+    return true;
+  }
+
+  bool decode(const SoundEntry* e, AudioGeneratorMP3* mp3, PcmCapture* capture,
+              uint32_t skip, int16_t* dst, uint32_t frames) {
+    if (!file.open(e)) return false;
+    capture->start(skip, frames);
+    capture->target(dst, frames);
+    if (!mp3->begin(&file, capture)) return false;
+    while (mp3->isRunning() && !capture->complete() && mp3->loop()) {}
+    mp3->stop();
+    return true;
+  }
+
+  const SoundBank* bank;
+  BankFileSource file;
+  BankPcmDecoder raw;
+  PcmClip clips[AUDIO_CACHE_CLIPS];
+  uint8_t count;
+  uint32_t used;
+  uint32_t budget;
+  bool psram;
+};
+
+#endif // PCM_CACHE_H
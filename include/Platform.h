@@ -0,0 +1,86 @@
+/*
+ * Platform.h - Clock Access for Portable Game Logic
+ * Shared between Host, Display, Joysticks and the native builds
+ *
+ * Game logic reads time through a Clock object (and logs through Log.h),
+ * so the same code runs on the ESP cores (Arduino micros()) and as a
+ * Linux process (CLOCK_MONOTONIC).
+ */
+
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stdint.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#endif
+
+// =============================================================================
+// CLOCK INTERFACE (32-bit wrapping, like micros()/millis())
+// =============================================================================
+class Clock {
+public:
+  virtual ~Clock() {}
+  virtual uint32_t micros() = 0;
+  virtual uint32_t millis() = 0;
+
+  // Busy-wait until micros() reaches us (scheduled actions)
+  virtual void waitUntil(uint32_t us) {
+    while ((int32_t)(micros() - us) < 0) {
+    }
+  }
+};
+
+// =============================================================================
+// SYSTEM CLOCK
+// =============================================================================
+class SystemClock : public Clock {
+public:
+#ifdef ARDUINO
+  uint32_t micros() override { return ::micros(); }
+  uint32_t millis() override { return ::millis(); }
+#else
+  uint32_t micros() override { return (uint32_t)(monotonicNs() / 1000); }
+  uint32_t millis() override { return (uint32_t)(monotonicNs() / 1000000); }
+
+private:
+  static uint64_t monotonicNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+  }
+#endif
+};
+
+// =============================================================================
+// VIRTUAL CLOCK (simulation)
+// =============================================================================
+// Time only moves when the owner advances it, so runs are deterministic and
+// as fast as the CPU allows. 64-bit inside; micros()/millis() wrap like the
+// real ones.
+class VirtualClock : public Clock {
+public:
+  explicit VirtualClock(uint64_t startUs = 1000000) : nowUs(startUs) {}
+
+  uint32_t micros() override { return (uint32_t)nowUs; }
+  uint32_t millis() override { return (uint32_t)(nowUs / 1000); }
+
+  // Waiting costs nothing: jump straight to the target
+  void waitUntil(uint32_t us) override {
+    int32_t ahead = (int32_t)(us - (uint32_t)nowUs);
+    if (ahead > 0) nowUs += (uint32_t)ahead;
+  }
+
+  void advance(uint32_t us) { nowUs += us; }
+  void setUs(uint64_t us) { if (us > nowUs) nowUs = us; }
+  uint64_t nowUs64() const { return nowUs; }
+
+private:
+  uint64_t nowUs;
+};
+
+#endif // PLATFORM_H
@@ -2,14 +2,20 @@
  * Protocol.h - Reaction Time Duel Communication Protocol
  * Shared between ESP32-S3 Master and ESP8266 Joysticks
  * 
- * Packet Format (7 bytes):
+ * Packet Format v1 (7 bytes):
  * [START][DEST_ID][SRC_ID][CMD][DATA_HIGH][DATA_LOW][CRC8]
+ *
+ * Frame Format v2 (8-250 bytes, several commands per transmission):
+ * [START_V2][DEST_ID][SRC_ID][COUNT][LEN] + COUNT x [CMD][N][DATA x N] + [CRC8]
+ * LEN is the byte length of the records. A v2 frame is never 7 bytes long
+ * and uses a different start byte, so v1 receivers drop it cleanly.
  */
 
 #ifndef PROTOCOL_H
 #define PROTOCOL_H
 
 #include <stdint.h>
+#include "Crc8.h"
 
 // =============================================================================
 // PACKET STRUCTURE
@@ -35,12 +41,14 @@ typedef struct __attribute__((packed)) {
 #define ID_STICK2         0x02
 #define ID_STICK3         0x03
 #define ID_STICK4         0x04
+#define ID_NEW            0xFD  // Stick without an ID (join requests only)
+#define ID_DISPLAY        0xFE
 #define ID_BROADCAST      0xFF
 
 // =============================================================================
 // COMMANDS: Host → Joysticks
 // =============================================================================
-#define CMD_OK            0x0B  // Acknowledge (join confirmed)
+#define CMD_OK            0x0B  // Join confirmed (data = assigned ID, see Pairing.h)
 #define CMD_GAME_START    0x21  // Start round (data_high=mode, data_low=param)
 #define CMD_VIBRATE       0x23  // Vibrate (0xFF=GO signal, else duration×10ms)
 #define CMD_IDLE          0x24  // Return to idle state
@@ -49,9 +57,34 @@ typedef struct __attribute__((packed)) {
 // =============================================================================
 // COMMANDS: Joysticks → Host
 // =============================================================================
-#define CMD_REQ_ID        0x0D  // Request to join game
+#define CMD_REQ_ID        0x0D  // Request to join game (broadcast, see Pairing.h)
 #define CMD_REACTION_DONE 0x26  // Reaction complete (data = time_ms, 0xFFFF=penalty)
 #define CMD_SHAKE_DONE    0x27  // Shake complete (data = time_ms, 0xFFFF=timeout)
+#define CMD_REACTION_US   0x29  // Reaction time in µs, v2 only (data = time_us u32)
+
+// =============================================================================
+// COMMANDS: Host → Display (v2 records only)
+// =============================================================================
+#define CMD_RESULT        0x28  // Player result (data = player_id, time_ms)
+#define CMD_PEER_STATS    0x2A  // Link quality of one node (see LinkTelemetry.h)
+
+// =============================================================================
+// COMMANDS: Link layer (v2 records only, see ReliableLink.h)
+// =============================================================================
+#define CMD_LINK_SEQ      0x30  // Sequence header (data = seq, flags)
+#define CMD_LINK_ACK      0x31  // Selective ACK (data = channel, last_seq, bitmap32)
+
+// =============================================================================
+// COMMANDS: Clock sync (v2 records only, see ClockSync.h)
+// =============================================================================
+#define CMD_SYNC_REQ      0x32  // Host → node (data = t1, offset, drift_ppb, flags)
+#define CMD_SYNC_RESP     0x33  // Node → host (data = t1, t2, t3)
+
+// =============================================================================
+// COMMANDS: Scheduling (v2 records only, see Scheduler.h)
+// =============================================================================
+#define CMD_FIRE_AT       0x34  // Following records run at host instant (data = host_us)
+#define CMD_SKEW_REPORT   0x35  // Node → host (data = cmd, late_us)
 
 // =============================================================================
 // GAME MODES
@@ -71,20 +104,16 @@ typedef struct __attribute__((packed)) {
 #define VIBRATE_GO        0xFF    // GO signal vibration
 
 // =============================================================================
-// CRC8 CALCULATION (Polynomial 0x8C)
+// CRC8 CALCULATION (Polynomial 0x8C, engine selected by CRC8_IMPL)
 // =============================================================================
 inline uint8_t calcCRC8(const uint8_t* data, uint8_t len) {
-  uint8_t crc = 0x00;
-  while (len--) {
-    uint8_t extract = *data++;
-    for (uint8_t i = 8; i; i--) {
-      uint8_t sum = (crc ^ extract) & 0x01;
-      crc >>= 1;
-      if (sum) crc ^= 0x8C;
-      extract >>= 1;
-    }
-  }
-  return crc;
+#if CRC8_IMPL == CRC8_IMPL_TABLE
+  return crc8Table(data, len);
+#elif CRC8_IMPL == CRC8_IMPL_NIBBLE
+  return crc8Nibble(data, len);
+#else
+  return crc8Bitwise(data, len);
+#endif
 }
 
 // =============================================================================
@@ -114,4 +143,152 @@ inline void buildPacket(GamePacket* pkt, uint8_t dest, uint8_t src, uint8_t cmd,
   pkt->crc = calcCRC8((const uint8_t*)pkt, 6);
 }
 
+// =============================================================================
+// V2 FRAME STRUCTURE
+// =============================================================================
+#define FRAME_START_V2    0x0C
+#define FRAME_HEADER_SIZE 5
+#define FRAME_MAX_SIZE    250   // ESP-NOW payload limit
+
+// Header byte offsets
+#define FRAME_OFS_DEST    1
+#define FRAME_OFS_SRC     2
+#define FRAME_OFS_COUNT   3
+#define FRAME_OFS_LEN     4
+
+typedef struct {
+  uint8_t buf[FRAME_MAX_SIZE];
+  uint8_t len;          // Bytes used so far (header + records, CRC excluded)
+} GameFrame;
+
+typedef struct {
+  uint8_t cmd;
+  uint8_t len;
+  const uint8_t* data;
+} FrameRecord;
+
+typedef struct {
+  uint8_t dest_id;
+  uint8_t src_id;
+  uint8_t remaining;    // Records not yet returned by frameNext()
+  bool v1;              // Source was a 7-byte v1 packet
+  const uint8_t* pos;
+  const uint8_t* end;
+} FrameReader;
+
+// =============================================================================
+// V2 FRAME BUILDING
+// =============================================================================
+inline void frameBegin(GameFrame* f, uint8_t dest, uint8_t src) {
+  f->buf[0] = FRAME_START_V2;
+  f->buf[FRAME_OFS_DEST] = dest;
+  f->buf[FRAME_OFS_SRC] = src;
+  f->buf[FRAME_OFS_COUNT] = 0;
+  f->buf[FRAME_OFS_LEN] = 0;
+  f->len = FRAME_HEADER_SIZE;
+}
+
+// Append a record; returns false (frame unchanged) if it does not fit
+inline bool frameAdd(GameFrame* f, uint8_t cmd, const uint8_t* data, uint8_t len) {
+  if (f->len + 2 + len + 1 > FRAME_MAX_SIZE) return false;
+  f->buf[f->len++] = cmd;
+  f->buf[f->len++] = len;
+  for (uint8_t i = 0; i < len; i++) {
+    f->buf[f->len++] = data[i];
+  }
+  f->buf[FRAME_OFS_COUNT]++;
+  f->buf[FRAME_OFS_LEN] = f->len - FRAME_HEADER_SIZE;
+  return true;
+}
+
+// Same 16-bit big-endian payload as a v1 packet
+inline bool frameAddU16(GameFrame* f, uint8_t cmd, uint16_t data) {
+  uint8_t bytes[2] = { (uint8_t)(data >> 8), (uint8_t)(data & 0xFF) };
+  return frameAdd(f, cmd, bytes, 2);
+}
+
+// Append the CRC; returns the number of bytes to transmit
+inline uint8_t frameFinish(GameFrame* f) {
+  f->buf[f->len] = calcCRC8(f->buf, f->len);
+  return f->len + 1;
+}
+
+// =============================================================================
+// V2 FRAME PARSING (v1 packets are read as a single 2-byte record)
+// =============================================================================
+inline bool frameOpen(FrameReader* r, const uint8_t* data, int len) {
+  if (len == PACKET_SIZE) {
+    const GamePacket* pkt = (const GamePacket*)data;
+    if (!validatePacket(pkt)) return false;
+    r->dest_id = pkt->dest_id;
+    r->src_id = pkt->src_id;
+    r->remaining = 1;
+    r->v1 = true;
+    r->pos = &pkt->cmd;
+    r->end = &pkt->crc;
+    return true;
+  }
+
+  if (len < FRAME_HEADER_SIZE + 1 || len > FRAME_MAX_SIZE) return false;
+  if (data[0] != FRAME_START_V2) return false;
+  if (data[FRAME_OFS_LEN] != len - FRAME_HEADER_SIZE - 1) return false;
+  if (calcCRC8(data, len - 1) != data[len - 1]) return false;
+
+  r->dest_id = data[FRAME_OFS_DEST];
+  r->src_id = data[FRAME_OFS_SRC];
+  r->remaining = data[FRAME_OFS_COUNT];
+  r->v1 = false;
+  r->pos = data + FRAME_HEADER_SIZE;
+  r->end = data + len - 1;
+  return true;
+}
+
+// Next record; returns false at the end or on a truncated record
+inline bool frameNext(FrameReader* r, FrameRecord* rec) {
+  if (r->remaining == 0) return false;
+
+  if (r->v1) {
+    rec->cmd = r->pos[0];
+    rec->len = 2;
+    rec->data = r->pos + 1;
+    r->remaining = 0;
+    return true;
+  }
+
+  if (r->end - r->pos < 2) return false;
+  rec->cmd = r->pos[0];
+  rec->len = r->pos[1];
+  if (r->end - r->pos - 2 < rec->len) return false;
+  rec->data = r->pos + 2;
+  r->pos += 2 + rec->len;
+  r->remaining--;
+  return true;
+}
+
+// =============================================================================
+// RECORD HELPERS
+// =============================================================================
+inline uint16_t recordU16(const FrameRecord* rec, uint8_t ofs = 0) {
+  if (rec->len < ofs + 2) return 0;
+  return ((uint16_t)rec->data[ofs] << 8) | rec->data[ofs + 1];
+}
+
+inline uint32_t recordU32(const FrameRecord* rec, uint8_t ofs = 0) {
+  if (rec->len < ofs + 4) return 0;
+  return ((uint32_t)rec->data[ofs] << 24) | ((uint32_t)rec->data[ofs + 1] << 16) |
+         ((uint32_t)rec->data[ofs + 2] << 8) | rec->data[ofs + 3];
+}
+
+inline void putU32(uint8_t* buf, uint32_t value) {
+  buf[0] = (uint8_t)(value >> 24);
+  buf[1] = (uint8_t)(value >> 16);
+  buf[2] = (uint8_t)(value >> 8);
+  buf[3] = (uint8_t)value;
+}
+
+inline uint32_t getU32(const uint8_t* buf) {
+  return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) |
+         ((uint32_t)buf[2] << 8) | buf[3];
+}
+
 #endif // PROTOCOL_H
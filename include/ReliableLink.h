@@ -0,0 +1,370 @@
+/*
+ * ReliableLink.h - Sequence-numbered Delivery over ESP-NOW
+ * Shared between Host and Joysticks
+ *
+ * A reliable frame carries a CMD_LINK_SEQ record. The receiver answers with
+ * CMD_LINK_ACK holding its newest sequence number plus a bitmap of the 32
+ * before it, so one ACK confirms a whole window (selective ACK).
+ * - Unicast: one sequence stream per destination ID
+ * - Broadcast: one shared stream; every registered peer must ACK, missing
+ *   peers get unicast retransmissions
+ * - Retransmit timeout follows the measured RTT (srtt + 4*rttvar, Karn's
+ *   rule), doubled per attempt, at most LINK_MAX_RETRIES retries
+ * - Receivers suppress duplicates with the same window
+ *
+ * No platform calls: the caller passes the clock in and supplies a send hook.
+ */
+
+#ifndef RELIABLE_LINK_H
+#define RELIABLE_LINK_H
+
+#include <stdint.h>
+#include <string.h>
+#include "Protocol.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#ifndef LINK_MAX_NODES
+#define LINK_MAX_NODES    17      // Node IDs 0..16 tracked (host + up to 16 sticks)
+#endif
+#ifndef LINK_TX_SLOTS
+#define LINK_TX_SLOTS     4       // Unacknowledged frames in flight
+#endif
+
+#define LINK_MAX_RETRIES  5
+#define LINK_RTO_INIT_US  8000    // Before the first RTT sample
+#define LINK_RTO_MIN_US   2000
+#define LINK_RTO_MAX_US   100000
+#define LINK_WINDOW       32      // Receive window / ACK bitmap width
+
+// CMD_LINK_SEQ flags
+#define LINK_FLAG_ACK_REQ 0x01
+#define LINK_FLAG_SYN     0x02    // First frame of a stream, resets receiver
+
+// CMD_LINK_ACK channels
+#define LINK_CH_UNICAST   0
+#define LINK_CH_BROADCAST 1
+
+// =============================================================================
+// TYPES
+// =============================================================================
+// ctx: the pointer given to begin()
+typedef void (*LinkSendFn)(void* ctx, uint8_t destId, const uint8_t* data, uint8_t len);
+typedef void (*LinkRttFn)(void* ctx, uint8_t id, uint32_t rttUs);
+
+typedef struct {
+  uint32_t sent;        // Reliable frames transmitted (first attempt)
+  uint32_t retries;     // Retransmissions
+  uint32_t delivered;   // Frames acknowledged by every destination
+  uint32_t drops;       // Gave up after LINK_MAX_RETRIES
+  uint32_t dupes;       // Duplicates suppressed on receive
+  uint32_t acks;        // ACK frames sent
+  uint32_t full;        // send() rejected, no free slot
+  uint32_t macFails;    // Radio reported send failure
+} LinkStats;
+
+// =============================================================================
+// RELIABLE LINK CLASS
+// =============================================================================
+class ReliableLink {
+public:
+  ReliableLink() : myId(ID_HOST), sendFn(nullptr), sendCtx(nullptr), rttFn(nullptr), peerMask(0), bcastSeq(0), bcastSyn(true) {
+    memset(slots, 0, sizeof(slots));
+    memset(peers, 0, sizeof(peers));
+    memset(&bcastRx, 0, sizeof(bcastRx));
+    memset(&stats, 0, sizeof(stats));
+    for (uint8_t i = 0; i < LINK_MAX_NODES; i++) {
+      peers[i].syn = true;
+    }
+  }
+
+  void begin(uint8_t id, LinkSendFn fn, void* ctx = nullptr) {
+    myId = id;
+    sendFn = fn;
+    sendCtx = ctx;
+  }
+
+  // Optional: every RTT sample (first-attempt ACKs only), same ctx as begin()
+  void setRttHook(LinkRttFn fn) { rttFn = fn; }
+
+  // Peers that must acknowledge reliable broadcasts
+  void addPeer(uint8_t id) {
+    if (id < LINK_MAX_NODES) peerMask |= (1UL << id);
+  }
+
+  void removePeer(uint8_t id) {
+    if (id < LINK_MAX_NODES) peerMask &= ~(1UL << id);
+  }
+
+  // Forget sequence state of a restarted node: its numbering starts over
+  void resetPeer(uint8_t id) {
+    if (id >= LINK_MAX_NODES) return;
+    memset(&peers[id], 0, sizeof(peers[id]));
+    peers[id].syn = true;
+    bcastRx[id].valid = false;
+  }
+
+  // Add a sequence record to a built frame and transmit it reliably
+  bool send(GameFrame* frame, uint32_t nowUs) {
+    uint8_t dest = frame->buf[FRAME_OFS_DEST];
+    bool bcast = (dest == ID_BROADCAST);
+    if (!bcast && dest >= LINK_MAX_NODES) return false;
+
+    Slot* slot = freeSlot();
+    if (!slot) {
+      stats.full++;
+      return false;
+    }
+
+    uint8_t* seq = bcast ? &bcastSeq : &peers[dest].txSeq;
+    bool* syn = bcast ? &bcastSyn : &peers[dest].syn;
+    uint8_t hdr[2] = { *seq, (uint8_t)(LINK_FLAG_ACK_REQ | (*syn ? LINK_FLAG_SYN : 0)) };
+    if (!frameAdd(frame, CMD_LINK_SEQ, hdr, sizeof(hdr))) return false;
+    (*seq)++;
+    *syn = false;
+
+    slot->len = frameFinish(frame);
+    memcpy(slot->buf, frame->buf, slot->len);
+    slot->dest = dest;
+    slot->seq = hdr[0];
+    slot->tries = 0;
+    slot->pending = bcast ? peerMask : (1UL << dest);
+    slot->firstUs = nowUs;
+    slot->nextUs = nowUs + rtoFor(slot);
+    slot->used = (slot->pending != 0);
+
+    if (sendFn) sendFn(sendCtx, dest, slot->buf, slot->len);
+    stats.sent++;
+    return true;
+  }
+
+  // Retransmit overdue frames; call every loop
+  void poll(uint32_t nowUs) {
+    for (uint8_t i = 0; i < LINK_TX_SLOTS; i++) {
+      Slot* slot = &slots[i];
+      if (!slot->used || (int32_t)(nowUs - slot->nextUs) < 0) continue;
+
+      if (slot->tries >= LINK_MAX_RETRIES) {
+        slot->used = false;
+        stats.drops++;
+        continue;
+      }
+
+      // Only the peers still missing the frame hear it again
+      for (uint8_t id = 0; id < LINK_MAX_NODES; id++) {
+        if ((slot->pending & (1UL << id)) && sendFn) {
+          sendFn(sendCtx, id, slot->buf, slot->len);
+        }
+      }
+      slot->tries++;
+      slot->nextUs = nowUs + (rtoFor(slot) << slot->tries);
+      stats.retries++;
+    }
+  }
+
+  // Process link records of an incoming frame. Returns true if the frame
+  // carries application records that have not been delivered before.
+  bool onReceive(const uint8_t* data, int len, uint32_t nowUs) {
+    FrameReader reader;
+    if (!frameOpen(&reader, data, len)) return false;
+    if (reader.v1) return true;
+
+    uint8_t src = reader.src_id;
+    bool hasSeq = false;
+    uint8_t seq = 0, flags = 0, appRecords = 0;
+
+    FrameRecord rec;
+    while (frameNext(&reader, &rec)) {
+      if (rec.cmd == CMD_LINK_ACK) {
+        if (rec.len >= 6) handleAck(src, &rec, nowUs);
+      } else if (rec.cmd == CMD_LINK_SEQ) {
+        if (rec.len >= 2) {
+          hasSeq = true;
+          seq = rec.data[0];
+          flags = rec.data[1];
+        }
+      } else {
+        appRecords++;
+      }
+    }
+
+    if (!hasSeq || src >= LINK_MAX_NODES) return appRecords > 0;
+
+    bool bcast = (reader.dest_id == ID_BROADCAST);
+    Window* w = bcast ? &bcastRx[src] : &peers[src].rx;
+    bool fresh = accept(w, seq, flags & LINK_FLAG_SYN);
+
+    if (flags & LINK_FLAG_ACK_REQ) {
+      sendAck(src, bcast ? LINK_CH_BROADCAST : LINK_CH_UNICAST, w);
+    }
+    if (!fresh) {
+      stats.dupes++;
+      return false;
+    }
+    return appRecords > 0;
+  }
+
+  // Feed the radio's send status callback
+  void noteSendStatus(bool ok) {
+    if (!ok) stats.macFails++;
+  }
+
+  // Current retransmit timeout towards a peer
+  uint32_t rtoUs(uint8_t id) const {
+    if (id >= LINK_MAX_NODES || !peers[id].hasRtt) return LINK_RTO_INIT_US;
+    uint32_t rto = peers[id].srttUs + 4 * peers[id].rttvarUs;
+    if (rto < LINK_RTO_MIN_US) rto = LINK_RTO_MIN_US;
+    if (rto > LINK_RTO_MAX_US) rto = LINK_RTO_MAX_US;
+    return rto;
+  }
+
+  uint32_t srttUs(uint8_t id) const {
+    return (id < LINK_MAX_NODES) ? peers[id].srttUs : 0;
+  }
+
+  uint8_t inFlight() const {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < LINK_TX_SLOTS; i++) {
+      if (slots[i].used) n++;
+    }
+    return n;
+  }
+
+  const LinkStats& getStats() const { return stats; }
+
+private:
+  struct Slot {
+    bool used;
+    uint8_t dest;
+    uint8_t seq;
+    uint8_t tries;
+    uint32_t pending;   // Node IDs that still have to ACK
+    uint32_t firstUs;
+    uint32_t nextUs;
+    uint8_t len;
+    uint8_t buf[FRAME_MAX_SIZE];
+  };
+
+  // bits: bit i set = sequence (last - 1 - i) received
+  struct Window {
+    bool valid;
+    uint8_t last;
+    uint32_t bits;
+  };
+
+  struct Peer {
+    uint8_t txSeq;
+    bool syn;
+    bool hasRtt;
+    uint32_t srttUs;
+    uint32_t rttvarUs;
+    Window rx;
+  };
+
+  Slot* freeSlot() {
+    for (uint8_t i = 0; i < LINK_TX_SLOTS; i++) {
+      if (!slots[i].used) return &slots[i];
+    }
+    return nullptr;
+  }
+
+  uint32_t rtoFor(const Slot* slot) const {
+    uint32_t rto = LINK_RTO_MIN_US;
+    for (uint8_t id = 0; id < LINK_MAX_NODES; id++) {
+      if ((slot->pending & (1UL << id)) && rtoUs(id) > rto) rto = rtoUs(id);
+    }
+    return rto;
+  }
+
+  static bool covers(uint8_t last, uint32_t bits, uint8_t seq) {
+    uint8_t back = (uint8_t)(last - seq);
+    if (back == 0) return true;
+    return back <= LINK_WINDOW && (bits & (1UL << (back - 1)));
+  }
+
+  // Returns true if seq is new and marks it received
+  static bool accept(Window* w, uint8_t seq, bool syn) {
+    int8_t ahead = (int8_t)(seq - w->last);
+    bool inWindow = w->valid && ahead <= 0 && ahead >= -LINK_WINDOW;
+
+    if (!w->valid || (syn && !(inWindow && covers(w->last, w->bits, seq)))) {
+      w->valid = true;
+      w->last = seq;
+      w->bits = 0;
+      return true;
+    }
+    if (ahead > 0) {
+      w->bits = (ahead >= LINK_WINDOW) ? 0 : (w->bits << ahead);
+      if (ahead <= LINK_WINDOW) w->bits |= (1UL << (ahead - 1));
+      w->last = seq;
+      return true;
+    }
+    if (!inWindow || covers(w->last, w->bits, seq)) return false;
+    w->bits |= (1UL << (-ahead - 1));
+    return true;
+  }
+
+  void sendAck(uint8_t dest, uint8_t channel, const Window* w) {
+    GameFrame ack;
+    frameBegin(&ack, dest, myId);
+    uint8_t body[6] = { channel, w->last };
+    putU32(&body[2], w->bits);
+    frameAdd(&ack, CMD_LINK_ACK, body, sizeof(body));
+    uint8_t len = frameFinish(&ack);
+    if (sendFn) sendFn(sendCtx, dest, ack.buf, len);
+    stats.acks++;
+  }
+
+  void handleAck(uint8_t src, const FrameRecord* rec, uint32_t nowUs) {
+    if (src >= LINK_MAX_NODES) return;
+    bool bcast = (rec->data[0] == LINK_CH_BROADCAST);
+    uint8_t last = rec->data[1];
+    uint32_t bits = recordU32(rec, 2);
+
+    for (uint8_t i = 0; i < LINK_TX_SLOTS; i++) {
+      Slot* slot = &slots[i];
+      if (!slot->used || !(slot->pending & (1UL << src))) continue;
+      if ((slot->dest == ID_BROADCAST) != bcast) continue;
+      if (!covers(last, bits, slot->seq)) continue;
+
+      if (slot->tries == 0) sampleRtt(src, nowUs - slot->firstUs);
+      slot->pending &= ~(1UL << src);
+      if (slot->pending == 0) {
+        slot->used = false;
+        stats.delivered++;
+      }
+    }
+  }
+
+  // RFC 6298 smoothing in integer microseconds
+  void sampleRtt(uint8_t id, uint32_t rtt) {
+    if (rttFn) rttFn(sendCtx, id, rtt);
+    Peer* p = &peers[id];
+    if (!p->hasRtt) {
+      p->srttUs = rtt;
+      p->rttvarUs = rtt / 2;
+      p->hasRtt = true;
+      return;
+    }
+    uint32_t err = (p->srttUs > rtt) ? (p->srttUs - rtt) : (rtt - p->srttUs);
+    p->rttvarUs = (3 * p->rttvarUs + err) / 4;
+    p->srttUs = (7 * p->srttUs + rtt) / 8;
+  }
+
+  uint8_t myId;
+  LinkSendFn sendFn;
+  void* sendCtx;
+  LinkRttFn rttFn;
+  uint32_t peerMask;
+
+  Slot slots[LINK_TX_SLOTS];
+  Peer peers[LINK_MAX_NODES];
+  Window bcastRx[LINK_MAX_NODES];   // Broadcast stream per source
+  uint8_t bcastSeq;
+  bool bcastSyn;
+
+  LinkStats stats;
+};
+
+#endif // RELIABLE_LINK_H
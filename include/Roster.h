@@ -0,0 +1,137 @@
+/*
+ * Roster.h - Player Slots for One Round
+ * Host and native builds
+ *
+ * Stick ID → slot is a direct-indexed table over the whole ID space, so
+ * the per-packet lookup is one load with no range checks. Joined/finished
+ * are bitmasks: "everyone done" is a single compare. Results are ranked
+ * N-way by reaction time (µs), penalties last, equal times share a place.
+ */
+
+#ifndef ROSTER_H
+#define ROSTER_H
+
+#include <stdint.h>
+#include <string.h>
+#include "Protocol.h"
+#include "GameTypes.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define ROSTER_NO_SLOT    0xFF
+
+#if MAX_PLAYERS > 16
+#error "MAX_PLAYERS is limited to 16 (PlayerMask width)"
+#endif
+
+typedef uint16_t PlayerMask;    // Bit i = slot i
+
+// =============================================================================
+// ROSTER CLASS
+// =============================================================================
+class Roster {
+public:
+  Roster() : joined(0), finished(0) {
+    memset(slotTable, ROSTER_NO_SLOT, sizeof(slotTable));
+    for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+      slotTable[ID_STICK1 + i] = i;
+    }
+    memset(players, 0, sizeof(players));
+  }
+
+  // ROSTER_NO_SLOT for the host, display and anything out of range
+  uint8_t slotOf(uint8_t id) const { return slotTable[id]; }
+  static uint8_t idOf(uint8_t slot) { return ID_STICK1 + slot; }
+  static bool isStickId(uint8_t id) { return id >= ID_STICK1 && id < ID_STICK1 + MAX_PLAYERS; }
+
+  // New round with the given players; clears every result
+  void startRound(PlayerMask players_) {
+    joined = players_;
+    finished = 0;
+    memset(players, 0, sizeof(players));
+  }
+
+  // A player's report; false for a duplicate or a slot not in the round
+  bool finish(uint8_t slot, uint16_t timeMs) {
+    if (slot >= MAX_PLAYERS) return false;
+    PlayerMask bit = (PlayerMask)(1U << slot);
+    if (!(joined & bit) || (finished & bit)) return false;
+    players[slot].reactionTime = timeMs;
+    players[slot].reactionUs = (uint32_t)timeMs * 1000;
+    finished |= bit;
+    return true;
+  }
+
+  // Full resolution, follows finish() in the same frame
+  void setReactionUs(uint8_t slot, uint32_t us) {
+    if (slot < MAX_PLAYERS) players[slot].reactionUs = us;
+  }
+
+  bool allDone() const { return (finished & joined) == joined; }
+
+  // No report counts as a penalty, not as 0 ms
+  void penalizeUnfinished() {
+    PlayerMask missing = joined & ~finished;
+    for (uint8_t i = 0; missing; i++, missing >>= 1) {
+      if (!(missing & 1)) continue;
+      players[i].reactionTime = TIME_PENALTY;
+      players[i].reactionUs = (uint32_t)TIME_PENALTY * 1000;
+    }
+    finished |= joined;
+  }
+
+  // Joined slots, best first; place[k] is 1-based and shared by equal
+  // times. Returns the number of ranked slots.
+  uint8_t rank(uint8_t* order, uint8_t* place) const {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+      if (!(joined & (1U << i))) continue;
+      // Insertion sort: at most 16 entries
+      uint8_t k = n++;
+      while (k > 0 && better(i, order[k - 1])) {
+        order[k] = order[k - 1];
+        k--;
+      }
+      order[k] = i;
+    }
+    for (uint8_t k = 0; k < n; k++) {
+      place[k] = (k > 0 && same(order[k], order[k - 1])) ? place[k - 1] : (uint8_t)(k + 1);
+    }
+    return n;
+  }
+
+  // Sole fastest valid player, or NO_WINNER (tie, all penalties, empty)
+  uint8_t winner() const {
+    uint8_t order[MAX_PLAYERS], place[MAX_PLAYERS];
+    uint8_t n = rank(order, place);
+    if (n == 0 || isPenalty(order[0])) return NO_WINNER;
+    if (n > 1 && place[1] == 1) return NO_WINNER;
+    return order[0];
+  }
+
+  bool isJoined(uint8_t slot) const { return slot < MAX_PLAYERS && (joined & (1U << slot)); }
+  bool isFinished(uint8_t slot) const { return slot < MAX_PLAYERS && (finished & (1U << slot)); }
+  bool isPenalty(uint8_t slot) const { return players[slot].reactionTime == TIME_PENALTY; }
+  PlayerMask joinedMask() const { return joined; }
+  PlayerMask finishedMask() const { return finished; }
+  const Player& player(uint8_t slot) const { return players[slot]; }
+
+private:
+  // Valid before penalty, then faster, then lower slot (stable)
+  bool better(uint8_t a, uint8_t b) const {
+    if (isPenalty(a) != isPenalty(b)) return isPenalty(b);
+    return players[a].reactionUs < players[b].reactionUs;
+  }
+
+  bool same(uint8_t a, uint8_t b) const {
+    return isPenalty(a) == isPenalty(b) && players[a].reactionUs == players[b].reactionUs;
+  }
+
+  uint8_t slotTable[256];       // Indexed by src_id
+  PlayerMask joined;
+  PlayerMask finished;
+  Player players[MAX_PLAYERS];
+};
+
+#endif // ROSTER_H
@@ -0,0 +1,157 @@
+/*
+ * Scheduler.h - Timed Execution of Protocol Commands
+ * Shared between Host, Display and Joysticks
+ *
+ * A CMD_FIRE_AT record defers every following record of its frame until the
+ * given host instant. Each node converts that instant to its own clock
+ * (SyncedClock), parks the records here and runs them from loop() when due,
+ * busy-waiting the last SCHED_SPIN_US so loop delays do not add jitter.
+ *
+ * Lateness (execution - target) is recorded per node as skew statistics.
+ * No platform calls: the caller passes the clock in. Not thread-safe:
+ * schedule() and run() belong to the same task (frames received in the
+ * WiFi task go through an SpscQueue first).
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include <string.h>
+#include "Protocol.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define SCHED_SLOTS       4
+#define SCHED_MAX_DATA    8       // Largest record payload that can be parked
+#define SCHED_SPIN_US     2000    // Busy-wait window before a due action
+#define SCHED_LEAD_US     20000   // Host: how far ahead actions are scheduled
+
+// =============================================================================
+// TYPES
+// =============================================================================
+// targetUs: local instant the action was scheduled for; ctx: given to run()
+typedef void (*ScheduledFn)(void* ctx, const FrameRecord* rec, uint32_t targetUs);
+
+typedef struct {
+  uint32_t count;
+  int32_t lastUs;       // Lateness of the most recent action
+  int32_t maxUs;
+  int32_t sumUs;        // For the mean (count actions)
+} SkewStats;
+
+// =============================================================================
+// ACTION SCHEDULER CLASS
+// =============================================================================
+class ActionScheduler {
+public:
+  ActionScheduler() {
+    memset(slots, 0, sizeof(slots));
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  // Park a record until the local instant atUs; false if it cannot be held
+  bool schedule(uint32_t atUs, const FrameRecord* rec) {
+    if (rec->len > SCHED_MAX_DATA) return false;
+    for (uint8_t i = 0; i < SCHED_SLOTS; i++) {
+      Slot* slot = &slots[i];
+      if (slot->used) continue;
+      slot->atUs = atUs;
+      slot->cmd = rec->cmd;
+      slot->len = rec->len;
+      memcpy(slot->data, rec->data, rec->len);
+      slot->used = true;    // Last: a filled slot is never seen half-written
+      return true;
+    }
+    return false;
+  }
+
+  // Any action due at or before nowUs + windowUs
+  bool dueWithin(uint32_t nowUs, uint32_t windowUs) const {
+    for (uint8_t i = 0; i < SCHED_SLOTS; i++) {
+      if (slots[i].used && (int32_t)(slots[i].atUs - nowUs) <= (int32_t)windowUs) return true;
+    }
+    return false;
+  }
+
+  // Target of the earliest parked action, due or not
+  bool nextDue(uint32_t* atUs) const {
+    bool found = false;
+    for (uint8_t i = 0; i < SCHED_SLOTS; i++) {
+      if (!slots[i].used) continue;
+      if (!found || (int32_t)(slots[i].atUs - *atUs) < 0) *atUs = slots[i].atUs;
+      found = true;
+    }
+    return found;
+  }
+
+  // Run due actions in target order; returns how many ran
+  uint8_t run(uint32_t nowUs, ScheduledFn fn, void* ctx = nullptr) {
+    uint8_t ran = 0;
+    Slot* next;
+    while ((next = earliestDue(nowUs)) != nullptr) {
+      Slot slot = *next;
+      next->used = false;
+
+      int32_t late = (int32_t)(nowUs - slot.atUs);
+      stats.count++;
+      stats.lastUs = late;
+      if (late > stats.maxUs) stats.maxUs = late;
+      stats.sumUs += late;
+
+      FrameRecord rec = { slot.cmd, slot.len, slot.data };
+      fn(ctx, &rec, slot.atUs);
+      ran++;
+    }
+    return ran;
+  }
+
+  void clear() {
+    for (uint8_t i = 0; i < SCHED_SLOTS; i++) {
+      slots[i].used = false;
+    }
+  }
+
+  const SkewStats& skew() const { return stats; }
+
+private:
+  struct Slot {
+    bool used;
+    uint32_t atUs;
+    uint8_t cmd;
+    uint8_t len;
+    uint8_t data[SCHED_MAX_DATA];
+  };
+
+  Slot* earliestDue(uint32_t nowUs) {
+    Slot* best = nullptr;
+    for (uint8_t i = 0; i < SCHED_SLOTS; i++) {
+      Slot* slot = &slots[i];
+      if (!slot->used || (int32_t)(nowUs - slot->atUs) < 0) continue;
+      if (!best || (int32_t)(slot->atUs - best->atUs) < 0) best = slot;
+    }
+    return best;
+  }
+
+  Slot slots[SCHED_SLOTS];
+  SkewStats stats;
+};
+
+// =============================================================================
+// RECORD BUILDERS
+// =============================================================================
+inline bool frameAddFireAt(GameFrame* f, uint32_t hostUs) {
+  uint8_t body[4];
+  putU32(body, hostUs);
+  return frameAdd(f, CMD_FIRE_AT, body, sizeof(body));
+}
+
+// Node → host: how late a scheduled command ran
+inline bool frameAddSkewReport(GameFrame* f, uint8_t cmd, int32_t lateUs) {
+  uint8_t body[5] = { cmd };
+  putU32(&body[1], (uint32_t)lateUs);
+  return frameAdd(f, CMD_SKEW_REPORT, body, sizeof(body));
+}
+
+#endif // SCHEDULER_H
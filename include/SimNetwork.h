@@ -0,0 +1,261 @@
+/*
+ * SimNetwork.h - Deterministic In-process Network and Node Clocks
+ * Native simulation builds only
+ *
+ * Every simulated node gets a SimTransport attached to one SimNetwork.
+ * Frames are delivered after a configurable latency (+ jitter) and dropped
+ * with a configurable probability, all driven by the shared VirtualClock
+ * and a seeded PRNG, so a run with the same seed is bit-for-bit repeatable.
+ *
+ * runUntil() advances the virtual clock to each pending delivery in order,
+ * so receive timestamps are exact rather than quantized to the tick.
+ *
+ * SimNodeClock gives a node its own offset and crystal drift on top of the
+ * virtual clock, so clock sync and GO scheduling see realistic clocks.
+ */
+
+#ifndef SIM_NETWORK_H
+#define SIM_NETWORK_H
+
+#include <stdint.h>
+#include <string.h>
+#include "Platform.h"
+#include "Transport.h"
+#include "Protocol.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define SIM_MAX_ENDPOINTS 20
+#define SIM_QUEUE_SIZE    256     // Frames in flight
+
+class SimTransport;
+
+typedef struct {
+  uint32_t sent;        // Transmissions
+  uint32_t delivered;   // Receptions (one per receiving node)
+  uint32_t lost;        // Receptions dropped by the loss model
+  uint32_t overflows;   // Dropped, queue full
+} SimNetStats;
+
+// =============================================================================
+// SIM NETWORK CLASS
+// =============================================================================
+class SimNetwork {
+public:
+  explicit SimNetwork(VirtualClock* clock) :
+    clock(clock),
+    endpointCount(0),
+    latencyUs(1000),
+    jitterUs(0),
+    lossPermille(0),
+    rng(1),
+    nextSeq(0),
+    pendingCount(0) {
+    memset(queue, 0, sizeof(queue));
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  // lossPermille: per reception, 0..1000
+  void configure(uint32_t latency, uint32_t jitter, uint16_t loss, uint32_t seed) {
+    latencyUs = latency;
+    jitterUs = jitter;
+    lossPermille = loss;
+    rng = seed ? seed : 1;
+  }
+
+  // Idempotent, so a simulated node can be restarted
+  bool attach(SimTransport* endpoint) {
+    for (uint8_t i = 0; i < endpointCount; i++) {
+      if (endpoints[i] == endpoint) return true;
+    }
+    if (endpointCount >= SIM_MAX_ENDPOINTS) return false;
+    endpoints[endpointCount++] = endpoint;
+    return true;
+  }
+
+  // Queue one copy per addressed node (defined after SimTransport)
+  inline bool transmit(const SimTransport* src, const uint8_t* destMac, const uint8_t* data, uint8_t len);
+
+  // Deliver everything due up to targetUs in time order, moving the clock
+  // to each delivery instant, then to targetUs
+  inline void runUntil(uint64_t targetUs);
+
+  uint32_t random() {
+    // xorshift32
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+  }
+
+  uint16_t inFlight() const { return pendingCount; }
+
+  const SimNetStats& getStats() const { return stats; }
+
+private:
+  struct Pending {
+    bool used;
+    uint64_t atUs;
+    uint32_t seq;         // Keeps same-instant deliveries in send order
+    SimTransport* dest;
+    uint8_t srcMac[6];
+    uint8_t len;
+    uint8_t data[FRAME_MAX_SIZE];
+  };
+
+  Pending* earliest() {
+    Pending* best = nullptr;
+    for (uint16_t i = 0; i < SIM_QUEUE_SIZE; i++) {
+      Pending* p = &queue[i];
+      if (!p->used) continue;
+      if (!best || p->atUs < best->atUs || (p->atUs == best->atUs && p->seq < best->seq)) best = p;
+    }
+    return best;
+  }
+
+  VirtualClock* clock;
+  SimTransport* endpoints[SIM_MAX_ENDPOINTS];
+  uint8_t endpointCount;
+  uint32_t latencyUs;
+  uint32_t jitterUs;
+  uint16_t lossPermille;
+  uint32_t rng;
+  uint32_t nextSeq;
+  uint16_t pendingCount;
+  Pending queue[SIM_QUEUE_SIZE];
+  SimNetStats stats;
+};
+
+// =============================================================================
+// SIM TRANSPORT CLASS
+// =============================================================================
+class SimTransport : public Transport {
+public:
+  SimTransport(SimNetwork* net, const uint8_t* mac) : net(net), handler(nullptr) {
+    memcpy(myMac, mac, 6);
+  }
+
+  bool begin(TransportHandler* h) override {
+    handler = h;
+    return net->attach(this);
+  }
+
+  bool addPeer(const uint8_t* mac) override {
+    return true;
+  }
+
+  bool removePeer(const uint8_t* mac) override {
+    return true;
+  }
+
+  // Unicast reports failure when the frame was lost (like a missing MAC
+  // ACK on ESP-NOW); broadcast always reports success
+  bool send(const uint8_t* mac, const uint8_t* data, uint8_t len) override {
+    bool ok = net->transmit(this, mac, data, len);
+    if (handler) handler->onTransportSent(mac, ok || isBroadcastMac(mac));
+    return true;
+  }
+
+  void macAddress(uint8_t* mac) override {
+    memcpy(mac, myMac, 6);
+  }
+
+  const uint8_t* mac() const { return myMac; }
+
+  void deliver(const uint8_t* srcMac, const uint8_t* data, uint8_t len) {
+    if (handler) handler->onTransportReceive(srcMac, data, len);
+  }
+
+private:
+  SimNetwork* net;
+  uint8_t myMac[6];
+  TransportHandler* handler;
+};
+
+// Returns false if no addressed node will receive it
+inline bool SimNetwork::transmit(const SimTransport* src, const uint8_t* destMac, const uint8_t* data, uint8_t len) {
+  stats.sent++;
+  bool any = false;
+  bool bcast = isBroadcastMac(destMac);
+  for (uint8_t i = 0; i < endpointCount; i++) {
+    SimTransport* dest = endpoints[i];
+    if (dest == src) continue;
+    if (!bcast && memcmp(dest->mac(), destMac, 6) != 0) continue;
+
+    if (lossPermille && random() % 1000 < lossPermille) {
+      stats.lost++;
+      continue;
+    }
+
+    Pending* slot = nullptr;
+    for (uint16_t j = 0; j < SIM_QUEUE_SIZE; j++) {
+      if (!queue[j].used) {
+        slot = &queue[j];
+        break;
+      }
+    }
+    if (!slot) {
+      stats.overflows++;
+      continue;
+    }
+
+    slot->used = true;
+    pendingCount++;
+    slot->atUs = clock->nowUs64() + latencyUs + (jitterUs ? random() % (jitterUs + 1) : 0);
+    slot->seq = nextSeq++;
+    slot->dest = dest;
+    memcpy(slot->srcMac, src->mac(), 6);
+    slot->len = len;
+    memcpy(slot->data, data, len);
+    any = true;
+  }
+  return any;
+}
+
+inline void SimNetwork::runUntil(uint64_t targetUs) {
+  Pending* p;
+  while (pendingCount && (p = earliest()) != nullptr && p->atUs <= targetUs) {
+    clock->setUs(p->atUs);
+    Pending copy = *p;
+    p->used = false;
+    pendingCount--;
+    stats.delivered++;
+    copy.dest->deliver(copy.srcMac, copy.data, copy.len);
+  }
+  clock->setUs(targetUs);
+}
+
+// =============================================================================
+// SIM NODE CLOCK
+// =============================================================================
+// local = base + offset + drift * elapsed
+class SimNodeClock : public Clock {
+public:
+  SimNodeClock(VirtualClock* base, int32_t offsetUs, int32_t driftPpm) :
+    base(base), offsetUs(offsetUs), driftPpm(driftPpm), originUs(base->nowUs64()) {}
+
+  uint32_t micros() override { return (uint32_t)localUs(base->nowUs64()); }
+  uint32_t millis() override { return (uint32_t)(localUs(base->nowUs64()) / 1000); }
+
+  // Jump the shared clock to the base instant where local time reaches us
+  void waitUntil(uint32_t us) override {
+    int32_t ahead = (int32_t)(us - micros());
+    if (ahead <= 0) return;
+    uint64_t target = base->nowUs64() + (uint64_t)((int64_t)ahead * 1000000 / (1000000 + driftPpm)) + 1;
+    base->setUs(target);
+  }
+
+private:
+  uint64_t localUs(uint64_t baseUs) const {
+    int64_t elapsed = (int64_t)(baseUs - originUs);
+    return (uint64_t)((int64_t)baseUs + offsetUs + elapsed * driftPpm / 1000000);
+  }
+
+  VirtualClock* base;
+  int32_t offsetUs;
+  int32_t driftPpm;
+  uint64_t originUs;
+};
+
+#endif // SIM_NETWORK_H
@@ -0,0 +1,125 @@
+/*
+ * SoundBank.h - All Clips in One SPIFFS File
+ * Host only
+ *
+ * scripts/copy_data.py packs the clips listed in data_host/sounds.txt into
+ * SOUND_BANK_FILE and generates AudioDefs.h: a SND_ number per sound and
+ * its offset and length in the bank. Playing a sound is a seek in a file
+ * that is already open, instead of SPIFFS.exists() and open() by path,
+ * which scan the file system.
+ *
+ * SoundBank::begin() checks the bank's size and CRC against the ones the
+ * firmware was built with: after a firmware upload without the matching
+ * filesystem upload, sounds would play the wrong clips.
+ *
+ * BankFileSource: one clip of the bank as an ESP8266Audio file source.
+ * Keeps its own handle on the bank open; open(sound) only seeks.
+ */
+
+#ifndef SOUND_BANK_H
+#define SOUND_BANK_H
+
+#include <Arduino.h>
+#include "SPIFFS.h"
+#include "AudioFileSource.h"
+#include "AudioDefs.h"
+#include "Log.h"
+
+// =============================================================================
+// SOUND BANK CLASS
+// =============================================================================
+class SoundBank {
+public:
+  SoundBank() : ok(false) {}
+
+  // After SPIFFS.begin(); false if the bank is missing or from another build
+  bool begin() {
+    File f = SPIFFS.open(SOUND_BANK_FILE, "r");
+    if (!f) {
+      LOG(AUDIO_NOT_FOUND, SOUND_BANK_FILE);
+      return false;
+    }
+    uint8_t head[8] = {};
+    f.read(head, sizeof(head));
+    uint32_t size = f.size();
+    f.close();
+
+    uint32_t crc = (uint32_t)head[4] | ((uint32_t)head[5] << 8) |
+                   ((uint32_t)head[6] << 16) | ((uint32_t)head[7] << 24);
+    ok = memcmp(head, "SNDB", 4) == 0 && size == SOUND_BANK_SIZE && crc == SOUND_BANK_CRC;
+    if (!ok) LOG(AUDIO_BANK_MISMATCH, size, crc, SOUND_BANK_SIZE, SOUND_BANK_CRC);
+    return ok;
+  }
+
+  bool valid() const { return ok; }
+
+  // nullptr for an unknown sound or an unusable bank
+  const SoundEntry* entry(uint8_t sound) const {
+    return (ok && sound < NUM_SOUNDS) ? &SOUND_BANK[sound] : nullptr;
+  }
+
+  static const char* name(uint8_t sound) {
+    return sound < NUM_SOUNDS ? SOUND_BANK[sound].name : "?";
+  }
+
+private:
+  bool ok;
+};
+
+// =============================================================================
+// BANK FILE SOURCE
+// =============================================================================
+class BankFileSource : public AudioFileSource {
+public:
+  BankFileSource() : start(0), length(0), pos(0), clip(false) {}
+
+  // Once, after SPIFFS.begin()
+  bool begin() {
+    file = SPIFFS.open(SOUND_BANK_FILE, "r");
+    return (bool)file;
+  }
+
+  bool open(const SoundEntry* e) {
+    start = e->offset;
+    length = e->length;
+    pos = 0;
+    clip = file && file.seek(start);
+    return clip;
+  }
+
+  uint32_t read(void* data, uint32_t len) override {
+    if (!clip) return 0;
+    if (len > length - pos) len = length - pos;
+    uint32_t n = file.read((uint8_t*)data, len);
+    pos += n;
+    return n;
+  }
+
+  bool seek(int32_t offset, int dir) override {
+    int32_t to = offset;
+    if (dir == SEEK_CUR) to += pos;
+    else if (dir == SEEK_END) to += length;
+    if (!clip || to < 0 || (uint32_t)to > length) return false;
+    pos = to;
+    return file.seek(start + pos);
+  }
+
+  // The bank stays open for the next clip
+  bool close() override {
+    clip = false;
+    return true;
+  }
+
+  bool isOpen() override { return clip; }
+  uint32_t getSize() override { return length; }
+  uint32_t getPos() override { return pos; }
+
+private:
+  File file;
+  uint32_t start;
+  uint32_t length;
+  uint32_t pos;
+  bool clip;              // open() succeeded, not closed since
+};
+
+#endif // SOUND_BANK_H
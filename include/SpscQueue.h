@@ -0,0 +1,100 @@
+/*
+ * SpscQueue.h - Lock-free Single-Producer/Single-Consumer Ring Buffer
+ * Host and Display
+ *
+ * Fixed capacity, no allocation. The producer (ESP-NOW receive callback in
+ * the WiFi task) claims a slot, fills it in place and publishes it; the
+ * consumer (game loop) peeks, processes and pops. Each side only writes its
+ * own index, so acquire/release ordering is all the synchronization needed.
+ * A full queue drops the new item and counts it. env:native_queue stresses
+ * it from two threads.
+ */
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stdint.h>
+#include <atomic>
+#include "Protocol.h"
+
+// =============================================================================
+// SPSC QUEUE CLASS
+// =============================================================================
+template <typename T, uint16_t N>
+class SpscQueue {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+  SpscQueue() : head(0), tail(0), overflows(0), peak(0) {}
+
+  // Producer: slot to fill, or nullptr (counted) when full
+  T* claim() {
+    uint16_t h = head.load(std::memory_order_relaxed);
+    uint16_t t = tail.load(std::memory_order_acquire);
+    if ((uint16_t)(h - t) >= N) {
+      overflows.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    return &items[h & (N - 1)];
+  }
+
+  // Producer: make the claimed slot visible to the consumer
+  void publish() {
+    uint16_t h = (uint16_t)(head.load(std::memory_order_relaxed) + 1);
+    head.store(h, std::memory_order_release);
+    uint16_t depth = (uint16_t)(h - tail.load(std::memory_order_relaxed));
+    if (depth > peak.load(std::memory_order_relaxed)) {
+      peak.store(depth, std::memory_order_relaxed);
+    }
+  }
+
+  bool push(const T& item) {
+    T* slot = claim();
+    if (!slot) return false;
+    *slot = item;
+    publish();
+    return true;
+  }
+
+  // Consumer: oldest item, or nullptr when empty
+  T* peek() {
+    uint16_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) return nullptr;
+    return &items[t & (N - 1)];
+  }
+
+  // Consumer: release the item returned by peek()
+  void pop() {
+    tail.store((uint16_t)(tail.load(std::memory_order_relaxed) + 1), std::memory_order_release);
+  }
+
+  uint16_t size() const {
+    return (uint16_t)(head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire));
+  }
+
+  uint16_t capacity() const { return N; }
+  uint32_t overflowCount() const { return overflows.load(std::memory_order_relaxed); }
+  uint16_t peakDepth() const { return peak.load(std::memory_order_relaxed); }
+
+private:
+  T items[N];
+  std::atomic<uint16_t> head;     // Written by the producer only
+  std::atomic<uint16_t> tail;     // Written by the consumer only
+  std::atomic<uint32_t> overflows;
+  std::atomic<uint16_t> peak;
+};
+
+// =============================================================================
+// INBOUND PACKETS
+// =============================================================================
+#define RX_QUEUE_SIZE     32      // 16 sticks ACKing one broadcast + sync replies
+
+typedef struct {
+  uint32_t rxUs;        // micros() at the receive callback
+  uint8_t mac[6];
+  int8_t rssi;          // dBm, 0 if not measured
+  uint8_t len;
+  uint8_t data[FRAME_MAX_SIZE];
+} InboundPacket;
+
+#endif // SPSC_QUEUE_H
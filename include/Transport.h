@@ -0,0 +1,66 @@
+/*
+ * Transport.h - Datagram Transport Interface
+ * Shared between Host, Display, Joysticks and the native builds
+ *
+ * Game logic sends and receives raw frames (<= FRAME_MAX_SIZE bytes)
+ * addressed by 6-byte MAC through this interface instead of calling
+ * esp_now_* directly. Backends:
+ * - EspNowTransport.h: ESP-NOW on ESP32 / ESP8266
+ * - UdpTransport.h:    UDP multicast on Linux (native builds)
+ *
+ * Receive and send-status callbacks may run in another task (ESP32 WiFi
+ * task); handlers must only copy or enqueue there.
+ */
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stdint.h>
+#include <string.h>
+
+static const uint8_t BROADCAST_MAC[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+inline bool isBroadcastMac(const uint8_t* mac) {
+  return memcmp(mac, BROADCAST_MAC, 6) == 0;
+}
+
+// =============================================================================
+// RECEIVER INTERFACE
+// =============================================================================
+class TransportHandler {
+public:
+  virtual ~TransportHandler() {}
+  virtual void onTransportReceive(const uint8_t* mac, const uint8_t* data, uint8_t len) = 0;
+  virtual void onTransportSent(const uint8_t* mac, bool ok) {}
+};
+
+// =============================================================================
+// TRANSPORT INTERFACE
+// =============================================================================
+class Transport {
+public:
+  virtual ~Transport() {}
+
+  // Start the radio/socket and route callbacks to handler
+  virtual bool begin(TransportHandler* handler) = 0;
+
+  // Peers must be added before unicast sends (broadcast always works)
+  virtual bool addPeer(const uint8_t* mac) = 0;
+
+  // Forget a peer (e.g. a node ID paired again from another MAC); true if
+  // it is gone or was never added
+  virtual bool removePeer(const uint8_t* mac) = 0;
+
+  virtual bool send(const uint8_t* mac, const uint8_t* data, uint8_t len) = 0;
+
+  // Deliver pending callbacks (polled backends; no-op for ESP-NOW)
+  virtual void poll() {}
+
+  virtual void macAddress(uint8_t* mac) = 0;
+
+  // Signal strength (dBm) of the frame being delivered to
+  // onTransportReceive(), 0 if the backend cannot measure it
+  virtual int8_t lastRssi() { return 0; }
+};
+
+#endif // TRANSPORT_H
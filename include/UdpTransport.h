@@ -0,0 +1,197 @@
+/*
+ * UdpTransport.h - UDP Multicast Backend for Transport
+ * Native (Linux) builds only
+ *
+ * Every process joins one multicast group and port, which stands in for the
+ * ESP-NOW channel. Each datagram is prefixed with the sender and destination
+ * MAC; receivers drop their own datagrams and anything addressed to another
+ * MAC, so unicast and broadcast behave as on the radio.
+ *
+ * Datagram: [SRC MAC 6][DEST MAC 6][frame...]
+ *
+ * Environment overrides:
+ * - REACTION_UDP_PORT: port (default UDP_PORT), one per simulated "channel"
+ * - REACTION_UDP_IF:   interface address (default 127.0.0.1, same machine)
+ */
+
+#ifndef UDP_TRANSPORT_H
+#define UDP_TRANSPORT_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include "Transport.h"
+#include "Protocol.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define UDP_GROUP         "239.255.42.6"
+#define UDP_PORT          42006
+#define UDP_HEADER_SIZE   12
+
+// Locally administered MAC for a simulated node (02:00:00:00:00:<id>)
+inline void udpNodeMac(uint8_t id, uint8_t* mac) {
+  static const uint8_t base[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x00};
+  memcpy(mac, base, 6);
+  mac[5] = id;
+}
+
+typedef struct {
+  uint32_t txFrames;
+  uint32_t txBytes;
+  uint32_t txErrors;
+  uint32_t rxFrames;    // Delivered to the handler
+  uint32_t rxBytes;
+  uint32_t rxIgnored;   // Own echoes and frames for other MACs
+} UdpStats;
+
+// =============================================================================
+// UDP TRANSPORT CLASS
+// =============================================================================
+class UdpTransport : public Transport {
+public:
+  explicit UdpTransport(const uint8_t* mac) : sock(-1), handler(nullptr) {
+    memcpy(myMac, mac, 6);
+    memset(&group, 0, sizeof(group));
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  ~UdpTransport() override {
+    if (sock >= 0) close(sock);
+  }
+
+  bool begin(TransportHandler* h) override {
+    handler = h;
+
+    const char* portEnv = getenv("REACTION_UDP_PORT");
+    const char* ifEnv = getenv("REACTION_UDP_IF");
+    uint16_t port = portEnv ? (uint16_t)atoi(portEnv) : UDP_PORT;
+    struct in_addr ifAddr;
+    ifAddr.s_addr = inet_addr(ifEnv ? ifEnv : "127.0.0.1");
+
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) return false;
+
+    int one = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+#ifdef SO_REUSEPORT
+    setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+#endif
+
+    struct sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_port = htons(port);
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(sock, (struct sockaddr*)&local, sizeof(local)) < 0) return fail();
+
+    struct ip_mreq mreq;
+    mreq.imr_multiaddr.s_addr = inet_addr(UDP_GROUP);
+    mreq.imr_interface = ifAddr;
+    if (setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) return fail();
+    if (setsockopt(sock, IPPROTO_IP, IP_MULTICAST_IF, &ifAddr, sizeof(ifAddr)) < 0) return fail();
+
+    unsigned char loop = 1;
+    unsigned char ttl = 1;
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+
+    group.sin_family = AF_INET;
+    group.sin_port = htons(port);
+    group.sin_addr.s_addr = inet_addr(UDP_GROUP);
+    return true;
+  }
+
+  // Every node shares the group; nothing to register
+  bool addPeer(const uint8_t* mac) override {
+    return true;
+  }
+
+  bool removePeer(const uint8_t* mac) override {
+    return true;
+  }
+
+  bool send(const uint8_t* mac, const uint8_t* data, uint8_t len) override {
+    if (sock < 0 || len > FRAME_MAX_SIZE) return false;
+
+    uint8_t buf[UDP_HEADER_SIZE + FRAME_MAX_SIZE];
+    memcpy(&buf[0], myMac, 6);
+    memcpy(&buf[6], mac, 6);
+    memcpy(&buf[UDP_HEADER_SIZE], data, len);
+
+    bool ok = sendto(sock, buf, UDP_HEADER_SIZE + len, 0,
+                     (struct sockaddr*)&group, sizeof(group)) == UDP_HEADER_SIZE + len;
+    if (ok) {
+      stats.txFrames++;
+      stats.txBytes += len;
+    } else {
+      stats.txErrors++;
+    }
+
+    // No MAC-layer ACK on UDP: report the local send result
+    if (handler) handler->onTransportSent(mac, ok);
+    return ok;
+  }
+
+  // Deliver everything queued on the socket
+  void poll() override {
+    if (sock < 0) return;
+
+    uint8_t buf[UDP_HEADER_SIZE + FRAME_MAX_SIZE + 1];
+    ssize_t n;
+    while ((n = recv(sock, buf, sizeof(buf), 0)) >= 0) {
+      if (n <= UDP_HEADER_SIZE || n > UDP_HEADER_SIZE + FRAME_MAX_SIZE) continue;
+      const uint8_t* src = &buf[0];
+      const uint8_t* dest = &buf[6];
+      if (memcmp(src, myMac, 6) == 0 ||
+          (memcmp(dest, myMac, 6) != 0 && !isBroadcastMac(dest))) {
+        stats.rxIgnored++;
+        continue;
+      }
+
+      uint8_t len = (uint8_t)(n - UDP_HEADER_SIZE);
+      stats.rxFrames++;
+      stats.rxBytes += len;
+      if (handler) handler->onTransportReceive(src, &buf[UDP_HEADER_SIZE], len);
+    }
+  }
+
+  void macAddress(uint8_t* mac) override {
+    memcpy(mac, myMac, 6);
+  }
+
+  // Sleep until a datagram arrives or timeoutMs passes, so receive
+  // timestamps are not quantized by the loop period
+  bool wait(int timeoutMs) {
+    struct pollfd pfd = { sock, POLLIN, 0 };
+    return ::poll(&pfd, 1, timeoutMs) > 0;
+  }
+
+  int fd() const { return sock; }
+
+  const UdpStats& getStats() const { return stats; }
+
+private:
+  bool fail() {
+    close(sock);
+    sock = -1;
+    return false;
+  }
+
+  int sock;
+  uint8_t myMac[6];
+  struct sockaddr_in group;
+  TransportHandler* handler;
+  UdpStats stats;
+};
+
+#endif // UDP_TRANSPORT_H
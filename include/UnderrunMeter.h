@@ -0,0 +1,98 @@
+/*
+ * UnderrunMeter.h - DMA Underrun Reckoning for a Free-running Output
+ * Host firmware and native builds
+ *
+ * The I2S DMA cannot say when it ran dry: it repeats zeros and goes on.
+ * What it can be compared with is time. While a stream runs, the frames
+ * written are compared with the frames the DMA has played since the
+ * stream started (elapsed time × rate). Having played more means the DMA
+ * ran dry and sent zeros: one underrun, the shortfall counted as starved
+ * frames (whole DMA buffers, which is what the driver repeats).
+ *
+ * The comparison needs the time, so it runs only when due: on the first
+ * write after poll() (once per refill pass) or after the DMA was full,
+ * not per frame. The output asks due() before reading its clock and hands
+ * the time to accepted(). Times are micros(): the reckoning survives its
+ * wrap.
+ */
+
+#ifndef UNDERRUN_METER_H
+#define UNDERRUN_METER_H
+
+#include <stdint.h>
+#include <string.h>
+#include "AudioEngine.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#ifndef AUDIO_DMA_BUFFERS
+#define AUDIO_DMA_BUFFERS 8
+#endif
+#define AUDIO_DMA_FRAMES  AUDIO_BLOCK_FRAMES  // Stereo frames per DMA buffer
+
+typedef struct {
+  uint32_t frames;        // Accepted by the DMA
+  uint32_t underruns;     // DMA ran dry in the middle of a stream
+  uint32_t starved;       // Frames of silence those underruns inserted
+} AudioOutStats;
+
+// =============================================================================
+// UNDERRUN METER CLASS
+// =============================================================================
+class UnderrunMeter {
+public:
+  UnderrunMeter() : streaming(false), check(false), streamUs(0), streamFrames(0) {
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  // The next accepted() compares with the DMA's position: read the clock
+  bool due() const { return check || !streaming; }
+
+  // n frames taken by the DMA; nowUs is only read when due()
+  void accepted(uint32_t n, uint32_t nowUs) {
+    if (due()) {
+      if (!streaming) {
+        streaming = true;
+        streamUs = nowUs;
+        streamFrames = 0;
+      } else {
+        underrunCheck(nowUs);
+      }
+      check = false;
+    }
+    stats.frames += n;
+    streamFrames += n;
+  }
+
+  // Once per refill pass, and when the DMA was full
+  void poll() { check = true; }
+
+  // The queue ran out or was flushed; silence from here on is not an
+  // underrun
+  void endStream() { streaming = false; }
+
+  const AudioOutStats& getStats() const { return stats; }
+
+private:
+  // Played a DMA buffer more than written: the DMA ran dry. The margin
+  // covers the stream's first write, which waits for the buffer being
+  // sent, and clock drift. Restart the reckoning from this write.
+  void underrunCheck(uint32_t nowUs) {
+    uint32_t played = (uint32_t)((uint64_t)(nowUs - streamUs) * AUDIO_RATE / 1000000);
+    if (played < streamFrames + AUDIO_DMA_FRAMES) return;
+    uint32_t missing = played - streamFrames;
+    stats.underruns++;
+    stats.starved += (missing + AUDIO_DMA_FRAMES - 1) / AUDIO_DMA_FRAMES * AUDIO_DMA_FRAMES;
+    streamUs = nowUs;
+    streamFrames = 0;
+  }
+
+  bool streaming;         // Frames are being written
+  bool check;             // Next write: compare with the DMA's position
+  uint32_t streamUs;      // Reckoning origin: first write of the stream
+  uint32_t streamFrames;  // Written since streamUs
+  AudioOutStats stats;
+};
+
+#endif // UNDERRUN_METER_H
@@ -1,15 +1,51 @@
 """
 PlatformIO pre-script to copy environment-specific data files
+
+host_test: instead of copying the clips one by one, packs the ones listed
+in data_host/sounds.txt into a single bank file (data/sounds.bin) and
+regenerates include/AudioDefs.h with a SND_<ID> number, offset and length
+per clip. The firmware then opens one file and seeks to a clip, with no
+path lookup per play. The build stops if the manifest and the folder
+disagree or a clip is not an MP3.
+
+Bank layout: "SNDB", CRC32 of the rest (little endian), then the clips
+back to back without their ID3 tags. AudioDefs.h carries the same CRC, so
+a SPIFFS image from another build is detected at boot (SoundBank.h).
+
+Clip formats: mp3 (as is), pcm (16-bit) or adpcm (IMA-ADPCM, 4 bits per
+sample, ImaAdpcm.h). pcm and adpcm are transcoded here, once: decoded
+with ffmpeg (which drops the LAME encoder delay and padding), mixed down
+to mono and resampled to BANK_RATE, so the host plays them with a file
+read and at most a table lookup per sample instead of an MP3 decode. The
+default format is the env's custom_sound_format option (platformio.ini),
+else mp3; a third column in the manifest sets it per clip.
+
+Standalone (no PlatformIO): python scripts/copy_data.py host_test [--format adpcm]
 """
-Import("env")
+import array
 import shutil
 import os
+import re
+import subprocess
+import sys
+import zlib
 
-# Get the project directory
-project_dir = env.get("PROJECT_DIR")
-
-# Get the current environment name
-env_name = env.get("PIOENV")
+try:
+    Import("env")
+    # Get the project directory
+    project_dir = env.get("PROJECT_DIR")
+    # Get the current environment name
+    env_name = env.get("PIOENV")
+    sound_format = env.GetProjectOption("custom_sound_format", "mp3")
+except NameError:
+    project_dir = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    args = sys.argv[1:]
+    sound_format = "mp3"
+    if "--format" in args:
+        i = args.index("--format")
+        sound_format = args[i + 1] if i + 1 < len(args) else ""
+        del args[i:i + 2]
+    env_name = args[0] if args else "host_test"
 
 # Define source data directories
 data_sources = {
@@ -17,9 +53,260 @@ data_sources = {
     "host_test": "data_host"
 }
 
+# Environments whose data folder is packed into a sound bank
+sound_banks = {
+    "host_test": "sounds.txt"
+}
+
+BANK_FILE = "sounds.bin"
+BANK_MAGIC = b"SNDB"
+BANK_RATE = 22050                   # AUDIO_RATE (AudioEngine.h)
+FORMATS = ("mp3", "pcm", "adpcm")   # SND_FMT_ values, in order
+DEFS_FILE = os.path.join(project_dir, "include", "AudioDefs.h")
+
 # Target data directory
 data_dir = os.path.join(project_dir, "data")
 
+
+def fail(msg):
+    sys.exit(f"copy_data.py: {msg}")
+
+
+def id3_size(data):
+    """Bytes of the ID3v2 tag at the start (0 if none)"""
+    if data[:3] != b"ID3" or len(data) < 10:
+        return 0
+    size = (data[6] & 0x7F) << 21 | (data[7] & 0x7F) << 14 | (data[8] & 0x7F) << 7 | (data[9] & 0x7F)
+    return 10 + size + (10 if data[5] & 0x10 else 0)
+
+
+def mp3_format(data):
+    """(rate, channels) of the first frame, None if not MPEG layer III"""
+    if len(data) < 4 or data[0] != 0xFF or (data[1] & 0xE0) != 0xE0:
+        return None
+    version = (data[1] >> 3) & 3
+    layer = (data[1] >> 1) & 3
+    rate_idx = (data[2] >> 2) & 3
+    if version == 1 or layer != 1 or rate_idx == 3:
+        return None
+    rate = (44100, 48000, 32000)[rate_idx] >> {3: 0, 2: 1, 0: 2}[version]
+    return rate, 1 if (data[3] >> 6) == 3 else 2
+
+
+def read_manifest(path, default_format):
+    """[(ID, file, format)] in manifest order"""
+    entries = []
+    with open(path) as f:
+        for n, line in enumerate(f, 1):
+            line = line.split("#", 1)[0].strip()
+            if not line:
+                continue
+            parts = line.split()
+            if len(parts) not in (2, 3) or not re.fullmatch(r"[A-Z][A-Z0-9_]*", parts[0]):
+                fail(f"{path}:{n}: expected 'ID file.mp3 [format]', got '{line}'")
+            fmt = parts[2] if len(parts) == 3 else default_format
+            if fmt not in FORMATS:
+                fail(f"{path}:{n}: format '{fmt}' is not one of {', '.join(FORMATS)}")
+            entries.append((parts[0], parts[1], fmt))
+    return entries
+
+
+def decode_mp3(path):
+    """Mono 16-bit samples at BANK_RATE, encoder delay and padding dropped"""
+    ffmpeg = shutil.which("ffmpeg")
+    if not ffmpeg:
+        fail(f"ffmpeg not found: needed to transcode {os.path.basename(path)} (or use format mp3)")
+    r = subprocess.run([ffmpeg, "-v", "error", "-i", path, "-f", "s16le", "-acodec", "pcm_s16le",
+                        "-ac", "1", "-ar", str(BANK_RATE), "-"], capture_output=True)
+    if r.returncode != 0:
+        fail(f"ffmpeg failed on {os.path.basename(path)}: {r.stderr.decode(errors='replace').strip()}")
+    samples = array.array("h")
+    samples.frombytes(r.stdout[:len(r.stdout) // 2 * 2])
+    if sys.byteorder == "big":
+        samples.byteswap()
+    return samples
+
+
+# IMA-ADPCM, the encoder of ImaAdpcm.h
+ADPCM_BLOCK_BYTES = 256
+ADPCM_BLOCK_FRAMES = 1 + (ADPCM_BLOCK_BYTES - 4) * 2
+ADPCM_STEPS = (
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767)
+ADPCM_INDEX = (-1, -1, -1, -1, 2, 4, 6, 8)
+
+
+def encode_adpcm(samples):
+    """Blocks of ADPCM_BLOCK_BYTES (the last one shorter), WAV layout"""
+    out = bytearray()
+    index = 0
+    for start in range(0, len(samples), ADPCM_BLOCK_FRAMES):
+        block = samples[start:start + ADPCM_BLOCK_FRAMES]
+        predictor = block[0]
+        out += (predictor & 0xFFFF).to_bytes(2, "little") + bytes((index, 0))
+        nibbles = []
+        for s in block[1:]:
+            step = ADPCM_STEPS[index]
+            diff = s - predictor
+            nibble = 0
+            if diff < 0:
+                nibble = 8
+                diff = -diff
+            if diff >= step:
+                nibble |= 4
+                diff -= step
+            if diff >= step >> 1:
+                nibble |= 2
+                diff -= step >> 1
+            if diff >= step >> 2:
+                nibble |= 1
+            # Same reconstruction as the decoder
+            delta = step >> 3
+            if nibble & 4:
+                delta += step
+            if nibble & 2:
+                delta += step >> 1
+            if nibble & 1:
+                delta += step >> 2
+            predictor = max(-32768, min(32767, predictor - delta if nibble & 8 else predictor + delta))
+            index = max(0, min(88, index + ADPCM_INDEX[nibble & 7]))
+            nibbles.append(nibble)
+        if len(nibbles) & 1:
+            nibbles.append(0)
+        out += bytes(nibbles[i] | nibbles[i + 1] << 4 for i in range(0, len(nibbles), 2))
+    return bytes(out)
+
+
+def pack_bank(source_dir, manifest, default_format):
+    if default_format not in FORMATS:
+        fail(f"custom_sound_format '{default_format}' is not one of {', '.join(FORMATS)}")
+    entries = read_manifest(os.path.join(source_dir, manifest), default_format)
+    ids = [e[0] for e in entries]
+    files = [e[1] for e in entries]
+    for name in set(ids):
+        if ids.count(name) > 1:
+            fail(f"{manifest}: sound ID {name} listed twice")
+    for name in set(files):
+        if files.count(name) > 1:
+            fail(f"{manifest}: {name} listed twice")
+    clips = {f for f in os.listdir(source_dir) if f.lower().endswith(".mp3")}
+    unlisted = sorted(clips - set(files))
+    if unlisted:
+        fail(f"{manifest}: not listed: {', '.join(unlisted)}")
+
+    body = bytearray()
+    index = []
+    for sound_id, name, clip_format in entries:
+        path = os.path.join(source_dir, name)
+        if not os.path.isfile(path):
+            fail(f"{manifest}: {name} ({sound_id}) not found")
+        with open(path, "rb") as f:
+            data = f.read()
+        start = id3_size(data)
+        end = len(data) - (128 if data[-128:-125] == b"TAG" else 0)
+        fmt = mp3_format(data[start:start + 4])
+        if start >= end or fmt is None:
+            fail(f"{name} ({sound_id}) is not an MP3 (layer III)")
+        frames = 0
+        if clip_format == "mp3":
+            clip = data[start:end]
+        else:
+            samples = decode_mp3(path)
+            if not samples:
+                fail(f"{name} ({sound_id}) decodes to nothing")
+            frames = len(samples)
+            clip = encode_adpcm(samples) if clip_format == "adpcm" else samples.tobytes()
+            if clip_format == "pcm" and sys.byteorder == "big":
+                swapped = array.array("h", samples)
+                swapped.byteswap()
+                clip = swapped.tobytes()
+        offset = len(BANK_MAGIC) + 4 + len(body)
+        body += clip
+        index.append((sound_id, name, offset, len(clip), fmt, clip_format, frames))
+
+    crc = zlib.crc32(bytes(body)) & 0xFFFFFFFF
+    with open(os.path.join(data_dir, BANK_FILE), "wb") as f:
+        f.write(BANK_MAGIC + crc.to_bytes(4, "little") + body)
+    size = len(BANK_MAGIC) + 4 + len(body)
+    write_defs(index, size, crc)
+    formats = ", ".join(f"{sum(1 for e in index if e[5] == f)} {f}" for f in FORMATS
+                        if any(e[5] == f for e in index))
+    print(f"  Packed {len(index)} clips ({formats}) -> {BANK_FILE} ({size} bytes, crc {crc:08x})")
+
+
+def write_defs(index, size, crc):
+    lines = [
+        "/*",
+        " * AudioDefs.h - Sound IDs and Sound Bank Index",
+        " * Host only",
+        " *",
+        " * GENERATED by scripts/copy_data.py from data_host/sounds.txt on every",
+        " * host_test build: edit the manifest, not this file.",
+        " *",
+        " * All clips are packed into SOUND_BANK_FILE on SPIFFS; a sound is played",
+        " * by seeking to its offset (SoundBank.h), not by looking up a path.",
+        " */",
+        "",
+        "#ifndef AUDIODEFS_H",
+        "#define AUDIODEFS_H",
+        "",
+        "#include <stdint.h>",
+        "",
+        "// =============================================================================",
+        "// SOUND IDS",
+        "// =============================================================================",
+    ]
+    width = max(len(e[0]) for e in index) + 5
+    for n, e in enumerate(index):
+        lines.append(f"#define {'SND_' + e[0]:<{width}}{n}")
+    lines += [
+        "",
+        f"#define {'NUM_SOUNDS':<{width}}{len(index)}",
+        "",
+        "// =============================================================================",
+        "// SOUND BANK",
+        "// =============================================================================",
+        '#define SOUND_BANK_FILE   "/' + BANK_FILE + '"',
+        f"#define SOUND_BANK_SIZE   {size}",
+        f"#define SOUND_BANK_CRC    0x{crc:08X}",
+        f"#define SOUND_BANK_RATE   {BANK_RATE}     // pcm and adpcm clips: mono at this rate",
+        "",
+    ]
+    lines += [f"#define SND_FMT_{f.upper():<10}{n}" for n, f in enumerate(FORMATS)]
+    lines += [
+        "",
+        "typedef struct {",
+        "  uint32_t offset;        // Bytes from the start of the bank",
+        "  uint32_t length;",
+        "  uint32_t frames;        // pcm, adpcm: samples (mp3: 0, not known)",
+        "  uint8_t format;         // SND_FMT_",
+        "  const char* name;       // File it was packed from, for logs",
+        "} SoundEntry;",
+        "",
+        "static const SoundEntry SOUND_BANK[NUM_SOUNDS] = {",
+    ]
+    for sound_id, name, offset, length, (rate, channels), clip_format, frames in index:
+        entry = (f'  {{ {offset:7}, {length:6}, {frames:6}, SND_FMT_{clip_format.upper()}, '
+                 f'"{os.path.splitext(name)[0]}" }},')
+        lines.append(f"{entry:<62}// {sound_id}, {rate} Hz {'mono' if channels == 1 else 'stereo'}")
+    lines += ["};", "", "#endif // AUDIODEFS_H", ""]
+    text = "\n".join(lines)
+
+    # Rewritten only on a change: the firmware is not rebuilt for nothing
+    if os.path.exists(DEFS_FILE):
+        with open(DEFS_FILE) as f:
+            if f.read() == text:
+                return
+    with open(DEFS_FILE, "w") as f:
+        f.write(text)
+    print(f"  Generated {os.path.relpath(DEFS_FILE, project_dir)}")
+
+
 # Clear and recreate data directory
 if os.path.exists(data_dir):
     shutil.rmtree(data_dir)
@@ -29,13 +316,17 @@ os.makedirs(data_dir)
 if env_name in data_sources:
     source_dir = os.path.join(project_dir, data_sources[env_name])
     if os.path.exists(source_dir):
-        print(f"Copying {data_sources[env_name]} -> data/ for {env_name}")
-        for item in os.listdir(source_dir):
-            src = os.path.join(source_dir, item)
-            dst = os.path.join(data_dir, item)
-            if os.path.isfile(src):
-                shutil.copy2(src, dst)
-                print(f"  Copied: {item}")
+        if env_name in sound_banks:
+            print(f"Packing {data_sources[env_name]} -> data/{BANK_FILE} for {env_name}")
+            pack_bank(source_dir, sound_banks[env_name], sound_format)
+        else:
+            print(f"Copying {data_sources[env_name]} -> data/ for {env_name}")
+            for item in os.listdir(source_dir):
+                src = os.path.join(source_dir, item)
+                dst = os.path.join(data_dir, item)
+                if os.path.isfile(src):
+                    shutil.copy2(src, dst)
+                    print(f"  Copied: {item}")
     else:
         print(f"Warning: Source directory {source_dir} not found")
 else:
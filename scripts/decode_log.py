@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+"""
+Decode tokenized log frames (include/Log.h) back into text
+
+The devices send [0xA5][words][id u16][us u32][arg u32 x words][CRC8]
+(big-endian, like the game protocol) instead of formatted strings. The
+message table is read from include/LogMessages.h, so this script always
+matches the firmware built from the same tree. Anything that is not a valid frame (boot messages,
+Serial.println from setup) is passed through unchanged.
+
+Usage:
+  decode_log.py capture.bin              raw bytes saved from the serial port
+  decode_log.py -                        stdin
+  decode_log.py --port /dev/ttyUSB0      live (needs pyserial)
+Options:
+  --time           prefix each message with the device timestamp (s)
+  --baud N         serial speed (default 115200)
+  --messages PATH  other LogMessages.h
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+FRAME_START = 0xA5
+MAX_WORDS = 8
+STR_WORDS = 2        # LOG_STR_CHARS / 4
+CRC8_POLY = 0x8C
+
+MSG_RE = re.compile(r'LOG_MSG\(\s*(\w+)\s*,\s*(\w+)\s*,\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+SPEC_RE = re.compile(r'%([-+ #0]*)(\d*)(\.\d+)?(hh|h|ll|l|z)?([diuxXcs%])')
+ESCAPES = {'n': '\n', 't': '\t', '"': '"', '\\': '\\', 'r': '\r'}
+
+
+def default_messages():
+    here = os.path.dirname(os.path.abspath(__file__))
+    return os.path.join(here, '..', 'include', 'LogMessages.h')
+
+
+def load_messages(path):
+    """Message index -> (name, format), in table order like the LogId enum"""
+    with open(path) as f:
+        text = f.read()
+    # Skip the usage line in the header comment
+    text = text[text.find('#define LOG_MESSAGES'):]
+    table = []
+    for name, _module, _level, fmt in MSG_RE.findall(text):
+        fmt = re.sub(r'\\(.)', lambda m: ESCAPES.get(m.group(1), m.group(1)), fmt)
+        table.append((name, fmt))
+    return table
+
+
+def crc8(data):
+    crc = 0
+    for byte in data:
+        for _ in range(8):
+            mix = (crc ^ byte) & 0x01
+            crc >>= 1
+            if mix:
+                crc ^= CRC8_POLY
+            byte >>= 1
+    return crc
+
+
+def format_message(fmt, words):
+    """printf-style formatting with one 32-bit word per integer, two per %s"""
+    out = []
+    pos = 0
+    index = 0
+    for m in SPEC_RE.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, width, precision, _length, conv = m.groups()
+        if conv == '%':
+            out.append('%')
+            continue
+        spec = '%' + flags + width + (precision or '')
+        if conv == 's':
+            raw = b''.join(struct.pack('>I', w) for w in words[index:index + STR_WORDS])
+            index += STR_WORDS
+            out.append((spec + 's') % raw.split(b'\0')[0].decode('latin-1'))
+            continue
+        value = words[index] if index < len(words) else 0
+        index += 1
+        if conv in 'di' and value & 0x80000000:
+            value -= 1 << 32
+        if conv == 'c':
+            out.append((spec + 'c') % chr(value & 0xFF))
+        else:
+            out.append((spec + ('d' if conv in 'diu' else conv)) % value)
+    out.append(fmt[pos:])
+    return ''.join(out)
+
+
+class Decoder:
+    def __init__(self, table, show_time, write):
+        self.table = table
+        self.show_time = show_time
+        self.write = write
+        self.buf = bytearray()
+
+    def feed(self, data):
+        self.buf += data
+        while self.buf:
+            start = self.buf.find(FRAME_START)
+            if start < 0:
+                self.text(self.buf)
+                self.buf.clear()
+                return
+            if start > 0:
+                self.text(self.buf[:start])
+                del self.buf[:start]
+            if len(self.buf) < 2:
+                return
+            words = self.buf[1]
+            length = 8 + 4 * words + 1
+            if words > MAX_WORDS:
+                self.text(self.buf[:1])
+                del self.buf[:1]
+                continue
+            if len(self.buf) < length:
+                return
+            frame = bytes(self.buf[:length])
+            msg_id, us = struct.unpack_from('>HI', frame, 2)
+            if msg_id >= len(self.table) or crc8(frame[1:-1]) != frame[-1]:
+                self.text(self.buf[:1])
+                del self.buf[:1]
+                continue
+            del self.buf[:length]
+            args = struct.unpack_from('>%dI' % words, frame, 8)
+            self.message(us, msg_id, args)
+
+    def text(self, data):
+        self.write(bytes(data).decode('latin-1'))
+
+    def message(self, us, msg_id, args):
+        text = format_message(self.table[msg_id][1], args)
+        if self.show_time:
+            lead = len(text) - len(text.lstrip('\n'))
+            text = text[:lead] + '[%11.6f] ' % (us / 1e6) + text[lead:]
+        self.write(text)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode tokenized log frames')
+    parser.add_argument('input', nargs='?', default='-', help='capture file or - for stdin')
+    parser.add_argument('--port', help='serial port to read live')
+    parser.add_argument('--baud', type=int, default=115200)
+    parser.add_argument('--time', action='store_true', help='prefix device timestamps')
+    parser.add_argument('--messages', default=default_messages(), help='LogMessages.h')
+    args = parser.parse_args()
+
+    table = load_messages(args.messages)
+    if not table:
+        sys.exit('No LOG_MSG entries in %s' % args.messages)
+
+    def write(text):
+        sys.stdout.write(text)
+        sys.stdout.flush()
+
+    decoder = Decoder(table, args.time, write)
+
+    if args.port:
+        import serial  # pyserial, only needed for live decoding
+        with serial.Serial(args.port, args.baud, timeout=0.1) as port:
+            while True:
+                decoder.feed(port.read(256))
+    else:
+        stream = sys.stdin.buffer if args.input == '-' else open(args.input, 'rb')
+        with stream:
+            while True:
+                chunk = stream.read(4096)
+                if not chunk:
+                    break
+                decoder.feed(chunk)
+
+
+if __name__ == '__main__':
+    try:
+        main()
+    except KeyboardInterrupt:
+        pass
@@ -7,22 +7,44 @@
  * Tests:
  * - LVGL UI (player circles, GO text, reaction times)
  * - ESP-NOW reception from Host
+ * - Join handshake (host MAC learned from CMD_OK)
+ * - Packet capture (serial: c = dump)
+ * - Link telemetry from the host after each round (CMD_PEER_STATS)
  * - Embedded bitmap images (compiled into firmware)
  *
  * Pin usage: RGB parallel display (handled by lgfx_conf)
  */
 
 #include <Arduino.h>
-#include <esp_now.h>
-#include <WiFi.h>
 #include "lvgl.h"
 #include "ui_lib.h"  // Triggers PlatformIO LDF to compile lib/ui
 #include "Protocol.h"
+#include "Log.h"
+#include "ClockSync.h"
+#include "Scheduler.h"
+#include "SpscQueue.h"
+#include "EspNowTransport.h"
+#include "PacketCapture.h"
+#include "LinkTelemetry.h"
+#include "Pairing.h"
 
 // =============================================================================
 // ESP-NOW CONFIGURATION
 // =============================================================================
-uint8_t hostMac[6] = {0x88, 0x57, 0x21, 0xB3, 0x05, 0xAC};
+uint8_t hostMac[6];               // Learned from CMD_OK
+SystemClock sysClock;
+EspNowTransport espNow;
+PacketCapture capture;            // Every frame sent/received, newest kept
+CaptureTransport radio(&espNow, &capture, &sysClock);
+
+bool joined = false;
+uint32_t lastJoinMs = 0;          // Last CMD_REQ_ID sent
+uint32_t lastHostMs = 0;          // Last frame from the host
+
+#define DISPLAY_RX_QUEUE  8       // Frames between two loop() passes
+
+// Filled by the WiFi task (core 0), drained by loop() (core 1)
+SpscQueue<InboundPacket, DISPLAY_RX_QUEUE> rxQueue;
 
 // =============================================================================
 // GAME STATE
@@ -39,6 +61,11 @@ uint8_t countdownValue = 0;
 uint16_t playerTimes[4] = {0, 0, 0, 0};  // Support 4 players
 uint8_t activePlayers = 2;  // Default to 2 for testing
 
+#define DISPLAY_SPIN_US   40000
+
+SyncedClock hostClock;        // Host timebase, maintained by CMD_SYNC_REQ
+ActionScheduler scheduler;    // Commands deferred by CMD_FIRE_AT
+
 // =============================================================================
 // LVGL UI HELPERS
 // =============================================================================
@@ -69,24 +96,24 @@ void showCountdown(uint8_t num) {
   // For now just show center circle pulsing
   lv_obj_clear_flag(ui_centerCircle, LV_OBJ_FLAG_HIDDEN);
   
-  Serial.printf("COUNTDOWN: %d\n", num);
+  LOG(DISP_COUNTDOWN, num);
 }
 
 void showGO() {
   lv_obj_add_flag(ui_imgStart, LV_OBJ_FLAG_HIDDEN);
   lv_obj_clear_flag(ui_imgGo, LV_OBJ_FLAG_HIDDEN);
   
-  Serial.println("GO!");
+  LOG(DISP_GO);
 }
 
 void showResults(uint16_t times[4]) {
   lv_obj_add_flag(ui_imgGo, LV_OBJ_FLAG_HIDDEN);
   
   // TODO: Add time labels under player circles
-  // For now just print to serial
-  Serial.println("RESULTS:");
+  // For now just log
+  LOG(DISP_RESULTS);
   for (uint8_t i = 0; i < activePlayers; i++) {
-    Serial.printf("  Player %d: %d ms\n", i + 1, times[i]);
+    LOG(DISP_PLAYER_TIME, i + 1, times[i]);
   }
   
   // Find winner (lowest valid time)
@@ -100,33 +127,48 @@ void showResults(uint16_t times[4]) {
   }
   
   if (winner != 0xFF) {
-    Serial.printf("Player %d WINS!\n", winner + 1);
+    LOG(DISP_WINNER, winner + 1);
   } else {
-    Serial.println("NO WINNER (all penalties)");
+    LOG(DISP_NO_WINNER);
   }
 }
 
 // =============================================================================
 // ESP-NOW CALLBACKS
 // =============================================================================
-void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
-  if (len != sizeof(GamePacket)) return;
+void sendToHost(GameFrame* frame) {
+  uint8_t len = frameFinish(frame);
+  radio.send(hostMac, frame->buf, len);
+}
 
+// The display's ID is fixed; joining tells the host its MAC
+void sendJoinRequest() {
+  lastJoinMs = millis();
   GamePacket pkt;
-  memcpy(&pkt, data, sizeof(pkt));
+  buildPacket(&pkt, ID_HOST, ID_DISPLAY, CMD_REQ_ID, 0);
+  radio.send(BROADCAST_MAC, (uint8_t*)&pkt, sizeof(pkt));
+}
+
+void handleCommand(uint8_t srcId, const FrameRecord* rec, uint32_t rxUs) {
+  switch(rec->cmd) {
+    case CMD_SYNC_REQ: {
+      hostClock.update(rec);
+      GameFrame frame;
+      frameBegin(&frame, ID_HOST, ID_DISPLAY);
+      frameAddSyncResponse(&frame, recordU32(rec), rxUs, micros());
+      sendToHost(&frame);
+      break;
+    }
+      
 
-  if (!validatePacket(&pkt)) return;
-  if (pkt.dest_id != ID_HOST && pkt.dest_id != ID_BROADCAST) return; // Only process if for display
-  
-  switch(pkt.cmd) {
     case CMD_COUNTDOWN:
-      countdownValue = pkt.data_low;
+      countdownValue = recordU16(rec) & 0xFF;
       currentState = DISP_COUNTDOWN;
       showCountdown(countdownValue);
       break;
       
     case CMD_VIBRATE:
-      if (pkt.data_low == VIBRATE_GO) {
+      if ((recordU16(rec) & 0xFF) == VIBRATE_GO) {
         currentState = DISP_GO_SIGNAL;
         showGO();
       }
@@ -134,10 +176,10 @@ void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
       
     case CMD_REACTION_DONE:
       // Store reaction time for any player (1-4)
-      if (pkt.src_id >= ID_STICK1 && pkt.src_id <= ID_STICK4) {
-        uint8_t playerIdx = pkt.src_id - ID_STICK1;  // Convert to 0-3 index
-        playerTimes[playerIdx] = packetData(&pkt);
-        Serial.printf("Player %d done: %d ms\n", playerIdx + 1, playerTimes[playerIdx]);
+      if (srcId >= ID_STICK1 && srcId <= ID_STICK4) {
+        uint8_t playerIdx = srcId - ID_STICK1;  // Convert to 0-3 index
+        playerTimes[playerIdx] = recordU16(rec);
+        LOG(DISP_PLAYER_DONE, playerIdx + 1, playerTimes[playerIdx]);
         
         // Check if all active players finished
         bool allDone = true;
@@ -155,6 +197,14 @@ void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
       }
       break;
       
+    case CMD_RESULT:
+      // Host batches all player times into one frame (data = id, time_ms)
+      if (rec->len >= 3 && rec->data[0] >= ID_STICK1 && rec->data[0] <= ID_STICK4) {
+        playerTimes[rec->data[0] - ID_STICK1] = recordU16(rec, 1);
+        currentState = DISP_RESULTS;
+      }
+      break;
+      
     case CMD_IDLE:
       currentState = DISP_IDLE;
       for (uint8_t i = 0; i < 4; i++) {
@@ -162,13 +212,109 @@ void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
       }
       lv_obj_add_flag(ui_imgGo, LV_OBJ_FLAG_HIDDEN);
       lv_obj_clear_flag(ui_imgStart, LV_OBJ_FLAG_HIDDEN);
-      Serial.println("IDLE mode");
+      LOG(DISP_IDLE);
+      break;
+
+    case CMD_PEER_STATS: {
+      // Host's view of one node's link, logged as on the host
+      PeerStatsRecord s;
+      if (!peerStatsDecode(rec, &s)) break;
+      LOG(LINK_PEER, s.id, s.txOk, s.txFail, s.rxFrames, s.rssiAvg, s.rssiMin,
+          s.seenAgoMs, s.rttMaxUs);
+      LOG(LINK_RTT, s.id, s.rttShare[0], s.rttShare[1], s.rttShare[2],
+          s.rttShare[3], s.rttShare[4], s.rttShare[5], s.rttShare[6]);
       break;
+    }
+  }
+}
+
+// loop() task: the UI, the sync state and the scheduler are only touched here
+void handleFrame(const uint8_t *mac, const uint8_t *data, uint8_t len, uint32_t rxUs) {
+  FrameReader reader;
+  if (!frameOpen(&reader, data, len)) return;
+  if (reader.dest_id != ID_DISPLAY && reader.dest_id != ID_BROADCAST) return; // Only process if for display
+  if (joined && memcmp(mac, hostMac, 6) == 0) lastHostMs = millis();
+  
+  bool hadResults = false;
+  bool deferred = false;
+  uint32_t fireUs = 0;
+  FrameRecord rec;
+  while (frameNext(&reader, &rec)) {
+    // Records after CMD_FIRE_AT wait for the host instant (needs sync)
+    if (rec.cmd == CMD_FIRE_AT) {
+      deferred = hostClock.isSynced();
+      fireUs = hostClock.toLocal(recordU32(&rec));
+      continue;
+    }
+    if (rec.cmd == CMD_OK && !joined) {
+      memcpy(hostMac, mac, 6);
+      radio.addPeer(hostMac);
+      lastHostMs = millis();
+      joined = true;
+      LOG(DISP_JOINED);
+      continue;
+    }
+    if (deferred && scheduler.schedule(fireUs, &rec)) continue;
+    
+    handleCommand(reader.src_id, &rec, rxUs);
+    if (rec.cmd == CMD_RESULT) hadResults = true;
+  }
+  
+  // Render once per frame, after every result record is stored
+  if (hadResults) {
+    showResults(playerTimes);
   }
 }
 
-void OnDataSent(const uint8_t *mac, esp_now_send_status_t status) {
-  // Display doesn't send, only receives
+// Display only sends sync replies and skew reports: no send-status handling
+class DisplayRadio : public TransportHandler {
+public:
+  // WiFi task: copy and timestamp only
+  void onTransportReceive(const uint8_t* mac, const uint8_t* data, uint8_t len) override {
+    uint32_t rxUs = micros();
+    if (len == 0 || len > FRAME_MAX_SIZE) return;
+
+    InboundPacket* pkt = rxQueue.claim();
+    if (!pkt) return;  // Full: counted by the queue
+    pkt->rxUs = rxUs;
+    memcpy(pkt->mac, mac, 6);
+    pkt->rssi = 0;
+    pkt->len = len;
+    memcpy(pkt->data, data, len);
+    rxQueue.publish();
+  }
+};
+
+DisplayRadio radioHandler;
+
+void processInbound() {
+  InboundPacket* pkt;
+  while ((pkt = rxQueue.peek()) != nullptr) {
+    handleFrame(pkt->mac, pkt->data, pkt->len, pkt->rxUs);
+    rxQueue.pop();
+  }
+}
+
+// Runs a deferred command and reports its lateness to the host
+void runScheduled(void* ctx, const FrameRecord* rec, uint32_t targetUs) {
+  handleCommand(ID_HOST, rec, targetUs);
+  
+  GameFrame frame;
+  frameBegin(&frame, ID_HOST, ID_DISPLAY);
+  frameAddSkewReport(&frame, rec->cmd, scheduler.skew().lastUs);
+  sendToHost(&frame);
+}
+
+// =============================================================================
+// SERIAL COMMANDS
+// =============================================================================
+// c: dump the packet capture (between rounds; the loop stops while it writes)
+void printCaptureLine(void* ctx, const char* line) {
+  Serial.printf("%s\n", line);
+}
+
+void handleSerial() {
+  if (Serial.read() == 'c') capture.dump(printCaptureLine, nullptr);
 }
 
 // =============================================================================
@@ -177,6 +323,7 @@ void OnDataSent(const uint8_t *mac, esp_now_send_status_t status) {
 void setup() {
   Serial.begin(115200);
   Serial.println("\n=== DISPLAY TEST (ESP32-S3) ===");
+  logStartTask(Serial);   // Game logs: binary frames, scripts/decode_log.py
   
   
   // Initialize LVGL + Display
@@ -190,29 +337,13 @@ void setup() {
   lv_obj_clear_flag(ui_imgStart, LV_OBJ_FLAG_HIDDEN); // Show START initially
   
   // Initialize ESP-NOW
-  WiFi.mode(WIFI_STA);
-  WiFi.disconnect();
-  
-  if (esp_now_init() != ESP_OK) {
+  if (!radio.begin(&radioHandler)) {
     Serial.println("ESP-NOW init failed!");
     return;
   }
   
-  esp_now_register_recv_cb(OnDataRecv);
-  esp_now_register_send_cb(OnDataSent);
-  
-  // Pair with Host
-  esp_now_peer_info_t peerInfo = {};
-  memcpy(peerInfo.peer_addr, hostMac, 6);
-  peerInfo.channel = ESPNOW_CHANNEL;
-  peerInfo.encrypt = false;
-  peerInfo.ifidx = WIFI_IF_STA;
-  
-  if (esp_now_add_peer(&peerInfo) == ESP_OK) {
-    Serial.println("Host paired");
-  } else {
-    Serial.println("Host pair failed!");
-  }
+  // Join the host (repeated from loop() until it answers)
+  sendJoinRequest();
   
   Serial.print("Display MAC: ");
   Serial.println(WiFi.macAddress());
@@ -223,6 +354,24 @@ void setup() {
 // LOOP
 // =============================================================================
 void loop() {
+  handleSerial();
+  processInbound();
+  
+  // Join, or rejoin once the host has gone quiet
+  uint32_t now = millis();
+  if (joined ? (now - lastHostMs > JOIN_LOST_MS) : (now - lastJoinMs >= JOIN_RETRY_MS)) {
+    joined = false;
+    sendJoinRequest();
+  }
+  
+  // Scheduled commands: busy-wait the last stretch for accuracy. A full
+  // LVGL refresh can take tens of ms, so start waiting earlier than usual
+  if (scheduler.dueWithin(micros(), DISPLAY_SPIN_US)) {
+    while (!scheduler.dueWithin(micros(), 0)) {
+    }
+    scheduler.run(micros(), runScheduled);
+  }
+  
   lv_timer_handler();
   delay(5);
 }
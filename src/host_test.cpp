@@ -6,9 +6,16 @@
  * 
  * Tests:
  * - ESP-NOW broadcast to Display + 2 Joysticks
+ * - Join handshake (pairings kept in NVS)
  * - Audio playback (countdown + GO beep)
  * - NeoPixel animations (5 rings)
  * - Game timing logic
+ * - Packet capture (serial: c = dump, C = save to SPIFFS)
+ * - Link telemetry per node (serial: s)
+ * - LED refresh statistics (serial: l)
+ * - Sound start latency per clip, underruns (serial: a)
+ * - Audio under load on the loop's core (serial: x toggles)
+ * - Gapless clip sequences, silence per boundary (serial: g)
  * 
  * Pins:
  * - GPIO4: NeoPixel DIN
@@ -18,268 +25,240 @@
  */
 
 #include <Arduino.h>
-#include <esp_now.h>
-#include <WiFi.h>
-#include <esp_wifi.h>
-#include <Adafruit_NeoPixel.h>
 #include "Protocol.h"
 #include "GameTypes.h"
 #include "AudioManager.h"
+#include "LedStrip.h"
+#include "HostLeds.h"
+#include "EspNowTransport.h"
+#include "PacketCapture.h"
+#include "Pairing.h"
+#include "HostGame.h"
 
 // =============================================================================
 // PIN DEFINITIONS
 // =============================================================================
 #define PIN_NEOPIXEL      4
 
-// =============================================================================
-// ESP-NOW CONFIGURATION
-// =============================================================================
-uint8_t displayMac[6] = {0xD0, 0xCF, 0x13, 0x01, 0xD1, 0xA4};
-uint8_t stick1Mac[6]  = {0xBC, 0xFF, 0x4D, 0xF9, 0xF3, 0x91};
-uint8_t stick2Mac[6]  = {0xBC, 0xFF, 0x4D, 0xF9, 0xAE, 0x29};
-uint8_t broadcastMac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
-
 // =============================================================================
 // HARDWARE
 // =============================================================================
-Adafruit_NeoPixel pixels(NEOPIXEL_COUNT, PIN_NEOPIXEL, NEO_GRB + NEO_KHZ800);
+LedStrip pixels;            // RMT output: show() never blocks the loop
+HostLeds leds;              // Ring effects, rendered into pixels
 AudioManager audio;
+SystemClock sysClock;
+EspNowTransport espNow;
+PacketCapture capture;      // Every frame sent/received, newest kept
+CaptureTransport radio(&espNow, &capture, &sysClock);
+NvsPairingStore pairings;   // Joined nodes survive a host reboot
 
 // =============================================================================
-// GAME STATE
+// GAME LOGIC (HostGame.h)
 // =============================================================================
-GameState gameState = GAME_IDLE;
-Player players[2]; // Only 2 joysticks for test
-unsigned long stateStartTime = 0;
-uint8_t countdownNum = 3;
-NeoMode neoMode = NEO_OFF;
+HostGame game;
 
 // =============================================================================
-// NEOPIXEL HELPERS
+// NEOPIXELS (HostLeds.h scenes, LedStrip.h output)
 // =============================================================================
-void setRingColor(uint8_t ring, uint32_t color) {
-  uint8_t start = ring * LEDS_PER_RING;
-  for (uint8_t i = 0; i < LEDS_PER_RING; i++) {
-    pixels.setPixelColor(start + i, color);
-  }
-}
+// Loop passes and CPU time spent on the LEDs since the last report
+uint32_t ledLoops = 0;
+uint64_t ledCycles = 0;
+uint32_t ledReportMs = 0;
 
-void setAllRings(uint32_t color) {
-  for (int i = 0; i < NEOPIXEL_COUNT; i++) {
-    pixels.setPixelColor(i, color);
+// Renders only changed or due frames; sends only frames that differ
+void updateNeoPixels() {
+  uint32_t c0 = ESP.getCycleCount();
+  uint32_t now = millis();
+  leds.update(game.getNeoMode(), game.getRoster(), now);
+  if (leds.draw(now, pixels.pixels()) || pixels.pending()) {
+    pixels.show();
   }
+  ledCycles += ESP.getCycleCount() - c0;
+  ledLoops++;
 }
 
-uint32_t wheel(uint8_t pos) {
-  pos = 255 - pos;
-  if (pos < 85) return pixels.Color(255 - pos * 3, 0, pos * 3);
-  if (pos < 170) { pos -= 85; return pixels.Color(0, pos * 3, 255 - pos * 3); }
-  pos -= 170;
-  return pixels.Color(pos * 3, 255 - pos * 3, 0);
-}
-
-void updateNeoPixels() {
-  static uint8_t offset = 0;
-  static unsigned long lastUpdate = 0;
-  static bool blinkState = false;
-  
-  unsigned long now = millis();
-  
-  switch (neoMode) {
-    case NEO_OFF:
-      setAllRings(0);
-      break;
-      
-    case NEO_IDLE_RAINBOW:
-      if (now - lastUpdate > 50) {
-        lastUpdate = now;
-        for (int i = 0; i < NEOPIXEL_COUNT; i++) {
-          pixels.setPixelColor(i, wheel((i * 256 / NEOPIXEL_COUNT + offset) & 255));
-        }
-        offset++;
-      }
-      break;
-      
-    case NEO_STATUS:
-      // Player 1 = Ring 0, Player 2 = Ring 1, Center = Ring 2
-      setRingColor(0, players[0].joined ? COLOR_GREEN : COLOR_RED);
-      setRingColor(1, players[1].joined ? COLOR_GREEN : COLOR_RED);
-      setRingColor(2, wheel(offset++));
-      setRingColor(3, 0); // Ring 3, 4 off
-      setRingColor(4, 0);
-      break;
-      
-    case NEO_COUNTDOWN:
-      if (now - lastUpdate > 250) {
-        lastUpdate = now;
-        blinkState = !blinkState;
-        setAllRings(blinkState ? COLOR_RED : 0);
-      }
-      break;
-      
-    case NEO_FIXED_COLOR:
-      setAllRings(COLOR_GREEN); // GO signal
-      break;
-      
-    default:
-      break;
-  }
-  
-  pixels.show();
+// Rates since the previous report
+void logLedStats() {
+  static uint32_t lastRenders = 0;
+  static LedStats last = {};
+  uint32_t now = millis();
+  uint32_t ms = now - ledReportMs;
+  if (ms == 0) return;
+  const LedStats& s = pixels.getStats();
+  uint32_t cpuUs = (uint32_t)(ledCycles / ESP.getCpuFreqMHz());
+  uint32_t loops = (uint32_t)(ledLoops * 1000ULL / ms);
+  uint32_t renders = (uint32_t)((leds.renderCount() - lastRenders) * 1000ULL / ms);
+  uint32_t shows = (uint32_t)((s.shows - last.shows) * 1000ULL / ms);
+  LOG(HOST_LED_STATS, ms, loops, renders, shows, s.unchanged - last.unchanged,
+      s.busy - last.busy, (uint32_t)(cpuUs * 1000ULL / ms));
+  lastRenders = leds.renderCount();
+  last = s;
+  ledLoops = 0;
+  ledCycles = 0;
+  ledReportMs = now;
 }
 
 // =============================================================================
-// ESP-NOW SEND
+// GAME OUTPUTS
 // =============================================================================
-void sendPacket(uint8_t* mac, uint8_t dest, uint8_t cmd, uint16_t data) {
-  GamePacket pkt;
-  buildPacket(&pkt, dest, ID_HOST, cmd, data);
-  esp_now_send(mac, (uint8_t*)&pkt, sizeof(pkt));
+// "Player N, <ms> milliseconds"; the serial line stays the record when a
+// word has no clip yet (the boot log counts the words recorded)
+void announceTime(uint8_t player, uint16_t timeMs) {
+  if (timeMs == TIME_PENALTY) return;
+  SpeechPhrase phrase;
+  phrase.player(player);
+  phrase.number(timeMs);
+  phrase.add(WORD_MILLISECONDS);
+  audio.announce(phrase);
 }
 
-void broadcast(uint8_t cmd, uint16_t data) {
-  sendPacket(broadcastMac, ID_BROADCAST, cmd, data);
-}
+class HostOutputs : public HostEvents {
+public:
+  void onIdle() override {
+    audio.queueSound(SND_GET_READY);
+  }
 
-// =============================================================================
-// ESP-NOW CALLBACKS
-// =============================================================================
-void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
-  if (len != sizeof(GamePacket)) return;
+  void onCountdown(uint8_t num) override {
+    audio.playCountdown(num);
+  }
 
-  GamePacket pkt;
-  memcpy(&pkt, data, sizeof(pkt));
+  void onGo() override {
+    audio.playCue(SND_BEEP);
+  }
 
-  if (!validatePacket(&pkt)) return;
+  void onPlayerFinished(uint8_t playerIdx, uint16_t timeMs) override {
+    leds.playerFinished(playerIdx, timeMs == TIME_PENALTY, millis());
+    audio.playEffect(SND_BUTTON_CLICK);     // Over the beep, not after it
+  }
 
-  // Handle joystick responses
-  if (pkt.cmd == CMD_REACTION_DONE) {
-    uint8_t playerIdx = (pkt.src_id == ID_STICK1) ? 0 : 1;
-    players[playerIdx].reactionTime = packetData(&pkt);
-    players[playerIdx].finished = true;
+  // "Player two, two hundred thirty four milliseconds", then the fanfare;
+  // the next round's GET READY cuts either
+  void onWinner(uint8_t playerIdx, uint16_t timeMs) override {
+    announceTime(playerIdx + 1, timeMs);
+    audio.queueSound(SND_VICTORY_FANFARE, AUDIO_PRIO_LOW);
+  }
+};
 
-    Serial.printf("Player %d: %d ms\n", playerIdx + 1, players[playerIdx].reactionTime);
+HostOutputs outputs;
 
-    // Update NeoPixel ring
-    uint32_t color = (players[playerIdx].reactionTime == TIME_PENALTY) ? COLOR_RED : COLOR_GREEN;
-    setRingColor(playerIdx, color);
-    pixels.show();
+// =============================================================================
+// AUDIO STRESS (serial: x)
+// =============================================================================
+// Keeps sounds playing while the loop's core is loaded: a task there spins
+// with interrupts off in bursts (like a bit-banged LED push) and every loop
+// pass writes a long serial line. With the audio task on the other core
+// the underrun count stays at 0; build with -DAUDIO_IN_LOOP to compare.
+#define STRESS_SPIN_US    2000    // Interrupts off per burst, one burst per tick
+#define STRESS_LINE       160     // Serial bytes per loop pass (~14 ms at 115200)
+
+bool stressOn = false;
+TaskHandle_t stressTask = nullptr;
+portMUX_TYPE stressMux = portMUX_INITIALIZER_UNLOCKED;
+uint32_t stressStartMs = 0;
+uint32_t stressClips = 0;
+uint32_t stressLoopMaxMs = 0;
+AudioOutStats stressBase;
+
+void stressLoad(void* ctx) {
+  for (;;) {
+    if (!stressOn) {
+      vTaskDelay(pdMS_TO_TICKS(50));
+      continue;
+    }
+    portENTER_CRITICAL(&stressMux);
+    uint32_t t0 = micros();
+    while (micros() - t0 < STRESS_SPIN_US) {}
+    portEXIT_CRITICAL(&stressMux);
+    vTaskDelay(1);
   }
 }
 
-void OnDataSent(const uint8_t *mac, esp_now_send_status_t status) {
-  // Optional: track send failures
+// Loop side: the next countdown once the last one played, a long line
+void stressStep(uint32_t passMs) {
+  if (passMs > stressLoopMaxMs) stressLoopMaxMs = passMs;
+  if (!audio.playing()) {
+    audio.queueSound(SND_COUNTDOWN_3);
+    audio.queueSound(SND_COUNTDOWN_2);
+    audio.queueSound(SND_COUNTDOWN_1);
+    audio.queueSound(SND_BEEP);
+    stressClips += 4;
+  }
+  char line[STRESS_LINE + 1];
+  memset(line, '.', STRESS_LINE);
+  line[STRESS_LINE] = '\0';
+  Serial.println(line);
+}
+
+void toggleStress() {
+  if (!stressOn) {
+    if (!stressTask) {
+      xTaskCreatePinnedToCore(stressLoad, "stress", 2048, nullptr, 1, &stressTask, 1 - AUDIO_TASK_CORE);
+    }
+    stressBase = audio.getOutputStats();
+    stressStartMs = millis();
+    stressClips = 0;
+    stressLoopMaxMs = 0;
+    stressOn = true;
+    return;
+  }
+  stressOn = false;
+  audio.stop();
+  const AudioOutStats& s = audio.getOutputStats();
+  LOG(HOST_STRESS, millis() - stressStartMs, stressClips, s.underruns - stressBase.underruns,
+      s.starved - stressBase.starved, stressLoopMaxMs);
 }
 
 // =============================================================================
-// GAME STATE MACHINE
+// SERIAL COMMANDS
 // =============================================================================
-void runGame() {
-  unsigned long now = millis();
-  
-  switch (gameState) {
-    case GAME_IDLE:
-      if (stateStartTime == 0) {
-        stateStartTime = now;
-        neoMode = NEO_IDLE_RAINBOW;
-        
-        // Initialize players
-        players[0] = {true, false, 0, 0};
-        players[1] = {true, false, 0, 0};
-
-        broadcast(CMD_IDLE, 0);
-        audio.queueSound(SND_GET_READY);
-        
-        Serial.println("IDLE - Press button to start");
-      }
-      
-      // Auto-start after 3 seconds
-      if (now - stateStartTime > 3000) {
-        gameState = GAME_COUNTDOWN;
-        stateStartTime = 0;
-        countdownNum = 3;
-      }
-      break;
-      
-    case GAME_COUNTDOWN:
-      if (stateStartTime == 0) {
-        stateStartTime = now;
-        neoMode = NEO_COUNTDOWN;
-        audio.playCountdown(countdownNum);
-        broadcast(CMD_COUNTDOWN, countdownNum);
-        
-        Serial.printf("Countdown: %d\n", countdownNum);
-      }
-      
-      if (now - stateStartTime > 1000) {
-        countdownNum--;
-        if (countdownNum > 0) {
-          stateStartTime = now;
-          audio.playCountdown(countdownNum);
-          broadcast(CMD_COUNTDOWN, countdownNum);
-          Serial.printf("Countdown: %d\n", countdownNum);
-        } else {
-          gameState = GAME_REACTION_ACTIVE;
-          stateStartTime = 0;
-        }
-      }
-      break;
-      
-    case GAME_REACTION_ACTIVE: {
-      if (stateStartTime == 0) {
-        stateStartTime = now;
-        neoMode = NEO_FIXED_COLOR;
-
-        // Send GO signal
-        broadcast(CMD_VIBRATE, VIBRATE_GO);
-        audio.queueSound(SND_BEEP);
-
-        Serial.println("GO!");
-      }
+// c: dump the packet capture to serial, C: save it to SPIFFS (between
+// rounds; the loop stops while it writes), s: link telemetry per node,
+// l: LED refresh rates and CPU time since the last l, a: queue-to-first-
+// sample latency per sound, boundary silence and underruns, x: audio
+// stress on/off, g: "player 2 wins" and the countdown back to back
+// (AUDIO_GAP per boundary), m: a prompt with two effects mixed over it,
+// n: "player 2, 234 milliseconds" (phrase start latency: a)
+#define PCAP_FILE      "/capture.txt"
+
+void printCaptureLine(void* ctx, const char* line) {
+  Serial.printf("%s\n", line);
+}
 
-      // Check if both finished or timeout
-      bool allDone = players[0].finished && players[1].finished;
-      bool timeout = (now - stateStartTime > TIMEOUT_REACTION);
+void fileCaptureLine(void* ctx, const char* line) {
+  File* f = (File*)ctx;
+  f->print(line);
+  f->print("\n");
+}
 
-      if (allDone || timeout) {
-        gameState = GAME_RESULTS;
-        stateStartTime = 0;
-      }
-      break;
-    }
-      
-    case GAME_RESULTS:
-      if (stateStartTime == 0) {
-        stateStartTime = now;
-        neoMode = NEO_STATUS;
-        
-        Serial.println("\n=== RESULTS ===");
-        Serial.printf("Player 1: %d ms\n", players[0].reactionTime);
-        Serial.printf("Player 2: %d ms\n", players[1].reactionTime);
-        
-        // Determine winner
-        if (players[0].reactionTime < players[1].reactionTime && 
-            players[0].reactionTime != TIME_PENALTY) {
-          Serial.println("Player 1 WINS!");
-          audio.queueSound(SND_VICTORY_FANFARE);
-        } else if (players[1].reactionTime < players[0].reactionTime && 
-                   players[1].reactionTime != TIME_PENALTY) {
-          Serial.println("Player 2 WINS!");
-          audio.queueSound(SND_VICTORY_FANFARE);
-        } else {
-          Serial.println("TIE or BOTH PENALTY");
-        }
-      }
-      
-      // Return to IDLE after 5 seconds
-      if (now - stateStartTime > 5000) {
-        gameState = GAME_IDLE;
-        stateStartTime = 0;
-      }
-      break;
-      
-    default:
-      break;
+void handleSerial() {
+  int c = Serial.read();
+  if (c == 'c') {
+    capture.dump(printCaptureLine, nullptr);
+  } else if (c == 'C') {
+    File f = SPIFFS.open(PCAP_FILE, "w");
+    if (!f) return;
+    capture.dump(fileCaptureLine, &f);
+    f.close();
+  } else if (c == 's') {
+    game.logTelemetry();
+  } else if (c == 'l') {
+    logLedStats();
+  } else if (c == 'a') {
+    audio.logStats();
+  } else if (c == 'x') {
+    toggleStress();
+  } else if (c == 'g') {
+    audio.playPlayerWins(2);
+    audio.queueSound(SND_COUNTDOWN_3);
+    audio.queueSound(SND_COUNTDOWN_2);
+    audio.queueSound(SND_COUNTDOWN_1);
+    audio.queueSound(SND_BEEP);
+  } else if (c == 'm') {
+    audio.queueSound(SND_GET_READY);
+    audio.playEffect(SND_BUTTON_CLICK);
+    audio.playEffect(SND_BEEP);
+  } else if (c == 'n') {
+    announceTime(2, 234);
   }
 }
 
@@ -289,60 +268,39 @@ void runGame() {
 void setup() {
   Serial.begin(115200);
   Serial.println("\n=== HOST TEST (ESP32) ===");
+  logStartTask(Serial);   // Game logs: binary frames, scripts/decode_log.py
 
   // Initialize Audio
   if (audio.begin(1.0)) {
-    Serial.println("Audio system ready");
+    // Sounds players react to: decoded to RAM, no SPIFFS/MP3 start delay
+    audio.cacheSound(SND_BEEP);
+    audio.cacheSound(SND_COUNTDOWN_3);
+    audio.cacheSound(SND_COUNTDOWN_2);
+    audio.cacheSound(SND_COUNTDOWN_1);
+    audio.cacheSound(SND_BUTTON_CLICK);     // Mixed over speech (playEffect)
+    Serial.printf("Audio system ready (%u clips, %u bytes cached)\n",
+                  audio.getCache().size(), (unsigned)audio.getCache().bytesUsed());
+#ifndef AUDIO_IN_LOOP
+    if (!audio.startTask()) Serial.println("Audio task failed, playing from loop");
+#endif
   } else {
     Serial.println("Audio init failed!");
   }
 
   // Initialize NeoPixels
-  pixels.begin();
-  pixels.setBrightness(NEO_BRIGHTNESS);
+  if (!pixels.begin(PIN_NEOPIXEL)) {
+    Serial.println("LED init failed!");
+  }
+  leds.setBrightness(NEO_BRIGHTNESS);   // Gamma table, not the strip
   pixels.show();
 
-  // Initialize ESP-NOW
-  WiFi.mode(WIFI_STA);
-  WiFi.disconnect();
-  esp_wifi_set_channel(ESPNOW_CHANNEL, WIFI_SECOND_CHAN_NONE);
-
-  if (esp_now_init() != ESP_OK) {
+  // Initialize ESP-NOW; display and joysticks join with CMD_REQ_ID
+  espNow.trackRssi();
+  if (!game.begin(&radio, &sysClock, &outputs, &pairings)) {
     Serial.println("ESP-NOW init failed!");
     return;
   }
 
-  esp_now_register_recv_cb(OnDataRecv);
-  esp_now_register_send_cb(OnDataSent);
-
-  // Add peers
-  esp_now_peer_info_t peerInfo = {};
-  peerInfo.channel = ESPNOW_CHANNEL;
-  peerInfo.encrypt = false;
-  peerInfo.ifidx = WIFI_IF_STA;
-
-  // Broadcast
-  memcpy(peerInfo.peer_addr, broadcastMac, 6);
-  esp_now_add_peer(&peerInfo);
-
-  // Display
-  memcpy(peerInfo.peer_addr, displayMac, 6);
-  if (esp_now_add_peer(&peerInfo) == ESP_OK) {
-    Serial.println("Display paired");
-  }
-
-  // Joystick 1
-  memcpy(peerInfo.peer_addr, stick1Mac, 6);
-  if (esp_now_add_peer(&peerInfo) == ESP_OK) {
-    Serial.println("Joystick 1 paired");
-  }
-
-  // Joystick 2
-  memcpy(peerInfo.peer_addr, stick2Mac, 6);
-  if (esp_now_add_peer(&peerInfo) == ESP_OK) {
-    Serial.println("Joystick 2 paired");
-  }
-
   Serial.print("Host MAC: ");
   Serial.println(WiFi.macAddress());
   Serial.println("Host ready!");
@@ -352,8 +310,14 @@ void setup() {
 // LOOP
 // =============================================================================
 void loop() {
-  audio.update(); // Non-blocking audio
+  static uint32_t lastPassMs = 0;
+  uint32_t now = millis();
+  if (stressOn) stressStep(now - lastPassMs);
+  lastPassMs = now;
+
+  handleSerial();
+  audio.update(); // Non-blocking audio (no-op once its task runs)
+  game.update();
   updateNeoPixels();
-  runGame();
   delay(1);
 }
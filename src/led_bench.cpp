@@ -0,0 +1,96 @@
+/*
+ * led_bench.cpp - NeoPixel Output Benchmark (ESP32)
+ *
+ * Hardware: Host board (ESP32 DevKit-C), rings on GPIO4
+ *
+ * CPU cycles spent in the calling task per 60-LED frame:
+ * - Adafruit_NeoPixel::show()       blocks until the frame is out
+ * - LedStrip::show(), new frame     encode + start the RMT, then return
+ * - LedStrip::show(), same frame    compare only, nothing sent
+ * plus the time the RMT then needs on its own (free for the loop).
+ *
+ * Run: pio run -e led_bench -t upload && pio device monitor
+ */
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+#include "GameTypes.h"
+#include "LedStrip.h"
+
+#define PIN_NEOPIXEL      4
+#define BENCH_FRAMES      200
+
+Adafruit_NeoPixel neo(NEOPIXEL_COUNT, PIN_NEOPIXEL, NEO_GRB + NEO_KHZ800);
+LedStrip strip;
+
+// A different frame every time, so neither path can skip it
+uint32_t frameColor(uint32_t frame, uint16_t i) {
+  uint8_t v = (uint8_t)(frame * 7 + i * 4);
+  return ((uint32_t)v << 16) | ((uint32_t)(255 - v) << 8) | (uint8_t)(v * 3);
+}
+
+void report(const char* name, uint64_t cycles, uint32_t frames) {
+  uint32_t perFrame = (uint32_t)(cycles / frames);
+  Serial.printf("%-28s %8u cycles/frame  %7.1f us\n",
+                name, perFrame, perFrame / (float)ESP.getCpuFreqMHz());
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(500);
+  Serial.println("\n=== LED OUTPUT BENCHMARK (ESP32) ===");
+  Serial.printf("%u LEDs, %u frames per test, CPU %u MHz\n\n",
+                NEOPIXEL_COUNT, BENCH_FRAMES, ESP.getCpuFreqMHz());
+
+  // Before: blocking show()
+  neo.begin();
+  neo.setBrightness(NEO_BRIGHTNESS);
+  uint64_t total = 0;
+  for (uint32_t f = 0; f < BENCH_FRAMES; f++) {
+    for (uint16_t i = 0; i < NEOPIXEL_COUNT; i++) neo.setPixelColor(i, frameColor(f, i));
+    uint32_t c0 = ESP.getCycleCount();
+    neo.show();
+    total += ESP.getCycleCount() - c0;
+    delay(1);
+  }
+  report("Adafruit show()", total, BENCH_FRAMES);
+
+  // After: RMT, every frame new (waits for the previous one outside the
+  // measurement, like a loop running at the refresh rate would)
+  if (!strip.begin(PIN_NEOPIXEL)) {
+    Serial.println("RMT init failed!");
+    return;
+  }
+  strip.setBrightness(NEO_BRIGHTNESS);
+  uint64_t txTotal = 0;
+  total = 0;
+  for (uint32_t f = 0; f < BENCH_FRAMES; f++) {
+    for (uint16_t i = 0; i < NEOPIXEL_COUNT; i++) strip.setPixelColor(i, frameColor(f, i));
+    uint32_t c0 = ESP.getCycleCount();
+    strip.show();
+    uint32_t c1 = ESP.getCycleCount();
+    while (strip.busy()) {
+    }
+    total += c1 - c0;
+    txTotal += ESP.getCycleCount() - c1;
+    delay(1);
+  }
+  report("LedStrip show() new frame", total, BENCH_FRAMES);
+  report("  RMT transmit (CPU free)", txTotal, BENCH_FRAMES);
+
+  // Unchanged frame: what the 1 ms loop pays between changes
+  total = 0;
+  for (uint32_t f = 0; f < BENCH_FRAMES; f++) {
+    uint32_t c0 = ESP.getCycleCount();
+    strip.show();
+    total += ESP.getCycleCount() - c0;
+  }
+  report("LedStrip show() unchanged", total, BENCH_FRAMES);
+
+  const LedStats& s = strip.getStats();
+  Serial.printf("\nLedStrip: %u sent, %u unchanged, %u busy\n", s.shows, s.unchanged, s.busy);
+}
+
+void loop() {
+  delay(1000);
+}
@@ -0,0 +1,910 @@
+/*
+ * native_audio.cpp - Gapless Sequencing and Priority Test
+ *
+ * Plays clip sequences ("player 2" + "wins", the countdown) through the
+ * host's AudioSequencer and AudioPump (AudioEngine.h) into a virtual I2S
+ * DMA, on a virtual clock, and measures the silence where clips meet.
+ *
+ * The clips are the real ones: each file in the data directory is parsed
+ * with Mp3Gapless.h (Info frame, LAME encoder delay and padding), and a
+ * fake decoder reproduces what the MP3 decoder outputs for it: silence for
+ * the header frame, encoder and decoder delay, a tone for the encoded
+ * audio, silence for the padding. Speech has silence of its own at its
+ * edges; leaving it out measures only what the decoder and the sequencing
+ * add. Decoder costs advance the clock (--open-us: bank seek and header
+ * probe, --start-us: decoder start, --decode-ns per frame) while the DMA
+ * keeps playing; when it runs dry it plays zeros, as the real one does.
+ *
+ * Reported per sequence and mode (padding trimmed or not, next clip
+ * prefetched or not): the silent frames at each boundary, as played by
+ * the DAC, and DMA underruns. Then the open cost at which each mode first
+ * underruns. Exits 1 if the gapless mode (trim + prefetch) leaves any
+ * silence at a boundary with the given costs.
+ *
+ * First sample: each clip queued alone on an idle engine, cached in RAM
+ * and streamed from the bank, at instants spread over a DMA buffer (the
+ * idle DMA keeps clocking zeros). Reported: queue to first audible frame
+ * at the DAC, min/avg/max, next to what the sequencer logs on the device.
+ * Exits 1 if a clip starts later than the buffer being sent (+ its open,
+ * start and lead-in decode from the bank).
+ *
+ * Underruns: I2sOutput's reckoning (UnderrunMeter.h) fed from the virtual
+ * DMA while the task stalls (within the DMA depth, short of it by less
+ * than a buffer, past it, across the micros() wrap) or the queue goes
+ * idle between clips. Checked: the underruns it counts, and its starved
+ * frames against what the DMA really played dry.
+ *
+ * Priorities: synthetic clips queued at set times, with priorities and
+ * deadlines, as the game queues them (a countdown over a voice prompt,
+ * three priority levels, a prompt past its deadline, a full queue, with
+ * and without a prompt prefetched). Each fake clip plays at its own
+ * level, so the DAC trace tells what played when. Checked: the order the
+ * DAC plays them in, the preempted, stale, evicted and rejected counts,
+ * and that every cue starts within the DMA depth + one block + one task
+ * period of being queued, or of the cue ahead of it ending (+ open and
+ * start costs when not cached). Any failure exits 1 as well.
+ *
+ * Usage: native_audio [--data DIR] [--open-us US] [--start-us US] [--decode-ns NS]
+ *   --data       MP3 directory (default data_host)
+ *   --open-us    open() cost (default 12000)
+ *   --start-us   first read() cost (default 6000)
+ *   --decode-ns  cost per decoded frame (default 2000)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+#include "AudioEngine.h"
+#include "Mp3Gapless.h"
+#include "UnderrunMeter.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define DMA_FRAMES        (AUDIO_DMA_BUFFERS * AUDIO_DMA_FRAMES)
+#define TASK_WAIT_US      2000                        // AUDIO_TASK_WAIT_MS
+#define TONE_STEP         1000                        // Tone level: (sound + 1) × step
+#define MAX_CLIPS         8
+#define MAX_GAPS          16
+#define SWEEP_MAX_US      60000
+#define SWEEP_STEP_US     1000
+#define FIRST_PHASES      32                          // Queue instants per clip
+#define FIRST_IDLE_US     100000                      // Engine idle until then
+
+static uint64_t clockUs;
+static uint32_t openUs = 12000;
+static uint32_t startUs = 6000;
+static uint32_t decodeNs = 2000;
+
+// =============================================================================
+// CLIPS
+// =============================================================================
+// What the MP3 decoder outputs for one file, in AUDIO_RATE frames
+typedef struct {
+  char name[32];
+  uint32_t total;         // Decoded, header frame included
+  uint32_t skip;          // Silence before the audio
+  uint32_t length;        // Audio
+  bool lame;
+  bool cached;            // In the PcmCache: no open, start or decode cost
+} ClipSpec;
+
+// The DAC trace tells which sound played from the level
+static int16_t toneOf(uint8_t sound) { return (int16_t)((sound + 1) * TONE_STEP); }
+static int soundOf(int16_t s) { return (s < 0 ? -s : s) / TONE_STEP - 1; }
+
+static uint32_t toOutput(uint32_t samples, uint32_t rate) {
+  return (uint32_t)((uint64_t)samples * AUDIO_RATE / rate);
+}
+
+// Used when the file is not there: LAME's defaults for a 1 s voice clip
+static void defaultSpec(ClipSpec* c) {
+  c->cached = false;
+  c->skip = 576 + 576 + MP3_DECODER_DELAY;
+  c->length = AUDIO_RATE;
+  c->total = 39 * 576;
+  c->lame = true;
+}
+
+static bool loadSpec(const char* dir, const char* name, ClipSpec* c) {
+  snprintf(c->name, sizeof(c->name), "%s", name);
+  char path[256];
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    defaultSpec(c);
+    return false;
+  }
+  uint8_t head[10];
+  uint32_t start = (fread(head, 1, 10, f) == 10) ? mp3Id3Size(head) : 0;
+  uint8_t probe[MP3_PROBE_BYTES];
+  fseek(f, start, SEEK_SET);
+  uint32_t n = fread(probe, 1, sizeof(probe), f);
+  fclose(f);
+
+  Mp3Info info;
+  if (!mp3ParseInfo(probe, n, &info) || !info.frames) {
+    defaultSpec(c);
+    return false;
+  }
+  uint32_t skip, length;
+  mp3GaplessSpan(info, &skip, &length);
+  uint32_t total = (info.frames + (info.infoFrame ? 1 : 0)) * info.frameSamples;
+  if (!length) length = total - skip;
+  c->total = toOutput(total, info.rate);
+  c->skip = toOutput(skip, info.rate);
+  c->length = toOutput(length, info.rate);
+  c->lame = info.lame;
+  c->cached = false;
+  printf("  %-16s %5u Hz %u ch  info %u  lame %u  delay %4u  padding %4u  -> skip %4u, keep %6u of %6u frames\n",
+         name, info.rate, info.channels, info.infoFrame, info.lame, info.encDelay, info.padding,
+         c->skip, c->length, c->total);
+  return true;
+}
+
+// =============================================================================
+// FAKE DECODER AND SOURCE
+// =============================================================================
+class FakeDecoder : public AudioDecoder {
+public:
+  FakeDecoder() : spec(nullptr), trim(true), started(false), pos(0), level(0) {}
+
+  void load(const ClipSpec* s, bool gapless) {
+    spec = s;
+    trim = gapless;
+  }
+
+  bool open(uint8_t sound) override {
+    if (!spec->cached) clockUs += openUs;
+    level = toneOf(sound);
+    started = false;
+    pos = trim ? spec->skip : 0;
+    return true;
+  }
+
+  uint32_t read(int16_t* out, uint32_t frames) override {
+    if (!started && !spec->cached) {
+      clockUs += startUs;
+      if (trim) clockUs += (uint64_t)spec->skip * decodeNs / 1000;    // Decoded, dropped
+      started = true;
+    }
+    uint32_t end = trim ? spec->skip + spec->length : spec->total;
+    uint32_t n = end - pos;
+    if (n > frames) n = frames;
+    for (uint32_t i = 0; i < n; i++, pos++) {
+      bool audio = pos >= spec->skip && pos < spec->skip + spec->length;
+      out[i] = audio ? ((pos & 16) ? level : -level) : 0;
+    }
+    if (!spec->cached) clockUs += (uint64_t)n * decodeNs / 1000;
+    return n;
+  }
+
+  void close() override {}
+
+  uint32_t trimmed() const override { return trim ? spec->total - spec->length : 0; }
+
+private:
+  const ClipSpec* spec;
+  bool trim;
+  bool started;
+  uint32_t pos;
+  int16_t level;
+};
+
+class FakeSource : public AudioSource {
+public:
+  FakeSource(const ClipSpec* s, uint8_t n) : specs(s), count(n), trim(true) {
+    memset(busy, 0, sizeof(busy));
+  }
+
+  void setTrim(bool on) { trim = on; }
+
+  AudioDecoder* open(uint8_t sound) override {
+    if (sound >= count) return nullptr;
+    for (uint8_t i = 0; i < 2; i++) {
+      if (busy[i]) continue;
+      decoders[i].load(&specs[sound], trim);
+      decoders[i].open(sound);
+      busy[i] = true;
+      return &decoders[i];
+    }
+    return nullptr;
+  }
+
+  void release(AudioDecoder* decoder) override {
+    for (uint8_t i = 0; i < 2; i++) {
+      if (decoder == &decoders[i]) busy[i] = false;
+    }
+  }
+
+  bool cached(uint8_t sound) const override { return sound < count && specs[sound].cached; }
+
+  const char* name(uint8_t sound) const override {
+    return sound < count ? specs[sound].name : "?";
+  }
+
+private:
+  const ClipSpec* specs;
+  uint8_t count;
+  bool trim;
+  FakeDecoder decoders[2];
+  bool busy[2];
+};
+
+// =============================================================================
+// VIRTUAL DMA
+// =============================================================================
+// Plays AUDIO_RATE frames per second of the virtual clock; zeros when
+// nothing is queued. Records what the DAC plays from the first write on.
+class VirtualDma : public AudioSink {
+public:
+  VirtualDma() : originUs(0), played(0), running(false), clocked(false), starved(0), underruns(0),
+                 dry(false) {}
+
+  // Clocking zeros since time 0, as the installed driver does: the first
+  // write plays once the DMA buffer being sent is out
+  void setClocked(bool on) { clocked = on; }
+
+  void advance(uint64_t nowUs) {
+    if (!running || nowUs < originUs) return;
+    uint64_t due = (nowUs - originUs) * AUDIO_RATE / 1000000;
+    while (played < due) {
+      played++;
+      if (!queue.empty()) {
+        dac.push_back(queue.front());
+        queue.pop_front();
+        dry = false;
+      } else {
+        dac.push_back(0);
+        starved++;
+        if (!dry) underruns++;
+        dry = true;
+      }
+    }
+  }
+
+  uint32_t write(const int16_t* frames, uint32_t count) override {
+    if (!running) {
+      running = true;
+      originUs = clockUs;
+      if (clocked) {
+        uint64_t buffers = (clockUs * AUDIO_RATE / 1000000 + AUDIO_BLOCK_FRAMES) / AUDIO_BLOCK_FRAMES;
+        originUs = (buffers * AUDIO_BLOCK_FRAMES * 1000000 + AUDIO_RATE - 1) / AUDIO_RATE;
+      }
+    }
+    advance(clockUs);
+    uint32_t n = DMA_FRAMES - (uint32_t)queue.size();
+    if (n > count) n = count;
+    for (uint32_t i = 0; i < n; i++) queue.push_back(frames[i]);
+    return n;
+  }
+
+  // Preemption: what is queued turns to zeros, still played out, as
+  // i2s_zero_dma_buffer() does
+  void flush() override {
+    for (int16_t& s : queue) s = 0;
+  }
+
+  // The sequence is over: play out what is queued
+  void drain() {
+    while (!queue.empty()) {
+      dac.push_back(queue.front());
+      queue.pop_front();
+    }
+  }
+
+  std::vector<int16_t> dac;
+  uint64_t startUs() const { return originUs; }      // dac[0]
+  uint32_t starvedFrames() const { return starved; }
+  uint32_t underrunCount() const { return underruns; }
+
+private:
+  std::deque<int16_t> queue;
+  uint64_t originUs;
+  uint64_t played;
+  bool running;
+  bool clocked;
+  uint32_t starved;
+  uint32_t underruns;
+  bool dry;
+};
+
+// =============================================================================
+// RUN
+// =============================================================================
+typedef struct {
+  uint32_t gaps[MAX_GAPS];      // Silent runs inside the sequence, in order
+  uint8_t gapCount;
+  uint32_t silent;
+  uint32_t underruns;
+  uint32_t starved;
+  AudioGapStats stats;          // As the sequencer measured them
+} RunResult;
+
+static void runSequence(const ClipSpec* specs, uint8_t count, const uint8_t* sounds,
+                        uint8_t length, bool trim, bool prefetch, RunResult* r) {
+  FakeSource source(specs, count);
+  source.setTrim(trim);
+  AudioSequencer seq(&source);
+  seq.setPrefetch(prefetch);
+  AudioPump pump;
+  VirtualDma dma;
+
+  clockUs = 0;
+  for (uint8_t i = 0; i < length; i++) seq.push(sounds[i], 0);
+  for (;;) {
+    dma.advance(clockUs);
+    bool more = pump.run(&seq, &dma, (uint32_t)clockUs);
+    if (!more && !seq.busy()) break;
+    clockUs += TASK_WAIT_US;
+  }
+  dma.drain();
+
+  // Silent runs between the first and the last audible frame
+  memset(r, 0, sizeof(*r));
+  const std::vector<int16_t>& d = dma.dac;
+  size_t first = 0, last = d.size();
+  while (first < d.size() && d[first] == 0) first++;
+  while (last > first && d[last - 1] == 0) last--;
+  uint32_t run = 0;
+  for (size_t i = first; i < last; i++) {
+    if (d[i] == 0) {
+      run++;
+      continue;
+    }
+    if (run && r->gapCount < MAX_GAPS) r->gaps[r->gapCount++] = run;
+    r->silent += run;
+    run = 0;
+  }
+  r->underruns = dma.underrunCount();
+  r->starved = dma.starvedFrames();
+  r->stats = seq.getGapStats();
+}
+
+static void printResult(const char* mode, const RunResult& r) {
+  printf("    %-20s %6u silent frames (%5.1f ms)  underruns %u  gaps:", mode, r.silent,
+         r.silent * 1000.0 / AUDIO_RATE, r.underruns);
+  if (!r.gapCount) printf(" none");
+  for (uint8_t i = 0; i < r.gapCount; i++) printf(" %u", r.gaps[i]);
+  printf("  (sequencer: %u boundaries, %u silent, %u trimmed)\n", r.stats.boundaries,
+         r.stats.silent, r.stats.trimmed);
+}
+
+// =============================================================================
+// FIRST SAMPLE
+// =============================================================================
+// One clip queued on an idle engine and serviced at once, as the audio
+// task does on a command, at FIRST_PHASES instants across a DMA buffer.
+// Timed from the queue to its first audible frame at the DAC, and as the
+// sequencer logs it (getLatency(): the refill pass's start, before the
+// decoder opens).
+typedef struct {
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint64_t totalUs;
+  uint32_t loggedMaxUs;
+} FirstSample;
+
+static uint32_t dmaBufferUs() {
+  return (uint32_t)(((uint64_t)AUDIO_BLOCK_FRAMES * 1000000 + AUDIO_RATE - 1) / AUDIO_RATE);
+}
+
+// The buffer being sent, one frame of rounding, and for a bank clip its
+// open, start, the dropped lead-in and the first block decoded
+static uint32_t firstBoundUs(const ClipSpec& c) {
+  uint32_t us = dmaBufferUs() + 1000000 / AUDIO_RATE + 1;
+  if (c.cached) return us;
+  return us + openUs + startUs + (uint32_t)((uint64_t)(c.skip + AUDIO_BLOCK_FRAMES) * decodeNs / 1000);
+}
+
+static void measureFirst(const ClipSpec* specs, uint8_t count, uint8_t sound, FirstSample* r) {
+  memset(r, 0, sizeof(*r));
+  r->minUs = UINT32_MAX;
+  for (uint32_t k = 0; k < FIRST_PHASES; k++) {
+    FakeSource source(specs, count);
+    AudioSequencer seq(&source);
+    AudioPump pump;
+    VirtualDma dma;
+    dma.setClocked(true);
+
+    clockUs = FIRST_IDLE_US + (uint64_t)k * dmaBufferUs() / FIRST_PHASES;
+    uint32_t queuedUs = (uint32_t)clockUs;
+    AudioQueueEntry e = { sound, AUDIO_PRIO_CUE, queuedUs, 0, 0 };
+    pump.queue(&seq, &dma, e);
+    for (;;) {
+      dma.advance(clockUs);
+      bool more = pump.run(&seq, &dma, (uint32_t)clockUs);
+      if (!more && !seq.busy()) break;
+      clockUs += TASK_WAIT_US;
+    }
+    dma.drain();
+
+    const std::vector<int16_t>& d = dma.dac;
+    size_t i = 0;
+    while (i < d.size() && d[i] == 0) i++;
+    uint64_t at = dma.startUs() + ((uint64_t)i * 1000000 + AUDIO_RATE - 1) / AUDIO_RATE;
+    uint32_t us = (uint32_t)(at - queuedUs);
+    if (us < r->minUs) r->minUs = us;
+    if (us > r->maxUs) r->maxUs = us;
+    r->totalUs += us;
+
+    uint8_t n;
+    const AudioLatency* logged = seq.getLatency(&n);
+    if (n && logged[0].maxUs > r->loggedMaxUs) r->loggedMaxUs = logged[0].maxUs;
+  }
+}
+
+// Each clip cached (PcmCache) and streamed from the bank; false if one
+// starts later than its bound
+static bool runFirstSample(ClipSpec* specs, uint8_t count) {
+  printf("\nQueue to first sample at the DAC, idle engine, %u instants (bound: %.1f ms cached):\n",
+         FIRST_PHASES, dmaBufferUs() / 1000.0);
+  printf("  %-16s %-7s %8s %8s %8s %8s %8s\n", "clip", "from", "min ms", "avg ms", "max ms",
+         "bound", "log max");
+  bool ok = true;
+  for (uint8_t s = 0; s < count; s++) {
+    for (int cached = 1; cached >= 0; cached--) {
+      bool was = specs[s].cached;
+      specs[s].cached = cached;
+      FirstSample r;
+      measureFirst(specs, count, s, &r);
+      uint32_t bound = firstBoundUs(specs[s]);
+      specs[s].cached = was;
+      bool late = r.maxUs > bound;
+      printf("  %-16s %-7s %8.2f %8.2f %8.2f %8.2f %8.2f%s\n", specs[s].name, cached ? "cache" : "bank",
+             r.minUs / 1000.0, r.totalUs / 1000.0 / FIRST_PHASES, r.maxUs / 1000.0, bound / 1000.0,
+             r.loggedMaxUs / 1000.0, late ? "  FAIL" : "");
+      if (late) ok = false;
+    }
+  }
+  return ok;
+}
+
+// =============================================================================
+// PRIORITIES
+// =============================================================================
+// Synthetic clips: only their length and whether they are cached matter
+enum {
+  P_VOICE, P_THREE, P_TWO, P_ONE, P_GO, P_FANFARE, P_PROMPT_A, P_PROMPT_B, P_CHIME,
+  P_LOW0, P_LOW1, P_LOW2, P_LOW3, P_LOW4, P_LOW5, P_LOW6, P_LOW7, P_LOW8, P_LOW9, P_LOW10,
+  P_LOW11, P_CLIPS
+};
+
+static void makeSpec(ClipSpec* c, const char* name, uint32_t ms, bool cached) {
+  snprintf(c->name, sizeof(c->name), "%s", name);
+  c->skip = 0;
+  c->length = c->total = ms * (AUDIO_RATE / 1000);
+  c->lame = true;
+  c->cached = cached;
+}
+
+static void makePrioritySpecs(ClipSpec* c) {
+  static const char* const lows[] = {
+    "low0", "low1", "low2", "low3", "low4", "low5", "low6", "low7", "low8", "low9", "low10", "low11"
+  };
+  makeSpec(&c[P_VOICE], "voice", 1500, false);
+  makeSpec(&c[P_THREE], "three", 400, true);
+  makeSpec(&c[P_TWO], "two", 400, true);
+  makeSpec(&c[P_ONE], "one", 400, true);
+  makeSpec(&c[P_GO], "go", 300, true);
+  makeSpec(&c[P_FANFARE], "fanfare", 3000, false);
+  makeSpec(&c[P_PROMPT_A], "prompt_a", 400, false);
+  makeSpec(&c[P_PROMPT_B], "prompt_b", 400, false);
+  makeSpec(&c[P_CHIME], "chime", 200, true);
+  for (uint8_t i = 0; i < 12; i++) makeSpec(&c[P_LOW0 + i], lows[i], 200, false);
+}
+
+// What the game queues, and when
+typedef struct {
+  uint32_t atMs;
+  uint8_t sound;
+  uint8_t priority;
+  uint16_t deadlineMs;    // 0: none
+} QueueEvent;
+
+typedef struct {
+  const char* name;
+  const QueueEvent* events;
+  uint8_t eventCount;
+  const uint8_t* expect;  // Sounds in the order the DAC plays them; nullptr: not checked
+  uint8_t expectCount;
+  AudioQueueStats stats;
+} Scenario;
+
+// One clip as the DAC played it
+typedef struct {
+  uint8_t sound;
+  uint32_t queuedUs;      // Latest event for it before it started
+  uint8_t priority;
+  uint32_t startUs;
+  uint32_t frames;
+} Played;
+
+#define MAX_PLAYED        24
+
+// Latest start of a cue after it is queued: the DMA depth (what was queued
+// before it, silenced or not), one staging block, one task period, and the
+// decoder's open and start when it is not cached
+static uint32_t cueBoundUs(bool cached) {
+  uint32_t us = (uint32_t)((uint64_t)(DMA_FRAMES + AUDIO_BLOCK_FRAMES) * 1000000 / AUDIO_RATE) + TASK_WAIT_US;
+  return cached ? us : us + openUs + startUs;
+}
+
+// Events are handled when they are due, as AudioManager handles its
+// commands: queued, then serviced at once
+static uint8_t runEvents(const ClipSpec* specs, const QueueEvent* events, uint8_t n,
+                         Played* played, AudioQueueStats* stats) {
+  FakeSource source(specs, P_CLIPS);
+  AudioSequencer seq(&source);
+  AudioPump pump;
+  VirtualDma dma;
+
+  clockUs = 0;
+  uint8_t e = 0;
+  for (;;) {
+    dma.advance(clockUs);
+    for (; e < n && (uint64_t)events[e].atMs * 1000 <= clockUs; e++) {
+      const QueueEvent& ev = events[e];
+      uint32_t at = ev.atMs * 1000;
+      AudioQueueEntry entry = { ev.sound, ev.priority, at, 0, 0 };
+      if (ev.deadlineMs) entry.deadlineUs = (at + ev.deadlineMs * 1000) | 1;
+      pump.queue(&seq, &dma, entry);
+    }
+    bool more = pump.run(&seq, &dma, (uint32_t)clockUs);
+    if (!more && !seq.busy() && e == n) break;
+    uint64_t wake = clockUs + TASK_WAIT_US;
+    if (e < n && (uint64_t)events[e].atMs * 1000 < wake) {
+      uint64_t at = (uint64_t)events[e].atMs * 1000;
+      wake = at > clockUs ? at : clockUs;
+    }
+    clockUs = wake;
+  }
+  dma.drain();
+  *stats = seq.getQueueStats();
+
+  // A clip starts where the level changes to another sound's
+  uint8_t count = 0;
+  const std::vector<int16_t>& d = dma.dac;
+  for (size_t i = 0; i < d.size(); i++) {
+    if (d[i] == 0) continue;
+    int sound = soundOf(d[i]);
+    if (count && played[count - 1].sound == sound) {
+      played[count - 1].frames++;
+      continue;
+    }
+    if (count == MAX_PLAYED) break;
+    Played* p = &played[count++];
+    p->sound = (uint8_t)sound;
+    p->startUs = (uint32_t)(dma.startUs() + ((uint64_t)i * 1000000 + AUDIO_RATE - 1) / AUDIO_RATE);
+    p->frames = 1;
+    p->queuedUs = 0;
+    p->priority = AUDIO_PRIO_NORMAL;
+    // The DMA model plays a frame in the slot it was written in: it can
+    // start up to a frame before the event that queued it
+    for (uint8_t k = 0; k < n; k++) {
+      if (events[k].sound == sound && events[k].atMs * 1000 <= p->startUs + 1000000 / AUDIO_RATE) {
+        p->queuedUs = events[k].atMs * 1000;
+        p->priority = events[k].priority;
+      }
+    }
+  }
+  return count;
+}
+
+// Prints the DAC's order and latencies; false if anything is off
+static bool runScenario(const ClipSpec* specs, const Scenario& sc) {
+  Played played[MAX_PLAYED];
+  AudioQueueStats stats;
+  uint8_t count = runEvents(specs, sc.events, sc.eventCount, played, &stats);
+  bool ok = true;
+
+  printf("%s:\n", sc.name);
+  for (uint8_t i = 0; i < count; i++) {
+    const Played& p = played[i];
+    uint32_t latency = p.startUs > p.queuedUs ? p.startUs - p.queuedUs : 0;
+    bool cue = p.priority == AUDIO_PRIO_CUE;
+    // A cue queued while another plays waits for it: the bound counts from
+    // that one's end
+    uint32_t from = p.queuedUs;
+    if (cue && i && played[i - 1].priority == AUDIO_PRIO_CUE) {
+      uint32_t end = played[i - 1].startUs + (uint32_t)((uint64_t)played[i - 1].frames * 1000000 / AUDIO_RATE);
+      if (end > from) from = end;
+    }
+    bool late = cue && p.startUs > from && p.startUs - from > cueBoundUs(specs[p.sound].cached);
+    printf("    %-10s queued %7.1f ms  starts %7.1f ms  latency %6.1f ms%s  played %5.0f of %5.0f ms%s\n",
+           specs[p.sound].name, p.queuedUs / 1000.0, p.startUs / 1000.0, latency / 1000.0,
+           cue ? (late ? " > bound" : " (cue)  ") : "        ", p.frames * 1000.0 / AUDIO_RATE,
+           specs[p.sound].length * 1000.0 / AUDIO_RATE, late ? "  FAIL" : "");
+    if (late) ok = false;
+  }
+  printf("    queue: %u preempted, %u stale, %u evicted, %u rejected\n", stats.preempted,
+         stats.stale, stats.evicted, stats.rejected);
+  if (!sc.expect) return ok;
+
+  bool order = count == sc.expectCount;
+  for (uint8_t i = 0; order && i < count; i++) order = played[i].sound == sc.expect[i];
+  if (!order) {
+    printf("    FAIL: expected");
+    for (uint8_t i = 0; i < sc.expectCount; i++) printf(" %s", specs[sc.expect[i]].name);
+    printf("\n");
+  }
+  bool counted = stats.preempted == sc.stats.preempted && stats.stale == sc.stats.stale &&
+                 stats.evicted == sc.stats.evicted && stats.rejected == sc.stats.rejected;
+  if (!counted) {
+    printf("    FAIL: expected %u preempted, %u stale, %u evicted, %u rejected\n",
+           sc.stats.preempted, sc.stats.stale, sc.stats.evicted, sc.stats.rejected);
+  }
+  return ok && order && counted;
+}
+
+static bool runPriorities() {
+  ClipSpec specs[P_CLIPS];
+  makePrioritySpecs(specs);
+
+  // Countdown over a long prompt, as the game queues it
+  static const QueueEvent countdown[] = {
+    { 0, P_VOICE, AUDIO_PRIO_NORMAL, 0 },
+    { 500, P_THREE, AUDIO_PRIO_CUE, 250 },
+    { 1500, P_TWO, AUDIO_PRIO_CUE, 250 },
+    { 2500, P_ONE, AUDIO_PRIO_CUE, 250 },
+    { 3500, P_GO, AUDIO_PRIO_CUE, 250 },
+  };
+  static const uint8_t countdownOrder[] = { P_VOICE, P_THREE, P_TWO, P_ONE, P_GO };
+
+  // The same, all plain FIFO: what the countdown did before priorities
+  static const QueueEvent fifo[] = {
+    { 0, P_VOICE, AUDIO_PRIO_NORMAL, 0 },
+    { 500, P_THREE, AUDIO_PRIO_NORMAL, 0 },
+    { 1500, P_TWO, AUDIO_PRIO_NORMAL, 0 },
+    { 2500, P_ONE, AUDIO_PRIO_NORMAL, 0 },
+    { 3500, P_GO, AUDIO_PRIO_NORMAL, 0 },
+  };
+
+  // Each level cuts the one below; the prefetched prompt goes back in line
+  static const QueueEvent levels[] = {
+    { 0, P_FANFARE, AUDIO_PRIO_LOW, 0 },
+    { 100, P_PROMPT_A, AUDIO_PRIO_NORMAL, 0 },
+    { 100, P_CHIME, AUDIO_PRIO_LOW, 0 },
+    { 100, P_PROMPT_B, AUDIO_PRIO_NORMAL, 0 },
+    { 200, P_GO, AUDIO_PRIO_CUE, 250 },
+  };
+  static const uint8_t levelsOrder[] = { P_FANFARE, P_PROMPT_A, P_GO, P_PROMPT_B, P_CHIME };
+
+  // A prompt that would start 1 s late is dropped, even once prefetched
+  static const QueueEvent stale[] = {
+    { 0, P_VOICE, AUDIO_PRIO_NORMAL, 0 },
+    { 100, P_PROMPT_A, AUDIO_PRIO_NORMAL, 500 },
+    { 100, P_PROMPT_B, AUDIO_PRIO_NORMAL, 0 },
+  };
+  static const uint8_t staleOrder[] = { P_VOICE, P_PROMPT_B };
+
+  // A queue full of music: the prompt and the cue each evict the newest
+  // entry, another music clip is refused
+  static const QueueEvent full[] = {
+    { 0, P_VOICE, AUDIO_PRIO_NORMAL, 0 },
+    { 100, P_LOW0, AUDIO_PRIO_LOW, 0 }, { 100, P_LOW1, AUDIO_PRIO_LOW, 0 },
+    { 100, P_LOW2, AUDIO_PRIO_LOW, 0 }, { 100, P_LOW3, AUDIO_PRIO_LOW, 0 },
+    { 100, P_LOW4, AUDIO_PRIO_LOW, 0 }, { 100, P_LOW5, AUDIO_PRIO_LOW, 0 },
+    { 100, P_LOW6, AUDIO_PRIO_LOW, 0 }, { 100, P_LOW7, AUDIO_PRIO_LOW, 0 },
+    { 100, P_LOW8, AUDIO_PRIO_LOW, 0 }, { 100, P_LOW9, AUDIO_PRIO_LOW, 0 },
+    { 100, P_LOW10, AUDIO_PRIO_LOW, 0 }, { 100, P_LOW11, AUDIO_PRIO_LOW, 0 },
+    { 100, P_PROMPT_A, AUDIO_PRIO_NORMAL, 0 },
+    { 100, P_CHIME, AUDIO_PRIO_LOW, 0 },
+    { 100, P_GO, AUDIO_PRIO_CUE, 250 },
+  };
+  static const uint8_t fullOrder[] = {
+    P_VOICE, P_GO, P_PROMPT_A, P_LOW0, P_LOW1, P_LOW2, P_LOW3, P_LOW4, P_LOW5, P_LOW6, P_LOW7,
+    P_LOW8, P_LOW9
+  };
+  static_assert(P_LOW11 - P_LOW0 + 1 == AUDIO_QUEUE_SIZE, "full must fill the queue with music");
+
+  // The same behind a playing cue with the prompt prefetched: another cue
+  // puts the prompt back in line, and both evict music, not the prompt
+  static const QueueEvent prefetched[] = {
+    { 0, P_CHIME, AUDIO_PRIO_CUE, 0 },
+    { 0, P_PROMPT_A, AUDIO_PRIO_NORMAL, 0 },
+    { 100, P_LOW0, AUDIO_PRIO_LOW, 0 }, { 100, P_LOW1, AUDIO_PRIO_LOW, 0 },
+    { 100, P_LOW2, AUDIO_PRIO_LOW, 0 }, { 100, P_LOW3, AUDIO_PRIO_LOW, 0 },
+    { 100, P_LOW4, AUDIO_PRIO_LOW, 0 }, { 100, P_LOW5, AUDIO_PRIO_LOW, 0 },
+    { 100, P_LOW6, AUDIO_PRIO_LOW, 0 }, { 100, P_LOW7, AUDIO_PRIO_LOW, 0 },
+    { 100, P_LOW8, AUDIO_PRIO_LOW, 0 }, { 100, P_LOW9, AUDIO_PRIO_LOW, 0 },
+    { 100, P_LOW10, AUDIO_PRIO_LOW, 0 }, { 100, P_LOW11, AUDIO_PRIO_LOW, 0 },
+    { 150, P_GO, AUDIO_PRIO_CUE, 250 },
+  };
+  static const uint8_t prefetchedOrder[] = {
+    P_CHIME, P_GO, P_PROMPT_A, P_LOW0, P_LOW1, P_LOW2, P_LOW3, P_LOW4, P_LOW5, P_LOW6, P_LOW7,
+    P_LOW8, P_LOW9
+  };
+
+#define EVENTS(a) a, (uint8_t)(sizeof(a) / sizeof(a[0]))
+  const Scenario scenarios[] = {
+    { "countdown over a prompt", EVENTS(countdown), EVENTS(countdownOrder), { 1, 0, 0, 0 } },
+    { "same, FIFO (before priorities)", EVENTS(fifo), nullptr, 0, { 0, 0, 0, 0 } },
+    { "three levels", EVENTS(levels), EVENTS(levelsOrder), { 2, 0, 0, 0 } },
+    { "stale prompt", EVENTS(stale), EVENTS(staleOrder), { 0, 1, 0, 0 } },
+    { "full queue", EVENTS(full), EVENTS(fullOrder), { 1, 0, 2, 1 } },
+    { "full queue, prompt prefetched", EVENTS(prefetched), EVENTS(prefetchedOrder), { 0, 0, 2, 0 } },
+  };
+#undef EVENTS
+
+  printf("\nPriorities (cue bound: %.1f ms cached, %.1f ms from flash):\n",
+         cueBoundUs(true) / 1000.0, cueBoundUs(false) / 1000.0);
+  bool ok = true;
+  for (const Scenario& sc : scenarios) ok = runScenario(specs, sc) && ok;
+  return ok;
+}
+
+// =============================================================================
+// UNDERRUNS
+// =============================================================================
+// I2sOutput's reckoning (UnderrunMeter.h) on the virtual DMA, which knows
+// when it really ran dry. Written and checked as I2sOutput does: per
+// accepted block, poll() per refill pass and when full, endStream() when
+// the queue runs out.
+class MeteredDma : public VirtualDma {
+public:
+  uint32_t write(const int16_t* frames, uint32_t count) override {
+    uint32_t n = VirtualDma::write(frames, count);
+    if (n) meter.accepted(n, meter.due() ? (uint32_t)clockUs : 0);
+    if (n < count) meter.poll();
+    return n;
+  }
+
+  UnderrunMeter meter;
+};
+
+// One long cached clip; the task stalls once, and a second clip may
+// follow after an idle spell (not an underrun)
+typedef struct {
+  const char* name;
+  uint64_t startUs;       // Clock at the first queue (micros() wraps from it)
+  uint32_t stallAtMs;     // After the start; 0: no stall
+  uint32_t stallMs;
+  uint32_t againAtMs;     // Second clip; 0: none
+  uint32_t underruns;     // The meter must count
+} UnderrunCase;
+
+static bool runUnderrunCase(const UnderrunCase& c) {
+  ClipSpec spec;
+  makeSpec(&spec, "tone", 1000, true);
+  FakeSource source(&spec, 1);
+  AudioSequencer seq(&source);
+  AudioPump pump;
+  MeteredDma dma;
+
+  clockUs = c.startUs;
+  pump.queue(&seq, &dma, { 0, AUDIO_PRIO_NORMAL, (uint32_t)clockUs, 0, 0 });
+  bool stalled = !c.stallAtMs;
+  bool again = !c.againAtMs;
+  for (;;) {
+    dma.advance(clockUs);
+    uint64_t elapsedUs = clockUs - c.startUs;
+    if (!again && elapsedUs >= (uint64_t)c.againAtMs * 1000) {
+      pump.queue(&seq, &dma, { 0, AUDIO_PRIO_NORMAL, (uint32_t)clockUs, 0, 0 });
+      again = true;
+    }
+    dma.meter.poll();
+    bool more = pump.run(&seq, &dma, (uint32_t)clockUs);
+    if (!more) dma.meter.endStream();
+    if (!more && !seq.busy() && again) break;
+    clockUs += TASK_WAIT_US;
+    if (!stalled && elapsedUs >= (uint64_t)c.stallAtMs * 1000) {
+      clockUs += (uint64_t)c.stallMs * 1000;
+      stalled = true;
+    }
+  }
+  dma.drain();
+
+  // Counted: as expected, and when counted with no idle spell in the
+  // DMA's own count, what it really starved rounded up to whole buffers
+  const AudioOutStats& s = dma.meter.getStats();
+  uint32_t truth = dma.starvedFrames();
+  bool ok = s.underruns == c.underruns && s.frames == dma.dac.size() - truth;
+  if (c.underruns && !c.againAtMs) {
+    ok = ok && s.underruns == dma.underrunCount() && s.starved >= truth &&
+         s.starved < truth + s.underruns * AUDIO_DMA_FRAMES;
+  }
+  printf("  %-28s %2u underruns %5u starved   (DMA: %2u, %5u frames)%s\n", c.name, s.underruns,
+         s.starved, dma.underrunCount(), truth, ok ? "" : "  FAIL");
+  return ok;
+}
+
+static bool runUnderruns() {
+  uint32_t depthMs = (uint32_t)((uint64_t)DMA_FRAMES * 1000 / AUDIO_RATE);
+  static const UnderrunCase cases[] = {
+    { "steady",                      0,            0,   0,    0, 0 },
+    { "stall within the DMA depth",  0,          500,  15,    0, 0 },
+    { "stall short of one buffer",   0,          500,  24,    0, 0 },
+    { "stall past the DMA depth",    0,          500,  60,    0, 1 },
+    { "stall across micros() wrap",  0x100000000ULL - 520000, 500, 60, 0, 1 },
+    { "idle between two clips",      0,            0,   0, 2000, 0 },
+    { "stall, idle, clip again",     0,          300, 100, 2000, 1 },
+  };
+  printf("\nUnderruns (I2sOutput reckoning, DMA %u ms, task every %u ms):\n", depthMs,
+         TASK_WAIT_US / 1000);
+  bool ok = true;
+  for (const UnderrunCase& c : cases) ok = runUnderrunCase(c) && ok;
+  return ok;
+}
+
+// =============================================================================
+// MAIN
+// =============================================================================
+int main(int argc, char** argv) {
+  const char* dir = "data_host";
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--data") && i + 1 < argc) dir = argv[++i];
+    else if (!strcmp(argv[i], "--open-us") && i + 1 < argc) openUs = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--start-us") && i + 1 < argc) startUs = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--decode-ns") && i + 1 < argc) decodeNs = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: %s [--data DIR] [--open-us US] [--start-us US] [--decode-ns NS]\n", argv[0]);
+      return 2;
+    }
+  }
+  logEnabled() = false;
+
+  // Sound IDs are indexes into files
+  static const char* const files[] = {
+    "player2.mp3", "wins.mp3", "three.mp3", "two.mp3", "one.mp3", "beep.mp3"
+  };
+  static const uint8_t wins[] = { 0, 1 };
+  static const uint8_t countdown[] = { 2, 3, 4, 5 };
+  typedef struct {
+    const char* name;
+    const uint8_t* clips;
+    uint8_t length;
+  } Sequence;
+  static const Sequence sequences[] = {
+    { "player 2 wins", wins, 2 },
+    { "countdown", countdown, 4 },
+  };
+
+  ClipSpec specs[MAX_CLIPS];
+  uint8_t count = sizeof(files) / sizeof(files[0]);
+  printf("Clips (%s):\n", dir);
+  for (uint8_t i = 0; i < count; i++) {
+    if (!loadSpec(dir, files[i], &specs[i])) printf("  %-16s missing: default LAME clip\n", files[i]);
+  }
+  printf("\nCosts: open %u us, start %u us, %u ns/frame; DMA %u frames (%.1f ms)\n\n",
+         openUs, startUs, decodeNs, DMA_FRAMES, DMA_FRAMES * 1000.0 / AUDIO_RATE);
+
+  int rc = 0;
+  for (const Sequence& s : sequences) {
+    printf("%s:\n", s.name);
+    RunResult r;
+    runSequence(specs, count, s.clips, s.length, false, false, &r);
+    printResult("untrimmed", r);
+    runSequence(specs, count, s.clips, s.length, false, true, &r);
+    printResult("untrimmed+prefetch", r);
+    runSequence(specs, count, s.clips, s.length, true, false, &r);
+    printResult("trimmed", r);
+    runSequence(specs, count, s.clips, s.length, true, true, &r);
+    printResult("gapless", r);
+    if (r.silent) rc = 1;
+  }
+
+  // Open cost the DMA depth absorbs, per mode
+  printf("\nFirst open cost that underruns (countdown, start %u us):\n", startUs);
+  uint32_t saved = openUs;
+  for (int prefetch = 0; prefetch < 2; prefetch++) {
+    uint32_t at = 0;
+    for (openUs = 0; openUs <= SWEEP_MAX_US && !at; openUs += SWEEP_STEP_US) {
+      RunResult r;
+      runSequence(specs, count, countdown, 4, true, prefetch, &r);
+      if (r.underruns) at = openUs;
+    }
+    if (at) printf("  %-10s %u us\n", prefetch ? "prefetch" : "at start", at);
+    else printf("  %-10s none up to %u us\n", prefetch ? "prefetch" : "at start", SWEEP_MAX_US);
+  }
+  openUs = saved;
+
+  if (rc) printf("\nFAIL: gapless mode leaves silence at a boundary\n");
+  if (!runFirstSample(specs, count)) rc = 1;
+  if (!runUnderruns()) rc = 1;
+  if (!runPriorities()) rc = 1;
+  printf("\n%s\n", rc ? "FAIL" : "OK: gapless, first samples, underruns, priorities and deadlines");
+  return rc;
+}
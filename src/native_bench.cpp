@@ -0,0 +1,134 @@
+/*
+ * native_bench.cpp - Host Per-packet Path Benchmark
+ *
+ * MAX_PLAYERS sticks (16 in env:native_bench) join a HostGame over a
+ * SimNetwork on a virtual clock. At every GO, one reaction report per stick
+ * is pushed through the host's receive callback and processed by a single
+ * update(): queue copy, link parse, node and slot lookup, roster update and
+ * the all-done check. Wall-clock cost per packet is reported, minus the cost
+ * of an update() with nothing received.
+ *
+ * Usage: native_bench [rounds]   (default 2000)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "Platform.h"
+#include "SimNetwork.h"
+#include "HostGame.h"
+#include "JoystickGame.h"
+
+#define BENCH_TICK_US     1000
+
+// =============================================================================
+// HELPERS
+// =============================================================================
+static uint64_t wallNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Sticks never press: the injected reports are the only results
+class IdleButton : public JoystickIO {
+public:
+  bool buttonDown() override { return false; }
+};
+
+// Same frame a JoystickGame sends, without the link header
+static uint8_t buildReport(GameFrame* frame, uint8_t id, uint32_t reactionUs) {
+  uint8_t us[4];
+  putU32(us, reactionUs);
+  frameBegin(frame, ID_HOST, id);
+  frameAddU16(frame, CMD_REACTION_DONE, (uint16_t)(reactionUs / 1000));
+  frameAdd(frame, CMD_REACTION_US, us, sizeof(us));
+  return frameFinish(frame);
+}
+
+// =============================================================================
+// MAIN
+// =============================================================================
+int main(int argc, char** argv) {
+  uint32_t rounds = (argc > 1) ? strtoul(argv[1], NULL, 0) : 2000;
+  logEnabled() = false;
+
+  VirtualClock clock;
+  SimNetwork net(&clock);
+  net.configure(1000, 0, 0, 1);
+
+  uint8_t hostMac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, ID_HOST};
+  SimTransport hostRadio(&net, hostMac);
+  HostEvents quiet;
+  HostGame host;
+  host.begin(&hostRadio, &clock, &quiet);
+
+  static SimTransport* radios[MAX_PLAYERS];
+  static JoystickGame sticks[MAX_PLAYERS];
+  IdleButton button;
+  for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+    uint8_t mac[6] = {0x02, 0x00, 0x00, 0x00, 0x01, (uint8_t)(i + 1)};
+    radios[i] = new SimTransport(&net, mac);
+    sticks[i].begin(radios[i], &clock, &button);
+  }
+
+  uint32_t rng = 1;
+  uint32_t played = 0;
+  uint32_t incomplete = 0;
+  uint64_t batchNs = 0;
+  uint64_t idleNs = 0;
+  uint64_t bestBatchNs = ~0ULL;
+  GameState lastState = host.getState();
+
+  while (played < rounds) {
+    net.runUntil(clock.nowUs64() + BENCH_TICK_US);
+    for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+      sticks[i].update();
+    }
+    host.update();
+
+    GameState state = host.getState();
+    if (state == lastState) continue;
+    lastState = state;
+    if (state != GAME_REACTION_ACTIVE) continue;
+
+    // One report per stick, random times so the ranking has work to do
+    GameFrame frames[MAX_PLAYERS];
+    uint8_t lens[MAX_PLAYERS];
+    for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+      rng ^= rng << 13;
+      rng ^= rng >> 17;
+      rng ^= rng << 5;
+      lens[i] = buildReport(&frames[i], sticks[i].getId(), 120000 + rng % 300000);
+    }
+
+    uint64_t t0 = wallNs();
+    host.update();
+    uint64_t t1 = wallNs();
+    for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+      host.onTransportReceive(radios[i]->mac(), frames[i].buf, lens[i]);
+    }
+    host.update();
+    uint64_t t2 = wallNs();
+
+    idleNs += t1 - t0;
+    batchNs += t2 - t1;
+    if (t2 - t1 < bestBatchNs) bestBatchNs = t2 - t1;
+
+    // Every player reported: the same update() must have ended the round
+    if (host.getState() != GAME_RESULTS) incomplete++;
+    lastState = host.getState();
+    played++;
+  }
+
+  double idle = (double)idleNs / played;
+  double perPacket = ((double)batchNs / played - idle) / MAX_PLAYERS;
+  double bestPerPacket = ((double)bestBatchNs - idle) / MAX_PLAYERS;
+
+  printf("Sticks: %d, rounds: %u, packets: %u\n", MAX_PLAYERS, played, played * MAX_PLAYERS);
+  printf("Idle update: %.1f ns\n", idle);
+  printf("Per packet: %.1f ns mean, %.1f ns best round\n", perPacket, bestPerPacket);
+  printf("Rounds not completed by the reports: %u\n", incomplete);
+
+  return incomplete ? 1 : 0;
+}
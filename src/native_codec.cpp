@@ -0,0 +1,272 @@
+/*
+ * native_codec.cpp - Sound Bank Decode Cost per Format
+ *
+ * Reads the sound bank the build step packed (data/sounds.bin, index in
+ * AudioDefs.h) and times, per second of audio, what BankPcmDecoder does
+ * for each transcoded clip, AUDIO_BLOCK_FRAMES frames per read():
+ *   pcm    copy out of the bank
+ *   adpcm  block decode (ImaAdpcm.h), then the same copy
+ * A bank built with --format pcm has each clip encoded to ADPCM here with
+ * adpcmEncodeBlock(), so both rows cover the same clips, and the ADPCM
+ * SNR against the PCM is printed. A bank built with --format adpcm is
+ * decoded as shipped (the Python encoder's output) and its PCM row uses
+ * the decoded samples. Checks that every clip holds its index's frame
+ * count; exits 1 otherwise.
+ *
+ * MP3 clips are not timed: the MP3 decoder is an ESP8266Audio library
+ * that only builds for the ESP32. The host logs the cost of all three
+ * formats on the device, file reads included (logStats(),
+ * AUDIO_DECODE_STATS); the timings here are this machine's.
+ *
+ * Usage: native_codec [--bank FILE] [--repeat N]
+ *   --bank    sound bank (default data/sounds.bin; build it first with
+ *             python scripts/copy_data.py host_test --format pcm)
+ *   --repeat  decodes of the clip set per timing (default 200)
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "AudioDefs.h"
+#include "AudioEngine.h"
+#include "ImaAdpcm.h"
+
+static_assert(SOUND_BANK_RATE == AUDIO_RATE, "sound bank transcoded for another AUDIO_RATE");
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define MIN_SNR_DB        20.0      // ADPCM of a pcm clip, whole clip
+
+typedef struct {
+  const SoundEntry* e;
+  const int16_t* pcm;               // Samples (pcm clip, or decoded adpcm)
+  const uint8_t* adpcm;             // Blocks (adpcm clip, or encoded here)
+  uint32_t adpcmBytes;
+  uint32_t frames;
+} Clip;
+
+// =============================================================================
+// HELPERS
+// =============================================================================
+static uint64_t wallNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint8_t* loadFile(const char* path, uint32_t* size) {
+  FILE* f = fopen(path, "rb");
+  if (!f) return nullptr;
+  fseek(f, 0, SEEK_END);
+  *size = (uint32_t)ftell(f);
+  fseek(f, 0, SEEK_SET);
+  uint8_t* data = (uint8_t*)malloc(*size ? *size : 1);
+  if (fread(data, 1, *size, f) != *size) {
+    free(data);
+    data = nullptr;
+  }
+  fclose(f);
+  return data;
+}
+
+static uint32_t adpcmBytesFor(uint32_t frames) {
+  uint32_t blocks = frames / ADPCM_BLOCK_FRAMES;
+  uint32_t rest = frames % ADPCM_BLOCK_FRAMES;
+  return blocks * ADPCM_BLOCK_BYTES + (rest ? ADPCM_HEADER_BYTES + rest / 2 : 0);
+}
+
+// =============================================================================
+// DECODE PATHS (BankPcmDecoder::read(), without the file)
+// =============================================================================
+// Returns a sum of the samples, so the reads are not optimized away
+static uint32_t readPcm(const Clip& c) {
+  int16_t out[AUDIO_BLOCK_FRAMES];
+  uint32_t sum = 0;
+  for (uint32_t pos = 0; pos < c.frames; pos += AUDIO_BLOCK_FRAMES) {
+    uint32_t n = c.frames - pos < AUDIO_BLOCK_FRAMES ? c.frames - pos : AUDIO_BLOCK_FRAMES;
+    memcpy(out, &c.pcm[pos], n * sizeof(int16_t));
+    sum += (uint16_t)out[n - 1];
+  }
+  return sum;
+}
+
+static uint32_t readAdpcm(const Clip& c, int16_t* all) {
+  int16_t out[AUDIO_BLOCK_FRAMES];
+  int16_t pcm[ADPCM_BLOCK_FRAMES];
+  uint32_t sum = 0, done = 0, have = 0, offset = 0, at = 0;
+  while (done < c.frames) {
+    uint32_t n = c.frames - done < AUDIO_BLOCK_FRAMES ? c.frames - done : AUDIO_BLOCK_FRAMES;
+    uint32_t got = 0;
+    while (got < n) {
+      if (offset == have) {
+        uint32_t bytes = c.adpcmBytes - at < ADPCM_BLOCK_BYTES ? c.adpcmBytes - at : ADPCM_BLOCK_BYTES;
+        have = adpcmDecodeBlock(&c.adpcm[at], bytes, pcm);
+        at += bytes;
+        offset = 0;
+        if (!have) return sum;
+      }
+      uint32_t k = have - offset < n - got ? have - offset : n - got;
+      memcpy(&out[got], &pcm[offset], k * sizeof(int16_t));
+      offset += k;
+      got += k;
+    }
+    if (all) memcpy(&all[done], out, n * sizeof(int16_t));
+    sum += (uint16_t)out[n - 1];
+    done += n;
+  }
+  return sum;
+}
+
+static uint8_t* encode(const int16_t* pcm, uint32_t frames, uint32_t* bytes) {
+  uint8_t* out = (uint8_t*)malloc(adpcmBytesFor(frames) + 1);
+  int8_t index = 0;
+  *bytes = 0;
+  for (uint32_t pos = 0; pos < frames; pos += ADPCM_BLOCK_FRAMES) {
+    uint32_t n = frames - pos < ADPCM_BLOCK_FRAMES ? frames - pos : ADPCM_BLOCK_FRAMES;
+    *bytes += adpcmEncodeBlock(&pcm[pos], n, &index, &out[*bytes]);
+  }
+  return out;
+}
+
+static double snrDb(const int16_t* ref, const int16_t* test, uint32_t frames) {
+  double signal = 0, noise = 0;
+  for (uint32_t i = 0; i < frames; i++) {
+    double d = (double)ref[i] - test[i];
+    signal += (double)ref[i] * ref[i];
+    noise += d * d;
+  }
+  return noise > 0 ? 10.0 * log10(signal / noise) : 99.0;
+}
+
+// =============================================================================
+// MAIN
+// =============================================================================
+int main(int argc, char** argv) {
+  const char* path = "data/sounds.bin";
+  uint32_t repeat = 200;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--bank") && i + 1 < argc) path = argv[++i];
+    else if (!strcmp(argv[i], "--repeat") && i + 1 < argc) repeat = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: %s [--bank FILE] [--repeat N]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (!repeat) repeat = 1;
+
+  uint32_t size;
+  uint8_t* bank = loadFile(path, &size);
+  if (!bank) {
+    fprintf(stderr, "%s: cannot read (python scripts/copy_data.py host_test --format pcm)\n", path);
+    return 2;
+  }
+  if (size != SOUND_BANK_SIZE) {
+    fprintf(stderr, "%s: %u bytes, AudioDefs.h indexes %u: rebuild with the same bank\n", path,
+            size, (unsigned)SOUND_BANK_SIZE);
+    return 2;
+  }
+
+  printf("Sound Bank Decode Cost\n");
+  printf("======================\n");
+  printf("%s, %u clips at %u Hz, %u frames per read()\n\n", path, NUM_SOUNDS, AUDIO_RATE,
+         AUDIO_BLOCK_FRAMES);
+
+  Clip clips[NUM_SOUNDS];
+  uint8_t count = 0, mp3s = 0;
+  uint32_t mp3Bytes = 0;
+  bool ok = true;
+  double worstSnr = 99.0;
+  printf("%-14s %-6s %8s %9s %9s %8s\n", "clip", "format", "frames", "pcm B", "adpcm B", "SNR dB");
+  for (uint8_t s = 0; s < NUM_SOUNDS; s++) {
+    const SoundEntry* e = &SOUND_BANK[s];
+    if (e->format == SND_FMT_MP3) {
+      mp3s++;
+      mp3Bytes += e->length;
+      continue;
+    }
+    Clip* c = &clips[count++];
+    c->e = e;
+    c->frames = e->frames;
+    const uint8_t* data = bank + e->offset;
+    if (e->format == SND_FMT_PCM) {
+      if (e->length != e->frames * sizeof(int16_t)) {
+        printf("FAIL: %s holds %u bytes for %u frames\n", e->name, e->length, e->frames);
+        ok = false;
+        count--;
+        continue;
+      }
+      c->pcm = (const int16_t*)data;
+      c->adpcm = encode(c->pcm, c->frames, &c->adpcmBytes);
+      int16_t* back = (int16_t*)malloc(c->frames * sizeof(int16_t) + 1);
+      readAdpcm(*c, back);
+      double snr = snrDb(c->pcm, back, c->frames);
+      if (snr < worstSnr) worstSnr = snr;
+      free(back);
+      printf("%-14s %-6s %8u %9u %9u %8.1f\n", e->name, "pcm", c->frames, e->length,
+             c->adpcmBytes, snr);
+    } else {
+      c->adpcm = data;
+      c->adpcmBytes = e->length;
+      int16_t* pcm = (int16_t*)calloc(c->frames + 1, sizeof(int16_t));
+      uint32_t got = 0;
+      for (uint32_t at = 0; at < e->length; at += ADPCM_BLOCK_BYTES) {
+        uint32_t bytes = e->length - at < ADPCM_BLOCK_BYTES ? e->length - at : ADPCM_BLOCK_BYTES;
+        got += adpcmBlockFrames(bytes);
+      }
+      // Last nibble of an even-length clip is padding: frames is the count
+      if (got != c->frames && got != c->frames + 1) {
+        printf("FAIL: %s decodes to %u frames, index says %u\n", e->name, got, c->frames);
+        ok = false;
+      }
+      readAdpcm(*c, pcm);
+      c->pcm = pcm;
+      printf("%-14s %-6s %8u %9u %9u %8s\n", e->name, "adpcm", c->frames,
+             (unsigned)(c->frames * sizeof(int16_t)), e->length, "-");
+    }
+  }
+  if (mp3s) printf("%-14s %-6s %8s %9u\n", "(others)", "mp3", "-", mp3Bytes);
+
+  if (!count) {
+    printf("\nNo pcm or adpcm clips: build the bank with --format pcm (or adpcm)\n");
+    return ok ? 2 : 1;
+  }
+
+  uint64_t frames = 0;
+  uint32_t pcmBytes = 0, adpcmBytes = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    frames += clips[i].frames;
+    pcmBytes += clips[i].frames * sizeof(int16_t);
+    adpcmBytes += clips[i].adpcmBytes;
+  }
+  double audioS = (double)frames / AUDIO_RATE;
+
+  // Timings, clip set repeated
+  volatile uint32_t sink = 0;
+  uint64_t t0 = wallNs();
+  for (uint32_t r = 0; r < repeat; r++) {
+    for (uint8_t i = 0; i < count; i++) sink += readPcm(clips[i]);
+  }
+  uint64_t pcmNs = wallNs() - t0;
+  t0 = wallNs();
+  for (uint32_t r = 0; r < repeat; r++) {
+    for (uint8_t i = 0; i < count; i++) sink += readAdpcm(clips[i], nullptr);
+  }
+  uint64_t adpcmNs = wallNs() - t0;
+
+  double pcmPerS = pcmNs / (audioS * repeat);
+  double adpcmPerS = adpcmNs / (audioS * repeat);
+  printf("\n%u clips, %.2f s of audio, each decoded %u times\n", count, audioS, repeat);
+  printf("%-6s %10s %12s %10s\n", "format", "bank B", "ns/s audio", "x realtime");
+  printf("%-6s %10u %12.0f %10.0f\n", "pcm", pcmBytes, pcmPerS, 1e9 / pcmPerS);
+  printf("%-6s %10u %12.0f %10.0f\n", "adpcm", adpcmBytes, adpcmPerS, 1e9 / adpcmPerS);
+  printf("%-6s %10s %12s %10s   (ESP32 only: AUDIO_DECODE_STATS)\n", "mp3", "-", "-", "-");
+  if (worstSnr < 99.0) {
+    printf("\nADPCM of the pcm clips: worst SNR %.1f dB (min %.0f)\n", worstSnr, MIN_SNR_DB);
+    if (worstSnr < MIN_SNR_DB) ok = false;
+  }
+  printf("\n%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+/*
+ * native_crc8.cpp - CRC8 Engine Check and Benchmark
+ *
+ * The nibble and table engines (Crc8.h) against the bitwise reference:
+ * every single byte value from every starting register, then random
+ * packets of the lengths the link sends (a bare ACK up to a full
+ * ESP-NOW frame). Each engine is then timed per packet at each length.
+ *
+ * Usage: native_crc8 [packets]   (default 200000 per length)
+ * Exits 1 if any engine disagrees with the bitwise one
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "Crc8.h"
+
+#define CRC_MAX_LEN       250     // ESP-NOW payload limit
+#define CRC_RANDOM_RUNS   2000    // Random packets checked per length
+
+typedef uint8_t (*Crc8Fn)(const uint8_t*, uint8_t);
+
+typedef struct {
+  const char* name;
+  Crc8Fn fn;
+} Crc8Engine;
+
+static const Crc8Engine ENGINES[] = {
+  { "bitwise", crc8Bitwise },
+  { "nibble",  crc8Nibble },
+  { "table",   crc8Table },
+};
+#define NUM_ENGINES (sizeof(ENGINES) / sizeof(ENGINES[0]))
+
+// Bare ACK, stick report, sync, game frame, largest frames
+static const uint8_t LENGTHS[] = { 1, 4, 8, 12, 16, 32, 64, 128, CRC_MAX_LEN };
+#define NUM_LENGTHS (sizeof(LENGTHS) / sizeof(LENGTHS[0]))
+
+// =============================================================================
+// HELPERS
+// =============================================================================
+static uint64_t wallNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t rng = 1;
+
+static uint8_t nextByte() {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return (uint8_t)rng;
+}
+
+// =============================================================================
+// CHECKS
+// =============================================================================
+// Every (register, byte) pair: the register is reached by prefixing the
+// byte that shifts to it, so the engines run from every starting state
+static uint32_t checkAllBytes() {
+  uint32_t failures = 0;
+  uint8_t prefix[256];
+  for (int b = 0; b < 256; b++) {
+    uint8_t one = (uint8_t)b;
+    prefix[crc8Bitwise(&one, 1)] = one;
+  }
+  for (int reg = 0; reg < 256; reg++) {
+    for (int b = 0; b < 256; b++) {
+      uint8_t pair[2] = { prefix[reg], (uint8_t)b };
+      uint8_t want = crc8Bitwise(pair, 2);
+      for (uint8_t e = 1; e < NUM_ENGINES; e++) {
+        uint8_t got = ENGINES[e].fn(pair, 2);
+        if (got != want) {
+          if (failures < 10) {
+            printf("FAIL %s reg 0x%02X byte 0x%02X: 0x%02X, bitwise 0x%02X\n",
+                   ENGINES[e].name, reg, b, got, want);
+          }
+          failures++;
+        }
+      }
+    }
+  }
+  return failures;
+}
+
+static uint32_t checkPackets() {
+  uint32_t failures = 0;
+  uint8_t buf[CRC_MAX_LEN];
+  for (uint8_t l = 0; l < NUM_LENGTHS; l++) {
+    for (uint32_t run = 0; run < CRC_RANDOM_RUNS; run++) {
+      for (uint8_t i = 0; i < LENGTHS[l]; i++) buf[i] = nextByte();
+      uint8_t want = crc8Bitwise(buf, LENGTHS[l]);
+      for (uint8_t e = 1; e < NUM_ENGINES; e++) {
+        uint8_t got = ENGINES[e].fn(buf, LENGTHS[l]);
+        if (got != want) {
+          if (failures < 10) {
+            printf("FAIL %s %u-byte packet: 0x%02X, bitwise 0x%02X\n",
+                   ENGINES[e].name, LENGTHS[l], got, want);
+          }
+          failures++;
+        }
+      }
+    }
+  }
+  return failures;
+}
+
+// =============================================================================
+// MAIN
+// =============================================================================
+int main(int argc, char** argv) {
+  uint32_t packets = (argc > 1) ? strtoul(argv[1], NULL, 0) : 200000;
+  if (!packets) packets = 1;
+
+  uint32_t failures = checkAllBytes();
+  printf("Single bytes (256 registers x 256 values): %s\n", failures ? "FAIL" : "ok");
+  uint32_t packetFailures = checkPackets();
+  printf("Packets (%u lengths x %u): %s\n", (unsigned)NUM_LENGTHS, CRC_RANDOM_RUNS,
+         packetFailures ? "FAIL" : "ok");
+  failures += packetFailures;
+
+  // Same packets for every engine; the sum keeps the calls alive
+  static uint8_t bufs[16][CRC_MAX_LEN];
+  for (uint8_t p = 0; p < 16; p++) {
+    for (uint16_t i = 0; i < CRC_MAX_LEN; i++) bufs[p][i] = nextByte();
+  }
+
+  printf("\nns/packet  %-8s", "bytes");
+  for (uint8_t e = 0; e < NUM_ENGINES; e++) printf(" %9s", ENGINES[e].name);
+  printf("\n");
+  volatile uint32_t sink = 0;
+  for (uint8_t l = 0; l < NUM_LENGTHS; l++) {
+    printf("           %-8u", LENGTHS[l]);
+    for (uint8_t e = 0; e < NUM_ENGINES; e++) {
+      Crc8Fn fn = ENGINES[e].fn;
+      uint32_t sum = 0;
+      uint64_t t0 = wallNs();
+      for (uint32_t n = 0; n < packets; n++) {
+        sum += fn(bufs[n & 15], LENGTHS[l]);
+      }
+      uint64_t t1 = wallNs();
+      sink += sum;
+      printf(" %9.1f", (double)(t1 - t0) / packets);
+    }
+    printf("\n");
+  }
+  (void)sink;
+
+  printf("\nEngine mismatches: %u\n", failures);
+  return failures ? 1 : 0;
+}
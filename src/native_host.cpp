@@ -0,0 +1,95 @@
+/*
+ * native_host.cpp - Host Game Logic as a Linux Process
+ *
+ * Runs HostGame.h over UDP multicast (UdpTransport.h) so rounds can be
+ * played against native_joystick processes on a workstation. Audio and LED
+ * outputs are printed; every round also prints the traffic it took.
+ * Sticks join by themselves; with a pairing file their IDs survive a host
+ * restart, like the NVS table on the ESP32.
+ *
+ * Usage: native_host [pairing_file]
+ *   (pio run -e native_host, then .pio/build/native_host/program)
+ */
+
+#include <stdio.h>
+#include "Platform.h"
+#include "UdpTransport.h"
+#include "Pairing.h"
+#include "HostGame.h"
+#include "NumberSpeech.h"
+
+// =============================================================================
+// GAME OUTPUTS (printed)
+// =============================================================================
+class NativeOutputs : public HostEvents {
+public:
+  void onIdle() override { printf("[AUDIO] get ready\n"); }
+  void onCountdown(uint8_t num) override { printf("[AUDIO] %d\n", num); }
+  void onGo() override { printf("[AUDIO] beep\n"); }
+  void onPlayerFinished(uint8_t playerIdx, uint16_t timeMs) override {
+    printf("[LED] ring %d %s\n", playerIdx, (timeMs == TIME_PENALTY) ? "red" : "green");
+  }
+  void onWinner(uint8_t playerIdx, uint16_t timeMs) override {
+    SpeechPhrase phrase;
+    phrase.player(playerIdx + 1);
+    phrase.number(timeMs);
+    phrase.add(WORD_MILLISECONDS);
+    char text[96];
+    phrase.text(text, sizeof(text));
+    printf("[AUDIO] %s, fanfare\n", text);
+  }
+};
+
+// =============================================================================
+// MAIN
+// =============================================================================
+int main(int argc, char** argv) {
+  setvbuf(stdout, NULL, _IOLBF, 0);
+  printf("\n=== HOST (native) ===\n");
+
+  uint8_t mac[6];
+  udpNodeMac(ID_HOST, mac);
+  UdpTransport radio(mac);
+  SystemClock sysClock;
+  NativeOutputs outputs;
+  HostGame game;
+
+  MemoryPairingStore memoryStore;
+  FilePairingStore fileStore((argc > 1) ? argv[1] : "");
+  PairingStore* store = (argc > 1) ? (PairingStore*)&fileStore : &memoryStore;
+
+  if (!game.begin(&radio, &sysClock, &outputs, store)) {
+    perror("UDP transport");
+    return 1;
+  }
+  printf("Host ready!\n");
+
+  // Traffic per round (IDLE to RESULTS)
+  GameState lastState = game.getState();
+  UdpStats roundStart = radio.getStats();
+  uint32_t roundStartMs = sysClock.millis();
+
+  while (true) {
+    radio.poll();
+    game.update();
+
+    GameState state = game.getState();
+    if (state != lastState && state == GAME_RESULTS) {
+      const UdpStats& now = radio.getStats();
+      uint32_t ms = sysClock.millis() - roundStartMs;
+      uint32_t rx = now.rxFrames - roundStart.rxFrames;
+      uint32_t tx = now.txFrames - roundStart.txFrames;
+      printf("Round traffic: %u ms, rx %u frames (%u B), tx %u frames (%u B), %.1f frames/s\n",
+             ms, rx, now.rxBytes - roundStart.rxBytes, tx, now.txBytes - roundStart.txBytes,
+             ms ? (rx + tx) * 1000.0 / ms : 0.0);
+      game.logTelemetry();
+    }
+    if (state != lastState && state == GAME_IDLE) {
+      roundStart = radio.getStats();
+      roundStartMs = sysClock.millis();
+    }
+    lastState = state;
+
+    radio.wait(1);
+  }
+}
@@ -0,0 +1,301 @@
+/*
+ * native_input.cpp - Button Edge Replay
+ *
+ * Synthetic edge sequences (microsecond stamps, as the ISR records them)
+ * replayed two ways:
+ * - Capture: straight into InputCapture, polled like the stick's loop
+ *   (every --poll-us, or not at all until the end for a stalled loop).
+ *   Bounce trains on press and release, presses closer than the debounce
+ *   time, the micros() wrap and a ring overflow; the debounced press
+ *   times must match exactly.
+ * - Game: into a JoystickGame on a virtual clock around a GO, immediate or
+ *   scheduled and processed late. Presses after GO must be scored from
+ *   their first edge to the GO instant; a press from before GO is early.
+ *
+ * Usage: native_input [--poll-us 1000]
+ * Exits 1 if any press time or result differs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Platform.h"
+#include "Transport.h"
+#include "InputCapture.h"
+#include "JoystickGame.h"
+
+#define INPUT_MAX_EDGES   24
+#define INPUT_MAX_PRESSES 4
+#define INPUT_TAIL_US     20000   // Keep polling after the last edge
+#define INPUT_BASE_US     5000000
+
+typedef struct {
+  int32_t us;           // Relative to the case's base
+  uint8_t level;        // 0 = pressed
+} SynthEdge;
+
+// =============================================================================
+// CAPTURE CASES
+// =============================================================================
+typedef struct {
+  const char* name;
+  uint32_t baseUs;
+  bool stalled;         // No poll until every edge is in the ring
+  uint8_t edgeCount;
+  SynthEdge edges[INPUT_MAX_EDGES];
+  uint8_t pressCount;
+  int32_t presses[INPUT_MAX_PRESSES];
+  uint32_t overflows;
+} CaptureCase;
+
+static const CaptureCase CAPTURE_CASES[] = {
+  { "clean", INPUT_BASE_US, false,
+    2, { {1000, 0}, {81000, 1} },
+    1, { 1000 }, 0 },
+  { "press bounce", INPUT_BASE_US, false,
+    6, { {1000, 0}, {1040, 1}, {1090, 0}, {1300, 1}, {1310, 0}, {81000, 1} },
+    1, { 1000 }, 0 },
+  { "release bounce", INPUT_BASE_US, false,
+    6, { {1000, 0}, {81000, 1}, {81200, 0}, {81500, 1}, {82100, 0}, {82300, 1} },
+    1, { 1000 }, 0 },
+  { "two presses", INPUT_BASE_US, false,
+    6, { {1000, 0}, {81000, 1}, {90000, 0}, {90150, 1}, {90200, 0}, {170000, 1} },
+    2, { 1000, 90000 }, 0 },
+  { "re-press in debounce", INPUT_BASE_US, false,
+    4, { {1000, 0}, {81000, 1}, {84000, 0}, {160000, 1} },
+    1, { 1000 }, 0 },
+  { "micros() wrap", 0xFFFFFC18, false,
+    6, { {0, 0}, {500, 1}, {700, 0}, {80000, 1}, {100000, 0}, {180000, 1} },
+    2, { 0, 100000 }, 0 },
+  { "stalled loop", INPUT_BASE_US, true,
+    10, { {1000, 0}, {1050, 1}, {1100, 0}, {60000, 1}, {60100, 0}, {60200, 1},
+          {70000, 0}, {70030, 1}, {70060, 0}, {150000, 1} },
+    2, { 1000, 70000 }, 0 },
+  { "ring overflow", INPUT_BASE_US, true,
+    20, { {1000, 0}, {1100, 1}, {1200, 0}, {1300, 1}, {1400, 0}, {1500, 1},
+          {1600, 0}, {1700, 1}, {1800, 0}, {1900, 1}, {2000, 0}, {2100, 1},
+          {2200, 0}, {2300, 1}, {2400, 0}, {2500, 1}, {2600, 0}, {2700, 1},
+          {2800, 0}, {2900, 1} },
+    1, { 1000 }, 20 - (CAPTURE_QUEUE_SIZE - 1) },
+};
+#define NUM_CAPTURE_CASES (sizeof(CAPTURE_CASES) / sizeof(CAPTURE_CASES[0]))
+
+static bool runCaptureCase(const CaptureCase* c, uint32_t pollUs) {
+  InputCapture capture;
+  uint32_t got[INPUT_MAX_PRESSES];
+  uint8_t gotCount = 0;
+  uint8_t fed = 0;
+  bool ok = true;
+
+  // Absolute stamps wrap like micros(); the loop runs on relative time
+  int32_t endRel = c->edges[c->edgeCount - 1].us + INPUT_TAIL_US;
+  int32_t rel = c->stalled ? endRel : c->edges[0].us;
+  while (true) {
+    while (fed < c->edgeCount && c->edges[fed].us <= rel) {
+      capture.onEdge(c->baseUs + (uint32_t)c->edges[fed].us, c->edges[fed].level);
+      fed++;
+    }
+    uint32_t pressUs;
+    while (capture.nextPress(&pressUs, c->baseUs + (uint32_t)rel)) {
+      if (gotCount < INPUT_MAX_PRESSES) got[gotCount] = pressUs;
+      gotCount++;
+    }
+    if (rel >= endRel) break;
+    rel += pollUs;
+  }
+
+  if (gotCount != c->pressCount) ok = false;
+  for (uint8_t i = 0; ok && i < gotCount; i++) {
+    if (got[i] != c->baseUs + (uint32_t)c->presses[i]) ok = false;
+  }
+  if (capture.overflowCount() != c->overflows) ok = false;
+  // Every case ends released, unless the release was one of the lost edges
+  if (!c->overflows && capture.isPressed()) ok = false;
+
+  printf("%-22s %u press(es):", c->name, gotCount);
+  for (uint8_t i = 0; i < gotCount && i < INPUT_MAX_PRESSES; i++) {
+    printf(" %+d", (int32_t)(got[i] - c->baseUs));
+  }
+  printf(", %u overflow(s)%s\n", capture.overflowCount(), ok ? "" : "  FAIL");
+  return ok;
+}
+
+// =============================================================================
+// GAME CASES
+// =============================================================================
+// Press times relative to the GO instant
+typedef struct {
+  const char* name;
+  bool scheduled;       // CMD_FIRE_AT GO (else GO acts on arrival)
+  int32_t deliverUs;    // GO frame arrival
+  uint8_t edgeCount;
+  SynthEdge edges[INPUT_MAX_EDGES];
+  uint32_t reactionUs;  // Expected report, TIME_PENALTY * 1000 = early
+} GameCase;
+
+#define INPUT_EARLY       ((uint32_t)TIME_PENALTY * 1000)
+
+static const GameCase GAME_CASES[] = {
+  { "press after GO", false, 0,
+    6, { {234567, 0}, {234600, 1}, {234640, 0}, {234900, 1}, {235000, 0}, {320000, 1} },
+    234567 },
+  { "held at GO", false, 0,
+    2, { {-50000, 0}, {60000, 1} },
+    INPUT_EARLY },
+  { "bouncing at GO", false, 0,
+    6, { {-300, 0}, {-200, 1}, {100, 0}, {400, 1}, {700, 0}, {80000, 1} },
+    INPUT_EARLY },
+  { "tap before GO", false, 0,
+    4, { {-80000, 0}, {-20000, 1}, {300000, 0}, {380000, 1} },
+    300000 },
+  { "late GO, released", true, 30000,
+    2, { {5000, 0}, {25000, 1} },
+    5000 },
+  { "late GO, held", true, 30000,
+    4, { {5000, 0}, {5100, 1}, {5150, 0}, {90000, 1} },
+    5000 },
+  { "scheduled GO, early", true, 30000,
+    2, { {-2000, 0}, {90000, 1} },
+    INPUT_EARLY },
+};
+#define NUM_GAME_CASES (sizeof(GAME_CASES) / sizeof(GAME_CASES[0]))
+
+// Keeps the first reaction report the stick sends
+class ReportTransport : public Transport {
+public:
+  ReportTransport() : reported(false), reactionUs(0) {}
+
+  bool begin(TransportHandler* h) override { return true; }
+  bool addPeer(const uint8_t* mac) override { return true; }
+  bool removePeer(const uint8_t* mac) override { return true; }
+  void macAddress(uint8_t* mac) override { memset(mac, 0x02, 6); }
+
+  bool send(const uint8_t* mac, const uint8_t* data, uint8_t len) override {
+    FrameReader reader;
+    FrameRecord rec;
+    if (reported || !frameOpen(&reader, data, len)) return true;
+    while (frameNext(&reader, &rec)) {
+      if (rec.cmd == CMD_REACTION_US && rec.len >= 4) {
+        reactionUs = recordU32(&rec);
+        reported = true;
+      } else if (rec.cmd == CMD_REACTION_DONE && recordU16(&rec) == TIME_PENALTY) {
+        reactionUs = INPUT_EARLY;
+        reported = true;
+      }
+    }
+    return true;
+  }
+
+  bool reported;
+  uint32_t reactionUs;
+};
+
+class ReplayButton : public JoystickIO {
+public:
+  ReplayButton() : down(false) {}
+  bool buttonDown() override { return down; }
+  bool down;
+};
+
+static const uint8_t HOST_MAC[6] = {0x02, 0x00, 0x00, 0x00, 0x00, ID_HOST};
+
+static void deliver(JoystickGame* game, GameFrame* frame) {
+  uint8_t len = frameFinish(frame);
+  game->onTransportReceive(HOST_MAC, frame->buf, len);
+}
+
+static bool runGameCase(const GameCase* c, uint32_t pollUs) {
+  VirtualClock clock(INPUT_BASE_US);
+  ReportTransport radio;
+  ReplayButton button;
+  JoystickGame game;
+  game.begin(&radio, &clock, &button);
+
+  GameFrame frame;
+  frameBegin(&frame, ID_NEW, ID_HOST);
+  frameAddU16(&frame, CMD_OK, ID_STICK1);
+  deliver(&game, &frame);
+
+  // Host and stick clocks equal: a zero-offset estimate from one exchange
+  SyncEstimator est;
+  uint32_t t1 = clock.micros();
+  est.addSample(t1, t1 + 1000, t1 + 1000, t1 + 2000);
+  frameBegin(&frame, ID_STICK1, ID_HOST);
+  frameAddSyncRequest(&frame, t1, &est);
+  deliver(&game, &frame);
+
+  // GO one second in, with the earliest edge still ahead of the clock
+  uint32_t goUs = clock.micros() + 1000000;
+  int32_t startRel = c->edges[0].us < 0 ? c->edges[0].us - 1000 : -1000;
+  int32_t endRel = c->edges[c->edgeCount - 1].us + INPUT_TAIL_US;
+  if (endRel < c->deliverUs + INPUT_TAIL_US) endRel = c->deliverUs + INPUT_TAIL_US;
+
+  // The ISR: edges at their own instants, the level follows the last one
+  uint8_t fed = 0;
+  auto feed = [&](int32_t rel) {
+    clock.setUs(INPUT_BASE_US + 1000000 + rel);
+    while (fed < c->edgeCount && c->edges[fed].us <= rel) {
+      game.onButtonEdge(goUs + (uint32_t)c->edges[fed].us, c->edges[fed].level);
+      button.down = (c->edges[fed].level == 0);
+      fed++;
+    }
+  };
+
+  bool goSent = false;
+  for (int32_t rel = startRel; rel <= endRel && !radio.reported; rel += pollUs) {
+    // The GO frame arrives at its own instant, between two loop passes
+    if (!goSent && rel >= c->deliverUs) {
+      feed(c->deliverUs);
+      frameBegin(&frame, ID_STICK1, ID_HOST);
+      if (c->scheduled) frameAddFireAt(&frame, goUs);
+      frameAddU16(&frame, CMD_VIBRATE, VIBRATE_GO);
+      deliver(&game, &frame);
+      goSent = true;
+    }
+    feed(rel);
+    game.update();
+  }
+
+  bool ok = radio.reported && radio.reactionUs == c->reactionUs;
+  printf("%-22s ", c->name);
+  if (!radio.reported) printf("no report");
+  else if (radio.reactionUs == INPUT_EARLY) printf("early");
+  else printf("%u us", radio.reactionUs);
+  if (!ok) {
+    if (c->reactionUs == INPUT_EARLY) printf(", expected early  FAIL");
+    else printf(", expected %u us  FAIL", c->reactionUs);
+  }
+  printf("\n");
+  return ok;
+}
+
+// =============================================================================
+// MAIN
+// =============================================================================
+int main(int argc, char** argv) {
+  uint32_t pollUs = 1000;
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* val = (i + 1 < argc) ? argv[i + 1] : "0";
+    if (!strcmp(arg, "--poll-us")) { pollUs = strtoul(val, NULL, 0); i++; }
+    else {
+      fprintf(stderr, "Unknown option %s\n", arg);
+      return 2;
+    }
+  }
+  if (!pollUs) pollUs = 1;
+  logEnabled() = false;
+
+  uint32_t failures = 0;
+  printf("Capture (poll every %u us):\n", pollUs);
+  for (uint8_t i = 0; i < NUM_CAPTURE_CASES; i++) {
+    if (!runCaptureCase(&CAPTURE_CASES[i], pollUs)) failures++;
+  }
+  printf("\nGame (reaction to the GO instant):\n");
+  for (uint8_t i = 0; i < NUM_GAME_CASES; i++) {
+    if (!runGameCase(&GAME_CASES[i], pollUs)) failures++;
+  }
+
+  printf("\n%s\n", failures ? "FAIL" : "OK");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * native_joystick.cpp - Simulated Joysticks as a Linux Process
+ *
+ * Runs one or more JoystickGame.h instances over UDP multicast
+ * (UdpTransport.h), each with its own simulated MAC; each joins the host
+ * and is assigned its ID there. A simulated player
+ * presses the button a random 150-350 ms (or the given reaction time)
+ * after the local GO instant; presses are fed in as timestamped edges,
+ * exactly like the GPIO interrupt does on the ESP8266.
+ *
+ * Usage: native_joystick [count] [reaction_ms] [first_mac]
+ *   native_joystick 2       -> two sticks, random reactions
+ *   native_joystick 1 0 3   -> one more stick, MAC ..:01:03 (a restarted
+ *                              stick keeps its MAC, so it gets its old ID)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <poll.h>
+#include "Platform.h"
+#include "UdpTransport.h"
+#include "JoystickGame.h"
+
+#define SIM_MAX_STICKS    16
+#define SIM_PRESS_US      80000   // Button held down
+
+// =============================================================================
+// SIMULATED PLAYER
+// =============================================================================
+class SimPlayer : public JoystickIO {
+public:
+  SimPlayer() : game(nullptr), reactionMs(0), pressPending(false), releasePending(false), pressUs(0) {}
+
+  bool buttonDown() override { return false; }
+
+  void onGo(uint32_t goUs) override {
+    uint32_t ms = reactionMs ? reactionMs : 150 + rand() % 200;
+    pressUs = goUs + ms * 1000;
+    pressPending = true;
+  }
+
+  // Edges at their exact instants, once the clock passes them
+  void update(uint32_t nowUs) {
+    if (pressPending && (int32_t)(nowUs - pressUs) >= 0) {
+      game->onButtonEdge(pressUs, 0);
+      pressPending = false;
+      releasePending = true;
+    }
+    if (releasePending && (int32_t)(nowUs - pressUs) >= SIM_PRESS_US) {
+      game->onButtonEdge(pressUs + SIM_PRESS_US, 1);
+      releasePending = false;
+    }
+  }
+
+  JoystickGame* game;
+  uint32_t reactionMs;
+
+private:
+  bool pressPending;
+  bool releasePending;
+  uint32_t pressUs;
+};
+
+// =============================================================================
+// MAIN
+// =============================================================================
+int main(int argc, char** argv) {
+  setvbuf(stdout, NULL, _IOLBF, 0);
+
+  int count = (argc > 1) ? atoi(argv[1]) : 1;
+  uint32_t reactionMs = (argc > 2) ? (uint32_t)atoi(argv[2]) : 0;
+  int firstMac = (argc > 3) ? atoi(argv[3]) : 1;
+  if (count < 1 || count > SIM_MAX_STICKS) {
+    fprintf(stderr, "count must be 1..%d\n", SIM_MAX_STICKS);
+    return 1;
+  }
+  srand(getpid());
+
+  SystemClock sysClock;
+  static UdpTransport* radios[SIM_MAX_STICKS];
+  static JoystickGame games[SIM_MAX_STICKS];
+  static SimPlayer players[SIM_MAX_STICKS];
+
+  for (int i = 0; i < count; i++) {
+    uint8_t mac[6];
+    udpNodeMac((uint8_t)(firstMac + i), mac);
+    mac[4] = 0x01;  // Stick MACs: 02:00:00:00:01:xx
+    radios[i] = new UdpTransport(mac);
+    players[i].game = &games[i];
+    players[i].reactionMs = reactionMs;
+    if (!games[i].begin(radios[i], &sysClock, &players[i])) {
+      perror("UDP transport");
+      return 1;
+    }
+    printf("Joystick %d ready, MAC %02X:%02X:%02X:%02X:%02X:%02X\n",
+           i + 1, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+  }
+
+  // Sleep until any stick's socket has data (or 1 ms for timers)
+  struct pollfd fds[SIM_MAX_STICKS];
+  for (int i = 0; i < count; i++) {
+    fds[i].fd = radios[i]->fd();
+    fds[i].events = POLLIN;
+  }
+
+  while (true) {
+    for (int i = 0; i < count; i++) {
+      radios[i]->poll();
+      players[i].update(sysClock.micros());
+      games[i].update();
+    }
+    poll(fds, count, 1);
+  }
+}
@@ -0,0 +1,302 @@
+/*
+ * native_leds.cpp - LED Scene Renderer and Benchmark
+ *
+ * Runs the host's ring scenes (HostLeds.h) on a virtual timeline and
+ * writes each one as a PPM strip: one row per frame, one column per LED,
+ * top to bottom in time. The images and the printed frame hashes are the
+ * reference for visual regression checks: at the default --frame-ms each
+ * hash is compared with the one committed in scenes[], so a change to an
+ * effect fails the run until the images are checked and the reference
+ * updated. Then times render() per frame, and plays one round
+ * with a 1 ms loop to count how many frames HostLeds::draw() renders and
+ * how many differ from the last one sent, against rendering and sending
+ * every pass.
+ *
+ * Usage: native_leds [--out DIR] [--frame-ms MS] [--scale N] [--frames N]
+ *   --out       directory for the .ppm files (default: current)
+ *   --frame-ms  timeline step between rows (default 10)
+ *   --scale     pixels per LED and row in the images (default 4)
+ *   --frames    frames rendered for the benchmark (default 200000)
+ * Exits 1 if a scene's hash differs from its reference
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "GameTypes.h"
+#include "Roster.h"
+#include "HostLeds.h"
+
+// =============================================================================
+// SCENES
+// =============================================================================
+// What the game does to the LEDs during one scene
+typedef struct {
+  uint32_t atMs;
+  int8_t player;          // -1: mode change
+  bool penalty;
+  NeoMode mode;
+} SceneEvent;
+
+typedef struct {
+  const char* name;
+  uint32_t durationMs;
+  const SceneEvent* events;
+  uint8_t eventCount;
+  uint32_t refHash;       // runScene() at LEDS_REF_FRAME_MS
+} Scene;
+
+static const SceneEvent idleEvents[] = {
+  { 0, -1, false, NEO_IDLE_RAINBOW },
+};
+static const SceneEvent countdownEvents[] = {
+  { 0, -1, false, NEO_COUNTDOWN },
+};
+static const SceneEvent goEvents[] = {
+  { 0,   -1, false, NEO_FIXED_COLOR },
+  { 234,  0, false, NEO_FIXED_COLOR },
+  { 456,  1, true,  NEO_FIXED_COLOR },
+  { 610,  3, false, NEO_FIXED_COLOR },
+};
+static const SceneEvent resultsEvents[] = {
+  { 0, -1, false, NEO_STATUS },
+};
+static const SceneEvent offEvents[] = {
+  { 0, -1, false, NEO_IDLE_RAINBOW },
+  { 200, -1, false, NEO_OFF },
+};
+
+// A whole round as the host runs it
+static const SceneEvent roundEvents[] = {
+  { 0,     -1, false, NEO_IDLE_RAINBOW },
+  { 3000,  -1, false, NEO_COUNTDOWN },
+  { 6000,  -1, false, NEO_FIXED_COLOR },
+  { 6234,   0, false, NEO_FIXED_COLOR },
+  { 6456,   1, true,  NEO_FIXED_COLOR },
+  { 6610,   3, false, NEO_FIXED_COLOR },
+  { 7100,  -1, false, NEO_STATUS },
+  { 12100, -1, false, NEO_IDLE_RAINBOW },
+};
+#define ROUND_MS          15000
+#define ROUND_LOOP_MS     1
+
+#define LEDS_REF_FRAME_MS 10
+
+#define SCENE(name, ms, events, hash) { name, ms, events, sizeof(events) / sizeof(events[0]), hash }
+
+static const Scene scenes[] = {
+  SCENE("idle",      LED_RAINBOW_MS, idleEvents,      0x6524D835),
+  SCENE("countdown", 3000,           countdownEvents, 0x2C421A25),
+  SCENE("go",        1500,           goEvents,        0x2D27D465),
+  SCENE("results",   2000,           resultsEvents,   0x492C7BB5),
+  SCENE("off",       400,            offEvents,       0xDD17B1A2),
+};
+
+// =============================================================================
+// HELPERS
+// =============================================================================
+static uint64_t wallNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// FNV-1a over every frame of a scene
+static uint32_t hashBytes(uint32_t h, const uint8_t* data, uint32_t len) {
+  for (uint32_t i = 0; i < len; i++) {
+    h = (h ^ data[i]) * 16777619u;
+  }
+  return h;
+}
+
+// Players 1, 2 and 4 in the round (3 missing: red ring in results)
+static void setupRoster(Roster* roster) {
+  roster->startRound(0x0B);
+}
+
+// Renders one scene; rows are appended to img (may be nullptr)
+static uint32_t runScene(const Scene* sc, uint32_t frameMs, uint8_t* img, uint32_t* rows) {
+  Roster roster;
+  setupRoster(&roster);
+  HostLeds leds;
+  leds.setBrightness(NEO_BRIGHTNESS);
+
+  uint8_t frame[LED_FRAME_BYTES];
+  uint32_t hash = 2166136261u;
+  uint8_t next = 0;
+  NeoMode mode = NEO_OFF;
+  *rows = 0;
+
+  // Start at an arbitrary instant: effects must not depend on t = 0
+  const uint32_t baseMs = 123456;
+  for (uint32_t t = 0; t < sc->durationMs; t += frameMs) {
+    uint32_t now = baseMs + t;
+    while (next < sc->eventCount && sc->events[next].atMs <= t) {
+      const SceneEvent* ev = &sc->events[next++];
+      if (ev->player < 0) {
+        mode = ev->mode;
+      } else {
+        leds.playerFinished(ev->player, ev->penalty, now);
+      }
+      leds.update(mode, roster, now);
+    }
+    leds.update(mode, roster, now);
+    leds.render(now, frame);
+    hash = hashBytes(hash, frame, sizeof(frame));
+    if (img) memcpy(&img[(*rows) * LED_FRAME_BYTES], frame, sizeof(frame));
+    (*rows)++;
+  }
+  return hash;
+}
+
+// 1 ms loop over roundEvents: draw() against render + send every pass.
+// Every pass also checks that the frame on the strip is the current one,
+// or at most one animation frame old.
+static void runRound(double renderNs) {
+  Roster roster;
+  setupRoster(&roster);
+  HostLeds leds;
+  leds.setBrightness(NEO_BRIGHTNESS);
+  HostLeds reference;
+  reference.setBrightness(NEO_BRIGHTNESS);
+
+  uint8_t shown[LED_FRAME_BYTES], sent[LED_FRAME_BYTES], fresh[LED_FRAME_BYTES];
+  memset(sent, 0, sizeof(sent));
+  uint32_t loops = 0, shows = 0, stale = 0, staleMax = 0, lastFreshMs = 0;
+  uint8_t next = 0;
+  NeoMode mode = NEO_OFF;
+  const uint8_t eventCount = sizeof(roundEvents) / sizeof(roundEvents[0]);
+
+  for (uint32_t t = 0; t < ROUND_MS; t += ROUND_LOOP_MS) {
+    uint32_t now = 500000 + t;
+    while (next < eventCount && roundEvents[next].atMs <= t) {
+      const SceneEvent* ev = &roundEvents[next++];
+      if (ev->player < 0) {
+        mode = ev->mode;
+      } else {
+        leds.playerFinished(ev->player, ev->penalty, now);
+        reference.playerFinished(ev->player, ev->penalty, now);
+      }
+    }
+    leds.update(mode, roster, now);
+    reference.update(mode, roster, now);
+    loops++;
+
+    if (leds.draw(now, shown) && memcmp(shown, sent, sizeof(sent)) != 0) {
+      memcpy(sent, shown, sizeof(sent));
+      shows++;
+    }
+
+    reference.render(now, fresh);
+    if (memcmp(fresh, sent, sizeof(sent)) == 0) {
+      lastFreshMs = t;
+    } else {
+      stale++;
+      if (t - lastFreshMs > staleMax) staleMax = t - lastFreshMs;
+    }
+  }
+
+  double seconds = ROUND_MS / 1000.0;
+  uint32_t renders = leds.renderCount();
+  printf("Round (%u ms, %u ms loop, cap %u fps):\n", ROUND_MS, ROUND_LOOP_MS, LED_MAX_FPS);
+  printf("  every pass: %.0f renders/s, %.0f shows/s\n", loops / seconds, loops / seconds);
+  printf("  draw():     %.0f renders/s, %.0f shows/s\n", renders / seconds, shows / seconds);
+  printf("  reclaimed: %.1f us/s of render CPU, %.0f transmissions/s\n",
+         (loops - renders) * renderNs / 1000.0 / seconds, (loops - shows) / seconds);
+  printf("  strip behind the scene: %u passes, at most %u ms\n", stale, staleMax);
+}
+
+static bool writePpm(const char* path, const uint8_t* img, uint32_t rows, uint32_t scale) {
+  FILE* f = fopen(path, "wb");
+  if (!f) return false;
+  fprintf(f, "P6\n%u %u\n255\n", NEOPIXEL_COUNT * scale, rows * scale);
+  uint8_t* line = (uint8_t*)malloc(LED_FRAME_BYTES * scale);
+  for (uint32_t r = 0; r < rows; r++) {
+    const uint8_t* src = &img[r * LED_FRAME_BYTES];
+    for (uint32_t i = 0; i < NEOPIXEL_COUNT; i++) {
+      for (uint32_t s = 0; s < scale; s++) memcpy(&line[(i * scale + s) * 3], &src[i * 3], 3);
+    }
+    for (uint32_t s = 0; s < scale; s++) fwrite(line, 1, LED_FRAME_BYTES * scale, f);
+  }
+  free(line);
+  return fclose(f) == 0;
+}
+
+// =============================================================================
+// MAIN
+// =============================================================================
+int main(int argc, char** argv) {
+  const char* outDir = ".";
+  uint32_t frameMs = LEDS_REF_FRAME_MS;
+  uint32_t scale = 4;
+  uint32_t benchFrames = 200000;
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* val = (i + 1 < argc) ? argv[i + 1] : "";
+    if (!strcmp(arg, "--out"))           { outDir = val; i++; }
+    else if (!strcmp(arg, "--frame-ms")) { frameMs = strtoul(val, NULL, 0); i++; }
+    else if (!strcmp(arg, "--scale"))    { scale = strtoul(val, NULL, 0); i++; }
+    else if (!strcmp(arg, "--frames"))   { benchFrames = strtoul(val, NULL, 0); i++; }
+    else {
+      fprintf(stderr, "unknown option %s\n", arg);
+      return 2;
+    }
+  }
+  if (frameMs == 0) frameMs = 1;
+  if (scale == 0) scale = 1;
+
+  // Scenes → PPM strips, hashes against the references
+  bool checked = (frameMs == LEDS_REF_FRAME_MS);
+  uint8_t changed = 0;
+  for (uint8_t s = 0; s < sizeof(scenes) / sizeof(scenes[0]); s++) {
+    const Scene* sc = &scenes[s];
+    uint32_t maxRows = (sc->durationMs + frameMs - 1) / frameMs;
+    uint8_t* img = (uint8_t*)malloc(maxRows * LED_FRAME_BYTES);
+    uint32_t rows;
+    uint32_t hash = runScene(sc, frameMs, img, &rows);
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/leds_%s.ppm", outDir, sc->name);
+    bool ok = writePpm(path, img, rows, scale);
+    free(img);
+    if (!ok) {
+      perror(path);
+      return 2;
+    }
+    printf("%-10s %4u frames  hash %08X  %s", sc->name, rows, hash, path);
+    if (checked && hash != sc->refHash) {
+      printf("  CHANGED (reference %08X)", sc->refHash);
+      changed++;
+    }
+    printf("\n");
+  }
+  if (!checked) {
+    printf("Hashes not checked: references are for --frame-ms %u\n", LEDS_REF_FRAME_MS);
+  } else if (changed) {
+    printf("%u scene(s) changed: check the images, then update the references in scenes[]\n", changed);
+  }
+
+  // Per-frame cost: the busiest scene (GO with status and flash layers)
+  Roster roster;
+  setupRoster(&roster);
+  HostLeds leds;
+  leds.setBrightness(NEO_BRIGHTNESS);
+  leds.update(NEO_FIXED_COLOR, roster, 0);
+  uint8_t frame[LED_FRAME_BYTES];
+  uint32_t sink = 0;
+  uint64_t t0 = wallNs();
+  for (uint32_t f = 0; f < benchFrames; f++) {
+    if (f % 100 == 0) leds.playerFinished((f / 100) % 4, f & 0x100, f);
+    leds.render(f, frame);
+    sink += frame[f % LED_FRAME_BYTES];
+  }
+  uint64_t ns = wallNs() - t0;
+  double renderNs = benchFrames ? (double)ns / benchFrames : 0.0;
+  printf("render(): %u frames, %.1f ns/frame (%u LEDs, %u layers) [%u]\n",
+         benchFrames, renderNs, NEOPIXEL_COUNT, LED_LAYERS, sink & 1);
+
+  runRound(renderNs);
+  return changed ? 1 : 0;
+}
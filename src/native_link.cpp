@@ -0,0 +1,203 @@
+/*
+ * native_link.cpp - Reliable Link Delivery under Frame Loss
+ *
+ * The host sends numbered reliable frames to one stick through two
+ * ReliableLinks over a SimNetwork on a virtual clock, once per --interval.
+ * Loss applies to every reception, ACKs included, and is swept from 0 to
+ * --max-loss. For each level: delivery latency from send() to the first
+ * arrival at the stick (p50, p99, max), frames that never arrived, and the
+ * link's own give-ups (drops) and retransmissions.
+ *
+ * Usage: native_link [options]
+ *   --frames N      reliable frames per loss level (default 5000)
+ *   --interval US   time between sends (default 20000)
+ *   --latency US    one-way latency (default 1000), --jitter US (default 500)
+ *   --max-loss P    highest loss in permille (default 300), --step P (50)
+ *   --seed N        PRNG seed (default 1)
+ * Exits 1 if a frame reached the application twice, or anything was lost
+ * or dropped without loss
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "Platform.h"
+#include "SimNetwork.h"
+#include "ReliableLink.h"
+
+#define LINK_TICK_US      250     // poll() period
+#define LINK_STICK_ID     1
+
+// =============================================================================
+// ENDPOINT
+// =============================================================================
+// One radio and its link; frames the link accepts go to onApp
+class LinkEnd : public TransportHandler {
+public:
+  LinkEnd(SimNetwork* net, VirtualClock* clock, const uint8_t* mac, const uint8_t* peer, uint8_t id) :
+    radio(net, mac), clock(clock), onApp(nullptr), appCtx(nullptr) {
+    memcpy(peerMac, peer, 6);
+    link.begin(id, sendHook, this);
+    radio.begin(this);
+  }
+
+  void onTransportReceive(const uint8_t* mac, const uint8_t* data, uint8_t len) override {
+    if (link.onReceive(data, len, clock->micros()) && onApp) onApp(appCtx, data, len);
+  }
+
+  SimTransport radio;
+  ReliableLink link;
+  VirtualClock* clock;
+  void (*onApp)(void* ctx, const uint8_t* data, uint8_t len);
+  void* appCtx;
+
+private:
+  static void sendHook(void* ctx, uint8_t destId, const uint8_t* data, uint8_t len) {
+    LinkEnd* end = (LinkEnd*)ctx;
+    end->radio.send(end->peerMac, data, len);
+  }
+
+  uint8_t peerMac[6];
+};
+
+// =============================================================================
+// ONE LOSS LEVEL
+// =============================================================================
+typedef struct {
+  VirtualClock* clock;
+  std::vector<uint32_t> sentUs;
+  std::vector<int64_t> arrivedUs;   // -1 until the frame arrives
+  uint32_t duplicates;
+} Delivery;
+
+static void onStickApp(void* ctx, const uint8_t* data, uint8_t len) {
+  Delivery* d = (Delivery*)ctx;
+  FrameReader reader;
+  FrameRecord rec;
+  if (!frameOpen(&reader, data, len)) return;
+  while (frameNext(&reader, &rec)) {
+    if (rec.cmd != CMD_RESULT || rec.len < 2) continue;
+    uint16_t n = recordU16(&rec);
+    if (n >= d->arrivedUs.size()) continue;
+    if (d->arrivedUs[n] >= 0) d->duplicates++;
+    else d->arrivedUs[n] = (int64_t)d->clock->nowUs64();
+  }
+}
+
+typedef struct {
+  uint32_t rejected;    // send() found no free slot
+  uint32_t lost;        // Never arrived
+  uint32_t duplicates;  // Reached the application twice
+  uint32_t p50Us, p99Us, maxUs;
+  LinkStats stats;
+} LevelResult;
+
+static LevelResult runLevel(uint16_t lossPermille, uint32_t frames, uint32_t intervalUs,
+                            uint32_t latencyUs, uint32_t jitterUs, uint32_t seed) {
+  VirtualClock clock;
+  SimNetwork net(&clock);
+  net.configure(latencyUs, jitterUs, lossPermille, seed);
+
+  uint8_t hostMac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, ID_HOST};
+  uint8_t stickMac[6] = {0x02, 0x00, 0x00, 0x00, 0x01, LINK_STICK_ID};
+  LinkEnd host(&net, &clock, hostMac, stickMac, ID_HOST);
+  LinkEnd stick(&net, &clock, stickMac, hostMac, LINK_STICK_ID);
+  host.link.addPeer(LINK_STICK_ID);
+
+  Delivery d;
+  d.clock = &clock;
+  d.sentUs.assign(frames, 0);
+  d.arrivedUs.assign(frames, -1);
+  d.duplicates = 0;
+  stick.onApp = onStickApp;
+  stick.appCtx = &d;
+
+  LevelResult r;
+  memset(&r, 0, sizeof(r));
+  uint64_t nextSendUs = clock.nowUs64();
+  uint32_t sent = 0;
+  // Run on until the last frame is acknowledged or given up
+  while (sent < frames || host.link.inFlight()) {
+    if (sent < frames && clock.nowUs64() >= nextSendUs) {
+      GameFrame frame;
+      frameBegin(&frame, LINK_STICK_ID, ID_HOST);
+      frameAddU16(&frame, CMD_RESULT, (uint16_t)sent);
+      d.sentUs[sent] = clock.micros();
+      if (!host.link.send(&frame, clock.micros())) {
+        r.rejected++;
+        d.arrivedUs[sent] = -2;
+      }
+      sent++;
+      nextSendUs += intervalUs;
+    }
+    net.runUntil(clock.nowUs64() + LINK_TICK_US);
+    host.link.poll(clock.micros());
+    stick.link.poll(clock.micros());
+  }
+  net.runUntil(clock.nowUs64() + 4 * latencyUs + jitterUs);
+
+  std::vector<uint32_t> latencies;
+  for (uint32_t i = 0; i < frames; i++) {
+    if (d.arrivedUs[i] == -1) r.lost++;
+    if (d.arrivedUs[i] < 0) continue;
+    latencies.push_back((uint32_t)((uint32_t)d.arrivedUs[i] - d.sentUs[i]));
+  }
+  std::sort(latencies.begin(), latencies.end());
+  if (!latencies.empty()) {
+    r.p50Us = latencies[latencies.size() / 2];
+    r.p99Us = latencies[(latencies.size() * 99) / 100];
+    r.maxUs = latencies.back();
+  }
+  r.duplicates = d.duplicates;
+  r.stats = host.link.getStats();
+  return r;
+}
+
+// =============================================================================
+// MAIN
+// =============================================================================
+int main(int argc, char** argv) {
+  uint32_t frames = 5000;
+  uint32_t intervalUs = 20000;
+  uint32_t latencyUs = 1000;
+  uint32_t jitterUs = 500;
+  uint16_t maxLoss = 300;
+  uint16_t step = 50;
+  uint32_t seed = 1;
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* val = (i + 1 < argc) ? argv[i + 1] : "0";
+    if (!strcmp(arg, "--frames"))        { frames = strtoul(val, NULL, 0); i++; }
+    else if (!strcmp(arg, "--interval")) { intervalUs = strtoul(val, NULL, 0); i++; }
+    else if (!strcmp(arg, "--latency"))  { latencyUs = strtoul(val, NULL, 0); i++; }
+    else if (!strcmp(arg, "--jitter"))   { jitterUs = strtoul(val, NULL, 0); i++; }
+    else if (!strcmp(arg, "--max-loss")) { maxLoss = (uint16_t)strtoul(val, NULL, 0); i++; }
+    else if (!strcmp(arg, "--step"))     { step = (uint16_t)strtoul(val, NULL, 0); i++; }
+    else if (!strcmp(arg, "--seed"))     { seed = strtoul(val, NULL, 0); i++; }
+    else {
+      fprintf(stderr, "Unknown option %s\n", arg);
+      return 2;
+    }
+  }
+  if (frames > 65536) frames = 65536;
+  if (!step) step = 50;
+
+  printf("%u frames per level, every %u us, latency %u us + up to %u us\n\n",
+         frames, intervalUs, latencyUs, jitterUs);
+  printf("loss   p50 us   p99 us   max us  lost  drops  retries  full  dupes\n");
+
+  bool ok = true;
+  for (uint16_t loss = 0; loss <= maxLoss; loss += step) {
+    LevelResult r = runLevel(loss, frames, intervalUs, latencyUs, jitterUs, seed);
+    printf("%3u.%u%% %8u %8u %8u %5u %6u %8u %5u %6u\n", loss / 10, loss % 10,
+           r.p50Us, r.p99Us, r.maxUs, r.lost, r.stats.drops, r.stats.retries, r.rejected, r.duplicates);
+    if (r.duplicates) ok = false;
+    if (loss == 0 && (r.lost || r.stats.drops || r.rejected)) ok = false;
+  }
+
+  printf("\n%s\n", ok ? "OK" : "FAIL");
+  return ok ? 0 : 1;
+}
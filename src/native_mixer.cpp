@@ -0,0 +1,283 @@
+/*
+ * native_mixer.cpp - Audio Mixer Kernel Benchmark and Check
+ *
+ * Times the host's mixing kernels (AudioMixer.h: mixAdd() per voice, then
+ * mixOut()) for 1 - 4 voices of full-scale noise, as GCC vectorizes them
+ * (this environment builds with -O3) and as a scalar loop (the same code,
+ * vectorizer off: what the ESP32 runs). Both must give the same samples
+ * and the same count of saturated ones, at every block length. Then
+ * plays a voice clip through AudioSequencer + AudioMixer with effects
+ * started over it, and checks the output against the saturated sum of the
+ * clips at their gains, and that a third effect on a full mixer takes the
+ * oldest voice. Exits 1 on any mismatch.
+ *
+ * The timings are this machine's; the ESP32's own cycles per mixed block
+ * are in the host's 'a' report (AUDIO_MIX_STATS).
+ *
+ * Usage: native_mixer [--seconds N]
+ *   --seconds  audio mixed per timing (default 600)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "AudioEngine.h"
+#include "AudioMixer.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define NOISE_BLOCKS      256       // Distinct input blocks per voice, cycled
+#define MAX_VOICES        4
+
+static const int16_t gains[MAX_VOICES] = {
+  AUDIO_GAIN_ONE, AUDIO_GAIN_ONE * 7 / 10, AUDIO_GAIN_ONE / 2, AUDIO_GAIN_ONE * 3 / 2
+};
+
+// =============================================================================
+// HELPERS
+// =============================================================================
+static uint64_t wallNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t rng = 0x12345678;
+static int16_t noise() {
+  rng = rng * 1664525u + 1013904223u;
+  return (int16_t)(rng >> 16);
+}
+
+// The kernels again, vectorizer off
+__attribute__((optimize("no-tree-vectorize")))
+static void scalarAdd(int32_t* __restrict acc, const int16_t* __restrict in, int16_t gain,
+                      uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) acc[i] += (int32_t)in[i] * gain;
+}
+
+__attribute__((optimize("no-tree-vectorize")))
+static uint32_t scalarOut(int16_t* __restrict out, const int32_t* __restrict acc, uint32_t n) {
+  uint32_t clipped = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    int32_t v = acc[i] >> AUDIO_GAIN_SHIFT;
+    int32_t s = v < -32768 ? -32768 : (v > 32767 ? 32767 : v);
+    clipped += s != v;
+    out[i] = (int16_t)s;
+  }
+  return clipped;
+}
+
+typedef void (*AddFn)(int32_t*, const int16_t*, int16_t, uint32_t);
+typedef uint32_t (*OutFn)(int16_t*, const int32_t*, uint32_t);
+
+// One block of voices: what AudioMixer::fill() does once its sources read
+static uint32_t mixBlock(AddFn add, OutFn out, int16_t (*in)[AUDIO_BLOCK_FRAMES],
+                         uint8_t voices, uint32_t n, int16_t* dst) {
+  int32_t acc[AUDIO_BLOCK_FRAMES];
+  memset(acc, 0, n * sizeof(acc[0]));
+  for (uint8_t v = 0; v < voices; v++) add(acc, in[v], gains[v], n);
+  return out(dst, acc, n);
+}
+
+// =============================================================================
+// KERNELS
+// =============================================================================
+static int16_t input[NOISE_BLOCKS][MAX_VOICES][AUDIO_BLOCK_FRAMES];
+
+// Vectorized and scalar agree on every length and voice count
+static bool checkKernels() {
+  for (uint8_t voices = 1; voices <= MAX_VOICES; voices++) {
+    for (uint32_t n = 1; n <= AUDIO_BLOCK_FRAMES; n++) {
+      for (uint32_t b = 0; b < NOISE_BLOCKS; b++) {
+        int16_t a[AUDIO_BLOCK_FRAMES], s[AUDIO_BLOCK_FRAMES];
+        uint32_t ca = mixBlock(mixAdd, mixOut, input[b], voices, n, a);
+        uint32_t cs = mixBlock(scalarAdd, scalarOut, input[b], voices, n, s);
+        if (ca != cs || memcmp(a, s, n * sizeof(a[0]))) {
+          printf("FAIL: %u voices, %u frames, block %u: vectorized and scalar differ\n",
+                 voices, n, b);
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+static double timeKernels(AddFn add, OutFn out, uint8_t voices, uint32_t blocks, uint32_t* clipped) {
+  int16_t dst[AUDIO_BLOCK_FRAMES];
+  uint32_t sum = 0;
+  uint64_t t0 = wallNs();
+  for (uint32_t b = 0; b < blocks; b++) {
+    sum += mixBlock(add, out, input[b % NOISE_BLOCKS], voices, AUDIO_BLOCK_FRAMES, dst);
+    __asm__ __volatile__("" : : "r"(dst) : "memory");     // Keep the output
+  }
+  *clipped = sum;
+  return (double)(wallNs() - t0) / blocks;
+}
+
+// =============================================================================
+// MIXER
+// =============================================================================
+// RAM clips for the sequencer: PcmDecoders over PcmClips
+class ClipSource : public AudioSource {
+public:
+  ClipSource(const PcmClip* c, uint8_t n) : clips(c), count(n) {
+    memset(busy, 0, sizeof(busy));
+  }
+
+  AudioDecoder* open(uint8_t sound) override {
+    if (sound >= count) return nullptr;
+    for (uint8_t i = 0; i < 2; i++) {
+      if (busy[i]) continue;
+      decoders[i].load(&clips[sound]);
+      decoders[i].open(sound);
+      busy[i] = true;
+      return &decoders[i];
+    }
+    return nullptr;
+  }
+
+  void release(AudioDecoder* decoder) override {
+    for (uint8_t i = 0; i < 2; i++) {
+      if (decoder == &decoders[i]) busy[i] = false;
+    }
+  }
+
+  bool cached(uint8_t sound) const override { return true; }
+  const char* name(uint8_t sound) const override { return "clip"; }
+
+private:
+  const PcmClip* clips;
+  uint8_t count;
+  PcmDecoder decoders[2];
+  bool busy[2];
+};
+
+enum { C_VOICE, C_CLICK, C_BEEP, C_TICK, C_CLIPS };
+
+static int16_t voiceData[AUDIO_RATE];           // 1 s
+static int16_t clickData[AUDIO_RATE / 10];
+static int16_t beepData[AUDIO_RATE / 4];
+static int16_t tickData[AUDIO_RATE / 20];
+
+// Output of the mixer for one block, worked out sample by sample
+static int16_t expected(const PcmClip* clip, int32_t pos, int16_t gain, int32_t* sum) {
+  if (pos >= 0 && pos < (int32_t)clip->frames) *sum += clip->samples[pos] * gain;
+  int32_t v = *sum >> AUDIO_GAIN_SHIFT;
+  return (int16_t)(v < -32768 ? -32768 : (v > 32767 ? 32767 : v));
+}
+
+static bool checkMixer() {
+  static const PcmClip clips[C_CLIPS] = {
+    { C_VOICE, voiceData, sizeof(voiceData) / 2 },
+    { C_CLICK, clickData, sizeof(clickData) / 2 },
+    { C_BEEP, beepData, sizeof(beepData) / 2 },
+    { C_TICK, tickData, sizeof(tickData) / 2 },
+  };
+  for (int16_t& s : voiceData) s = noise() / 2;
+  for (int16_t& s : clickData) s = noise();
+  for (int16_t& s : beepData) s = noise();
+  for (int16_t& s : tickData) s = noise();
+
+  ClipSource source(clips, C_CLIPS);
+  AudioSequencer seq(&source);
+  AudioMixer mixer(&seq);
+  seq.push(C_VOICE, 0);
+
+  // Effects start at these blocks, each with its own gain
+  typedef struct {
+    uint32_t block;
+    uint8_t clip;
+    float gain;
+    int32_t start;        // Frame of the stream it starts at
+    int16_t q12;
+  } Effect;
+  Effect fx[] = {
+    { 10, C_CLICK, 0.7f, -1, 0 },
+    { 20, C_BEEP, 1.5f, -1, 0 },
+    { 30, C_TICK, 1.0f, -1, 0 },       // Both effect voices busy: takes the click's
+  };
+  const uint8_t fxCount = sizeof(fx) / sizeof(fx[0]);
+  bool ok = true;
+  uint32_t frame = 0;
+  for (uint32_t b = 0; mixer.busy() || b <= fx[fxCount - 1].block; b++) {
+    for (Effect& e : fx) {
+      if (e.block != b) continue;
+      mixer.play(&clips[e.clip], e.gain);
+      e.start = (int32_t)frame;
+      e.q12 = (int16_t)(e.gain * AUDIO_GAIN_ONE);
+    }
+    int16_t out[AUDIO_BLOCK_FRAMES];
+    uint32_t n = mixer.fill(out, AUDIO_BLOCK_FRAMES, 0);
+    for (uint32_t i = 0; i < n && ok; i++) {
+      int32_t f = (int32_t)(frame + i);
+      int32_t sum = 0;
+      int16_t want = expected(&clips[C_VOICE], f, AUDIO_GAIN_ONE, &sum);
+      for (uint8_t k = 0; k < fxCount; k++) {
+        if (fx[k].start < 0) continue;
+        // The click stops where the tick takes its voice
+        if (k == 0 && fx[2].start >= 0 && f >= fx[2].start) continue;
+        want = expected(&clips[fx[k].clip], f - fx[k].start, fx[k].q12, &sum);
+      }
+      if (out[i] != want) {
+        printf("FAIL: mixer frame %d: %d, expected %d\n", f, out[i], want);
+        ok = false;
+      }
+    }
+    frame += n;
+  }
+
+  const AudioMixStats& m = mixer.getStats();
+  printf("Mixer: %u frames, %u blocks, %u mixed, peak %u voices, %u clipped, %u stolen\n",
+         frame, m.blocks, m.mixed, m.peakVoices, m.clipped, m.stolen);
+  if (m.stolen != 1 || m.peakVoices != 3) {
+    printf("FAIL: expected 1 stolen voice and a peak of 3 voices\n");
+    ok = false;
+  }
+  return ok;
+}
+
+// =============================================================================
+// MAIN
+// =============================================================================
+int main(int argc, char** argv) {
+  uint32_t seconds = 600;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: %s [--seconds N]\n", argv[0]);
+      return 2;
+    }
+  }
+  logEnabled() = false;
+
+  for (uint32_t b = 0; b < NOISE_BLOCKS; b++) {
+    for (uint8_t v = 0; v < MAX_VOICES; v++) {
+      for (uint32_t i = 0; i < AUDIO_BLOCK_FRAMES; i++) input[b][v][i] = noise();
+    }
+  }
+
+  int rc = 0;
+  if (!checkKernels()) rc = 1;
+  else printf("Kernels: vectorized and scalar agree (1 - %u voices, 1 - %u frames)\n",
+              MAX_VOICES, AUDIO_BLOCK_FRAMES);
+  if (!checkMixer()) rc = 1;
+
+  uint32_t blocks = (uint32_t)((uint64_t)seconds * AUDIO_RATE / AUDIO_BLOCK_FRAMES);
+  double blockNs = AUDIO_BLOCK_FRAMES * 1e9 / AUDIO_RATE;
+  printf("\nKernels, %u s of audio (%u blocks of %u frames, %.0f us each):\n", seconds, blocks,
+         AUDIO_BLOCK_FRAMES, blockNs / 1000);
+  printf("  voices   vectorized ns/block   scalar ns/block   speedup   CPU vectorized/scalar   clipped\n");
+  for (uint8_t voices = 1; voices <= MAX_VOICES; voices++) {
+    uint32_t cv, cs;
+    double v = timeKernels(mixAdd, mixOut, voices, blocks, &cv);
+    double s = timeKernels(scalarAdd, scalarOut, voices, blocks, &cs);
+    printf("  %6u   %19.1f   %15.1f   %6.2fx   %9.4f%% / %.4f%%   %7.3f%%\n", voices, v, s, s / v,
+           v * 100 / blockNs, s * 100 / blockNs, cv * 100.0 / ((double)blocks * AUDIO_BLOCK_FRAMES));
+  }
+
+  printf("\n%s\n", rc ? "FAIL" : "OK");
+  return rc;
+}
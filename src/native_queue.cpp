@@ -0,0 +1,167 @@
+/*
+ * native_queue.cpp - SPSC Queue Two-thread Stress
+ *
+ * One std::thread produces numbered items through claim()/publish(), the
+ * way the receive callbacks fill InboundPackets in place, another peeks and
+ * pops them. The producer retries while the queue is full and the consumer
+ * spins while it is empty, so both edges are hit millions of times at small
+ * capacities. Each item carries its number in every word: the consumer
+ * checks order, completeness and that no item was read half-written.
+ * A last run drops on full instead of retrying, like the firmware does: what
+ * arrives must still be in order, and the drops must match the queue's
+ * overflow count.
+ *
+ * Usage: native_queue [items]   (default 4000000 per run)
+ * Exits 1 on any lost, duplicated, reordered or torn item
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <atomic>
+#include <thread>
+#include "SpscQueue.h"
+
+#define QUEUE_ITEM_WORDS  8
+#define QUEUE_SPINS       64      // Busy retries before a yield
+
+typedef struct {
+  uint32_t words[QUEUE_ITEM_WORDS];   // All equal to the item number
+} StressItem;
+
+typedef struct {
+  uint64_t received;
+  uint64_t outOfOrder;
+  uint64_t torn;
+  uint64_t fullSpins;     // Producer found the queue full
+  uint64_t emptySpins;    // Consumer found the queue empty
+  uint64_t dropped;       // Drop mode: items the producer gave up on
+  uint32_t overflows;
+  uint16_t peak;
+  double seconds;
+} StressResult;
+
+// =============================================================================
+// HELPERS
+// =============================================================================
+static uint64_t wallNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Spin first (both threads hammer the edge on a multicore machine), then
+// yield so the other thread gets the CPU when there is only one
+static void backoff(uint64_t spins) {
+  if (spins % QUEUE_SPINS == 0) std::this_thread::yield();
+}
+
+// =============================================================================
+// ONE RUN
+// =============================================================================
+// retry: wait for room (every item must arrive); else drop on full
+template <uint16_t N>
+static StressResult runStress(uint32_t items, bool retry) {
+  SpscQueue<StressItem, N>& queue = *new SpscQueue<StressItem, N>();
+
+  StressResult r = {};
+  std::atomic<bool> producerDone(false);
+  uint64_t t0 = wallNs();
+
+  std::thread producer([&]() {
+    for (uint32_t n = 0; n < items; n++) {
+      StressItem* slot;
+      while ((slot = queue.claim()) == nullptr) {
+        r.fullSpins++;
+        if (!retry) break;
+        backoff(r.fullSpins);
+      }
+      if (!slot) {
+        r.dropped++;
+        backoff(r.dropped);
+        continue;
+      }
+      for (uint8_t w = 0; w < QUEUE_ITEM_WORDS; w++) slot->words[w] = n;
+      queue.publish();
+    }
+    producerDone.store(true, std::memory_order_release);
+  });
+
+  std::thread consumer([&]() {
+    uint64_t expected = 0;    // Retry mode: exactly this number next
+    int64_t last = -1;        // Drop mode: anything above the previous one
+    while (true) {
+      StressItem* item = queue.peek();
+      if (!item) {
+        // Done only once the producer has finished and the queue drained
+        if (producerDone.load(std::memory_order_acquire) && !queue.peek()) break;
+        r.emptySpins++;
+        backoff(r.emptySpins);
+        continue;
+      }
+      uint32_t n = item->words[0];
+      for (uint8_t w = 1; w < QUEUE_ITEM_WORDS; w++) {
+        if (item->words[w] != n) {
+          r.torn++;
+          break;
+        }
+      }
+      if (retry ? (n != expected) : ((int64_t)n <= last)) r.outOfOrder++;
+      expected = (uint64_t)n + 1;
+      last = n;
+      r.received++;
+      queue.pop();
+    }
+  });
+
+  producer.join();
+  consumer.join();
+  r.seconds = (double)(wallNs() - t0) / 1e9;
+  r.overflows = queue.overflowCount();
+  r.peak = queue.peakDepth();
+  delete &queue;
+  return r;
+}
+
+template <uint16_t N>
+static bool report(const char* name, uint32_t items, bool retry) {
+  StressResult r = runStress<N>(items, retry);
+  bool ok = !r.outOfOrder && !r.torn && r.peak <= N;
+  if (retry) {
+    // Every item, and a failed claim() counted for every full spin
+    ok = ok && r.received == items && !r.dropped && r.overflows == (uint32_t)r.fullSpins;
+  } else {
+    ok = ok && r.received + r.dropped == items && r.overflows == (uint32_t)r.dropped;
+  }
+  printf("%-14s N=%-3u %9llu recv %9llu drop %10llu full %10llu empty  peak %3u  %5.1f Mitem/s%s\n",
+         name, N, (unsigned long long)r.received, (unsigned long long)r.dropped,
+         (unsigned long long)r.fullSpins, (unsigned long long)r.emptySpins, r.peak,
+         r.received / r.seconds / 1e6, ok ? "" : "  FAIL");
+  if (r.outOfOrder || r.torn) {
+    printf("  %llu out of order, %llu torn\n", (unsigned long long)r.outOfOrder,
+           (unsigned long long)r.torn);
+  }
+  return ok;
+}
+
+// =============================================================================
+// MAIN
+// =============================================================================
+int main(int argc, char** argv) {
+  uint32_t items = (argc > 1) ? strtoul(argv[1], NULL, 0) : 4000000;
+  if (!items) items = 1;
+
+  printf("%u items per run, %u-word items, %u hardware threads\n\n",
+         items, QUEUE_ITEM_WORDS, std::thread::hardware_concurrency());
+
+  bool ok = true;
+  ok &= report<2>("retry", items, true);
+  ok &= report<4>("retry", items, true);
+  ok &= report<RX_QUEUE_SIZE>("retry", items, true);
+  ok &= report<256>("retry", items, true);
+  ok &= report<4>("drop on full", items, false);
+  ok &= report<RX_QUEUE_SIZE>("drop on full", items, false);
+
+  printf("\n%s\n", ok ? "OK" : "FAIL");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,358 @@
+/*
+ * native_replay.cpp - Feed a Packet Capture Back into the Game Logic
+ *
+ * Reads the CAP lines of a capture (PacketCapture.h: a serial dump, a
+ * decoded log, /capture.txt from SPIFFS or native_sim --capture) and plays
+ * the received frames into a HostGame, or a JoystickGame with --stick, on a
+ * virtual clock at their recorded times. The game's own log shows what it
+ * made of them; its sends are compared with the ones in the capture.
+ *
+ * - Capture from power-on (nothing overwritten): the game starts at the
+ *   recorded transport start, so a capture from the same code replays
+ *   frame for frame.
+ * - Partial capture: host pairings are rebuilt from the frames' source IDs;
+ *   a stick is joined with a synthetic CMD_OK for the ID it was sending as.
+ * - Stick button presses are not on the air: the replay presses at each
+ *   captured reaction report, which reproduces the report within a loop
+ *   period.
+ *
+ * Also reports the cost of processing the received frames, measured on
+ * the capture's own traffic mix.
+ *
+ * Usage: native_replay [options] capture.txt
+ *   --stick      replay into JoystickGame (default: HostGame)
+ *   --tick US    loop period (default 1000, the firmware loop; use the
+ *                native_sim --tick value for sim captures)
+ *   --quiet      no game log output
+ *   --check      exit 1 unless the capture is from power-on and every send
+ *                matches it (round trip: native_sim --tick 1000 --capture)
+ * Exit status is non-zero if the capture has no records.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "Platform.h"
+#include "PacketCapture.h"
+#include "Pairing.h"
+#include "HostGame.h"
+#include "JoystickGame.h"
+
+#define REPLAY_PRESS_US   80000   // Button held down
+
+// =============================================================================
+// HELPERS
+// =============================================================================
+static uint64_t wallNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static bool hasCommand(const CaptureRecord* rec, uint8_t cmd) {
+  FrameReader reader;
+  if (!frameOpen(&reader, rec->data, rec->len)) return false;
+  FrameRecord r;
+  while (frameNext(&reader, &r)) {
+    if (r.cmd == cmd) return true;
+  }
+  return false;
+}
+
+// Same destination and the same commands in the same order
+static bool sameCommands(const CaptureRecord* a, const CaptureRecord* b) {
+  FrameReader ra, rb;
+  if (memcmp(a->mac, b->mac, 6) != 0) return false;
+  if (!frameOpen(&ra, a->data, a->len) || !frameOpen(&rb, b->data, b->len)) return false;
+  if (ra.dest_id != rb.dest_id || ra.src_id != rb.src_id) return false;
+  FrameRecord x, y;
+  for (;;) {
+    bool more = frameNext(&ra, &x);
+    if (more != frameNext(&rb, &y)) return false;
+    if (!more) return true;
+    if (x.cmd != y.cmd) return false;
+  }
+}
+
+// Partial host capture: every node that sent frames was paired
+static void seedPairings(const std::vector<CaptureRecord>& records, PairingStore* store) {
+  PairingEntry entries[PAIRING_MAX];
+  uint8_t count = 0;
+  for (size_t i = 0; i < records.size() && count < PAIRING_MAX; i++) {
+    FrameReader fr;
+    if (records[i].dir != PCAP_RX || !frameOpen(&fr, records[i].data, records[i].len)) continue;
+    if (fr.src_id != ID_DISPLAY && !Roster::isStickId(fr.src_id)) continue;
+    bool known = false;
+    for (uint8_t k = 0; k < count; k++) known |= (entries[k].id == fr.src_id);
+    if (known) continue;
+    entries[count].id = fr.src_id;
+    memcpy(entries[count].mac, records[i].mac, 6);
+    count++;
+  }
+  store->save(entries, count);
+}
+
+// Partial stick capture: CMD_OK from the host it heard, for the ID it was
+// sending as
+static bool syntheticJoin(const std::vector<CaptureRecord>& records, CaptureRecord* ok) {
+  uint8_t id = ID_NEW;
+  const uint8_t* hostMac = nullptr;
+  for (size_t i = 0; i < records.size(); i++) {
+    FrameReader fr;
+    if (records[i].dir == PCAP_RX && !hostMac) hostMac = records[i].mac;
+    if (records[i].dir != PCAP_TX || id != ID_NEW) continue;
+    if (frameOpen(&fr, records[i].data, records[i].len) && Roster::isStickId(fr.src_id)) id = fr.src_id;
+  }
+  if (id == ID_NEW || !hostMac) return false;
+
+  GamePacket pkt;
+  buildPacket(&pkt, ID_NEW, ID_HOST, CMD_OK, id);
+  memcpy(ok->mac, hostMac, 6);
+  ok->dir = PCAP_RX;
+  ok->len = sizeof(pkt);
+  memcpy(ok->data, &pkt, sizeof(pkt));
+  return true;
+}
+
+// =============================================================================
+// REPLAY TRANSPORT
+// =============================================================================
+// Nothing goes on the air: sends are kept for the comparison
+class ReplayTransport : public Transport {
+public:
+  explicit ReplayTransport(Clock* clock) : clock(clock), handler(nullptr) {}
+
+  bool begin(TransportHandler* h) override {
+    handler = h;
+    return true;
+  }
+
+  bool addPeer(const uint8_t* mac) override { return true; }
+  bool removePeer(const uint8_t* mac) override { return true; }
+
+  bool send(const uint8_t* mac, const uint8_t* data, uint8_t len) override {
+    CaptureRecord rec;
+    rec.us = clock->micros();
+    memcpy(rec.mac, mac, 6);
+    rec.dir = PCAP_TX;
+    rec.len = len;
+    memcpy(rec.data, data, len);
+    sent.push_back(rec);
+    if (handler) handler->onTransportSent(mac, true);
+    return true;
+  }
+
+  void macAddress(uint8_t* mac) override {
+    static const uint8_t replayMac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0xEE};
+    memcpy(mac, replayMac, 6);
+  }
+
+  void deliver(const CaptureRecord* rec) {
+    if (handler) handler->onTransportReceive(rec->mac, rec->data, rec->len);
+  }
+
+  std::vector<CaptureRecord> sent;
+
+private:
+  Clock* clock;
+  TransportHandler* handler;
+};
+
+// =============================================================================
+// REPLAYED STICK BUTTON
+// =============================================================================
+class ReplayButton : public JoystickIO {
+public:
+  ReplayButton() : game(nullptr), down(false), releaseUs(0) {}
+
+  bool buttonDown() override { return down; }
+
+  void press(uint32_t us) {
+    down = true;
+    releaseUs = us + REPLAY_PRESS_US;
+    game->onButtonEdge(us, 0);      // Active-low
+  }
+
+  void update(uint32_t us) {
+    if (down && (int32_t)(us - releaseUs) >= 0) {
+      down = false;
+      game->onButtonEdge(us, 1);
+    }
+  }
+
+  JoystickGame* game;
+
+private:
+  bool down;
+  uint32_t releaseUs;
+};
+
+// =============================================================================
+// MAIN
+// =============================================================================
+int main(int argc, char** argv) {
+  bool stickMode = false;
+  bool check = false;
+  uint32_t tickUs = 1000;
+  const char* path = nullptr;
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* val = (i + 1 < argc) ? argv[i + 1] : "0";
+    if (!strcmp(arg, "--stick"))      { stickMode = true; }
+    else if (!strcmp(arg, "--tick"))  { tickUs = strtoul(val, NULL, 0); i++; }
+    else if (!strcmp(arg, "--quiet")) { logEnabled() = false; }
+    else if (!strcmp(arg, "--check")) { check = true; }
+    else if (arg[0] != '-')           { path = arg; }
+    else {
+      fprintf(stderr, "unknown option %s\n", arg);
+      return 2;
+    }
+  }
+  if (!path) {
+    fprintf(stderr, "usage: native_replay [--stick] [--tick US] [--quiet] [--check] capture.txt\n");
+    return 2;
+  }
+  if (tickUs == 0) tickUs = 1;
+
+  CaptureReader reader;
+  if (!reader.open(path)) {
+    perror(path);
+    return 2;
+  }
+  std::vector<CaptureRecord> records;
+  CaptureRecord rec;
+  while (reader.next(&rec)) records.push_back(rec);
+  if (records.empty()) {
+    fprintf(stderr, "%s: no capture records\n", path);
+    return 1;
+  }
+
+  // From power-on: start where the capture started
+  bool complete = reader.hasHeader() && reader.overwritten() == 0;
+  uint32_t startUs = complete ? reader.startUs() : records[0].us;
+
+  VirtualClock clock(1000000);
+  uint64_t base = clock.nowUs64();
+  ReplayTransport radio(&clock);
+  HostEvents quiet;
+  HostGame host;
+  JoystickGame stick;
+  ReplayButton button;
+  MemoryPairingStore pairings;
+
+  if (stickMode) {
+    button.game = &stick;
+    stick.begin(&radio, &clock, &button);
+    CaptureRecord ok;
+    if (!complete && syntheticJoin(records, &ok)) radio.deliver(&ok);
+  } else {
+    if (!complete) seedPairings(records, &pairings);
+    host.begin(&radio, &clock, &quiet, &pairings);
+  }
+
+  // Run the loop on the tick grid, delivering each record at its time
+  uint64_t nextTick = base + tickUs;
+  uint32_t rxCount = 0, txCount = 0;
+  uint32_t pending = 0;
+  uint64_t busyNs = 0, idleNs = 0;
+  uint32_t busyTicks = 0, idleTicks = 0, busyFrames = 0;
+  uint64_t lastUs = base;
+
+  auto runTick = [&](uint64_t at) {
+    clock.setUs(at);
+    if (stickMode) button.update(clock.micros());
+    uint64_t t0 = wallNs();
+    if (stickMode) stick.update(); else host.update();
+    uint64_t ns = wallNs() - t0;
+    if (pending) {
+      busyNs += ns;
+      busyTicks++;
+      busyFrames += pending;
+      pending = 0;
+    } else {
+      idleNs += ns;
+      idleTicks++;
+    }
+  };
+
+  for (size_t i = 0; i < records.size(); i++) {
+    const CaptureRecord* r = &records[i];
+    uint64_t at = base + (uint32_t)(r->us - startUs);
+    if (at < lastUs) at = lastUs;         // Clock steps in a merged capture
+    lastUs = at;
+    // A frame received on a tick is handled in that tick's update(), as
+    // the firmware loop and native_sim do
+    while (nextTick < at) {
+      runTick(nextTick);
+      nextTick += tickUs;
+    }
+    clock.setUs(at);
+    if (r->dir == PCAP_RX) {
+      // The stick handles frames right here, the host in its next update()
+      uint64_t t0 = wallNs();
+      radio.deliver(r);
+      busyNs += wallNs() - t0;
+      pending++;
+      rxCount++;
+    } else {
+      txCount++;
+      if (stickMode && hasCommand(r, CMD_REACTION_DONE)) button.press(clock.micros());
+    }
+  }
+  // One more loop pass handles the last frame; the capture ends there
+  while (nextTick <= lastUs + tickUs) {
+    runTick(nextTick);
+    nextTick += tickUs;
+  }
+
+  // Sends in order against the captured ones. Timestamps inside frames
+  // (clock sync) follow the loop timing, which the capture does not hold,
+  // so sends are matched by their commands; identical bytes are counted.
+  std::vector<const CaptureRecord*> captured;
+  for (size_t i = 0; i < records.size(); i++) {
+    if (records[i].dir == PCAP_TX) captured.push_back(&records[i]);
+  }
+  size_t compared = (captured.size() < radio.sent.size()) ? captured.size() : radio.sent.size();
+  uint32_t identical = 0;
+  long divergeAt = -1;
+  for (size_t i = 0; i < compared; i++) {
+    const CaptureRecord* a = captured[i];
+    const CaptureRecord* b = &radio.sent[i];
+    if (a->len == b->len && memcmp(a->data, b->data, a->len) == 0 && memcmp(a->mac, b->mac, 6) == 0) {
+      identical++;
+    } else if (divergeAt < 0 && !sameCommands(a, b)) {
+      divergeAt = (long)i;
+    }
+  }
+  if (divergeAt < 0 && captured.size() != radio.sent.size()) divergeAt = (long)compared;
+
+  double idle = idleTicks ? (double)idleNs / idleTicks : 0.0;
+  double perFrame = busyFrames ? ((double)busyNs - idle * busyTicks) / busyFrames : 0.0;
+
+  printf("\n=== REPLAY (%s) ===\n", stickMode ? "stick" : "host");
+  printf("Capture: %u records, %u rx, %u tx, %s, %.3f s\n",
+         (unsigned)records.size(), rxCount, txCount,
+         complete ? "from start" : "partial", (lastUs - base) / 1e6);
+  printf("Replayed sends: %u, %u byte-identical, commands %s\n",
+         (unsigned)radio.sent.size(), identical, (divergeAt < 0) ? "all match" : "differ");
+  if (divergeAt >= 0 && (size_t)divergeAt < compared) {
+    char line[PCAP_LINE_MAX];
+    printf("First difference: send %ld, captured at %.6f s, replayed at %.6f s\n", divergeAt,
+           (uint32_t)(captured[divergeAt]->us - startUs) / 1e6,
+           (uint32_t)(radio.sent[divergeAt].us - (uint32_t)base) / 1e6);
+    PacketCapture::formatLine(captured[divergeAt], line);
+    printf("  captured: %s\n", line);
+    PacketCapture::formatLine(&radio.sent[divergeAt], line);
+    printf("  replayed: %s\n", line);
+  }
+  printf("Processing: %.1f ns per received frame, idle update %.1f ns\n", perFrame, idle);
+
+  if (check && (!complete || divergeAt >= 0)) {
+    printf("FAIL: %s\n", complete ? "replay differs from the capture" : "capture not from power-on");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,390 @@
+/*
+ * native_sim.cpp - Deterministic Simulation of Complete Rounds
+ *
+ * HostGame and 2 (up to MAX_PLAYERS) JoystickGame instances run in one process on a
+ * VirtualClock over a SimNetwork, so a round that takes ~20 s on the
+ * hardware (DURATION_IDLE, 3 countdown ticks, up to TIMEOUT_REACTION,
+ * DURATION_RESULTS) runs in well under a millisecond. Audio and LED outputs
+ * go to a recording sink. Each stick has its own clock offset and drift.
+ *
+ * Rounds cycle through fixed two-player scenarios (faster player, tie, early
+ * press, timeout, double penalty), or draw random ones with --random (always
+ * with more than two sticks), and every result is checked against the
+ * expected times and winner. Exit status is non-zero if any round disagreed.
+ *
+ * Sticks join through the CMD_REQ_ID handshake. With --rejoin, stick 2 is
+ * restarted at every round's IDLE and must get its old ID back.
+ *
+ * Usage: native_sim [options]
+ *   --rounds N      rounds to play (default 1000)
+ *   --random        random reactions/penalties instead of the fixed cycle
+ *   --sticks N      simulated sticks, 2..MAX_PLAYERS (default 2)
+ *   --tick US       loop period in virtual time (default 5000; 1000 matches
+ *                   the firmware loop, larger runs faster)
+ *   --loss PERMILLE frame loss per reception (default 0)
+ *   --latency US    one-way latency (default 1000), --jitter US (default 0)
+ *   --seed N        PRNG seed (default 1)
+ *   --start-us N    initial virtual time, e.g. 4294000000 to cross the
+ *                   32-bit micros() wrap
+ *   --rejoin        restart stick 2 every round (checks the rejoin)
+ *   --capture FILE  write the host's packet capture (native_replay input)
+ *   --verbose       keep the game's own log output
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <new>
+#include "Platform.h"
+#include "SimNetwork.h"
+#include "PacketCapture.h"
+#include "HostGame.h"
+#include "JoystickGame.h"
+
+#define SIM_MAX_STICKS    MAX_PLAYERS
+#define SIM_PRESS_US      80000   // Button held down
+
+// =============================================================================
+// SCENARIOS
+// =============================================================================
+enum PressMode {
+  PRESS_AT,       // Press reactMs after the local GO instant
+  PRESS_EARLY,    // Button already down at GO
+  PRESS_NEVER     // No press: stick/host timeout
+};
+
+typedef struct {
+  const char* name;
+  PressMode mode[SIM_MAX_STICKS];
+  uint32_t reactMs[SIM_MAX_STICKS];
+} Scenario;
+
+static const Scenario SCENARIOS[] = {
+  { "p1 faster",    { PRESS_AT,    PRESS_AT },    { 150, 250 } },
+  { "p2 faster",    { PRESS_AT,    PRESS_AT },    { 320, 181 } },
+  { "tie",          { PRESS_AT,    PRESS_AT },    { 200, 200 } },
+  { "p1 early",     { PRESS_EARLY, PRESS_AT },    { 0, 300 } },
+  { "p2 timeout",   { PRESS_AT,    PRESS_NEVER }, { 400, 0 } },
+  { "both penalty", { PRESS_EARLY, PRESS_NEVER }, { 0, 0 } },
+};
+#define NUM_SCENARIOS (sizeof(SCENARIOS) / sizeof(SCENARIOS[0]))
+
+// Winner slot the host must announce: sole fastest valid press, -1 for none
+static int expectedWinner(const Scenario* sc, uint8_t n) {
+  int best = -1;
+  bool tie = false;
+  for (uint8_t i = 0; i < n; i++) {
+    if (sc->mode[i] != PRESS_AT) continue;
+    if (best < 0 || sc->reactMs[i] < sc->reactMs[best]) {
+      best = i;
+      tie = false;
+    } else if (sc->reactMs[i] == sc->reactMs[best]) {
+      tie = true;
+    }
+  }
+  return tie ? -1 : best;
+}
+
+// =============================================================================
+// SIMULATED PLAYER (button)
+// =============================================================================
+class SimPlayer : public JoystickIO {
+public:
+  SimPlayer() : game(nullptr), clock(nullptr), mode(PRESS_NEVER), reactMs(0),
+                pressPending(false), releasePending(false), pressUs(0) {}
+
+  bool buttonDown() override { return mode == PRESS_EARLY; }
+
+  void onGo(uint32_t goUs) override {
+    if (mode != PRESS_AT) return;
+    pressUs = goUs + reactMs * 1000;
+    pressPending = true;
+  }
+
+  // Edges at their exact local instants, once the clock passes them
+  void update() {
+    uint32_t nowUs = clock->micros();
+    if (pressPending && (int32_t)(nowUs - pressUs) >= 0) {
+      game->onButtonEdge(pressUs, 0);
+      pressPending = false;
+      releasePending = true;
+    }
+    if (releasePending && (int32_t)(nowUs - pressUs) >= SIM_PRESS_US) {
+      game->onButtonEdge(pressUs + SIM_PRESS_US, 1);
+      releasePending = false;
+    }
+  }
+
+  JoystickGame* game;
+  Clock* clock;
+  PressMode mode;
+  uint32_t reactMs;
+
+private:
+  bool pressPending;
+  bool releasePending;
+  uint32_t pressUs;
+};
+
+// =============================================================================
+// RECORDING SINK (audio, LEDs)
+// =============================================================================
+class SimOutputs : public HostEvents {
+public:
+  SimOutputs() : sounds(0), ledUpdates(0), winner(-1) {}
+
+  void onIdle() override { sounds++; winner = -1; }
+  void onCountdown(uint8_t num) override { sounds++; }
+  void onGo() override { sounds++; }
+  void onPlayerFinished(uint8_t playerIdx, uint16_t timeMs) override { ledUpdates++; }
+  void onWinner(uint8_t playerIdx, uint16_t timeMs) override { sounds++; winner = playerIdx; }
+
+  uint32_t sounds;
+  uint32_t ledUpdates;
+  int winner;
+};
+
+// =============================================================================
+// HELPERS
+// =============================================================================
+static uint64_t wallNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void writeCaptureLine(void* ctx, const char* line) {
+  fprintf((FILE*)ctx, "%s\n", line);
+}
+
+// Compare the host's view of one round with the scenario; prints mismatches
+static bool checkRound(uint32_t round, const Scenario* sc, uint8_t n, const HostGame* host, const SimOutputs* out) {
+  bool ok = true;
+  const Roster& roster = host->getRoster();
+  for (uint8_t i = 0; i < n; i++) {
+    if (!roster.isJoined(i)) {
+      printf("round %u (%s): player %d not in the round\n", round, sc->name, i + 1);
+      ok = false;
+      continue;
+    }
+    const Player& p = roster.player(i);
+    uint16_t wantMs = (sc->mode[i] == PRESS_AT) ? (uint16_t)sc->reactMs[i] : TIME_PENALTY;
+    uint32_t wantUs = (sc->mode[i] == PRESS_AT) ? sc->reactMs[i] * 1000 : (uint32_t)TIME_PENALTY * 1000;
+    if (p.reactionTime != wantMs || p.reactionUs != wantUs) {
+      printf("round %u (%s): player %d got %u ms / %u us, expected %u ms / %u us\n",
+             round, sc->name, i + 1, p.reactionTime, p.reactionUs, wantMs, wantUs);
+      ok = false;
+    }
+  }
+  int want = expectedWinner(sc, n);
+  if (out->winner != want) {
+    printf("round %u (%s): winner %d, expected %d\n", round, sc->name, out->winner + 1, want + 1);
+    ok = false;
+  }
+  return ok;
+}
+
+// =============================================================================
+// MAIN
+// =============================================================================
+int main(int argc, char** argv) {
+  uint32_t rounds = 1000;
+  bool randomMode = false;
+  uint32_t tickUs = 5000;
+  uint32_t lossPermille = 0;
+  uint32_t latencyUs = 1000;
+  uint32_t jitterUs = 0;
+  uint32_t seed = 1;
+  uint64_t startUs = 1000000;
+  uint32_t stickCount = 2;
+  bool rejoin = false;
+  bool verbose = false;
+  const char* capturePath = nullptr;
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* val = (i + 1 < argc) ? argv[i + 1] : "0";
+    if (!strcmp(arg, "--rounds"))        { rounds = strtoul(val, NULL, 0); i++; }
+    else if (!strcmp(arg, "--random"))   { randomMode = true; }
+    else if (!strcmp(arg, "--tick"))     { tickUs = strtoul(val, NULL, 0); i++; }
+    else if (!strcmp(arg, "--loss"))     { lossPermille = strtoul(val, NULL, 0); i++; }
+    else if (!strcmp(arg, "--latency"))  { latencyUs = strtoul(val, NULL, 0); i++; }
+    else if (!strcmp(arg, "--jitter"))   { jitterUs = strtoul(val, NULL, 0); i++; }
+    else if (!strcmp(arg, "--seed"))     { seed = strtoul(val, NULL, 0); i++; }
+    else if (!strcmp(arg, "--start-us")) { startUs = strtoull(val, NULL, 0); i++; }
+    else if (!strcmp(arg, "--sticks"))   { stickCount = strtoul(val, NULL, 0); i++; }
+    else if (!strcmp(arg, "--rejoin"))   { rejoin = true; }
+    else if (!strcmp(arg, "--verbose"))  { verbose = true; }
+    else if (!strcmp(arg, "--capture"))  { capturePath = val; i++; }
+    else {
+      fprintf(stderr, "unknown option %s\n", arg);
+      return 2;
+    }
+  }
+  if (tickUs == 0) tickUs = 1;
+  if (stickCount < 2 || stickCount > SIM_MAX_STICKS) {
+    fprintf(stderr, "--sticks must be 2..%d\n", SIM_MAX_STICKS);
+    return 2;
+  }
+  // Fixed scenarios are two-player
+  if (stickCount > 2) randomMode = true;
+  const uint8_t n = (uint8_t)stickCount;
+  logEnabled() = verbose;
+
+  VirtualClock clock(startUs);
+  SimNetwork net(&clock);
+  net.configure(latencyUs, jitterUs, (uint16_t)lossPermille, seed);
+
+  // Host on the reference clock
+  uint8_t hostMac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, ID_HOST};
+  SimTransport hostRadio(&net, hostMac);
+  static PacketCapture capture;
+  CaptureTransport hostCapture(&hostRadio, &capture, &clock);
+  SimOutputs outputs;
+  HostGame host;
+  host.begin(capturePath ? (Transport*)&hostCapture : &hostRadio, &clock, &outputs);
+
+  // Sticks with their own crystal offset and drift (±20 ms, ±40 ppm)
+  SimNodeClock* stickClocks[SIM_MAX_STICKS];
+  SimTransport* stickRadios[SIM_MAX_STICKS];
+  static JoystickGame sticks[SIM_MAX_STICKS];
+  static SimPlayer players[SIM_MAX_STICKS];
+
+  for (uint8_t i = 0; i < n; i++) {
+    uint8_t mac[6] = {0x02, 0x00, 0x00, 0x00, 0x01, (uint8_t)(i + 1)};
+    int32_t offsetUs = (i == 0) ? 12345 : (i == 1) ? -7000 : (int32_t)(i * 7919 % 40000) - 20000;
+    int32_t driftPpm = (i == 0) ? 35 : (i == 1) ? -20 : (int32_t)(i * 13 % 80) - 40;
+    stickClocks[i] = new SimNodeClock(&clock, offsetUs, driftPpm);
+    stickRadios[i] = new SimTransport(&net, mac);
+    players[i].game = &sticks[i];
+    players[i].clock = stickClocks[i];
+    sticks[i].begin(stickRadios[i], stickClocks[i], &players[i]);
+  }
+
+  // Restarted stick: ID before the restart and when the restart happened
+  const uint8_t rebootIdx = 1;
+  uint8_t rebootId = ID_NEW;
+  uint64_t rebootUs = 0;
+  uint32_t rejoins = 0;
+  uint32_t rejoinMaxUs = 0;
+
+  // Same seed, same draws: random scenarios are reproducible too
+  uint32_t rng = seed * 2654435761u + 1;
+  Scenario randomScenario = { "random", {}, {} };
+  const Scenario* current = &SCENARIOS[0];
+
+  uint32_t played = 0;
+  uint32_t failures = 0;
+  uint64_t ticks = 0;
+  uint64_t hostNs = 0;
+  uint64_t startVirtualUs = clock.nowUs64();
+  uint64_t startWall = wallNs();
+  GameState lastState = host.getState();
+
+  while (played < rounds) {
+    net.runUntil(clock.nowUs64() + tickUs);
+    for (uint8_t i = 0; i < n; i++) {
+      players[i].update();
+      sticks[i].update();
+    }
+    if (rebootId != ID_NEW && sticks[rebootIdx].isJoined()) {
+      uint32_t us = (uint32_t)(clock.nowUs64() - rebootUs);
+      if (us > rejoinMaxUs) rejoinMaxUs = us;
+      if (sticks[rebootIdx].getId() != rebootId) {
+        printf("round %u: stick %d rejoined as 0x%02X, was 0x%02X\n",
+               played, rebootIdx + 1, sticks[rebootIdx].getId(), rebootId);
+        failures++;
+      }
+      rejoins++;
+      rebootId = ID_NEW;
+    }
+
+    uint64_t t0 = wallNs();
+    host.update();
+    hostNs += wallNs() - t0;
+    ticks++;
+
+    GameState state = host.getState();
+    if (state == lastState) continue;
+
+    // New round: pick its scenario before GO
+    if (state == GAME_COUNTDOWN) {
+      if (randomMode) {
+        for (uint8_t i = 0; i < n; i++) {
+          rng ^= rng << 13;
+          rng ^= rng >> 17;
+          rng ^= rng << 5;
+          uint32_t r = rng % 100;
+          randomScenario.mode[i] = (r < 5) ? PRESS_EARLY : (r < 8) ? PRESS_NEVER : PRESS_AT;
+          randomScenario.reactMs[i] = 120 + (rng >> 8) % 300;
+        }
+        current = &randomScenario;
+      } else {
+        current = &SCENARIOS[played % NUM_SCENARIOS];
+      }
+      // Scenario slots are host player slots; join order picks the IDs
+      for (uint8_t i = 0; i < n; i++) {
+        uint8_t slot = (uint8_t)(sticks[i].getId() - ID_STICK1) % n;
+        players[i].mode = current->mode[slot];
+        players[i].reactMs = current->reactMs[slot];
+      }
+    }
+
+    // Power-cycle a stick between rounds
+    if (state == GAME_IDLE && rejoin && sticks[rebootIdx].isJoined()) {
+      rebootId = sticks[rebootIdx].getId();
+      rebootUs = clock.nowUs64();
+      sticks[rebootIdx].~JoystickGame();
+      new (&sticks[rebootIdx]) JoystickGame();
+      sticks[rebootIdx].begin(stickRadios[rebootIdx], stickClocks[rebootIdx], &players[rebootIdx]);
+    }
+
+    // Results were announced during GAME_RESULTS; players reset on IDLE entry
+    if (lastState == GAME_RESULTS) {
+      if (!checkRound(played, current, n, &host, &outputs)) failures++;
+      played++;
+    }
+    lastState = state;
+  }
+
+  uint64_t wall = wallNs() - startWall;
+
+  // Cost of the two clock reads around each host tick
+  uint64_t c0 = wallNs();
+  for (int i = 0; i < 100000; i++) {
+    wallNs();
+  }
+  double timerNs = (wallNs() - c0) / 100000.0;
+  double tickNs = ticks ? (double)hostNs / ticks - timerNs : 0.0;
+
+  double virtualS = (clock.nowUs64() - startVirtualUs) / 1e6;
+  const SimNetStats& ns = net.getStats();
+
+  printf("Rounds: %u played, %u failed (%s, %u sticks, seed %u, loss %u/1000, tick %u us)\n",
+         played, failures, randomMode ? "random" : "fixed cycle", stickCount, seed, lossPermille, tickUs);
+  printf("Virtual time: %.1f s, wall time: %.3f s, %.0f rounds/s\n",
+         virtualS, wall / 1e9, wall ? played * 1e9 / wall : 0.0);
+  printf("Host tick: %llu ticks, %.1f ns/tick (timer overhead %.1f ns removed)\n",
+         (unsigned long long)ticks, tickNs, timerNs);
+  printf("Network: %u sent, %u delivered, %u lost, %u overflows\n",
+         ns.sent, ns.delivered, ns.lost, ns.overflows);
+  printf("Outputs: %u sounds, %u LED updates\n", outputs.sounds, outputs.ledUpdates);
+  if (rejoin) {
+    printf("Rejoin: %u restarts, slowest %u us\n", rejoins, rejoinMaxUs);
+  }
+  logEnabled() = true;
+  host.logTelemetry();
+  if (capturePath) {
+    FILE* f = fopen(capturePath, "w");
+    if (!f) {
+      perror(capturePath);
+      return 2;
+    }
+    uint32_t n = capture.dump(writeCaptureLine, f);
+    fclose(f);
+    printf("Capture: %u records (%u overwritten) in %s\n", n, capture.overwrittenCount(), capturePath);
+  }
+
+  return failures ? 1 : 0;
+}
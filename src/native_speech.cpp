@@ -0,0 +1,572 @@
+/*
+ * native_speech.cpp - Number Announcer Test
+ *
+ * Phrase builder (NumberSpeech.h): numbers spelled as said, checked
+ * against their text, from 0 to 65535; player and unit words; truncation
+ * past SPEECH_MAX_WORDS. Voice: which words the sound bank (AudioDefs.h)
+ * has clips for, and that a complete clip set (the names of the word
+ * table) maps every phrase, with one/two/three standing in for num_1 -
+ * num_3.
+ *
+ * Scheduling: phrases queued as AudioManager::announce() queues them (low
+ * priority, deadline on the first word, one phrase ID) through the host's
+ * AudioSequencer and AudioPump into a virtual I2S DMA on a virtual clock,
+ * with the decoder costs of native_audio (--open-us, --start-us,
+ * --decode-ns). Each word is a tone at its own level, so the DAC trace
+ * tells which word played when. Checked per scenario: the words heard, in
+ * order, with no silence between them; the fanfare queued right behind
+ * the longest phrase, as onWinner() does, still played; a countdown cue
+ * or the next
+ * round's prompt cutting the phrase, with no word of it after them; a
+ * phrase that cannot start by its deadline or find room in the queue
+ * not played at all; a phrase queued with nothing playing heard within
+ * the first word's open, start and one block. Reported: phrase start
+ * latency as the sequencer logs it (AUDIO_PHRASE_STATS, taken when the
+ * refill pass starts, so without that pass's open and start) and as the
+ * DAC plays it, from flash and with the first word cached. Exits 1 on
+ * any failure.
+ *
+ * Usage: native_speech [--open-us US] [--start-us US] [--decode-ns NS]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+#include "AudioDefs.h"
+#include "AudioEngine.h"
+#include "NumberSpeech.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define DMA_FRAMES        (8 * AUDIO_BLOCK_FRAMES)    // AUDIO_DMA_BUFFERS × AUDIO_DMA_FRAMES
+#define TASK_WAIT_US      2000                        // AUDIO_TASK_WAIT_MS
+#define TONE_STEP         800                         // Tone level: (sound + 1) × step
+#define DEADLINE_MS       1000                        // AUDIO_ANNOUNCE_DEADLINE_MS
+#define CUE_DEADLINE_MS   250                         // AUDIO_CUE_DEADLINE_MS
+#define MAX_PLAYED        24
+
+// Clips besides the words
+enum {
+  S_CUE = SPEECH_WORDS,   // Countdown "three", cached
+  S_PROMPT,               // Next round's "get ready"
+  S_PROMPT2,              // "press to join"
+  S_FANFARE,
+  S_CLIPS
+};
+
+static uint64_t clockUs;
+static uint32_t openUs = 12000;
+static uint32_t startUs = 6000;
+static uint32_t decodeNs = 2000;
+
+typedef struct {
+  uint32_t frames;
+  bool cached;
+} ClipSpec;
+
+static ClipSpec specs[S_CLIPS];
+
+static int16_t toneOf(uint8_t sound) { return (int16_t)((sound + 1) * TONE_STEP); }
+static int soundOf(int16_t s) { return (s < 0 ? -s : s) / TONE_STEP - 1; }
+
+static const char* clipName(uint8_t sound) {
+  if (sound < SPEECH_WORDS) return SPEECH_TABLE[sound].text;
+  static const char* const others[] = { "three (cue)", "get ready", "press to join", "fanfare" };
+  return sound < S_CLIPS ? others[sound - S_CUE] : "?";
+}
+
+// Spoken words last about 60 ms per letter
+static void makeSpecs(bool firstCached) {
+  for (uint8_t w = 0; w < SPEECH_WORDS; w++) {
+    specs[w].frames = (150 + 60 * (uint32_t)strlen(SPEECH_TABLE[w].text)) * (AUDIO_RATE / 1000);
+    specs[w].cached = false;
+  }
+  for (uint8_t p = WORD_PLAYER_1; p <= WORD_PLAYER_4; p++) specs[p].cached = firstCached;
+  specs[S_CUE] = { 400 * (AUDIO_RATE / 1000), true };
+  specs[S_PROMPT] = { 900 * (AUDIO_RATE / 1000), false };
+  specs[S_PROMPT2] = { 1200 * (AUDIO_RATE / 1000), false };
+  specs[S_FANFARE] = { 3000 * (AUDIO_RATE / 1000), false };
+}
+
+// =============================================================================
+// FAKE DECODER AND SOURCE
+// =============================================================================
+class ToneDecoder : public AudioDecoder {
+public:
+  ToneDecoder() : spec(nullptr), started(false), pos(0), level(0) {}
+
+  bool open(uint8_t sound) override {
+    spec = &specs[sound];
+    if (!spec->cached) clockUs += openUs;
+    level = toneOf(sound);
+    started = false;
+    pos = 0;
+    return true;
+  }
+
+  uint32_t read(int16_t* out, uint32_t frames) override {
+    if (!started && !spec->cached) clockUs += startUs;
+    started = true;
+    uint32_t n = spec->frames - pos;
+    if (n > frames) n = frames;
+    for (uint32_t i = 0; i < n; i++, pos++) out[i] = (pos & 16) ? level : -level;
+    if (!spec->cached) clockUs += (uint64_t)n * decodeNs / 1000;
+    return n;
+  }
+
+  void close() override {}
+
+private:
+  const ClipSpec* spec;
+  bool started;
+  uint32_t pos;
+  int16_t level;
+};
+
+class ToneSource : public AudioSource {
+public:
+  ToneSource() { memset(busy, 0, sizeof(busy)); }
+
+  AudioDecoder* open(uint8_t sound) override {
+    if (sound >= S_CLIPS) return nullptr;
+    for (uint8_t i = 0; i < 2; i++) {
+      if (busy[i]) continue;
+      busy[i] = true;
+      decoders[i].open(sound);
+      return &decoders[i];
+    }
+    return nullptr;
+  }
+
+  void release(AudioDecoder* decoder) override {
+    for (uint8_t i = 0; i < 2; i++) {
+      if (decoder == &decoders[i]) busy[i] = false;
+    }
+  }
+
+  bool cached(uint8_t sound) const override { return sound < S_CLIPS && specs[sound].cached; }
+  const char* name(uint8_t sound) const override { return clipName(sound); }
+
+private:
+  ToneDecoder decoders[2];
+  bool busy[2];
+};
+
+// =============================================================================
+// VIRTUAL DMA
+// =============================================================================
+// AUDIO_RATE frames per second of the virtual clock, zeros when empty
+class VirtualDma : public AudioSink {
+public:
+  VirtualDma() : originUs(0), played(0), running(false) {}
+
+  void advance(uint64_t nowUs) {
+    if (!running) return;
+    uint64_t due = (nowUs - originUs) * AUDIO_RATE / 1000000;
+    while (played < due) {
+      played++;
+      if (queue.empty()) {
+        dac.push_back(0);
+        continue;
+      }
+      dac.push_back(queue.front());
+      queue.pop_front();
+    }
+  }
+
+  uint32_t write(const int16_t* frames, uint32_t count) override {
+    if (!running) {
+      running = true;
+      originUs = clockUs;
+    }
+    advance(clockUs);
+    uint32_t n = DMA_FRAMES - (uint32_t)queue.size();
+    if (n > count) n = count;
+    for (uint32_t i = 0; i < n; i++) queue.push_back(frames[i]);
+    return n;
+  }
+
+  void flush() override {
+    for (int16_t& s : queue) s = 0;
+  }
+
+  void drain() {
+    while (!queue.empty()) {
+      dac.push_back(queue.front());
+      queue.pop_front();
+    }
+  }
+
+  std::vector<int16_t> dac;
+  uint64_t startUs() const { return originUs; }
+
+private:
+  std::deque<int16_t> queue;
+  uint64_t originUs;
+  uint64_t played;
+  bool running;
+};
+
+// =============================================================================
+// SCENARIOS
+// =============================================================================
+// A clip queued on its own at atMs
+typedef struct {
+  uint32_t atMs;
+  uint8_t sound;
+  uint8_t priority;
+  uint16_t deadlineMs;
+} ClipEvent;
+
+typedef enum {
+  EXPECT_WHOLE,           // Every word, then the events' clips
+  EXPECT_CUT,             // Some words, then the events' clips, no word after
+  EXPECT_NONE             // No word
+} Expect;
+
+typedef struct {
+  const char* name;
+  uint8_t player;
+  uint16_t number;
+  uint32_t phraseAtMs;
+  const ClipEvent* events;
+  uint8_t eventCount;
+  Expect expect;
+  uint32_t cut;           // AudioPhraseStats.cut expected
+} Scenario;
+
+// One clip as the DAC played it
+typedef struct {
+  uint8_t sound;
+  uint32_t startUs;
+  uint32_t frames;
+  uint32_t silenceBefore; // Zeros since the previous clip
+} Played;
+
+typedef struct {
+  Played played[MAX_PLAYED];
+  uint8_t count;
+  AudioPhraseStats phrase;
+  bool refused;
+  uint8_t rejected;       // Event clips the queue refused
+} RunResult;
+
+// AudioManager::say()
+static bool say(AudioSequencer* seq, AudioPump* pump, VirtualDma* dma, const uint8_t* sounds,
+                uint8_t words, uint32_t atUs, uint8_t id) {
+  if (seq->room() < words) return false;
+  uint32_t deadline = (atUs + DEADLINE_MS * 1000) | 1;
+  for (uint8_t i = 0; i < words; i++) {
+    AudioQueueEntry e = { sounds[i], AUDIO_PRIO_LOW, atUs, i ? 0 : deadline, id };
+    pump->queue(seq, dma, e);
+  }
+  return true;
+}
+
+static void run(const Scenario& sc, const uint8_t* sounds, uint8_t words, RunResult* r) {
+  ToneSource source;
+  AudioSequencer seq(&source);
+  AudioPump pump;
+  VirtualDma dma;
+
+  memset(r, 0, sizeof(*r));
+  clockUs = 0;
+  uint8_t e = 0;
+  bool said = false;
+  for (;;) {
+    dma.advance(clockUs);
+    // At the same instant the phrase goes first, as onWinner() queues it
+    // before the fanfare
+    for (; e < sc.eventCount && (uint64_t)sc.events[e].atMs * 1000 <= clockUs; e++) {
+      const ClipEvent& ev = sc.events[e];
+      if (!said && ev.atMs >= sc.phraseAtMs) break;
+      uint32_t at = ev.atMs * 1000;
+      AudioQueueEntry entry = { ev.sound, ev.priority, at, ev.deadlineMs ? (at + ev.deadlineMs * 1000) | 1 : 0, 0 };
+      r->rejected += pump.queue(&seq, &dma, entry) == AUDIO_PUSH_DROPPED;
+    }
+    if (!said && (uint64_t)sc.phraseAtMs * 1000 <= clockUs) {
+      said = true;
+      r->refused = !say(&seq, &pump, &dma, sounds, words, sc.phraseAtMs * 1000, 1);
+      continue;
+    }
+    bool more = pump.run(&seq, &dma, (uint32_t)clockUs);
+    if (!more && !seq.busy() && e == sc.eventCount && said) break;
+
+    uint64_t wake = clockUs + TASK_WAIT_US;
+    uint64_t next = said ? UINT64_MAX : (uint64_t)sc.phraseAtMs * 1000;
+    if (e < sc.eventCount && (uint64_t)sc.events[e].atMs * 1000 < next) next = (uint64_t)sc.events[e].atMs * 1000;
+    if (next < wake) wake = next > clockUs ? next : clockUs;
+    clockUs = wake;
+  }
+  dma.drain();
+  r->phrase = seq.getPhraseStats();
+
+  // A clip starts where the level changes to another sound's
+  uint32_t zeros = 0;
+  const std::vector<int16_t>& d = dma.dac;
+  for (size_t i = 0; i < d.size(); i++) {
+    if (d[i] == 0) {
+      zeros++;
+      continue;
+    }
+    int sound = soundOf(d[i]);
+    if (r->count && r->played[r->count - 1].sound == sound && !zeros) {
+      r->played[r->count - 1].frames++;
+      continue;
+    }
+    if (r->count && r->played[r->count - 1].sound == sound) {
+      r->played[r->count - 1].frames += zeros + 1;    // Silence inside a clip: none here
+      zeros = 0;
+      continue;
+    }
+    if (r->count == MAX_PLAYED) break;
+    Played* p = &r->played[r->count++];
+    p->sound = (uint8_t)sound;
+    p->startUs = (uint32_t)(dma.startUs() + ((uint64_t)i * 1000000 + AUDIO_RATE - 1) / AUDIO_RATE);
+    p->frames = 1;
+    p->silenceBefore = r->count > 1 ? zeros : 0;
+    zeros = 0;
+  }
+}
+
+// First word of a phrase queued with nothing playing, to the DAC: the
+// first word's open, start and first block, then that block's time in
+// the DMA
+static uint32_t startBoundUs(bool cached) {
+  uint32_t us = (uint32_t)((uint64_t)AUDIO_BLOCK_FRAMES * 1000000 / AUDIO_RATE) + 1;
+  return cached ? us : us + openUs + startUs + AUDIO_BLOCK_FRAMES * decodeNs / 1000;
+}
+
+// Prints what played; false if it is not what the scenario expects
+static bool runScenario(const Scenario& sc, const SpeechVoice& voice) {
+  SpeechPhrase phrase;
+  phrase.player(sc.player);
+  phrase.number(sc.number);
+  phrase.add(WORD_MILLISECONDS);
+  uint8_t sounds[SPEECH_MAX_WORDS];
+  int words = voice.toSounds(phrase, sounds);
+  char text[128];
+  phrase.text(text, sizeof(text));
+  printf("%s: \"%s\" at %u ms\n", sc.name, text, sc.phraseAtMs);
+  if (words <= 0) {
+    printf("    FAIL: phrase has no clips\n");
+    return false;
+  }
+
+  RunResult r;
+  run(sc, sounds, (uint8_t)words, &r);
+  bool ok = true;
+  uint32_t queuedUs = sc.phraseAtMs * 1000;
+  uint8_t heard = 0;            // Words of the phrase, in order from the first
+  bool after = false;           // Another clip played since
+  uint8_t others = 0;           // Event clips played
+  for (uint8_t i = 0; i < r.count; i++) {
+    const Played& p = r.played[i];
+    bool word = heard < words && p.sound == sounds[heard] && !after;
+    if (word) {
+      heard++;
+    } else if (p.sound < SPEECH_WORDS) {
+      ok = false;               // A word out of order or after the cut
+    } else {
+      after = true;
+      others++;
+    }
+    bool gap = word && heard > 1 && p.silenceBefore;
+    if (gap) ok = false;
+    printf("    %-14s starts %8.1f ms  played %5.0f of %5.0f ms  silence before %4u frames%s%s\n",
+           clipName(p.sound), p.startUs / 1000.0, p.frames * 1000.0 / AUDIO_RATE,
+           specs[p.sound].frames * 1000.0 / AUDIO_RATE, p.silenceBefore,
+           word && heard == 1 ? "  <- phrase" : "", gap ? "  FAIL: gap" : "");
+    if (word && heard == 1) {
+      uint32_t us = p.startUs - queuedUs;
+      bool slow = sc.phraseAtMs == 0 && us > startBoundUs(specs[p.sound].cached);
+      if (slow) ok = false;
+      printf("    phrase start: logged %.1f ms, heard %.1f ms%s\n", r.phrase.minUs / 1000.0,
+             us / 1000.0, slow ? "  FAIL: over the bound" : "");
+    }
+  }
+  if (r.refused) printf("    refused: no room in the queue\n");
+  if (r.rejected) printf("    %u clips refused by the queue\n", r.rejected);
+  printf("    phrases: %u started, %u cut\n", r.phrase.started, r.phrase.cut);
+
+  switch (sc.expect) {
+    case EXPECT_WHOLE: ok = ok && heard == words; break;
+    case EXPECT_CUT:   ok = ok && heard > 0 && heard < words && after; break;
+    case EXPECT_NONE:  ok = ok && heard == 0; break;
+  }
+  if (r.phrase.cut != sc.cut) ok = false;
+  if (sc.expect != EXPECT_NONE && (others != sc.eventCount || r.rejected)) ok = false;
+  if (!ok) printf("    FAIL: expected %s, %u cut\n",
+                  sc.expect == EXPECT_WHOLE ? "every word" :
+                  (sc.expect == EXPECT_CUT ? "the phrase cut" : "no word"), sc.cut);
+  return ok;
+}
+
+static bool runScheduling(const SpeechVoice& voice) {
+  static const ClipEvent countdown[] = { { 700, S_CUE, AUDIO_PRIO_CUE, CUE_DEADLINE_MS } };
+  static const ClipEvent nextRound[] = { { 1200, S_PROMPT, AUDIO_PRIO_NORMAL, 0 } };
+  static const ClipEvent fanfareAfter[] = { { 0, S_FANFARE, AUDIO_PRIO_LOW, 0 } };
+  static const ClipEvent fanfareFirst[] = { { 0, S_FANFARE, AUDIO_PRIO_LOW, 0 } };
+  // Fills AUDIO_QUEUE_SIZE
+  static const ClipEvent busy[] = {
+    { 0, S_PROMPT, AUDIO_PRIO_NORMAL, 0 }, { 0, S_PROMPT2, AUDIO_PRIO_NORMAL, 0 },
+    { 0, S_PROMPT, AUDIO_PRIO_NORMAL, 0 }, { 0, S_PROMPT2, AUDIO_PRIO_NORMAL, 0 },
+    { 0, S_PROMPT, AUDIO_PRIO_NORMAL, 0 }, { 0, S_PROMPT2, AUDIO_PRIO_NORMAL, 0 },
+    { 0, S_PROMPT, AUDIO_PRIO_NORMAL, 0 }, { 0, S_PROMPT2, AUDIO_PRIO_NORMAL, 0 },
+    { 0, S_PROMPT, AUDIO_PRIO_NORMAL, 0 }, { 0, S_PROMPT2, AUDIO_PRIO_NORMAL, 0 },
+    { 0, S_PROMPT, AUDIO_PRIO_NORMAL, 0 }, { 0, S_PROMPT2, AUDIO_PRIO_NORMAL, 0 },
+  };
+  static_assert(sizeof(busy) / sizeof(busy[0]) == AUDIO_QUEUE_SIZE, "busy must fill the queue");
+
+#define EVENTS(a) a, (uint8_t)(sizeof(a) / sizeof(a[0]))
+  const Scenario scenarios[] = {
+    { "alone", 2, 234, 0, nullptr, 0, EXPECT_WHOLE, 0 },
+    { "longest phrase", 4, 65535, 0, nullptr, 0, EXPECT_WHOLE, 0 },
+    { "countdown starts over it", 1, 1234, 0, EVENTS(countdown), EXPECT_CUT, 1 },
+    { "next round's prompt", 3, 987, 0, EVENTS(nextRound), EXPECT_CUT, 1 },
+    { "then the fanfare (onWinner())", 2, 234, 0, EVENTS(fanfareAfter), EXPECT_WHOLE, 0 },
+    { "8 words, then the fanfare", 2, 1234, 0, EVENTS(fanfareAfter), EXPECT_WHOLE, 0 },
+    { "longest, then the fanfare", 4, 65535, 0, EVENTS(fanfareAfter), EXPECT_WHOLE, 0 },
+    { "behind a fanfare, past its deadline", 2, 234, 10, EVENTS(fanfareFirst), EXPECT_NONE, 1 },
+    { "queue too full for it", 2, 234, 10, EVENTS(busy), EXPECT_NONE, 0 },
+  };
+#undef EVENTS
+
+  bool ok = true;
+  for (uint8_t cached = 0; cached < 2; cached++) {
+    makeSpecs(cached);
+    printf("\nScheduling, first word %s (open %u us, start %u us, %u ns/frame):\n",
+           cached ? "cached" : "from flash", openUs, startUs, decodeNs);
+    for (const Scenario& sc : scenarios) ok = runScenario(sc, voice) && ok;
+  }
+  return ok;
+}
+
+// =============================================================================
+// PHRASE BUILDER
+// =============================================================================
+typedef struct {
+  uint16_t n;
+  const char* text;
+} NumberCase;
+
+static const NumberCase numbers[] = {
+  { 0, "zero" }, { 1, "one" }, { 7, "seven" }, { 10, "ten" }, { 13, "thirteen" },
+  { 19, "nineteen" }, { 20, "twenty" }, { 21, "twenty one" }, { 40, "forty" },
+  { 99, "ninety nine" }, { 100, "one hundred" }, { 101, "one hundred one" },
+  { 110, "one hundred ten" }, { 234, "two hundred thirty four" },
+  { 999, "nine hundred ninety nine" }, { 1000, "one thousand" },
+  { 1005, "one thousand five" }, { 2019, "two thousand nineteen" },
+  { 12345, "twelve thousand three hundred forty five" },
+  { 65534, "sixty five thousand five hundred thirty four" },
+};
+
+static bool checkBuilder() {
+  bool ok = true;
+  char text[128];
+  printf("Phrase builder:\n");
+  for (const NumberCase& c : numbers) {
+    SpeechPhrase p;
+    p.number(c.n);
+    p.text(text, sizeof(text));
+    bool match = !strcmp(text, c.text) && !p.truncated();
+    printf("  %5u  %-48s%s\n", c.n, text, match ? "" : "  FAIL");
+    if (!match) ok = false;
+  }
+
+  // Every value fits, with a player and a unit
+  uint8_t most = 0;
+  for (uint32_t n = 0; n <= 65535; n++) {
+    SpeechPhrase p;
+    p.player(4);
+    p.number((uint16_t)n);
+    p.add(WORD_MILLISECONDS);
+    if (p.truncated() || p.word(p.size() - 1) != WORD_MILLISECONDS) {
+      printf("  FAIL: %u does not fit\n", n);
+      ok = false;
+      break;
+    }
+    if (p.size() > most) most = p.size();
+  }
+  printf("  0 - 65535 with player and unit: at most %u words (SPEECH_MAX_WORDS %u)\n", most,
+         SPEECH_MAX_WORDS);
+
+  SpeechPhrase p;
+  p.player(2);
+  p.number(234);
+  p.add(WORD_MILLISECONDS);
+  p.text(text, sizeof(text));
+  bool phrase = !strcmp(text, "player two two hundred thirty four milliseconds");
+  printf("  player 2, 234 ms: %s%s\n", text, phrase ? "" : "  FAIL");
+  for (uint8_t i = 0; i < SPEECH_MAX_WORDS; i++) p.add(WORD_POINTS);
+  bool truncated = p.truncated() && p.size() == SPEECH_MAX_WORDS;
+  printf("  past %u words: %s\n", SPEECH_MAX_WORDS, truncated ? "truncated" : "FAIL: not flagged");
+  p.player(5);
+  bool badPlayer = p.size() == SPEECH_MAX_WORDS;
+  return ok && phrase && truncated && badPlayer;
+}
+
+// =============================================================================
+// VOICE
+// =============================================================================
+static const char* bankName(uint8_t sound) { return SOUND_BANK[sound].name; }
+
+// Every word's clip, except the three the countdown stands in for
+static const char* fullName(uint8_t sound) {
+  static const char* const aliases[] = { "one", "two", "three" };
+  if (sound >= 1 && sound <= 3) return aliases[sound - 1];
+  return SPEECH_TABLE[sound].clip;
+}
+
+static bool checkVoice(SpeechVoice* full) {
+  SpeechVoice bank;
+  uint8_t have = bank.begin(bankName, NUM_SOUNDS);
+  printf("\nThis sound bank: %u of %u words recorded\n  missing:", have, SPEECH_WORDS);
+  for (uint8_t w = 0; w < SPEECH_WORDS; w++) {
+    if (bank.soundOf(w) == SPEECH_NONE) printf(" %s", SPEECH_TABLE[w].clip);
+  }
+  printf("\n");
+
+  bool ok = full->begin(fullName, SPEECH_WORDS) == SPEECH_WORDS;
+  for (uint8_t w = 1; w <= 3; w++) ok = ok && full->soundOf(w) == w;
+  for (const NumberCase& c : numbers) {
+    SpeechPhrase p;
+    p.player(1);
+    p.number(c.n);
+    p.add(WORD_MILLISECONDS);
+    uint8_t sounds[SPEECH_MAX_WORDS];
+    ok = ok && full->toSounds(p, sounds) == p.size();
+    if (bank.toSounds(p, sounds) >= 0) printf("  speakable with this bank: %u\n", c.n);
+  }
+  printf("Complete clip set: %s\n", ok ? "every word and phrase mapped" : "FAIL");
+  return ok;
+}
+
+// =============================================================================
+// MAIN
+// =============================================================================
+int main(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--open-us") && i + 1 < argc) openUs = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--start-us") && i + 1 < argc) startUs = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--decode-ns") && i + 1 < argc) decodeNs = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: %s [--open-us US] [--start-us US] [--decode-ns NS]\n", argv[0]);
+      return 2;
+    }
+  }
+  logEnabled() = false;
+
+  printf("Number Announcer Test\n");
+  printf("=====================\n");
+  bool ok = checkBuilder();
+  SpeechVoice voice;
+  ok = checkVoice(&voice) && ok;
+  ok = runScheduling(voice) && ok;
+
+  printf("\n%s\n", ok ? "OK: phrases, gapless words, cut and dropped whole" : "FAIL");
+  return ok ? 0 : 1;
+}
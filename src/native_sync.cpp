@@ -0,0 +1,172 @@
+/*
+ * native_sync.cpp - Clock Sync Accuracy under Asymmetry, Jitter and Drift
+ *
+ * Synthetic NTP exchanges between a host clock and a node clock with its
+ * own offset and crystal drift, every SYNC_PERIOD_IDLE_MS for --seconds,
+ * starting just before the 32-bit micros() wrap. Each direction has its own
+ * base delay plus uniform jitter, and one exchange in ten queues for up to
+ * five times the jitter on one leg.
+ *
+ * After a warm-up of ten drift spans (the drift estimate converges by a
+ * quarter per span), every exchange checks:
+ * - host: SyncEstimator::offsetAt() against the true offset
+ * - node: a SyncedClock fed through CMD_SYNC_REQ, converting a host
+ *   instant one sync period ahead (the latest a GO can use it)
+ * The error must stay within half the path asymmetry (which no two-way
+ * exchange can see), plus half the jitter, plus the drift error that jitter
+ * on two anchors a drift span apart makes over the oldest anchor's age and
+ * one period, plus SYNC_DRIFT_SLACK_US.
+ *
+ * Usage: native_sync [--seconds 600] [--seed N]
+ * Exits 1 if a case leaves its bound
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ClockSync.h"
+
+#define SYNC_TURNAROUND_US  200       // Node receive to response
+#define SYNC_WARMUP_US      (10 * SYNC_DRIFT_SPAN_US)
+#define SYNC_DRIFT_SLACK_US 40        // Drift estimate residual over a period
+#define SYNC_START_US       4294000000ULL
+
+typedef struct {
+  const char* name;
+  int32_t offsetUs;     // Node minus host at the start
+  int32_t driftPpm;     // Node crystal error
+  uint32_t upUs;        // Host to node base delay
+  uint32_t downUs;      // Node to host base delay
+  uint32_t jitterUs;    // Uniform extra per leg
+} SyncCase;
+
+static const SyncCase CASES[] = {
+  { "symmetric",          123456,    0, 1000, 1000,    0 },
+  { "drift +100 ppm",     -50000,  100, 1000, 1000,    0 },
+  { "drift -150 ppm",    7000000, -150, 1000, 1000,    0 },
+  { "asymmetric",          98765,    0, 1800,  600,    0 },
+  { "jitter",              -4321,    0, 1000, 1000, 1500 },
+  { "asym+jitter+drift",  250000,   80,  700, 1900, 1200 },
+  { "asym+jitter-drift",      -1,  -60, 2500,  900,  800 },
+};
+#define NUM_CASES (sizeof(CASES) / sizeof(CASES[0]))
+
+// =============================================================================
+// HELPERS
+// =============================================================================
+static uint32_t rng = 1;
+
+static uint32_t nextRandom() {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+// Node clock at a host instant (64-bit host time since SYNC_START_US)
+static int64_t nodeAt(const SyncCase* c, uint64_t hostUs) {
+  int64_t elapsed = (int64_t)(hostUs - SYNC_START_US);
+  return (int64_t)hostUs + c->offsetUs + elapsed * c->driftPpm / 1000000;
+}
+
+static uint32_t legDelay(uint32_t base, uint32_t jitter, bool queued) {
+  if (!jitter) return base;
+  uint32_t extra = nextRandom() % (jitter + 1);
+  if (queued) extra += nextRandom() % (4 * jitter + 1);
+  return base + extra;
+}
+
+static int32_t absErr(int32_t e) { return e < 0 ? -e : e; }
+
+// =============================================================================
+// ONE CASE
+// =============================================================================
+typedef struct {
+  int32_t hostMaxErr;
+  int32_t nodeMaxErr;
+  int32_t bound;
+  int32_t driftPpb;
+} CaseResult;
+
+static CaseResult runCase(const SyncCase* c, uint32_t seconds) {
+  CaseResult r;
+  memset(&r, 0, sizeof(r));
+  int32_t asym = (int32_t)c->upUs - (int32_t)c->downUs;
+  uint64_t periodUs = (uint64_t)SYNC_PERIOD_IDLE_MS * 1000;
+  uint64_t horizonUs = (SYNC_WINDOW + 1) * periodUs;
+  r.bound = absErr(asym) / 2 + (int32_t)c->jitterUs / 2 +
+            (int32_t)(c->jitterUs * horizonUs / SYNC_DRIFT_SPAN_US) + SYNC_DRIFT_SLACK_US;
+
+  SyncEstimator est;
+  SyncedClock node;
+  uint64_t endUs = SYNC_START_US + (uint64_t)seconds * 1000000;
+
+  for (uint64_t h = SYNC_START_US; h < endUs; h += periodUs) {
+    // The request carries the estimate so far, as HostGame sends it
+    uint32_t t1 = (uint32_t)h;
+    GameFrame frame;
+    frameBegin(&frame, 1, ID_HOST);
+    frameAddSyncRequest(&frame, t1, &est);
+    uint8_t len = frameFinish(&frame);
+    FrameReader reader;
+    FrameRecord rec;
+    if (frameOpen(&reader, frame.buf, len) && frameNext(&reader, &rec)) node.update(&rec);
+
+    bool queued = (nextRandom() % 10) == 0;
+    bool queuedUp = queued && (nextRandom() & 1);
+    uint64_t atNode = h + legDelay(c->upUs, c->jitterUs, queuedUp);
+    uint64_t sendBack = atNode + SYNC_TURNAROUND_US;
+    uint64_t back = sendBack + legDelay(c->downUs, c->jitterUs, queued && !queuedUp);
+    uint32_t t2 = (uint32_t)nodeAt(c, atNode);
+    uint32_t t3 = (uint32_t)nodeAt(c, sendBack);
+    est.addSample(t1, t2, t3, (uint32_t)back);
+
+    if (back - SYNC_START_US < SYNC_WARMUP_US) continue;
+
+    int32_t trueOffset = (int32_t)(nodeAt(c, back) - (int64_t)back);
+    int32_t hostErr = absErr(est.offsetAt((uint32_t)back) - trueOffset);
+    if (hostErr > r.hostMaxErr) r.hostMaxErr = hostErr;
+
+    uint64_t ahead = h + periodUs;
+    int32_t nodeErr = absErr((int32_t)(node.toLocal((uint32_t)ahead) - (uint32_t)nodeAt(c, ahead)));
+    if (nodeErr > r.nodeMaxErr) r.nodeMaxErr = nodeErr;
+  }
+  r.driftPpb = est.drift();
+  return r;
+}
+
+// =============================================================================
+// MAIN
+// =============================================================================
+int main(int argc, char** argv) {
+  uint32_t seconds = 600;
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* val = (i + 1 < argc) ? argv[i + 1] : "0";
+    if (!strcmp(arg, "--seconds"))   { seconds = strtoul(val, NULL, 0); i++; }
+    else if (!strcmp(arg, "--seed")) { rng = strtoul(val, NULL, 0); i++; }
+    else {
+      fprintf(stderr, "Unknown option %s\n", arg);
+      return 2;
+    }
+  }
+  if (!rng) rng = 1;
+  if (seconds * 1000000ULL <= SYNC_WARMUP_US) seconds = SYNC_WARMUP_US / 1000000 + 1;
+
+  printf("%u s of exchanges every %u ms, checked after %u s\n\n",
+         seconds, SYNC_PERIOD_IDLE_MS, SYNC_WARMUP_US / 1000000);
+  printf("%-20s %9s %9s %9s %11s %11s\n", "case", "host err", "node err", "bound", "drift ppb", "true ppb");
+
+  bool ok = true;
+  for (uint8_t i = 0; i < NUM_CASES; i++) {
+    const SyncCase* c = &CASES[i];
+    CaseResult r = runCase(c, seconds);
+    bool pass = r.hostMaxErr <= r.bound && r.nodeMaxErr <= r.bound;
+    printf("%-20s %9d %9d %9d %11d %11d%s\n", c->name, r.hostMaxErr, r.nodeMaxErr, r.bound,
+           r.driftPpb, c->driftPpm * 1000, pass ? "" : "  FAIL");
+    if (!pass) ok = false;
+  }
+
+  printf("\n%s\n", ok ? "OK" : "FAIL");
+  return ok ? 0 : 1;
+}